@@ -0,0 +1,276 @@
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "burstselector.h"
+#include "qtcamlumaplane.h"
+#include "qtcamsharpness.h"
+#include <QRunnable>
+#include <QImageReader>
+#include <QImage>
+#include <QFile>
+#include <QtAlgorithms>
+#include <QDebug>
+#include <cstring>
+#if defined(QT4)
+#include <QDeclarativeInfo>
+#elif defined(QT5)
+#include <QQmlInfo>
+#endif
+
+// Long side of the decoded images. JPEG decoders scale while decoding so this is cheap.
+#define SCORE_SIZE               640
+#define SHARPNESS_WEIGHT         0.75
+#define MID_GREY                 118
+
+class BurstSelectorJob : public QRunnable {
+public:
+  BurstSelectorJob(BurstSelector *selector, const QString& fileName) :
+    m_selector(selector),
+    m_fileName(fileName) {
+
+  }
+
+  void run() {
+    QImageReader reader(m_fileName);
+    QSize size = reader.size();
+
+    if (size.isValid()) {
+      reader.setScaledSize(size.scaled(SCORE_SIZE, SCORE_SIZE, Qt::KeepAspectRatio));
+    }
+
+    double sharpness = 0.0;
+    double exposure = 0.0;
+
+    QImage image = reader.read();
+    if (image.isNull()) {
+      qWarning() << "Failed to read" << m_fileName << reader.errorString();
+    }
+    else {
+      BurstSelector::measure(image, &sharpness, &exposure);
+    }
+
+    // The selector outlives us. Its pool is waited for in its destructor.
+    QMetaObject::invokeMethod(m_selector, "measured", Qt::QueuedConnection,
+			      Q_ARG(QString, m_fileName), Q_ARG(double, sharpness),
+			      Q_ARG(double, exposure));
+  }
+
+private:
+  BurstSelector *m_selector;
+  QString m_fileName;
+};
+
+class BurstSelectorScore {
+public:
+  QString fileName;
+  double score;
+
+  bool operator<(const BurstSelectorScore& other) const {
+    return score > other.score;
+  }
+};
+
+BurstSelector::BurstSelector(QObject *parent) :
+  QObject(parent),
+  m_keep(1),
+  m_discard(false),
+  m_ended(false),
+  m_pending(0) {
+
+}
+
+BurstSelector::~BurstSelector() {
+  m_pool.waitForDone();
+}
+
+int BurstSelector::keep() const {
+  return m_keep;
+}
+
+void BurstSelector::setKeep(int keep) {
+  if (m_keep != keep) {
+    m_keep = keep;
+    emit keepChanged();
+  }
+}
+
+bool BurstSelector::discard() const {
+  return m_discard;
+}
+
+void BurstSelector::setDiscard(bool discard) {
+  if (m_discard != discard) {
+    m_discard = discard;
+    emit discardChanged();
+  }
+}
+
+bool BurstSelector::isBusy() const {
+  return !m_files.isEmpty();
+}
+
+void BurstSelector::begin() {
+  if (isBusy()) {
+    qmlInfo(this) << "A burst is already being scored";
+    return;
+  }
+
+  m_ended = false;
+  m_measurements.clear();
+}
+
+void BurstSelector::add(const QString& fileName) {
+  if (m_ended || m_files.contains(fileName)) {
+    return;
+  }
+
+  bool wasBusy = isBusy();
+
+  m_files << fileName;
+  ++m_pending;
+  m_pool.start(new BurstSelectorJob(this, fileName));
+
+  if (!wasBusy) {
+    emit busyChanged();
+  }
+}
+
+void BurstSelector::end() {
+  m_ended = true;
+
+  if (m_pending == 0) {
+    select();
+  }
+}
+
+void BurstSelector::measured(const QString& fileName, double sharpness, double exposure) {
+  Measurement m;
+  m.sharpness = sharpness;
+  m.exposure = exposure;
+  m_measurements.insert(fileName, m);
+
+  --m_pending;
+
+  if (m_ended && m_pending == 0) {
+    select();
+  }
+}
+
+void BurstSelector::select() {
+  if (m_files.isEmpty()) {
+    emit finished(QStringList(), QStringList());
+    return;
+  }
+
+  // Sharpness has no absolute scale so it is relative to the best frame of the burst.
+  double maxSharpness = 0.0;
+  foreach (const Measurement& m, m_measurements) {
+    maxSharpness = qMax(maxSharpness, m.sharpness);
+  }
+
+  QList<BurstSelectorScore> scores;
+
+  foreach (const QString& fileName, m_files) {
+    const Measurement m = m_measurements[fileName];
+
+    BurstSelectorScore s;
+    s.fileName = fileName;
+    s.score = (maxSharpness > 0.0 ? SHARPNESS_WEIGHT * m.sharpness / maxSharpness : 0.0) +
+      (1.0 - SHARPNESS_WEIGHT) * m.exposure;
+    scores << s;
+
+    emit scored(fileName, s.score);
+  }
+
+  qStableSort(scores);
+
+  QStringList kept;
+  QStringList rejected;
+
+  for (int x = 0; x < scores.size(); x++) {
+    const QString& fileName = scores[x].fileName;
+
+    if (m_keep <= 0 || x < m_keep) {
+      kept << fileName;
+      continue;
+    }
+
+    rejected << fileName;
+
+    if (m_discard) {
+      if (QFile::remove(fileName)) {
+	emit removed(fileName);
+      }
+      else {
+	qmlInfo(this) << "Failed to remove" << fileName;
+      }
+    }
+  }
+
+  m_files.clear();
+  m_measurements.clear();
+  m_ended = false;
+
+  emit busyChanged();
+  emit finished(kept, rejected);
+}
+
+bool BurstSelector::measure(const QImage& image, double *sharpness, double *exposure) {
+  if (image.width() < 2 || image.height() < 2) {
+    return false;
+  }
+
+  QImage rgb = image.convertToFormat(QImage::Format_RGB32);
+
+  QtCamLumaPlane plane;
+  plane.resize(rgb.width(), rgb.height(), rgb.size(), 1);
+
+  quint32 histogram[256];
+  memset(histogram, 0x0, sizeof(histogram));
+
+  quint64 total = 0;
+
+  for (int y = 0; y < rgb.height(); y++) {
+    const QRgb *in = (const QRgb *)rgb.constScanLine(y);
+    uchar *out = plane.bits() + y * plane.width();
+
+    for (int x = 0; x < rgb.width(); x++) {
+      QRgb p = in[x];
+      int l = (77 * qRed(p) + 150 * qGreen(p) + 29 * qBlue(p)) >> 8;
+      out[x] = l;
+      ++histogram[l];
+      total += l;
+    }
+  }
+
+  int pixels = plane.width() * plane.height();
+
+  quint32 clipped = histogram[0] + histogram[1] + histogram[2] +
+    histogram[253] + histogram[254] + histogram[255];
+
+  double mean = (double)total / pixels;
+
+  *sharpness = QtCamSharpness::measure(plane);
+  *exposure = qMax(0.0, 1.0 - 2.0 * clipped / pixels) *
+    (1.0 - qAbs(mean - MID_GREY) / 255.0);
+
+  return true;
+}
@@ -0,0 +1,93 @@
+// -*- c++ -*-
+
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef BURST_SELECTOR_H
+#define BURST_SELECTOR_H
+
+#include <QObject>
+#include <QStringList>
+#include <QHash>
+#include <QThreadPool>
+
+class QImage;
+
+// Scores the images of a burst for sharpness and exposure and picks the best ones.
+// Scoring happens on a thread pool from downscaled decodes of the saved files.
+class BurstSelector : public QObject {
+  Q_OBJECT
+
+  Q_PROPERTY(int keep READ keep WRITE setKeep NOTIFY keepChanged);
+  Q_PROPERTY(bool discard READ discard WRITE setDiscard NOTIFY discardChanged);
+  Q_PROPERTY(bool busy READ isBusy NOTIFY busyChanged);
+
+public:
+  BurstSelector(QObject *parent = 0);
+  ~BurstSelector();
+
+  int keep() const;
+  void setKeep(int keep);
+
+  // Remove the rejected files from disk.
+  bool discard() const;
+  void setDiscard(bool discard);
+
+  bool isBusy() const;
+
+  Q_INVOKABLE void begin();
+  Q_INVOKABLE void add(const QString& fileName);
+  // No more images will be added. finished() follows once all are scored.
+  Q_INVOKABLE void end();
+
+  static bool measure(const QImage& image, double *sharpness, double *exposure);
+
+signals:
+  void keepChanged();
+  void discardChanged();
+  void busyChanged();
+
+  // score is between 0 and 1. Only meaningful within the same burst.
+  void scored(const QString& fileName, qreal score);
+  void removed(const QString& fileName);
+  void finished(const QStringList& kept, const QStringList& rejected);
+
+private slots:
+  void measured(const QString& fileName, double sharpness, double exposure);
+
+private:
+  class Measurement {
+  public:
+    double sharpness;
+    double exposure;
+  };
+
+  void select();
+
+  int m_keep;
+  bool m_discard;
+  bool m_ended;
+  int m_pending;
+  QStringList m_files;
+  QHash<QString, Measurement> m_measurements;
+  QThreadPool m_pool;
+};
+
+#endif /* BURST_SELECTOR_H */
@@ -26,7 +26,9 @@ HEADERS += plugin.h previewprovider.h camera.h mode.h imagemode.h videomode.h \
            notificationscontainer.h sounds.h focus.h autofocus.h \
            roi.h cameraconfig.h videoplayer.h viewfinder.h capability.h \
            resolution.h viewfinderbufferhandler.h viewfinderframehandler.h \
-           viewfinderhandler.h
+           viewfinderhandler.h histogram.h focusassist.h \
+           burstselector.h motiondetector.h panorama.h \
+           exposurefusion.h nightstacker.h timelapse.h imagerotator.h
 
 SOURCES += plugin.cpp previewprovider.cpp camera.cpp mode.cpp imagemode.cpp videomode.cpp \
            zoom.cpp flash.cpp scene.cpp evcomp.cpp videotorch.cpp whitebalance.cpp \
@@ -36,7 +38,9 @@ SOURCES += plugin.cpp previewprovider.cpp camera.cpp mode.cpp imagemode.cpp vide
            notificationscontainer.cpp sounds.cpp focus.cpp autofocus.cpp \
            roi.cpp cameraconfig.cpp videoplayer.cpp viewfinder.cpp capability.cpp \
            resolution.cpp viewfinderbufferhandler.cpp viewfinderframehandler.cpp \
-           viewfinderhandler.cpp
+           viewfinderhandler.cpp histogram.cpp focusassist.cpp \
+           burstselector.cpp motiondetector.cpp panorama.cpp \
+           exposurefusion.cpp nightstacker.cpp timelapse.cpp imagerotator.cpp
 
 PLUGIN_IMPORT_PATH = QtCamera
 target.path = $$[QT_INSTALL_IMPORTS]/$$PLUGIN_IMPORT_PATH
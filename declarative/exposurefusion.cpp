@@ -0,0 +1,131 @@
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "exposurefusion.h"
+#include "qtcamexposurefusion.h"
+#include <QFile>
+
+ExposureFusion::ExposureFusion(QObject *parent) :
+  QObject(parent),
+  m_fusion(new QtCamExposureFusion(this)),
+  m_progress(0),
+  m_busy(false),
+  m_discard(true) {
+
+  // All emitted from the worker thread.
+  QObject::connect(m_fusion, SIGNAL(progress(qreal)),
+		   this, SLOT(fusionProgress(qreal)), Qt::QueuedConnection);
+  QObject::connect(m_fusion, SIGNAL(finished(const QString&)),
+		   this, SLOT(fusionFinished(const QString&)), Qt::QueuedConnection);
+  QObject::connect(m_fusion, SIGNAL(failed()),
+		   this, SLOT(fusionFailed()), Qt::QueuedConnection);
+}
+
+ExposureFusion::~ExposureFusion() {
+  m_fusion->cancel();
+  m_fusion->wait();
+}
+
+bool ExposureFusion::isBusy() const {
+  return m_busy;
+}
+
+qreal ExposureFusion::progress() const {
+  return m_progress;
+}
+
+bool ExposureFusion::discard() const {
+  return m_discard;
+}
+
+void ExposureFusion::setDiscard(bool discard) {
+  if (m_discard != discard) {
+    m_discard = discard;
+    emit discardChanged();
+  }
+}
+
+qreal ExposureFusion::msecsPerMegapixel() const {
+  return m_fusion->msecsPerMegapixel();
+}
+
+bool ExposureFusion::merge(const QStringList& fileNames, const QString& fileName) {
+  if (m_busy) {
+    return false;
+  }
+
+  if (!m_fusion->merge(fileNames, fileName)) {
+    return false;
+  }
+
+  m_frames = fileNames;
+  m_busy = true;
+  m_progress = 0;
+
+  emit busyChanged();
+  emit progressChanged();
+
+  return true;
+}
+
+void ExposureFusion::cancel() {
+  if (m_busy) {
+    // fusionFailed() will clean up.
+    m_fusion->cancel();
+  }
+}
+
+void ExposureFusion::fusionProgress(qreal progress) {
+  if (m_busy) {
+    m_progress = progress;
+    emit progressChanged();
+  }
+}
+
+void ExposureFusion::fusionFinished(const QString& fileName) {
+  m_busy = false;
+
+  if (m_discard) {
+    removeFrames();
+  }
+
+  m_frames.clear();
+
+  emit busyChanged();
+  emit merged(fileName);
+}
+
+void ExposureFusion::fusionFailed() {
+  // Keep the frames. They are better than nothing.
+  m_busy = false;
+  m_frames.clear();
+
+  emit busyChanged();
+  emit failed();
+}
+
+void ExposureFusion::removeFrames() {
+  foreach (const QString& fileName, m_frames) {
+    if (QFile::remove(fileName)) {
+      emit removed(fileName);
+    }
+  }
+}
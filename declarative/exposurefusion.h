@@ -0,0 +1,79 @@
+// -*- c++ -*-
+
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef EXPOSURE_FUSION_H
+#define EXPOSURE_FUSION_H
+
+#include <QObject>
+#include <QStringList>
+
+class QtCamExposureFusion;
+
+class ExposureFusion : public QObject {
+  Q_OBJECT
+
+  Q_PROPERTY(bool busy READ isBusy NOTIFY busyChanged);
+  Q_PROPERTY(qreal progress READ progress NOTIFY progressChanged);
+  Q_PROPERTY(bool discard READ discard WRITE setDiscard NOTIFY discardChanged);
+  Q_PROPERTY(qreal msecsPerMegapixel READ msecsPerMegapixel NOTIFY merged);
+
+public:
+  ExposureFusion(QObject *parent = 0);
+  ~ExposureFusion();
+
+  bool isBusy() const;
+  qreal progress() const;
+
+  // Remove the bracketed frames once merged.
+  bool discard() const;
+  void setDiscard(bool discard);
+
+  qreal msecsPerMegapixel() const;
+
+  // The frames are expected in exposure order. The middle one is the reference.
+  Q_INVOKABLE bool merge(const QStringList& fileNames, const QString& fileName);
+  Q_INVOKABLE void cancel();
+
+signals:
+  void busyChanged();
+  void progressChanged();
+  void discardChanged();
+  void merged(const QString& fileName);
+  void removed(const QString& fileName);
+  void failed();
+
+private slots:
+  void fusionProgress(qreal progress);
+  void fusionFinished(const QString& fileName);
+  void fusionFailed();
+
+private:
+  void removeFrames();
+
+  QtCamExposureFusion *m_fusion;
+  QStringList m_frames;
+  qreal m_progress;
+  bool m_busy;
+  bool m_discard;
+};
+
+#endif /* EXPOSURE_FUSION_H */
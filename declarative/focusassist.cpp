@@ -0,0 +1,232 @@
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "focusassist.h"
+#include "camera.h"
+#include "qtcamdevice.h"
+#include "qtcamfocusassist.h"
+#include "qtcamviewfinderbufferlistener.h"
+
+FocusAssist::FocusAssist(QObject *parent) :
+  QObject(parent),
+  m_cam(0),
+  m_dev(0),
+  m_assist(new QtCamFocusAssist(this)),
+  m_seq(0) {
+
+  // updated() is emitted from the streaming thread.
+  QObject::connect(m_assist, SIGNAL(updated()), this, SLOT(maskUpdated()),
+		   Qt::QueuedConnection);
+}
+
+FocusAssist::~FocusAssist() {
+  deviceAboutToChange();
+}
+
+Camera *FocusAssist::camera() const {
+  return m_cam;
+}
+
+void FocusAssist::setCamera(Camera *camera) {
+  if (m_cam == camera) {
+    return;
+  }
+
+  if (m_cam) {
+    QObject::disconnect(m_cam, SIGNAL(prepareForDeviceChange()),
+			this, SLOT(deviceAboutToChange()));
+    QObject::disconnect(m_cam, SIGNAL(deviceChanged()), this, SLOT(deviceChanged()));
+  }
+
+  deviceAboutToChange();
+
+  m_cam = camera;
+
+  if (m_cam) {
+    QObject::connect(m_cam, SIGNAL(prepareForDeviceChange()), this, SLOT(deviceAboutToChange()));
+    QObject::connect(m_cam, SIGNAL(deviceChanged()), this, SLOT(deviceChanged()));
+  }
+
+  emit cameraChanged();
+
+  update();
+}
+
+bool FocusAssist::isPeakingEnabled() const {
+  return m_assist->isPeakingEnabled();
+}
+
+void FocusAssist::setPeakingEnabled(bool enabled) {
+  if (isPeakingEnabled() != enabled) {
+    m_assist->setPeakingEnabled(enabled);
+
+    emit peakingChanged();
+
+    update();
+  }
+}
+
+bool FocusAssist::isZebraEnabled() const {
+  return m_assist->isZebraEnabled();
+}
+
+void FocusAssist::setZebraEnabled(bool enabled) {
+  if (isZebraEnabled() != enabled) {
+    m_assist->setZebraEnabled(enabled);
+
+    emit zebraChanged();
+
+    update();
+  }
+}
+
+int FocusAssist::peakingThreshold() const {
+  return m_assist->peakingThreshold();
+}
+
+void FocusAssist::setPeakingThreshold(int threshold) {
+  if (peakingThreshold() != threshold) {
+    m_assist->setPeakingThreshold(threshold);
+
+    emit peakingThresholdChanged();
+  }
+}
+
+int FocusAssist::zebraLevel() const {
+  return m_assist->zebraLevel();
+}
+
+void FocusAssist::setZebraLevel(int level) {
+  if (zebraLevel() != level) {
+    m_assist->setZebraLevel(level);
+
+    emit zebraLevelChanged();
+  }
+}
+
+int FocusAssist::load() const {
+  return m_assist->load();
+}
+
+void FocusAssist::setLoad(int load) {
+  if (FocusAssist::load() != load) {
+    m_assist->setLoad(load);
+
+    emit loadChanged();
+  }
+}
+
+QString FocusAssist::source() const {
+  return m_source;
+}
+
+void FocusAssist::deviceAboutToChange() {
+  if (m_dev) {
+    m_dev->bufferListener()->removeHandler(m_assist);
+    m_dev = 0;
+  }
+
+  if (!m_source.isEmpty()) {
+    m_source.clear();
+    emit sourceChanged();
+  }
+}
+
+void FocusAssist::deviceChanged() {
+  update();
+}
+
+void FocusAssist::maskUpdated() {
+  if (!m_dev || !FocusAssistProvider::instance()) {
+    return;
+  }
+
+  FocusAssistProvider::instance()->setMask(m_assist->mask());
+
+  // QML caches images by url.
+  m_source = QString("image://focusassist/%1").arg(m_seq);
+  ++m_seq;
+
+  emit sourceChanged();
+}
+
+void FocusAssist::update() {
+  // We stay out of the buffer listener entirely when there is nothing to draw.
+  bool enabled = m_assist->isPeakingEnabled() || m_assist->isZebraEnabled();
+  QtCamDevice *dev = enabled && m_cam ? m_cam->device() : 0;
+
+  if (dev == m_dev) {
+    return;
+  }
+
+  deviceAboutToChange();
+
+  if (dev) {
+    m_dev = dev;
+    m_dev->bufferListener()->addHandler(m_assist);
+  }
+}
+
+FocusAssistProvider *FocusAssistProvider::m_instance = 0;
+
+FocusAssistProvider::FocusAssistProvider() :
+#if defined(QT4)
+  QDeclarativeImageProvider(QDeclarativeImageProvider::Image) {
+#elif defined(QT5)
+  QQuickImageProvider(QQuickImageProvider::Image) {
+#endif
+
+  m_instance = this;
+}
+
+FocusAssistProvider::~FocusAssistProvider() {
+  m_instance = 0;
+}
+
+FocusAssistProvider *FocusAssistProvider::instance() {
+  return m_instance;
+}
+
+QImage FocusAssistProvider::requestImage(const QString& id, QSize *size,
+					 const QSize& requestedSize) {
+  Q_UNUSED(id);
+
+  QMutexLocker lock(&m_mutex);
+
+  QImage res = m_image;
+
+  // Nearest neighbour keeps the edges crisp.
+  if (!requestedSize.isEmpty()) {
+    res = res.scaled(requestedSize, Qt::IgnoreAspectRatio, Qt::FastTransformation);
+  }
+
+  if (size) {
+    *size = res.size();
+  }
+
+  return res;
+}
+
+void FocusAssistProvider::setMask(const QImage& mask) {
+  QMutexLocker lock(&m_mutex);
+
+  m_image = mask;
+}
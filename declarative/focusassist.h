@@ -0,0 +1,118 @@
+// -*- c++ -*-
+
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef FOCUS_ASSIST_H
+#define FOCUS_ASSIST_H
+
+#include <QObject>
+#if defined(QT4)
+#include <QDeclarativeImageProvider>
+#elif defined(QT5)
+#include <QQuickImageProvider>
+#endif
+#include <QMutex>
+
+class Camera;
+class QtCamDevice;
+class QtCamFocusAssist;
+
+class FocusAssist : public QObject {
+  Q_OBJECT
+
+  Q_PROPERTY(Camera* camera READ camera WRITE setCamera NOTIFY cameraChanged);
+  Q_PROPERTY(bool peaking READ isPeakingEnabled WRITE setPeakingEnabled NOTIFY peakingChanged);
+  Q_PROPERTY(bool zebra READ isZebraEnabled WRITE setZebraEnabled NOTIFY zebraChanged);
+  Q_PROPERTY(int peakingThreshold READ peakingThreshold WRITE setPeakingThreshold NOTIFY peakingThresholdChanged);
+  Q_PROPERTY(int zebraLevel READ zebraLevel WRITE setZebraLevel NOTIFY zebraLevelChanged);
+  Q_PROPERTY(int load READ load WRITE setLoad NOTIFY loadChanged);
+  Q_PROPERTY(QString source READ source NOTIFY sourceChanged);
+
+public:
+  FocusAssist(QObject *parent = 0);
+  ~FocusAssist();
+
+  Camera *camera() const;
+  void setCamera(Camera *camera);
+
+  bool isPeakingEnabled() const;
+  void setPeakingEnabled(bool enabled);
+
+  bool isZebraEnabled() const;
+  void setZebraEnabled(bool enabled);
+
+  int peakingThreshold() const;
+  void setPeakingThreshold(int threshold);
+
+  int zebraLevel() const;
+  void setZebraLevel(int level);
+
+  int load() const;
+  void setLoad(int load);
+
+  QString source() const;
+
+signals:
+  void cameraChanged();
+  void peakingChanged();
+  void zebraChanged();
+  void peakingThresholdChanged();
+  void zebraLevelChanged();
+  void loadChanged();
+  void sourceChanged();
+
+private slots:
+  void deviceAboutToChange();
+  void deviceChanged();
+  void maskUpdated();
+
+private:
+  void update();
+
+  Camera *m_cam;
+  QtCamDevice *m_dev;
+  QtCamFocusAssist *m_assist;
+  QString m_source;
+  unsigned long long m_seq;
+};
+
+#if defined(QT4)
+class FocusAssistProvider : public QDeclarativeImageProvider {
+#elif defined(QT5)
+class FocusAssistProvider : public QQuickImageProvider {
+#endif
+
+public:
+  FocusAssistProvider();
+  ~FocusAssistProvider();
+
+  static FocusAssistProvider *instance();
+
+  virtual QImage requestImage(const QString& id, QSize *size, const QSize& requestedSize);
+  void setMask(const QImage& mask);
+
+private:
+  static FocusAssistProvider *m_instance;
+  QImage m_image;
+  QMutex m_mutex;
+};
+
+#endif /* FOCUS_ASSIST_H */
@@ -0,0 +1,192 @@
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "histogram.h"
+#include "camera.h"
+#include "qtcamdevice.h"
+#include "qtcamhistogram.h"
+#include "qtcamviewfinderbufferlistener.h"
+
+static QVariantList toList(const QVector<quint32>& bins) {
+  QVariantList list;
+
+  foreach (quint32 bin, bins) {
+    list << bin;
+  }
+
+  return list;
+}
+
+Histogram::Histogram(QObject *parent) :
+  QObject(parent),
+  m_cam(0),
+  m_dev(0),
+  m_histogram(new QtCamHistogram(this)),
+  m_enabled(false),
+  m_shadowsClipped(0),
+  m_highlightsClipped(0),
+  m_mean(0),
+  m_median(0) {
+
+  // updated() is emitted from the streaming thread.
+  QObject::connect(m_histogram, SIGNAL(updated()), this, SLOT(histogramUpdated()),
+		   Qt::QueuedConnection);
+}
+
+Histogram::~Histogram() {
+  bool enabled = m_enabled;
+  m_enabled = false;
+  update();
+  m_enabled = enabled;
+}
+
+Camera *Histogram::camera() const {
+  return m_cam;
+}
+
+void Histogram::setCamera(Camera *camera) {
+  if (m_cam == camera) {
+    return;
+  }
+
+  if (m_cam) {
+    QObject::disconnect(m_cam, SIGNAL(prepareForDeviceChange()),
+			this, SLOT(deviceAboutToChange()));
+    QObject::disconnect(m_cam, SIGNAL(deviceChanged()), this, SLOT(deviceChanged()));
+  }
+
+  deviceAboutToChange();
+
+  m_cam = camera;
+
+  if (m_cam) {
+    QObject::connect(m_cam, SIGNAL(prepareForDeviceChange()), this, SLOT(deviceAboutToChange()));
+    QObject::connect(m_cam, SIGNAL(deviceChanged()), this, SLOT(deviceChanged()));
+  }
+
+  emit cameraChanged();
+
+  update();
+}
+
+bool Histogram::isEnabled() const {
+  return m_enabled;
+}
+
+void Histogram::setEnabled(bool enabled) {
+  if (m_enabled != enabled) {
+    m_enabled = enabled;
+
+    emit enabledChanged();
+
+    update();
+  }
+}
+
+int Histogram::interval() const {
+  return m_histogram->interval();
+}
+
+void Histogram::setInterval(int interval) {
+  if (m_histogram->interval() != interval) {
+    m_histogram->setInterval(interval);
+
+    emit intervalChanged();
+  }
+}
+
+QVariantList Histogram::luma() const {
+  return m_luma;
+}
+
+QVariantList Histogram::red() const {
+  return m_red;
+}
+
+QVariantList Histogram::green() const {
+  return m_green;
+}
+
+QVariantList Histogram::blue() const {
+  return m_blue;
+}
+
+qreal Histogram::shadowsClipped() const {
+  return m_shadowsClipped;
+}
+
+qreal Histogram::highlightsClipped() const {
+  return m_highlightsClipped;
+}
+
+int Histogram::mean() const {
+  return m_mean;
+}
+
+int Histogram::median() const {
+  return m_median;
+}
+
+void Histogram::deviceAboutToChange() {
+  if (m_dev) {
+    m_dev->bufferListener()->removeHandler(m_histogram);
+    m_dev = 0;
+  }
+}
+
+void Histogram::deviceChanged() {
+  update();
+}
+
+void Histogram::histogramUpdated() {
+  if (!m_dev) {
+    // A stale update queued before we unregistered
+    return;
+  }
+
+  QtCamHistogramData data = m_histogram->data();
+
+  m_luma = toList(data.luma);
+  m_red = toList(data.red);
+  m_green = toList(data.green);
+  m_blue = toList(data.blue);
+  m_shadowsClipped = data.shadowsClipped;
+  m_highlightsClipped = data.highlightsClipped;
+  m_mean = data.mean;
+  m_median = data.median;
+
+  emit updated();
+}
+
+void Histogram::update() {
+  QtCamDevice *dev = m_enabled && m_cam ? m_cam->device() : 0;
+
+  if (dev == m_dev) {
+    return;
+  }
+
+  deviceAboutToChange();
+
+  if (dev) {
+    m_dev = dev;
+    m_dev->bufferListener()->addHandler(m_histogram);
+  }
+}
@@ -0,0 +1,101 @@
+// -*- c++ -*-
+
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <QObject>
+#include <QVariant>
+
+class Camera;
+class QtCamDevice;
+class QtCamHistogram;
+
+class Histogram : public QObject {
+  Q_OBJECT
+
+  Q_PROPERTY(Camera* camera READ camera WRITE setCamera NOTIFY cameraChanged);
+  Q_PROPERTY(bool enabled READ isEnabled WRITE setEnabled NOTIFY enabledChanged);
+  Q_PROPERTY(int interval READ interval WRITE setInterval NOTIFY intervalChanged);
+  Q_PROPERTY(QVariantList luma READ luma NOTIFY updated);
+  Q_PROPERTY(QVariantList red READ red NOTIFY updated);
+  Q_PROPERTY(QVariantList green READ green NOTIFY updated);
+  Q_PROPERTY(QVariantList blue READ blue NOTIFY updated);
+  Q_PROPERTY(qreal shadowsClipped READ shadowsClipped NOTIFY updated);
+  Q_PROPERTY(qreal highlightsClipped READ highlightsClipped NOTIFY updated);
+  Q_PROPERTY(int mean READ mean NOTIFY updated);
+  Q_PROPERTY(int median READ median NOTIFY updated);
+
+public:
+  Histogram(QObject *parent = 0);
+  ~Histogram();
+
+  Camera *camera() const;
+  void setCamera(Camera *camera);
+
+  bool isEnabled() const;
+  void setEnabled(bool enabled);
+
+  int interval() const;
+  void setInterval(int interval);
+
+  QVariantList luma() const;
+  QVariantList red() const;
+  QVariantList green() const;
+  QVariantList blue() const;
+
+  qreal shadowsClipped() const;
+  qreal highlightsClipped() const;
+
+  int mean() const;
+  int median() const;
+
+signals:
+  void cameraChanged();
+  void enabledChanged();
+  void intervalChanged();
+  void updated();
+
+private slots:
+  void deviceAboutToChange();
+  void deviceChanged();
+  void histogramUpdated();
+
+private:
+  void update();
+
+  Camera *m_cam;
+  QtCamDevice *m_dev;
+  QtCamHistogram *m_histogram;
+  bool m_enabled;
+
+  QVariantList m_luma;
+  QVariantList m_red;
+  QVariantList m_green;
+  QVariantList m_blue;
+  qreal m_shadowsClipped;
+  qreal m_highlightsClipped;
+  int m_mean;
+  int m_median;
+};
+
+#endif /* HISTOGRAM_H */
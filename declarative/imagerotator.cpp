@@ -0,0 +1,91 @@
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "imagerotator.h"
+#include "qtcamjpegrotator.h"
+
+ImageRotator::ImageRotator(QObject *parent) :
+  QObject(parent),
+  m_rotator(new QtCamJpegRotator(this)),
+  m_pending(0),
+  m_enabled(false) {
+
+  // All emitted from the worker thread.
+  QObject::connect(m_rotator, SIGNAL(finished(const QString&)),
+		   this, SLOT(rotatorFinished(const QString&)), Qt::QueuedConnection);
+  QObject::connect(m_rotator, SIGNAL(failed(const QString&)),
+		   this, SLOT(rotatorFailed(const QString&)), Qt::QueuedConnection);
+}
+
+ImageRotator::~ImageRotator() {
+
+}
+
+bool ImageRotator::isEnabled() const {
+  return m_enabled;
+}
+
+void ImageRotator::setEnabled(bool enabled) {
+  if (m_enabled != enabled) {
+    m_enabled = enabled;
+    emit enabledChanged();
+  }
+}
+
+bool ImageRotator::isBusy() const {
+  return m_pending > 0;
+}
+
+qreal ImageRotator::msecsPerMegapixel() const {
+  return m_rotator->msecsPerMegapixel();
+}
+
+bool ImageRotator::rotate(const QString& fileName) {
+  if (!m_enabled || fileName.isEmpty()) {
+    return false;
+  }
+
+  m_rotator->rotate(fileName);
+
+  if (++m_pending == 1) {
+    emit busyChanged();
+  }
+
+  return true;
+}
+
+void ImageRotator::rotatorFinished(const QString& fileName) {
+  done();
+
+  emit rotated(fileName);
+}
+
+void ImageRotator::rotatorFailed(const QString& fileName) {
+  // The file is untouched and still carries its orientation tag.
+  done();
+
+  emit failed(fileName);
+}
+
+void ImageRotator::done() {
+  if (--m_pending == 0) {
+    emit busyChanged();
+  }
+}
@@ -0,0 +1,69 @@
+// -*- c++ -*-
+
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef IMAGE_ROTATOR_H
+#define IMAGE_ROTATOR_H
+
+#include <QObject>
+
+class QtCamJpegRotator;
+
+class ImageRotator : public QObject {
+  Q_OBJECT
+
+  Q_PROPERTY(bool enabled READ isEnabled WRITE setEnabled NOTIFY enabledChanged);
+  Q_PROPERTY(bool busy READ isBusy NOTIFY busyChanged);
+  Q_PROPERTY(qreal msecsPerMegapixel READ msecsPerMegapixel NOTIFY rotated);
+
+public:
+  ImageRotator(QObject *parent = 0);
+  ~ImageRotator();
+
+  bool isEnabled() const;
+  void setEnabled(bool enabled);
+
+  bool isBusy() const;
+
+  qreal msecsPerMegapixel() const;
+
+  // Queues a saved image. Does nothing unless enabled.
+  Q_INVOKABLE bool rotate(const QString& fileName);
+
+signals:
+  void enabledChanged();
+  void busyChanged();
+  void rotated(const QString& fileName);
+  void failed(const QString& fileName);
+
+private slots:
+  void rotatorFinished(const QString& fileName);
+  void rotatorFailed(const QString& fileName);
+
+private:
+  void done();
+
+  QtCamJpegRotator *m_rotator;
+  int m_pending;
+  bool m_enabled;
+};
+
+#endif /* IMAGE_ROTATOR_H */
@@ -0,0 +1,199 @@
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "motiondetector.h"
+#include "camera.h"
+#include "qtcamdevice.h"
+#include "qtcammotiondetector.h"
+#include "qtcamviewfinderbufferlistener.h"
+
+MotionDetector::MotionDetector(QObject *parent) :
+  QObject(parent),
+  m_cam(0),
+  m_dev(0),
+  m_detector(new QtCamMotionDetector(this)),
+  m_enabled(false),
+  m_motion(false) {
+
+  // Both are emitted from the streaming thread.
+  QObject::connect(m_detector, SIGNAL(motionStarted()), this, SLOT(detectorStarted()),
+		   Qt::QueuedConnection);
+  QObject::connect(m_detector, SIGNAL(motionStopped()), this, SLOT(detectorStopped()),
+		   Qt::QueuedConnection);
+}
+
+MotionDetector::~MotionDetector() {
+  deviceAboutToChange();
+}
+
+Camera *MotionDetector::camera() const {
+  return m_cam;
+}
+
+void MotionDetector::setCamera(Camera *camera) {
+  if (m_cam == camera) {
+    return;
+  }
+
+  if (m_cam) {
+    QObject::disconnect(m_cam, SIGNAL(prepareForDeviceChange()),
+			this, SLOT(deviceAboutToChange()));
+    QObject::disconnect(m_cam, SIGNAL(deviceChanged()), this, SLOT(deviceChanged()));
+  }
+
+  deviceAboutToChange();
+
+  m_cam = camera;
+
+  if (m_cam) {
+    QObject::connect(m_cam, SIGNAL(prepareForDeviceChange()), this, SLOT(deviceAboutToChange()));
+    QObject::connect(m_cam, SIGNAL(deviceChanged()), this, SLOT(deviceChanged()));
+  }
+
+  emit cameraChanged();
+
+  update();
+}
+
+bool MotionDetector::isEnabled() const {
+  return m_enabled;
+}
+
+void MotionDetector::setEnabled(bool enabled) {
+  if (m_enabled != enabled) {
+    m_enabled = enabled;
+
+    emit enabledChanged();
+
+    update();
+  }
+}
+
+int MotionDetector::sensitivity() const {
+  return m_detector->sensitivity();
+}
+
+void MotionDetector::setSensitivity(int sensitivity) {
+  if (MotionDetector::sensitivity() != sensitivity) {
+    m_detector->setSensitivity(sensitivity);
+
+    emit sensitivityChanged();
+  }
+}
+
+int MotionDetector::coolDown() const {
+  return m_detector->coolDown();
+}
+
+void MotionDetector::setCoolDown(int coolDown) {
+  if (MotionDetector::coolDown() != coolDown) {
+    m_detector->setCoolDown(coolDown);
+
+    emit coolDownChanged();
+  }
+}
+
+int MotionDetector::interval() const {
+  return m_detector->interval();
+}
+
+void MotionDetector::setInterval(int interval) {
+  if (MotionDetector::interval() != interval) {
+    m_detector->setInterval(interval);
+
+    emit intervalChanged();
+  }
+}
+
+QVariantList MotionDetector::masks() const {
+  return m_masks;
+}
+
+void MotionDetector::setMasks(const QVariantList& masks) {
+  if (m_masks == masks) {
+    return;
+  }
+
+  m_masks = masks;
+
+  QList<QRectF> rects;
+  foreach (const QVariant& mask, m_masks) {
+    rects << mask.toRectF();
+  }
+
+  m_detector->setMasks(rects);
+
+  emit masksChanged();
+}
+
+bool MotionDetector::hasMotion() const {
+  return m_motion;
+}
+
+void MotionDetector::deviceAboutToChange() {
+  if (m_dev) {
+    m_dev->bufferListener()->removeHandler(m_detector);
+    m_dev = 0;
+  }
+
+  m_detector->reset();
+
+  if (m_motion) {
+    m_motion = false;
+    emit motionChanged();
+    emit motionStopped();
+  }
+}
+
+void MotionDetector::deviceChanged() {
+  update();
+}
+
+void MotionDetector::detectorStarted() {
+  if (m_dev && !m_motion) {
+    m_motion = true;
+    emit motionChanged();
+    emit motionStarted();
+  }
+}
+
+void MotionDetector::detectorStopped() {
+  if (m_motion) {
+    m_motion = false;
+    emit motionChanged();
+    emit motionStopped();
+  }
+}
+
+void MotionDetector::update() {
+  QtCamDevice *dev = m_enabled && m_cam ? m_cam->device() : 0;
+
+  if (dev == m_dev) {
+    return;
+  }
+
+  deviceAboutToChange();
+
+  if (dev) {
+    m_dev = dev;
+    m_dev->bufferListener()->addHandler(m_detector);
+  }
+}
@@ -0,0 +1,96 @@
+// -*- c++ -*-
+
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef MOTION_DETECTOR_H
+#define MOTION_DETECTOR_H
+
+#include <QObject>
+#include <QVariant>
+
+class Camera;
+class QtCamDevice;
+class QtCamMotionDetector;
+
+class MotionDetector : public QObject {
+  Q_OBJECT
+
+  Q_PROPERTY(Camera* camera READ camera WRITE setCamera NOTIFY cameraChanged);
+  Q_PROPERTY(bool enabled READ isEnabled WRITE setEnabled NOTIFY enabledChanged);
+  Q_PROPERTY(int sensitivity READ sensitivity WRITE setSensitivity NOTIFY sensitivityChanged);
+  Q_PROPERTY(int coolDown READ coolDown WRITE setCoolDown NOTIFY coolDownChanged);
+  Q_PROPERTY(int interval READ interval WRITE setInterval NOTIFY intervalChanged);
+  Q_PROPERTY(QVariantList masks READ masks WRITE setMasks NOTIFY masksChanged);
+  Q_PROPERTY(bool motion READ hasMotion NOTIFY motionChanged);
+
+public:
+  MotionDetector(QObject *parent = 0);
+  ~MotionDetector();
+
+  Camera *camera() const;
+  void setCamera(Camera *camera);
+
+  bool isEnabled() const;
+  void setEnabled(bool enabled);
+
+  int sensitivity() const;
+  void setSensitivity(int sensitivity);
+
+  int coolDown() const;
+  void setCoolDown(int coolDown);
+
+  int interval() const;
+  void setInterval(int interval);
+
+  QVariantList masks() const;
+  void setMasks(const QVariantList& masks);
+
+  bool hasMotion() const;
+
+signals:
+  void cameraChanged();
+  void enabledChanged();
+  void sensitivityChanged();
+  void coolDownChanged();
+  void intervalChanged();
+  void masksChanged();
+  void motionChanged();
+  void motionStarted();
+  void motionStopped();
+
+private slots:
+  void deviceAboutToChange();
+  void deviceChanged();
+  void detectorStarted();
+  void detectorStopped();
+
+private:
+  void update();
+
+  Camera *m_cam;
+  QtCamDevice *m_dev;
+  QtCamMotionDetector *m_detector;
+  bool m_enabled;
+  bool m_motion;
+  QVariantList m_masks;
+};
+
+#endif /* MOTION_DETECTOR_H */
@@ -0,0 +1,127 @@
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "nightstacker.h"
+#include "qtcamnightstacker.h"
+#include <QFile>
+
+NightStacker::NightStacker(QObject *parent) :
+  QObject(parent),
+  m_stacker(new QtCamNightStacker(this)),
+  m_progress(0),
+  m_busy(false),
+  m_discard(true) {
+
+  // All emitted from the worker thread.
+  QObject::connect(m_stacker, SIGNAL(progress(qreal)),
+		   this, SLOT(stackerProgress(qreal)), Qt::QueuedConnection);
+  QObject::connect(m_stacker, SIGNAL(finished(const QString&)),
+		   this, SLOT(stackerFinished(const QString&)), Qt::QueuedConnection);
+  QObject::connect(m_stacker, SIGNAL(failed()),
+		   this, SLOT(stackerFailed()), Qt::QueuedConnection);
+}
+
+NightStacker::~NightStacker() {
+  m_stacker->cancel();
+  m_stacker->wait();
+}
+
+bool NightStacker::isBusy() const {
+  return m_busy;
+}
+
+qreal NightStacker::progress() const {
+  return m_progress;
+}
+
+bool NightStacker::discard() const {
+  return m_discard;
+}
+
+void NightStacker::setDiscard(bool discard) {
+  if (m_discard != discard) {
+    m_discard = discard;
+    emit discardChanged();
+  }
+}
+
+bool NightStacker::stack(const QStringList& fileNames, const QString& fileName) {
+  if (m_busy) {
+    return false;
+  }
+
+  if (!m_stacker->stack(fileNames, fileName)) {
+    return false;
+  }
+
+  m_frames = fileNames;
+  m_busy = true;
+  m_progress = 0;
+
+  emit busyChanged();
+  emit progressChanged();
+
+  return true;
+}
+
+void NightStacker::cancel() {
+  if (m_busy) {
+    // stackerFailed() will clean up.
+    m_stacker->cancel();
+  }
+}
+
+void NightStacker::stackerProgress(qreal progress) {
+  if (m_busy) {
+    m_progress = progress;
+    emit progressChanged();
+  }
+}
+
+void NightStacker::stackerFinished(const QString& fileName) {
+  m_busy = false;
+
+  if (m_discard) {
+    removeFrames();
+  }
+
+  m_frames.clear();
+
+  emit busyChanged();
+  emit stacked(fileName);
+}
+
+void NightStacker::stackerFailed() {
+  // Keep the frames. They are better than nothing.
+  m_busy = false;
+  m_frames.clear();
+
+  emit busyChanged();
+  emit failed();
+}
+
+void NightStacker::removeFrames() {
+  foreach (const QString& fileName, m_frames) {
+    if (QFile::remove(fileName)) {
+      emit removed(fileName);
+    }
+  }
+}
@@ -0,0 +1,76 @@
+// -*- c++ -*-
+
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef NIGHT_STACKER_H
+#define NIGHT_STACKER_H
+
+#include <QObject>
+#include <QStringList>
+
+class QtCamNightStacker;
+
+class NightStacker : public QObject {
+  Q_OBJECT
+
+  Q_PROPERTY(bool busy READ isBusy NOTIFY busyChanged);
+  Q_PROPERTY(qreal progress READ progress NOTIFY progressChanged);
+  Q_PROPERTY(bool discard READ discard WRITE setDiscard NOTIFY discardChanged);
+
+public:
+  NightStacker(QObject *parent = 0);
+  ~NightStacker();
+
+  bool isBusy() const;
+  qreal progress() const;
+
+  // Remove the frames once stacked.
+  bool discard() const;
+  void setDiscard(bool discard);
+
+  // The frames are expected in capture order. The middle one is the reference.
+  Q_INVOKABLE bool stack(const QStringList& fileNames, const QString& fileName);
+  Q_INVOKABLE void cancel();
+
+signals:
+  void busyChanged();
+  void progressChanged();
+  void discardChanged();
+  void stacked(const QString& fileName);
+  void removed(const QString& fileName);
+  void failed();
+
+private slots:
+  void stackerProgress(qreal progress);
+  void stackerFinished(const QString& fileName);
+  void stackerFailed();
+
+private:
+  void removeFrames();
+
+  QtCamNightStacker *m_stacker;
+  QStringList m_frames;
+  qreal m_progress;
+  bool m_busy;
+  bool m_discard;
+};
+
+#endif /* NIGHT_STACKER_H */
@@ -0,0 +1,247 @@
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "panorama.h"
+#include "camera.h"
+#include "qtcamdevice.h"
+#include "qtcampanorama.h"
+#include "qtcampanoramastitcher.h"
+#include "qtcamviewfinderbufferlistener.h"
+#include <QFile>
+#if defined(QT4)
+#include <QDeclarativeInfo>
+#elif defined(QT5)
+#include <QQmlInfo>
+#endif
+
+Panorama::Panorama(QObject *parent) :
+  QObject(parent),
+  m_cam(0),
+  m_dev(0),
+  m_panorama(new QtCamPanorama(this)),
+  m_stitcher(new QtCamPanoramaStitcher(this)),
+  m_progress(0),
+  m_stitching(false) {
+
+  // All emitted from worker threads.
+  QObject::connect(m_panorama, SIGNAL(moved(const QPointF&)),
+		   this, SLOT(panoramaMoved(const QPointF&)), Qt::QueuedConnection);
+  QObject::connect(m_panorama, SIGNAL(keyframeNeeded()),
+		   this, SIGNAL(keyframeNeeded()), Qt::QueuedConnection);
+  QObject::connect(m_panorama, SIGNAL(tooFast()),
+		   this, SIGNAL(tooFast()), Qt::QueuedConnection);
+  QObject::connect(m_stitcher, SIGNAL(progress(qreal)),
+		   this, SLOT(stitcherProgress(qreal)), Qt::QueuedConnection);
+  QObject::connect(m_stitcher, SIGNAL(finished(const QString&)),
+		   this, SLOT(stitcherFinished(const QString&)), Qt::QueuedConnection);
+  QObject::connect(m_stitcher, SIGNAL(failed()),
+		   this, SLOT(stitcherFailed()), Qt::QueuedConnection);
+}
+
+Panorama::~Panorama() {
+  deviceAboutToChange();
+}
+
+Camera *Panorama::camera() const {
+  return m_cam;
+}
+
+void Panorama::setCamera(Camera *camera) {
+  if (m_cam == camera) {
+    return;
+  }
+
+  if (m_cam) {
+    QObject::disconnect(m_cam, SIGNAL(prepareForDeviceChange()),
+			this, SLOT(deviceAboutToChange()));
+  }
+
+  deviceAboutToChange();
+
+  m_cam = camera;
+
+  if (m_cam) {
+    QObject::connect(m_cam, SIGNAL(prepareForDeviceChange()), this, SLOT(deviceAboutToChange()));
+  }
+
+  emit cameraChanged();
+}
+
+bool Panorama::isActive() const {
+  return m_dev != 0;
+}
+
+bool Panorama::isStitching() const {
+  return m_stitching;
+}
+
+qreal Panorama::progress() const {
+  return m_progress;
+}
+
+QPointF Panorama::position() const {
+  return m_position;
+}
+
+int Panorama::keyframes() const {
+  return m_keyframes.size();
+}
+
+int Panorama::height() const {
+  return m_stitcher->height();
+}
+
+void Panorama::setHeight(int height) {
+  if (Panorama::height() != height) {
+    m_stitcher->setHeight(height);
+    emit heightChanged();
+  }
+}
+
+bool Panorama::start() {
+  if (isActive() || m_stitching) {
+    qmlInfo(this) << "Panorama is busy";
+    return false;
+  }
+
+  if (!m_cam || !m_cam->device()) {
+    qmlInfo(this) << "Camera not set";
+    return false;
+  }
+
+  m_keyframes.clear();
+  m_position = QPointF();
+
+  m_dev = m_cam->device();
+  m_dev->bufferListener()->addHandler(m_panorama);
+  m_panorama->begin();
+
+  emit activeChanged();
+  emit keyframesChanged();
+  emit positionChanged();
+
+  return true;
+}
+
+void Panorama::stop() {
+  deviceAboutToChange();
+}
+
+void Panorama::addKeyframe(const QString& fileName) {
+  if (!isActive()) {
+    return;
+  }
+
+  m_panorama->addKeyframe(fileName);
+  m_keyframes << fileName;
+
+  emit keyframesChanged();
+}
+
+void Panorama::keyframeSkipped() {
+  if (!isActive()) {
+    return;
+  }
+
+  m_panorama->keyframeSkipped();
+}
+
+bool Panorama::stitch(const QString& fileName) {
+  stop();
+
+  if (m_stitching) {
+    return false;
+  }
+
+  if (!m_stitcher->stitch(m_panorama->keyframes(), fileName)) {
+    removeKeyframes();
+    return false;
+  }
+
+  m_stitching = true;
+  m_progress = 0;
+
+  emit stitchingChanged();
+  emit progressChanged();
+
+  return true;
+}
+
+void Panorama::cancel() {
+  stop();
+
+  if (m_stitching) {
+    // stitcherFailed() will clean up.
+    m_stitcher->cancel();
+  }
+  else {
+    removeKeyframes();
+  }
+}
+
+void Panorama::deviceAboutToChange() {
+  if (m_dev) {
+    m_panorama->end();
+    m_dev->bufferListener()->removeHandler(m_panorama);
+    m_dev = 0;
+
+    emit activeChanged();
+  }
+}
+
+void Panorama::panoramaMoved(const QPointF& position) {
+  if (isActive()) {
+    m_position = position;
+    emit positionChanged();
+  }
+}
+
+void Panorama::stitcherProgress(qreal progress) {
+  if (m_stitching) {
+    m_progress = progress;
+    emit progressChanged();
+  }
+}
+
+void Panorama::stitcherFinished(const QString& fileName) {
+  m_stitching = false;
+  removeKeyframes();
+
+  emit stitchingChanged();
+  emit stitched(fileName);
+}
+
+void Panorama::stitcherFailed() {
+  m_stitching = false;
+  removeKeyframes();
+
+  emit stitchingChanged();
+  emit stitchingFailed();
+}
+
+void Panorama::removeKeyframes() {
+  foreach (const QString& fileName, m_keyframes) {
+    QFile::remove(fileName);
+  }
+
+  m_keyframes.clear();
+  emit keyframesChanged();
+}
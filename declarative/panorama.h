@@ -0,0 +1,105 @@
+// -*- c++ -*-
+
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PANORAMA_H
+#define PANORAMA_H
+
+#include <QObject>
+#include <QPointF>
+#include <QStringList>
+
+class Camera;
+class QtCamDevice;
+class QtCamPanorama;
+class QtCamPanoramaStitcher;
+
+class Panorama : public QObject {
+  Q_OBJECT
+
+  Q_PROPERTY(Camera* camera READ camera WRITE setCamera NOTIFY cameraChanged);
+  Q_PROPERTY(bool active READ isActive NOTIFY activeChanged);
+  Q_PROPERTY(bool stitching READ isStitching NOTIFY stitchingChanged);
+  Q_PROPERTY(qreal progress READ progress NOTIFY progressChanged);
+  Q_PROPERTY(QPointF position READ position NOTIFY positionChanged);
+  Q_PROPERTY(int keyframes READ keyframes NOTIFY keyframesChanged);
+  Q_PROPERTY(int height READ height WRITE setHeight NOTIFY heightChanged);
+
+public:
+  Panorama(QObject *parent = 0);
+  ~Panorama();
+
+  Camera *camera() const;
+  void setCamera(Camera *camera);
+
+  bool isActive() const;
+  bool isStitching() const;
+  qreal progress() const;
+  QPointF position() const;
+  int keyframes() const;
+
+  int height() const;
+  void setHeight(int height);
+
+  Q_INVOKABLE bool start();
+  Q_INVOKABLE void stop();
+  Q_INVOKABLE void addKeyframe(const QString& fileName);
+  Q_INVOKABLE void keyframeSkipped();
+  // Blends the keyframes into fileName and removes them afterwards.
+  Q_INVOKABLE bool stitch(const QString& fileName);
+  // Removes the keyframes too so wait for those still being saved.
+  Q_INVOKABLE void cancel();
+
+signals:
+  void cameraChanged();
+  void activeChanged();
+  void stitchingChanged();
+  void progressChanged();
+  void positionChanged();
+  void keyframesChanged();
+  void heightChanged();
+
+  void keyframeNeeded();
+  void tooFast();
+  void stitched(const QString& fileName);
+  void stitchingFailed();
+
+private slots:
+  void deviceAboutToChange();
+  void panoramaMoved(const QPointF& position);
+  void stitcherProgress(qreal progress);
+  void stitcherFinished(const QString& fileName);
+  void stitcherFailed();
+
+private:
+  void removeKeyframes();
+
+  Camera *m_cam;
+  QtCamDevice *m_dev;
+  QtCamPanorama *m_panorama;
+  QtCamPanoramaStitcher *m_stitcher;
+  QStringList m_keyframes;
+  QPointF m_position;
+  qreal m_progress;
+  bool m_stitching;
+};
+
+#endif /* PANORAMA_H */
@@ -52,6 +52,15 @@
 #include "viewfinderhandler.h"
 #include "viewfinderbufferhandler.h"
 #include "viewfinderframehandler.h"
+#include "histogram.h"
+#include "focusassist.h"
+#include "burstselector.h"
+#include "motiondetector.h"
+#include "panorama.h"
+#include "exposurefusion.h"
+#include "nightstacker.h"
+#include "timelapse.h"
+#include "imagerotator.h"
 #if defined(QT4)
 #include <QDeclarativeEngine>
 #elif defined(QT5)
@@ -82,6 +91,7 @@ void DeclarativePlugin::initializeEngine(QQmlEngine *engine, const char *uri) {
   Q_UNUSED(uri);
 
   engine->addImageProvider("preview", new PreviewProvider);
+  engine->addImageProvider("focusassist", new FocusAssistProvider);
 }
 
 void DeclarativePlugin::registerTypes(const char *uri) {
@@ -129,6 +139,15 @@ void DeclarativePlugin::registerTypes(const char *uri) {
   qmlRegisterType<ViewfinderBufferHandler>(uri, MAJOR, MINOR, "ViewfinderBufferHandler");
   qmlRegisterType<ViewfinderFrameHandler>(uri, MAJOR, MINOR, "ViewfinderFrameHandler");
   qmlRegisterType<ViewfinderHandler>();
+  qmlRegisterType<Histogram>(uri, MAJOR, MINOR, "Histogram");
+  qmlRegisterType<FocusAssist>(uri, MAJOR, MINOR, "FocusAssist");
+  qmlRegisterType<BurstSelector>(uri, MAJOR, MINOR, "BurstSelector");
+  qmlRegisterType<MotionDetector>(uri, MAJOR, MINOR, "MotionDetector");
+  qmlRegisterType<Panorama>(uri, MAJOR, MINOR, "Panorama");
+  qmlRegisterType<ExposureFusion>(uri, MAJOR, MINOR, "ExposureFusion");
+  qmlRegisterType<NightStacker>(uri, MAJOR, MINOR, "NightStacker");
+  qmlRegisterType<TimeLapse>(uri, MAJOR, MINOR, "TimeLapse");
+  qmlRegisterType<ImageRotator>(uri, MAJOR, MINOR, "ImageRotator");
 }
 
 #if defined(QT4)
@@ -0,0 +1,150 @@
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "timelapse.h"
+#include "camera.h"
+#include "qtcamdevice.h"
+#include "qtcamtimelapse.h"
+#include "qtcamviewfinderbufferlistener.h"
+
+TimeLapse::TimeLapse(QObject *parent) :
+  QObject(parent),
+  m_cam(0),
+  m_dev(0),
+  m_timeLapse(new QtCamTimeLapse(this)),
+  m_frames(0) {
+
+  // Emitted from the streaming thread.
+  QObject::connect(m_timeLapse, SIGNAL(frameRecorded(int)), this, SLOT(frameRecorded(int)),
+		   Qt::QueuedConnection);
+  // Emitted from stop() which might be called from our destructor.
+  QObject::connect(m_timeLapse, SIGNAL(finished(const QString&)),
+		   this, SIGNAL(finished(const QString&)), Qt::QueuedConnection);
+  QObject::connect(m_timeLapse, SIGNAL(failed()), this, SIGNAL(failed()),
+		   Qt::QueuedConnection);
+}
+
+TimeLapse::~TimeLapse() {
+  stop();
+}
+
+Camera *TimeLapse::camera() const {
+  return m_cam;
+}
+
+void TimeLapse::setCamera(Camera *camera) {
+  if (m_cam == camera) {
+    return;
+  }
+
+  if (m_cam) {
+    QObject::disconnect(m_cam, SIGNAL(prepareForDeviceChange()),
+			this, SLOT(deviceAboutToChange()));
+  }
+
+  stop();
+
+  m_cam = camera;
+
+  if (m_cam) {
+    QObject::connect(m_cam, SIGNAL(prepareForDeviceChange()), this, SLOT(deviceAboutToChange()));
+  }
+
+  emit cameraChanged();
+}
+
+int TimeLapse::interval() const {
+  return m_timeLapse->interval();
+}
+
+void TimeLapse::setInterval(int interval) {
+  if (TimeLapse::interval() != interval) {
+    m_timeLapse->setInterval(interval);
+
+    emit intervalChanged();
+  }
+}
+
+int TimeLapse::frameRate() const {
+  return m_timeLapse->frameRate();
+}
+
+void TimeLapse::setFrameRate(int frameRate) {
+  if (TimeLapse::frameRate() != frameRate) {
+    m_timeLapse->setFrameRate(frameRate);
+
+    emit frameRateChanged();
+  }
+}
+
+bool TimeLapse::isRecording() const {
+  return m_dev != 0;
+}
+
+int TimeLapse::frames() const {
+  return m_frames;
+}
+
+bool TimeLapse::start(const QString& fileName) {
+  QtCamDevice *dev = m_cam ? m_cam->device() : 0;
+  if (!dev || m_dev) {
+    return false;
+  }
+
+  if (!m_timeLapse->start(dev->config(), fileName)) {
+    return false;
+  }
+
+  m_dev = dev;
+  m_dev->bufferListener()->addHandler(m_timeLapse);
+
+  m_frames = 0;
+
+  emit framesChanged();
+  emit recordingChanged();
+
+  return true;
+}
+
+void TimeLapse::stop() {
+  if (!m_dev) {
+    return;
+  }
+
+  m_dev->bufferListener()->removeHandler(m_timeLapse);
+  m_dev = 0;
+
+  m_timeLapse->stop();
+
+  emit recordingChanged();
+}
+
+void TimeLapse::deviceAboutToChange() {
+  // The file is still usable.
+  stop();
+}
+
+void TimeLapse::frameRecorded(int frames) {
+  if (m_dev) {
+    m_frames = frames;
+    emit framesChanged();
+  }
+}
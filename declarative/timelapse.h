@@ -0,0 +1,80 @@
+// -*- c++ -*-
+
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef TIME_LAPSE_H
+#define TIME_LAPSE_H
+
+#include <QObject>
+
+class Camera;
+class QtCamDevice;
+class QtCamTimeLapse;
+
+class TimeLapse : public QObject {
+  Q_OBJECT
+
+  Q_PROPERTY(Camera* camera READ camera WRITE setCamera NOTIFY cameraChanged);
+  Q_PROPERTY(int interval READ interval WRITE setInterval NOTIFY intervalChanged);
+  Q_PROPERTY(int frameRate READ frameRate WRITE setFrameRate NOTIFY frameRateChanged);
+  Q_PROPERTY(bool recording READ isRecording NOTIFY recordingChanged);
+  Q_PROPERTY(int frames READ frames NOTIFY framesChanged);
+
+public:
+  TimeLapse(QObject *parent = 0);
+  ~TimeLapse();
+
+  Camera *camera() const;
+  void setCamera(Camera *camera);
+
+  int interval() const;
+  void setInterval(int interval);
+
+  int frameRate() const;
+  void setFrameRate(int frameRate);
+
+  bool isRecording() const;
+  int frames() const;
+
+  Q_INVOKABLE bool start(const QString& fileName);
+  Q_INVOKABLE void stop();
+
+signals:
+  void cameraChanged();
+  void intervalChanged();
+  void frameRateChanged();
+  void recordingChanged();
+  void framesChanged();
+  void finished(const QString& fileName);
+  void failed();
+
+private slots:
+  void deviceAboutToChange();
+  void frameRecorded(int frames);
+
+private:
+  Camera *m_cam;
+  QtCamDevice *m_dev;
+  QtCamTimeLapse *m_timeLapse;
+  int m_frames;
+};
+
+#endif /* TIME_LAPSE_H */
@@ -20,13 +20,16 @@
 
 #include "videomode.h"
 #include "qtcamvideomode.h"
+#include "qtcamrecordingmonitor.h"
 #include "qtcamdevice.h"
 #include "camera.h"
 #include "resolution.h"
 
 VideoMode::VideoMode(QObject *parent) :
   Mode(parent),
-  m_video(0) {
+  m_video(0),
+  m_batteryPercentage(100),
+  m_batteryCharging(false) {
 
 }
 
@@ -39,6 +42,20 @@ bool VideoMode::startRecording(const QString& fileName, const QString& tmpFileNa
   return m_video ? m_video->startRecording(fileName, tmpFileName) : false;
 }
 
+bool VideoMode::enablePreRoll(int seconds, const QString& tmpFileName) {
+  return m_video ? m_video->enablePreRoll(seconds, tmpFileName) : false;
+}
+
+void VideoMode::disablePreRoll() {
+  if (m_video) {
+    m_video->disablePreRoll();
+  }
+}
+
+bool VideoMode::snapshot(const QString& fileName) {
+  return m_video ? m_video->snapshot(fileName) : false;
+}
+
 void VideoMode::stopRecording(bool sync) {
   if (m_video) {
     m_video->stopRecording(sync);
@@ -57,6 +74,14 @@ void VideoMode::preChangeMode() {
 			this, SIGNAL(recordingStateChanged()));
     QObject::disconnect(m_video, SIGNAL(pauseStateChanged()),
 			this, SIGNAL(pauseStateChanged()));
+    QObject::disconnect(m_video, SIGNAL(snapshotFailed(const QString&)),
+			this, SIGNAL(snapshotFailed(const QString&)));
+    QObject::disconnect(m_video, SIGNAL(audioLevelsChanged()),
+			this, SIGNAL(audioLevelsChanged()));
+    QObject::disconnect(m_video, SIGNAL(recordingStatsChanged()),
+			this, SIGNAL(recordingStatsChanged()));
+    QObject::disconnect(m_video, SIGNAL(bitrateGovernorChanged()),
+			this, SIGNAL(bitrateGovernorChanged()));
   }
 
   m_video = 0;
@@ -70,6 +95,20 @@ void VideoMode::postChangeMode() {
 		     this, SIGNAL(recordingStateChanged()));
     QObject::connect(m_video, SIGNAL(pauseStateChanged()),
 		     this, SIGNAL(pauseStateChanged()));
+    QObject::connect(m_video, SIGNAL(snapshotFailed(const QString&)),
+		     this, SIGNAL(snapshotFailed(const QString&)));
+    QObject::connect(m_video, SIGNAL(audioLevelsChanged()),
+		     this, SIGNAL(audioLevelsChanged()));
+    QObject::connect(m_video, SIGNAL(recordingStatsChanged()),
+		     this, SIGNAL(recordingStatsChanged()));
+    QObject::connect(m_video, SIGNAL(bitrateGovernorChanged()),
+		     this, SIGNAL(bitrateGovernorChanged()));
+
+    if (!m_storagePath.isEmpty()) {
+      m_video->setStoragePath(m_storagePath);
+    }
+
+    m_video->setBatteryState(m_batteryPercentage, m_batteryCharging);
   }
 }
 
@@ -81,6 +120,115 @@ bool VideoMode::isPaused() {
   return m_video ? m_video->isPaused() : false;
 }
 
+static QVariantList toVariantList(const QList<qreal>& levels) {
+  QVariantList list;
+
+  foreach (qreal level, levels) {
+    list << level;
+  }
+
+  return list;
+}
+
+QVariantList VideoMode::audioPeak() {
+  return m_video ? toVariantList(m_video->audioPeakLevels()) : QVariantList();
+}
+
+QVariantList VideoMode::audioRms() {
+  return m_video ? toVariantList(m_video->audioRmsLevels()) : QVariantList();
+}
+
+QVariantMap VideoMode::recordingStats() {
+  QVariantMap map;
+
+  if (!m_video) {
+    return map;
+  }
+
+  QtCamRecordingStats stats = m_video->recordingStats();
+
+  map["sourceFrames"] = stats.frames[QtCamRecordingStats::Source];
+  map["encoderFrames"] = stats.frames[QtCamRecordingStats::Encoder];
+  map["muxerFrames"] = stats.frames[QtCamRecordingStats::Muxer];
+  map["sourceMissingFrames"] = stats.missingFrames[QtCamRecordingStats::Source];
+  map["encoderMissingFrames"] = stats.missingFrames[QtCamRecordingStats::Encoder];
+  map["muxerMissingFrames"] = stats.missingFrames[QtCamRecordingStats::Muxer];
+  map["audioGaps"] = stats.audioGaps;
+  map["avDrift"] = stats.minAvDrift <= stats.maxAvDrift ?
+    (qint64)(stats.avDrift / (GstClockTimeDiff)GST_MSECOND) : 0;
+  map["bytesWritten"] = stats.bytesWritten;
+  map["longestWriteStall"] = stats.longestWriteStall / 1000;
+
+  int queueFill = 0;
+  foreach (int fill, stats.queueFill) {
+    queueFill = qMax(queueFill, fill);
+  }
+
+  map["queueFill"] = queueFill;
+
+  return map;
+}
+
+QString VideoMode::storagePath() const {
+  return m_storagePath;
+}
+
+void VideoMode::setStoragePath(const QString& path) {
+  if (m_storagePath != path) {
+    m_storagePath = path;
+
+    if (m_video) {
+      m_video->setStoragePath(m_storagePath);
+    }
+
+    emit storagePathChanged();
+  }
+}
+
+int VideoMode::batteryPercentage() const {
+  return m_batteryPercentage;
+}
+
+void VideoMode::setBatteryPercentage(int percentage) {
+  if (m_batteryPercentage != percentage) {
+    m_batteryPercentage = percentage;
+
+    if (m_video) {
+      m_video->setBatteryState(m_batteryPercentage, m_batteryCharging);
+    }
+
+    emit batteryStateChanged();
+  }
+}
+
+bool VideoMode::isBatteryCharging() const {
+  return m_batteryCharging;
+}
+
+void VideoMode::setBatteryCharging(bool charging) {
+  if (m_batteryCharging != charging) {
+    m_batteryCharging = charging;
+
+    if (m_video) {
+      m_video->setBatteryState(m_batteryPercentage, m_batteryCharging);
+    }
+
+    emit batteryStateChanged();
+  }
+}
+
+int VideoMode::videoBitrate() {
+  return m_video ? m_video->videoBitrate() : 0;
+}
+
+int VideoMode::remainingRecordingTime() {
+  return m_video ? (int)m_video->remainingRecordingTime() : -1;
+}
+
+bool VideoMode::isLowerResolutionSuggested() {
+  return m_video ? m_video->isLowerResolutionSuggested() : false;
+}
+
 void VideoMode::changeMode() {
   m_mode = m_cam->device()->videoMode();
 }
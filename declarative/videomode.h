@@ -24,6 +24,7 @@
 #define VIDEO_MODE_H
 
 #include "mode.h"
+#include <QVariant>
 
 class QtCamVideoMode;
 class Resolution;
@@ -32,6 +33,15 @@ class VideoMode : public Mode {
   Q_OBJECT
   Q_PROPERTY(bool recording READ isRecording NOTIFY recordingStateChanged);
   Q_PROPERTY(bool paused READ isPaused NOTIFY pauseStateChanged);
+  Q_PROPERTY(QVariantList audioPeak READ audioPeak NOTIFY audioLevelsChanged);
+  Q_PROPERTY(QVariantList audioRms READ audioRms NOTIFY audioLevelsChanged);
+  Q_PROPERTY(QVariantMap recordingStats READ recordingStats NOTIFY recordingStatsChanged);
+  Q_PROPERTY(QString storagePath READ storagePath WRITE setStoragePath NOTIFY storagePathChanged);
+  Q_PROPERTY(int batteryPercentage READ batteryPercentage WRITE setBatteryPercentage NOTIFY batteryStateChanged);
+  Q_PROPERTY(bool batteryCharging READ isBatteryCharging WRITE setBatteryCharging NOTIFY batteryStateChanged);
+  Q_PROPERTY(int videoBitrate READ videoBitrate NOTIFY bitrateGovernorChanged);
+  Q_PROPERTY(int remainingRecordingTime READ remainingRecordingTime NOTIFY bitrateGovernorChanged);
+  Q_PROPERTY(bool lowerResolutionSuggested READ isLowerResolutionSuggested NOTIFY bitrateGovernorChanged);
 
 public:
   VideoMode(QObject *parent = 0);
@@ -39,9 +49,32 @@ public:
 
   Q_INVOKABLE bool startRecording(const QString& fileName, const QString& tmpFileName);
 
+  Q_INVOKABLE bool enablePreRoll(int seconds, const QString& tmpFileName);
+  Q_INVOKABLE void disablePreRoll();
+
+  Q_INVOKABLE bool snapshot(const QString& fileName);
+
   bool isRecording();
   bool isPaused();
 
+  QVariantList audioPeak();
+  QVariantList audioRms();
+
+  QVariantMap recordingStats();
+
+  QString storagePath() const;
+  void setStoragePath(const QString& path);
+
+  int batteryPercentage() const;
+  void setBatteryPercentage(int percentage);
+
+  bool isBatteryCharging() const;
+  void setBatteryCharging(bool charging);
+
+  int videoBitrate();
+  int remainingRecordingTime();
+  bool isLowerResolutionSuggested();
+
 public slots:
   void stopRecording(bool sync);
   void pauseRecording(bool pause);
@@ -49,6 +82,12 @@ public slots:
 signals:
   void recordingStateChanged();
   void pauseStateChanged();
+  void snapshotFailed(const QString& fileName);
+  void audioLevelsChanged();
+  void recordingStatsChanged();
+  void storagePathChanged();
+  void batteryStateChanged();
+  void bitrateGovernorChanged();
 
 protected:
   virtual void preChangeMode();
@@ -58,6 +97,9 @@ protected:
 
 private:
   QtCamVideoMode *m_video;
+  QString m_storagePath;
+  int m_batteryPercentage;
+  bool m_batteryCharging;
 };
 
 #endif /* VIDEO_MODE_H */
@@ -29,7 +29,18 @@ HEADERS += qtcamconfig.h qtcamera.h qtcamscanner.h qtcamdevice.h qtcamviewfinder
            qtcamviewfinderbufferlistener.h qtcamviewfinderbufferhandler.h \
            qtcamgstsample.h qtcamnullviewfinder.h qtcamutils.h \
            qtcamviewfinderframe.h qtcamviewfinderframehandler.h \
-           qtcamviewfinderframelistener.h
+           qtcamviewfinderframelistener.h qtcamvideopreroll.h \
+           qtcamgstmessagerecorder.h qtcamroitracker.h \
+           qtcamlumaplane.h qtcamregiondetector.h \
+           qtcamsharpness.h qtcamcontrastfocus.h \
+           qtcamhistogram.h qtcamfocusassist.h \
+           qtcammotiondetector.h qtcamphasecorrelation.h \
+           qtcampanorama.h qtcampanoramastitcher.h \
+           qtcamjpegmetadata.h qtcamexposurefusion.h \
+           qtcamnightstacker.h qtcamtimelapse.h qtcamvideosnapshot.h \
+           qtcamaudiolevel.h qtcamrecordingmonitor.h qtcamfilewriter.h \
+           qtcamvideofileoutput.h qtcambitrategovernor.h qtcamjpegencoder.h \
+           qtcamjpegrotator.h
 
 SOURCES += qtcamconfig.cpp qtcamera.cpp qtcamscanner.cpp qtcamdevice.cpp qtcamviewfinder.cpp \
            qtcammode.cpp qtcamgstmessagehandler.cpp qtcamgstmessagelistener.cpp \
@@ -43,13 +54,26 @@ SOURCES += qtcamconfig.cpp qtcamera.cpp qtcamscanner.cpp qtcamdevice.cpp qtcamvi
            qtcamviewfinderbufferlistener.cpp qtcamviewfinderbufferhandler.cpp \
            qtcamgstsample.cpp qtcamnullviewfinder.cpp qtcamutils.cpp \
            qtcamviewfinderframe.cpp qtcamviewfinderframehandler.cpp \
-           qtcamviewfinderframelistener.cpp
+           qtcamviewfinderframelistener.cpp qtcamvideopreroll.cpp \
+           qtcamgstmessagerecorder.cpp qtcamroitracker.cpp \
+           qtcamlumaplane.cpp qtcamregiondetector.cpp \
+           qtcamsharpness.cpp qtcamcontrastfocus.cpp \
+           qtcamhistogram.cpp qtcamfocusassist.cpp \
+           qtcammotiondetector.cpp qtcamphasecorrelation.cpp \
+           qtcampanorama.cpp qtcampanoramastitcher.cpp \
+           qtcamjpegmetadata.cpp qtcamexposurefusion.cpp \
+           qtcamnightstacker.cpp qtcamtimelapse.cpp qtcamvideosnapshot.cpp \
+           qtcamaudiolevel.cpp qtcamrecordingmonitor.cpp qtcamfilewriter.cpp \
+           qtcamvideofileoutput.cpp qtcambitrategovernor.cpp qtcamjpegencoder.cpp \
+           qtcamjpegrotator.cpp
 
 HEADERS += qtcammode_p.h qtcamdevice_p.h qtcamcapability_p.h qtcamautofocus_p.h \
            qtcamnotifications_p.h qtcamflash_p.h qtcamroi_p.h qtcamviewfinderbufferlistener_p.h \
            qtcamconfig_p.h qtcamviewfinderrenderer_p.h qtcamviewfinderframelistener_p.h \
            qtcamvideomode_p.h
 
+LIBS += -ljpeg
+
 harmattan:LIBS += -lgstphotography-0.10
 sailfish:LIBS += -lgstphotography-1.0
 
@@ -0,0 +1,417 @@
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "qtcamaudiolevel.h"
+#include <QTimer>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+#define DEFAULT_INTERVAL         50
+// RMS is computed over 20ms windows
+#define WINDOWS_PER_SECOND       50
+#define FULL_SCALE               32767.0
+
+static inline int atomicValue(const QAtomicInt& atomic) {
+#if defined(QT4)
+  return (int)atomic;
+#else
+  return atomic.load();
+#endif
+}
+
+static inline void raise(QAtomicInt& atomic, int val) {
+  int old;
+
+  do {
+    old = atomicValue(atomic);
+    if (old >= val) {
+      return;
+    }
+  } while (!atomic.testAndSetRelaxed(old, val));
+}
+
+static inline int absolute(qint16 sample) {
+  return sample == -32768 ? 32767 : qAbs(sample);
+}
+
+QtCamAudioLevel::QtCamAudioLevel(QObject *parent) :
+  QObject(parent),
+  m_pad(0),
+  m_probe(0),
+  m_timer(new QTimer(this)),
+  m_channels(0),
+  m_rate(0),
+#if !GST_CHECK_VERSION(1,0,0)
+  m_caps(0),
+#endif
+  m_windowChannels(0),
+  m_windowFrames(0),
+  m_channelsOut(0) {
+
+  memset(m_squares, 0x0, sizeof(m_squares));
+  memset(m_windowPeak, 0x0, sizeof(m_windowPeak));
+
+  m_timer->setInterval(DEFAULT_INTERVAL);
+  QObject::connect(m_timer, SIGNAL(timeout()), this, SLOT(publish()));
+}
+
+QtCamAudioLevel::~QtCamAudioLevel() {
+  detach();
+}
+
+bool QtCamAudioLevel::attach(GstPad *pad) {
+  detach();
+
+  if (!pad) {
+    return false;
+  }
+
+  m_pad = pad;
+
+  // No probe yet so nothing else touches the streaming thread state.
+#if GST_CHECK_VERSION(1,0,0)
+  GstCaps *caps = gst_pad_get_current_caps(m_pad);
+#else
+  GstCaps *caps = gst_pad_get_negotiated_caps(m_pad);
+  m_caps = 0;
+#endif
+
+  setCaps(caps);
+
+  if (caps) {
+    gst_caps_unref(caps);
+  }
+
+  m_windowChannels = 0;
+  m_windowFrames = 0;
+
+#if GST_CHECK_VERSION(1,0,0)
+  m_probe = gst_pad_add_probe(m_pad, (GstPadProbeType)(GST_PAD_PROBE_TYPE_BUFFER |
+						       GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM),
+			      gst1_probe, this, NULL);
+#else
+  m_probe = gst_pad_add_buffer_probe(m_pad, G_CALLBACK(buffer_probe), this);
+#endif
+
+  m_timer->start();
+
+  return true;
+}
+
+void QtCamAudioLevel::detach() {
+  if (!m_pad) {
+    return;
+  }
+
+#if GST_CHECK_VERSION(1,0,0)
+  gst_pad_remove_probe(m_pad, m_probe);
+#else
+  gst_pad_remove_buffer_probe(m_pad, m_probe);
+#endif
+  gst_object_unref(m_pad);
+  m_pad = 0;
+  m_probe = 0;
+
+  m_timer->stop();
+
+  m_channelsOut.fetchAndStoreRelaxed(0);
+  for (int x = 0; x < QT_CAM_AUDIO_LEVEL_MAX_CHANNELS; x++) {
+    m_peakOut[x].fetchAndStoreRelaxed(0);
+    m_rmsOut[x].fetchAndStoreRelaxed(0);
+  }
+
+  if (!m_peak.isEmpty()) {
+    m_peak.clear();
+    m_rms.clear();
+    emit levelsChanged();
+  }
+}
+
+bool QtCamAudioLevel::isAttached() const {
+  return m_pad != 0;
+}
+
+int QtCamAudioLevel::interval() const {
+  return m_timer->interval();
+}
+
+void QtCamAudioLevel::setInterval(int msecs) {
+  m_timer->setInterval(qMax(1, msecs));
+}
+
+QList<qreal> QtCamAudioLevel::peak() const {
+  return m_peak;
+}
+
+QList<qreal> QtCamAudioLevel::rms() const {
+  return m_rms;
+}
+
+void QtCamAudioLevel::publish() {
+  int channels = atomicValue(m_channelsOut);
+
+  QList<qreal> peak;
+  QList<qreal> rms;
+
+  for (int x = 0; x < channels; x++) {
+    peak << m_peakOut[x].fetchAndStoreRelaxed(0) / FULL_SCALE;
+    rms << atomicValue(m_rmsOut[x]) / FULL_SCALE;
+  }
+
+  if (peak == m_peak && rms == m_rms) {
+    return;
+  }
+
+  m_peak = peak;
+  m_rms = rms;
+
+  emit levelsChanged();
+}
+
+void QtCamAudioLevel::setCaps(GstCaps *caps) {
+  int channels = 0;
+  int rate = 0;
+
+  if (caps && gst_caps_get_size(caps) > 0) {
+    GstStructure *s = gst_caps_get_structure(caps, 0);
+    bool supported;
+
+#if GST_CHECK_VERSION(1,0,0)
+    const gchar *format = gst_structure_get_string(s, "format");
+    supported = gst_structure_has_name(s, "audio/x-raw") && format &&
+      !strcmp(format, G_BYTE_ORDER == G_LITTLE_ENDIAN ? "S16LE" : "S16BE");
+#else
+    int width = 0, depth = 0, endianness = 0;
+    gboolean sign = FALSE;
+    supported = gst_structure_has_name(s, "audio/x-raw-int") &&
+      gst_structure_get_int(s, "width", &width) && width == 16 &&
+      gst_structure_get_int(s, "depth", &depth) && depth == 16 &&
+      gst_structure_get_boolean(s, "signed", &sign) && sign &&
+      gst_structure_get_int(s, "endianness", &endianness) && endianness == G_BYTE_ORDER;
+#endif
+
+    if (!supported || !gst_structure_get_int(s, "channels", &channels) ||
+	!gst_structure_get_int(s, "rate", &rate) ||
+	channels < 1 || channels > QT_CAM_AUDIO_LEVEL_MAX_CHANNELS || rate <= 0) {
+      channels = 0;
+      rate = 0;
+    }
+  }
+
+  m_rate.fetchAndStoreRelaxed(rate);
+  m_channels.fetchAndStoreRelease(channels);
+}
+
+#if GST_CHECK_VERSION(1,0,0)
+GstPadProbeReturn QtCamAudioLevel::gst1_probe(GstPad *pad, GstPadProbeInfo *info,
+					      gpointer user_data) {
+  Q_UNUSED(pad);
+
+  QtCamAudioLevel *level = (QtCamAudioLevel *) user_data;
+
+  if (info->type & GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM) {
+    GstEvent *event = GST_PAD_PROBE_INFO_EVENT(info);
+    if (event && GST_EVENT_TYPE(event) == GST_EVENT_CAPS) {
+      GstCaps *caps = NULL;
+      gst_event_parse_caps(event, &caps);
+      level->setCaps(caps);
+    }
+
+    return GST_PAD_PROBE_OK;
+  }
+
+  GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+  GstMapInfo map;
+
+  if (buffer && gst_buffer_map(buffer, &map, GST_MAP_READ)) {
+    level->process((const qint16 *)map.data, map.size);
+    gst_buffer_unmap(buffer, &map);
+  }
+
+  return GST_PAD_PROBE_OK;
+}
+#else
+gboolean QtCamAudioLevel::buffer_probe(GstPad *pad, GstMiniObject *mini_obj,
+				       gpointer user_data) {
+  Q_UNUSED(pad);
+
+  QtCamAudioLevel *level = (QtCamAudioLevel *) user_data;
+  GstBuffer *buffer = GST_BUFFER(mini_obj);
+
+  if (GST_BUFFER_CAPS(buffer) && GST_BUFFER_CAPS(buffer) != level->m_caps) {
+    // Only compared, never dereferenced later so no reference is needed.
+    level->m_caps = GST_BUFFER_CAPS(buffer);
+    level->setCaps(level->m_caps);
+  }
+
+  level->process((const qint16 *)GST_BUFFER_DATA(buffer), GST_BUFFER_SIZE(buffer));
+
+  return TRUE;
+}
+#endif
+
+void QtCamAudioLevel::process(const qint16 *samples, qint64 size) {
+  int channels = atomicValue(m_channels);
+  int rate = atomicValue(m_rate);
+
+  if (channels == 0 || !samples) {
+    return;
+  }
+
+  if (channels != m_windowChannels) {
+    m_windowChannels = channels;
+    m_windowFrames = 0;
+    memset(m_squares, 0x0, sizeof(m_squares));
+    memset(m_windowPeak, 0x0, sizeof(m_windowPeak));
+  }
+
+  int window = qMax(1, rate / WINDOWS_PER_SECOND);
+  int frames = size / (channels * sizeof(qint16));
+
+  while (frames > 0) {
+    int len = qMin(frames, qMax(0, window - m_windowFrames));
+
+    measure(samples, len, channels, m_squares, m_windowPeak);
+
+    samples += len * channels;
+    frames -= len;
+    m_windowFrames += len;
+
+    if (m_windowFrames < window) {
+      break;
+    }
+
+    for (int x = 0; x < channels; x++) {
+      raise(m_peakOut[x], m_windowPeak[x]);
+      m_rmsOut[x].fetchAndStoreRelaxed((int)sqrt((double)m_squares[x] / m_windowFrames));
+    }
+
+    m_channelsOut.fetchAndStoreRelease(channels);
+
+    m_windowFrames = 0;
+    memset(m_squares, 0x0, sizeof(m_squares));
+    memset(m_windowPeak, 0x0, sizeof(m_windowPeak));
+  }
+}
+
+void QtCamAudioLevel::measure(const qint16 *samples, int frames, int channels,
+			      quint64 *squares, int *peak) {
+  int x = 0;
+
+#if defined(__SSE2__)
+  if (channels <= 2) {
+    int len = frames * channels;
+    __m128i zero = _mm_setzero_si128();
+    // Selects the left samples of interleaved stereo, everything for mono.
+    __m128i mask = channels == 2 ? _mm_set1_epi32(0x0000ffff) : _mm_set1_epi32(-1);
+    __m128i sq0 = zero;
+    __m128i sq1 = zero;
+    __m128i pk = zero;
+
+    for (; x + 8 <= len; x += 8) {
+      __m128i v = _mm_loadu_si128((const __m128i *)(samples + x));
+
+      pk = _mm_max_epi16(pk, _mm_max_epi16(v, _mm_subs_epi16(zero, v)));
+
+      // The sum of two squares is at most 2^31 which fits an unsigned 32 bit lane.
+      __m128i s = _mm_madd_epi16(v, _mm_and_si128(v, mask));
+      sq0 = _mm_add_epi64(sq0, _mm_unpacklo_epi32(s, zero));
+      sq0 = _mm_add_epi64(sq0, _mm_unpackhi_epi32(s, zero));
+
+      if (channels == 2) {
+	s = _mm_madd_epi16(v, _mm_andnot_si128(mask, v));
+	sq1 = _mm_add_epi64(sq1, _mm_unpacklo_epi32(s, zero));
+	sq1 = _mm_add_epi64(sq1, _mm_unpackhi_epi32(s, zero));
+      }
+    }
+
+    quint64 sq[2][2];
+    qint16 p[8];
+    _mm_storeu_si128((__m128i *)sq[0], sq0);
+    _mm_storeu_si128((__m128i *)sq[1], sq1);
+    _mm_storeu_si128((__m128i *)p, pk);
+
+    squares[0] += sq[0][0] + sq[0][1];
+    if (channels == 2) {
+      squares[1] += sq[1][0] + sq[1][1];
+    }
+
+    for (int y = 0; y < 8; y++) {
+      int c = y % channels;
+      peak[c] = qMax(peak[c], (int)p[y]);
+    }
+
+    // Vectors hold whole frames.
+    x /= channels;
+  }
+#elif defined(__ARM_NEON__)
+  if (channels <= 2) {
+    uint64x2_t sq[2] = { vdupq_n_u64(0), vdupq_n_u64(0) };
+    int16x8_t pk[2] = { vdupq_n_s16(0), vdupq_n_s16(0) };
+
+    for (; x + 8 <= frames; x += 8) {
+      int16x8_t v[2];
+
+      if (channels == 2) {
+	int16x8x2_t lr = vld2q_s16(samples + x * 2);
+	v[0] = lr.val[0];
+	v[1] = lr.val[1];
+      } else {
+	v[0] = vld1q_s16(samples + x);
+      }
+
+      for (int c = 0; c < channels; c++) {
+	pk[c] = vmaxq_s16(pk[c], vqabsq_s16(v[c]));
+
+	int16x4_t lo = vget_low_s16(v[c]);
+	int16x4_t hi = vget_high_s16(v[c]);
+	sq[c] = vpadalq_u32(sq[c], vreinterpretq_u32_s32(vmull_s16(lo, lo)));
+	sq[c] = vpadalq_u32(sq[c], vreinterpretq_u32_s32(vmull_s16(hi, hi)));
+      }
+    }
+
+    for (int c = 0; c < channels; c++) {
+      qint16 p[8];
+      vst1q_s16(p, pk[c]);
+
+      squares[c] += vgetq_lane_u64(sq[c], 0) + vgetq_lane_u64(sq[c], 1);
+
+      for (int y = 0; y < 8; y++) {
+	peak[c] = qMax(peak[c], (int)p[y]);
+      }
+    }
+  }
+#endif
+
+  for (; x < frames; x++) {
+    for (int c = 0; c < channels; c++) {
+      qint16 sample = samples[x * channels + c];
+      squares[c] += sample * sample;
+      peak[c] = qMax(peak[c], absolute(sample));
+    }
+  }
+}
@@ -0,0 +1,106 @@
+// -*- c++ -*-
+
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#ifndef QT_CAM_AUDIO_LEVEL_H
+#define QT_CAM_AUDIO_LEVEL_H
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QList>
+#include <gst/gst.h>
+
+class QTimer;
+
+#define QT_CAM_AUDIO_LEVEL_MAX_CHANNELS       8
+
+// Peak and RMS level per channel of the signed 16 bit audio passing a pad,
+// in the 0 to 1 range. The probe neither locks nor allocates. It hands
+// its results over through atomics which a timer publishes at most once
+// per interval.
+class QtCamAudioLevel : public QObject {
+  Q_OBJECT
+
+public:
+  QtCamAudioLevel(QObject *parent = 0);
+  ~QtCamAudioLevel();
+
+  // Takes over the pad reference.
+  bool attach(GstPad *pad);
+  void detach();
+  bool isAttached() const;
+
+  int interval() const;
+  void setInterval(int msecs);
+
+  QList<qreal> peak() const;
+  QList<qreal> rms() const;
+
+  // Adds the squares of interleaved samples to squares and raises peak to
+  // the largest absolute sample, per channel. Absolute values saturate at 32767.
+  static void measure(const qint16 *samples, int frames, int channels,
+		      quint64 *squares, int *peak);
+
+signals:
+  void levelsChanged();
+
+private slots:
+  void publish();
+
+private:
+#if GST_CHECK_VERSION(1,0,0)
+  static GstPadProbeReturn gst1_probe(GstPad *pad, GstPadProbeInfo *info, gpointer user_data);
+#else
+  static gboolean buffer_probe(GstPad *pad, GstMiniObject *mini_obj, gpointer user_data);
+#endif
+
+  void setCaps(GstCaps *caps);
+  void process(const qint16 *samples, qint64 size);
+
+  GstPad *m_pad;
+  gulong m_probe;
+  QTimer *m_timer;
+
+  // Written by whoever knows the caps, read by the streaming thread.
+  QAtomicInt m_channels;
+  QAtomicInt m_rate;
+
+  // Streaming thread only.
+#if !GST_CHECK_VERSION(1,0,0)
+  GstCaps *m_caps;
+#endif
+  int m_windowChannels;
+  int m_windowFrames;
+  quint64 m_squares[QT_CAM_AUDIO_LEVEL_MAX_CHANNELS];
+  int m_windowPeak[QT_CAM_AUDIO_LEVEL_MAX_CHANNELS];
+
+  // Handed over to publish(). Peaks are the maximum since the last publish(),
+  // RMS values are from the last complete window.
+  QAtomicInt m_peakOut[QT_CAM_AUDIO_LEVEL_MAX_CHANNELS];
+  QAtomicInt m_rmsOut[QT_CAM_AUDIO_LEVEL_MAX_CHANNELS];
+  QAtomicInt m_channelsOut;
+
+  QList<qreal> m_peak;
+  QList<qreal> m_rms;
+};
+
+#endif /* QT_CAM_AUDIO_LEVEL_H */
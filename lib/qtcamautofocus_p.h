@@ -35,6 +35,7 @@
 #define GST_USE_UNSTABLE_API
 #endif /* GST_USE_UNSTABLE_API */
 #include <gst/interfaces/photography.h>
+#include "qtcamcontrastfocus.h"
 
 class QtCamAutoFocusPrivate : public QObject {
   Q_OBJECT
@@ -77,12 +78,13 @@ public:
       return false;
     }
 
-    if (!GST_IS_PHOTOGRAPHY(dev->d_ptr->videoSource)) {
-      return false;
-    }
+    GstPhotography *photo = GST_IS_PHOTOGRAPHY(dev->d_ptr->videoSource) ?
+      GST_PHOTOGRAPHY(dev->d_ptr->videoSource) : 0;
 
-    GstPhotography *photo = GST_PHOTOGRAPHY(dev->d_ptr->videoSource);
-    if (!photo) {
+    // Fall back to contrast detection if we can.
+    QtCamContrastFocus *contrast = photo ? 0 : dev->d_ptr->contrastFocus;
+
+    if (!photo && !contrast) {
       return false;
     }
 
@@ -95,7 +97,15 @@ public:
       emit q_ptr->statusChanged();
     }
 
-    gst_photography_set_autofocus(photo, enabled ? TRUE : FALSE);
+    if (photo) {
+      gst_photography_set_autofocus(photo, enabled ? TRUE : FALSE);
+    }
+    else if (enabled) {
+      contrast->start();
+    }
+    else {
+      contrast->stop();
+    }
 
     return true;
   }
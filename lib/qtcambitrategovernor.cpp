@@ -0,0 +1,257 @@
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "qtcambitrategovernor.h"
+#include <QTimer>
+#include <QFile>
+#include <QDebug>
+#include <climits>
+#include <sys/statvfs.h>
+
+#define DEFAULT_INTERVAL               5000
+#define DEFAULT_WARM_TEMPERATURE       45
+#define DEFAULT_HOT_TEMPERATURE        55
+#define DEFAULT_MINIMUM_BITRATE        2000000
+// Degrees the temperature has to drop below a limit before we go back up.
+#define THERMAL_HYSTERESIS             2
+#define BATTERY_LOW_PERCENTAGE         15
+// Try to leave room for at least this many seconds of video.
+#define MIN_RECORDING_TIME             600
+// Kept free for everybody else. The UI refuses to record below 100 MB anyway.
+#define STORAGE_RESERVE                (100 * 1024 * 1024)
+// Audio and container.
+#define OVERHEAD_BITRATE               (256 * 1024)
+// Do not chase every byte the file system gains or loses.
+#define BITRATE_STEP                   500000
+
+QtCamBitrateGovernor::QtCamBitrateGovernor(QObject *parent) :
+  QObject(parent),
+  m_timer(new QTimer(this)),
+  m_warm(DEFAULT_WARM_TEMPERATURE),
+  m_hot(DEFAULT_HOT_TEMPERATURE),
+  m_batteryPercentage(100),
+  m_charging(false),
+  m_nominalBitrate(0),
+  m_minimumBitrate(DEFAULT_MINIMUM_BITRATE),
+  m_bitrate(0),
+  m_remainingTime(-1),
+  m_temperature(INT_MIN),
+  m_thermalState(Normal),
+  m_lowerResolution(false) {
+
+  m_timer->setInterval(DEFAULT_INTERVAL);
+  QObject::connect(m_timer, SIGNAL(timeout()), this, SLOT(update()));
+}
+
+QtCamBitrateGovernor::~QtCamBitrateGovernor() {
+  stop();
+}
+
+void QtCamBitrateGovernor::setThermalZone(const QString& path) {
+  m_thermalZone = path;
+}
+
+QString QtCamBitrateGovernor::thermalZone() const {
+  return m_thermalZone;
+}
+
+void QtCamBitrateGovernor::setThermalLimits(int warm, int hot) {
+  m_warm = warm;
+  m_hot = qMax(warm, hot);
+}
+
+void QtCamBitrateGovernor::setStoragePath(const QString& path) {
+  m_storagePath = path;
+}
+
+QString QtCamBitrateGovernor::storagePath() const {
+  return m_storagePath;
+}
+
+void QtCamBitrateGovernor::setBatteryState(int percentage, bool charging) {
+  m_batteryPercentage = percentage;
+  m_charging = charging;
+}
+
+void QtCamBitrateGovernor::setNominalBitrate(int bitrate) {
+  m_nominalBitrate = bitrate;
+}
+
+int QtCamBitrateGovernor::nominalBitrate() const {
+  return m_nominalBitrate;
+}
+
+void QtCamBitrateGovernor::setMinimumBitrate(int bitrate) {
+  m_minimumBitrate = bitrate;
+}
+
+int QtCamBitrateGovernor::minimumBitrate() const {
+  return m_minimumBitrate;
+}
+
+void QtCamBitrateGovernor::setInterval(int msecs) {
+  m_timer->setInterval(msecs);
+}
+
+int QtCamBitrateGovernor::interval() const {
+  return m_timer->interval();
+}
+
+void QtCamBitrateGovernor::start() {
+  update();
+
+  m_timer->start();
+}
+
+void QtCamBitrateGovernor::stop() {
+  m_timer->stop();
+}
+
+int QtCamBitrateGovernor::bitrate() const {
+  return m_bitrate;
+}
+
+qint64 QtCamBitrateGovernor::remainingTime() const {
+  return m_remainingTime;
+}
+
+int QtCamBitrateGovernor::temperature() const {
+  return m_temperature;
+}
+
+QtCamBitrateGovernor::ThermalState QtCamBitrateGovernor::thermalState() const {
+  return m_thermalState;
+}
+
+bool QtCamBitrateGovernor::isLowerResolutionSuggested() const {
+  return m_lowerResolution;
+}
+
+void QtCamBitrateGovernor::update() {
+  m_temperature = readTemperature();
+  m_thermalState = toThermalState(m_temperature);
+
+  qint64 space = m_storagePath.isEmpty() ? -1 : freeSpace(m_storagePath);
+  if (space >= 0) {
+    space = qMax(Q_INT64_C(0), space - STORAGE_RESERVE);
+  }
+
+  int bitrate = m_nominalBitrate;
+  bool storageBound = false;
+
+  if (bitrate > 0) {
+    switch (m_thermalState) {
+    case Hot:
+      bitrate /= 2;
+      break;
+
+    case Warm:
+      bitrate = bitrate / 4 * 3;
+      break;
+
+    case Normal:
+      break;
+    }
+
+    if (!m_charging && m_batteryPercentage <= BATTERY_LOW_PERCENTAGE) {
+      bitrate = bitrate / 4 * 3;
+    }
+
+    if (space >= 0) {
+      qint64 fit = space * 8 / MIN_RECORDING_TIME - OVERHEAD_BITRATE;
+      if (fit < bitrate) {
+	bitrate = (int)qMax(Q_INT64_C(0), fit);
+	storageBound = true;
+      }
+    }
+
+    if (bitrate < m_nominalBitrate) {
+      bitrate = bitrate / BITRATE_STEP * BITRATE_STEP;
+    }
+
+    bitrate = qMax(bitrate, qMin(m_minimumBitrate, m_nominalBitrate));
+  }
+
+  qint64 remaining = -1;
+  if (space >= 0 && bitrate > 0) {
+    remaining = space * 8 / ((qint64)bitrate + OVERHEAD_BITRATE);
+  }
+
+  m_lowerResolution = m_thermalState == Hot ||
+    (storageBound && bitrate <= m_minimumBitrate);
+
+  if (bitrate != m_bitrate) {
+    m_bitrate = bitrate;
+    emit bitrateChanged();
+  }
+
+  if (remaining != m_remainingTime) {
+    m_remainingTime = remaining;
+    emit remainingTimeChanged();
+  }
+}
+
+qint64 QtCamBitrateGovernor::freeSpace(const QString& path) {
+  struct statvfs buf;
+
+  if (statvfs(QFile::encodeName(path).constData(), &buf) == -1) {
+    return -1;
+  }
+
+  return (qint64)buf.f_bavail * (qint64)buf.f_frsize;
+}
+
+int QtCamBitrateGovernor::readTemperature() {
+  if (m_thermalZone.isEmpty()) {
+    return INT_MIN;
+  }
+
+  QFile file(m_thermalZone + "/temp");
+  if (!file.open(QFile::ReadOnly)) {
+    return INT_MIN;
+  }
+
+  bool ok = false;
+  int temp = file.readAll().trimmed().toInt(&ok);
+  if (!ok) {
+    return INT_MIN;
+  }
+
+  return temp / 1000;
+}
+
+QtCamBitrateGovernor::ThermalState QtCamBitrateGovernor::toThermalState(int temperature) {
+  if (temperature == INT_MIN) {
+    return Normal;
+  }
+
+  // Only cool down once we are clearly below the limit.
+  int warm = m_thermalState >= Warm ? m_warm - THERMAL_HYSTERESIS : m_warm;
+  int hot = m_thermalState == Hot ? m_hot - THERMAL_HYSTERESIS : m_hot;
+
+  if (temperature >= hot) {
+    return Hot;
+  } else if (temperature >= warm) {
+    return Warm;
+  }
+
+  return Normal;
+}
@@ -0,0 +1,118 @@
+// -*- c++ -*-
+
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#ifndef QT_CAM_BITRATE_GOVERNOR_H
+#define QT_CAM_BITRATE_GOVERNOR_H
+
+#include <QObject>
+#include <QString>
+
+class QTimer;
+
+// Picks the video bitrate from the free space at the storage path, the
+// battery state and the temperature of a thermal zone. The bitrate never
+// exceeds the nominal bitrate the encoder was configured with. The
+// governor only decides. Applying the bitrate is up to the caller.
+class QtCamBitrateGovernor : public QObject {
+  Q_OBJECT
+
+public:
+  typedef enum {
+    Normal,
+    Warm,
+    Hot
+  } ThermalState;
+
+  QtCamBitrateGovernor(QObject *parent = 0);
+  ~QtCamBitrateGovernor();
+
+  // Directory of a sysfs thermal zone. Its temp file is in millidegrees Celsius.
+  void setThermalZone(const QString& path);
+  QString thermalZone() const;
+
+  // Temperatures in degrees Celsius.
+  void setThermalLimits(int warm, int hot);
+
+  void setStoragePath(const QString& path);
+  QString storagePath() const;
+
+  void setBatteryState(int percentage, bool charging);
+
+  void setNominalBitrate(int bitrate);
+  int nominalBitrate() const;
+
+  void setMinimumBitrate(int bitrate);
+  int minimumBitrate() const;
+
+  void setInterval(int msecs);
+  int interval() const;
+
+  void start();
+  void stop();
+
+  // In bits per second.
+  int bitrate() const;
+
+  // Recording time left at the current bitrate in seconds. -1 if unknown.
+  qint64 remainingTime() const;
+
+  // Degrees Celsius or INT_MIN if not available.
+  int temperature() const;
+  ThermalState thermalState() const;
+
+  // The bitrate alone cannot cope. A lower resolution would help next time.
+  bool isLowerResolutionSuggested() const;
+
+public slots:
+  void update();
+
+signals:
+  void bitrateChanged();
+  void remainingTimeChanged();
+
+protected:
+  // Available bytes for unprivileged users or -1 on error.
+  virtual qint64 freeSpace(const QString& path);
+
+private:
+  int readTemperature();
+  ThermalState toThermalState(int temperature);
+
+  QTimer *m_timer;
+  QString m_thermalZone;
+  int m_warm;
+  int m_hot;
+  QString m_storagePath;
+  int m_batteryPercentage;
+  bool m_charging;
+  int m_nominalBitrate;
+  int m_minimumBitrate;
+
+  int m_bitrate;
+  qint64 m_remainingTime;
+  int m_temperature;
+  ThermalState m_thermalState;
+  bool m_lowerResolution;
+};
+
+#endif /* QT_CAM_BITRATE_GOVERNOR_H */
@@ -65,125 +65,185 @@ QString QtCamConfig::lookUp(const QString& path) const {
 }
 
 QString QtCamConfig::deviceScannerType() const {
-  return d_ptr->confValue("devices/scanner").toString();
+  return d_ptr->values.deviceScannerType;
 }
 
 QString QtCamConfig::deviceScannerProperty() const {
-  return d_ptr->confValue("devices/property").toString();
+  return d_ptr->values.deviceScannerProperty;
 }
 
 QString QtCamConfig::videoSource() const {
-  return d_ptr->confValue("video-source/element").toString();
+  return d_ptr->values.videoSource;
 }
 
 QString QtCamConfig::viewfinderSink() const {
-  return d_ptr->confValue("viewfinder-sink/element").toString();
+  return d_ptr->values.viewfinderSink;
 }
 
 QString QtCamConfig::viewfinderRenderer() const {
-  return d_ptr->confValue("viewfinder-sink/renderer").toString();
+  return d_ptr->values.viewfinderRenderer;
 }
 
 bool QtCamConfig::viewfinderUseFence() const {
-  return d_ptr->confValue("viewfinder-sink/use-fence").toBool();
+  return d_ptr->values.viewfinderUseFence;
 }
 
 QString QtCamConfig::audioSource() const {
-  return d_ptr->confValue("audio-source/element").toString();
+  return d_ptr->values.audioSource;
 }
 
 QString QtCamConfig::wrapperVideoSource() const {
-  return d_ptr->confValue("wrapper-video-source/element").toString();
+  return d_ptr->values.wrapperVideoSource;
 }
 
 QString QtCamConfig::wrapperVideoSourceProperty() const {
-  return d_ptr->confValue("wrapper-video-source/property").toString();
+  return d_ptr->values.wrapperVideoSourceProperty;
 }
 
 QString QtCamConfig::imageEncodingProfileName() const {
-  return d_ptr->confValue("image/profile-name").toString();
+  return d_ptr->values.imageEncodingProfileName;
 }
 
 QString QtCamConfig::imageEncodingProfilePath() const {
-  return d_ptr->confValue("image/profile-path").toString();
+  return d_ptr->values.imageEncodingProfilePath;
 }
 
 QString QtCamConfig::videoEncodingProfileName() const {
-  return d_ptr->confValue("video/profile-name").toString();
+  return d_ptr->values.videoEncodingProfileName;
 }
 
 QString QtCamConfig::videoEncodingProfilePath() const {
-  return d_ptr->confValue("video/profile-path").toString();
+  return d_ptr->values.videoEncodingProfilePath;
+}
+
+qint64 QtCamConfig::videoPreRollMaxSize() const {
+  return d_ptr->values.videoPreRollMaxSize;
+}
+
+QString QtCamConfig::messageRecorderFile() const {
+  return d_ptr->values.messageRecorderFile;
+}
+
+bool QtCamConfig::recordingStats() const {
+  return d_ptr->values.recordingStats;
+}
+
+int QtCamConfig::videoOutputBufferSize() const {
+  return d_ptr->values.videoOutputBufferSize;
+}
+
+QString QtCamConfig::bitrateGovernorThermalZone() const {
+  return d_ptr->values.bitrateGovernorThermalZone;
+}
+
+int QtCamConfig::bitrateGovernorWarmTemperature() const {
+  return d_ptr->values.bitrateGovernorWarmTemperature;
+}
+
+int QtCamConfig::bitrateGovernorHotTemperature() const {
+  return d_ptr->values.bitrateGovernorHotTemperature;
+}
+
+int QtCamConfig::bitrateGovernorMinimumBitrate() const {
+  return d_ptr->values.bitrateGovernorMinimumBitrate;
+}
+
+int QtCamConfig::bitrateGovernorMaximumBitrate() const {
+  return d_ptr->values.bitrateGovernorMaximumBitrate;
+}
+
+int QtCamConfig::bitrateGovernorBitrateScale() const {
+  return d_ptr->values.bitrateGovernorBitrateScale;
 }
 
 QString QtCamConfig::audioCaptureCaps() const {
-  return d_ptr->confValue("audio-capture-caps/caps").toString();
+  return d_ptr->values.audioCaptureCaps;
 }
 
 QString QtCamConfig::imageSuffix() const {
-  return d_ptr->confValue("image/extension").toString();
+  return d_ptr->values.imageSuffix;
 }
 
 QString QtCamConfig::videoSuffix() const {
-  return d_ptr->confValue("video/extension").toString();
+  return d_ptr->values.videoSuffix;
 }
 
 QStringList QtCamConfig::viewfinderFilters() const {
-  return d_ptr->confValue("viewfinder-filters/elements").toStringList();
+  return d_ptr->values.viewfinderFilters;
 }
 
 bool QtCamConfig::viewfinderFiltersUseAnalysisBin() const {
-  return d_ptr->confValue("viewfinder-filters/use-analysis-bin").toBool();
+  return d_ptr->values.viewfinderFiltersUseAnalysisBin;
 }
 
 QStringList QtCamConfig::imageFilters() const {
-  return d_ptr->confValue("image-filters/elements").toStringList();
+  return d_ptr->values.imageFilters;
 }
 
 bool QtCamConfig::imageFiltersUseAnalysisBin() const {
-  return d_ptr->confValue("image-filters/use-analysis-bin").toBool();
+  return d_ptr->values.imageFiltersUseAnalysisBin;
 }
 
 QString QtCamConfig::roiElement() const {
-  return d_ptr->confValue("roi/element").toString();
+  return d_ptr->values.roiElement;
 }
 
 QString QtCamConfig::roiMessageName() const {
-  return d_ptr->confValue("roi/message").toString();
+  return d_ptr->values.roiMessage;
 }
 
 QString QtCamConfig::roiEnableProperty() const {
-  return d_ptr->confValue("roi/enable").toString();
+  return d_ptr->values.roiEnableProperty;
 }
 
 QString QtCamConfig::roiMessage() const {
-  return d_ptr->confValue("roi/message").toString();
+  return d_ptr->values.roiMessage;
+}
+
+bool QtCamConfig::roiSoftwareDetection() const {
+  return d_ptr->values.roiSoftwareDetection;
+}
+
+int QtCamConfig::roiSoftwareScale() const {
+  return d_ptr->values.roiSoftwareScale;
+}
+
+int QtCamConfig::roiSoftwareInterval() const {
+  return d_ptr->values.roiSoftwareInterval;
+}
+
+QString QtCamConfig::roiSoftwareMessage() const {
+  return d_ptr->values.roiSoftwareMessage;
+}
+
+QString QtCamConfig::softwareFocusProperty() const {
+  return d_ptr->values.softwareFocusProperty;
 }
 
 bool QtCamConfig::isPreviewSupported() const {
-  return d_ptr->confValue("General/preview-supported").toBool();
+  return d_ptr->values.previewSupported;
 }
 
 QString QtCamConfig::mediaType(const QString& id) const {
-  return d_ptr->confValue(QString("media-type/%1").arg(id)).toString();
+  return d_ptr->values.mediaTypes.value(id);
 }
 
 QString QtCamConfig::mediaFourcc(const QString& id) const {
-  return d_ptr->confValue(QString("media-type/%1-fourcc").arg(id)).toString();
+  return d_ptr->values.mediaFourccs.value(id);
 }
 
 QString QtCamConfig::fastCaptureProperty() const {
-  return d_ptr->confValue("fast-capture/property").toString();
+  return d_ptr->values.fastCaptureProperty;
 }
 
 QString QtCamConfig::resolutionsProvider() const {
-  return d_ptr->confValue("resolutions/provider").toString();
+  return d_ptr->values.resolutionsProvider;
 }
 
 int QtCamConfig::resolutionsImageFps() const {
-  return d_ptr->confValue("resolutions/imageFps").toInt();
+  return d_ptr->values.resolutionsImageFps;
 }
 
 int QtCamConfig::resolutionsVideoFps() const {
-  return d_ptr->confValue("resolutions/videoFps").toInt();
+  return d_ptr->values.resolutionsVideoFps;
 }
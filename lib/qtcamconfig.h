@@ -67,6 +67,20 @@ public:
   QString videoEncodingProfileName() const;
   QString videoEncodingProfilePath() const;
 
+  qint64 videoPreRollMaxSize() const;
+
+  QString messageRecorderFile() const;
+  bool recordingStats() const;
+
+  int videoOutputBufferSize() const;
+
+  QString bitrateGovernorThermalZone() const;
+  int bitrateGovernorWarmTemperature() const;
+  int bitrateGovernorHotTemperature() const;
+  int bitrateGovernorMinimumBitrate() const;
+  int bitrateGovernorMaximumBitrate() const;
+  int bitrateGovernorBitrateScale() const;
+
   QString imageSuffix() const;
   QString videoSuffix() const;
 
@@ -82,6 +96,12 @@ public:
   QString roiMessageName() const;
   QString roiEnableProperty() const;
   QString roiMessage() const;
+  bool roiSoftwareDetection() const;
+  int roiSoftwareScale() const;
+  int roiSoftwareInterval() const;
+  QString roiSoftwareMessage() const;
+
+  QString softwareFocusProperty() const;
 
   bool isPreviewSupported() const;
 
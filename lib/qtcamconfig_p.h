@@ -25,9 +25,83 @@
 
 #include <QSettings>
 #include <QFile>
+#include <QHash>
+#include <QStringList>
 #include "qtcamresolution.h"
 #include "qtcamutils.h"
 
+// Everything QtCamConfig getters return. It is read once from the ini files
+// so the getters do not have to go through QSettings on every call.
+class QtCamConfigValues {
+public:
+  QtCamConfigValues() :
+    viewfinderUseFence(false),
+    videoPreRollMaxSize(0),
+    recordingStats(false),
+    videoOutputBufferSize(0),
+    bitrateGovernorWarmTemperature(0),
+    bitrateGovernorHotTemperature(0),
+    bitrateGovernorMinimumBitrate(0),
+    bitrateGovernorMaximumBitrate(0),
+    bitrateGovernorBitrateScale(1),
+    viewfinderFiltersUseAnalysisBin(false),
+    imageFiltersUseAnalysisBin(false),
+    roiSoftwareDetection(false),
+    roiSoftwareScale(4),
+    roiSoftwareInterval(200),
+    previewSupported(false),
+    resolutionsImageFps(0),
+    resolutionsVideoFps(0) {
+
+  }
+
+  QString deviceScannerType;
+  QString deviceScannerProperty;
+  QString videoSource;
+  QString viewfinderSink;
+  QString viewfinderRenderer;
+  bool viewfinderUseFence;
+  QString audioSource;
+  QString wrapperVideoSource;
+  QString wrapperVideoSourceProperty;
+  QString imageEncodingProfileName;
+  QString imageEncodingProfilePath;
+  QString videoEncodingProfileName;
+  QString videoEncodingProfilePath;
+  qint64 videoPreRollMaxSize;
+  QString messageRecorderFile;
+  bool recordingStats;
+  int videoOutputBufferSize;
+  QString bitrateGovernorThermalZone;
+  int bitrateGovernorWarmTemperature;
+  int bitrateGovernorHotTemperature;
+  int bitrateGovernorMinimumBitrate;
+  int bitrateGovernorMaximumBitrate;
+  int bitrateGovernorBitrateScale;
+  QString audioCaptureCaps;
+  QString imageSuffix;
+  QString videoSuffix;
+  QStringList viewfinderFilters;
+  bool viewfinderFiltersUseAnalysisBin;
+  QStringList imageFilters;
+  bool imageFiltersUseAnalysisBin;
+  QString roiElement;
+  QString roiMessage;
+  QString roiEnableProperty;
+  bool roiSoftwareDetection;
+  int roiSoftwareScale;
+  int roiSoftwareInterval;
+  QString roiSoftwareMessage;
+  QString softwareFocusProperty;
+  bool previewSupported;
+  QHash<QString, QString> mediaTypes;
+  QHash<QString, QString> mediaFourccs;
+  QString fastCaptureProperty;
+  QString resolutionsProvider;
+  int resolutionsImageFps;
+  int resolutionsVideoFps;
+};
+
 class QtCamConfigPrivate {
 public:
   QtCamConfigPrivate(QtCamConfig *q) :
@@ -48,6 +122,8 @@ public:
     path = QString("%1/%2").arg(dir).arg("qtcamera.ini");
     genericConf = new QSettings(path, QSettings::IniFormat, q_ptr);
 
+    loadValues();
+
     // Now that we have our conf pointers set, we can try to read
     if (q_ptr->resolutionsProvider() == RESOLUTIONS_PROVIDER_INI) {
       resolutions = new QSettings(q_ptr->lookUp("resolutions.ini"), QSettings::IniFormat, q_ptr);
@@ -63,6 +139,89 @@ public:
     return val;
   }
 
+  void loadValues() {
+    values.deviceScannerType = confValue("devices/scanner").toString();
+    values.deviceScannerProperty = confValue("devices/property").toString();
+    values.videoSource = confValue("video-source/element").toString();
+    values.viewfinderSink = confValue("viewfinder-sink/element").toString();
+    values.viewfinderRenderer = confValue("viewfinder-sink/renderer").toString();
+    values.viewfinderUseFence = confValue("viewfinder-sink/use-fence").toBool();
+    values.audioSource = confValue("audio-source/element").toString();
+    values.wrapperVideoSource = confValue("wrapper-video-source/element").toString();
+    values.wrapperVideoSourceProperty = confValue("wrapper-video-source/property").toString();
+    values.imageEncodingProfileName = confValue("image/profile-name").toString();
+    values.imageEncodingProfilePath = confValue("image/profile-path").toString();
+    values.videoEncodingProfileName = confValue("video/profile-name").toString();
+    values.videoEncodingProfilePath = confValue("video/profile-path").toString();
+    values.videoPreRollMaxSize = confValue("video-preroll/max-size").toLongLong();
+    values.messageRecorderFile = confValue("debug/record-messages").toString();
+    values.recordingStats = confValue("debug/recording-stats").toBool();
+    values.videoOutputBufferSize = confValue("video-output/buffer-size").toInt();
+    values.bitrateGovernorThermalZone = confValue("bitrate-governor/thermal-zone").toString();
+    values.bitrateGovernorWarmTemperature = confValue("bitrate-governor/warm-temperature").toInt();
+    values.bitrateGovernorHotTemperature = confValue("bitrate-governor/hot-temperature").toInt();
+    values.bitrateGovernorMinimumBitrate = confValue("bitrate-governor/minimum-bitrate").toInt();
+    values.bitrateGovernorMaximumBitrate = confValue("bitrate-governor/maximum-bitrate").toInt();
+    QVariant bitrateScale = confValue("bitrate-governor/bitrate-scale");
+    values.bitrateGovernorBitrateScale = bitrateScale.isValid() ? qMax(1, bitrateScale.toInt()) : 1;
+    values.audioCaptureCaps = confValue("audio-capture-caps/caps").toString();
+    values.imageSuffix = confValue("image/extension").toString();
+    values.videoSuffix = confValue("video/extension").toString();
+    values.viewfinderFilters = confValue("viewfinder-filters/elements").toStringList();
+    values.viewfinderFiltersUseAnalysisBin =
+      confValue("viewfinder-filters/use-analysis-bin").toBool();
+    values.imageFilters = confValue("image-filters/elements").toStringList();
+    values.imageFiltersUseAnalysisBin = confValue("image-filters/use-analysis-bin").toBool();
+    values.roiElement = confValue("roi/element").toString();
+    QVariant roiMessage = confValue("roi/message");
+    values.roiMessage = roiMessage.isValid() ?
+      roiMessage.toString() : QString("regions-of-interest");
+    values.roiEnableProperty = confValue("roi/enable").toString();
+    values.roiSoftwareDetection = confValue("roi/software-detection").toBool();
+    values.softwareFocusProperty = confValue("focus/software-property").toString();
+    QVariant scale = confValue("roi/software-scale");
+    values.roiSoftwareScale = scale.isValid() ? scale.toInt() : 4;
+    QVariant interval = confValue("roi/software-interval");
+    values.roiSoftwareInterval = interval.isValid() ? interval.toInt() : 200;
+    // Posted where QtCamRoi listens unless configured otherwise.
+    QVariant softwareMessage = confValue("roi/software-message");
+    values.roiSoftwareMessage = softwareMessage.isValid() ?
+      softwareMessage.toString() : values.roiMessage;
+    values.previewSupported = confValue("General/preview-supported").toBool();
+    values.fastCaptureProperty = confValue("fast-capture/property").toString();
+    values.resolutionsProvider = confValue("resolutions/provider").toString();
+    values.resolutionsImageFps = confValue("resolutions/imageFps").toInt();
+    values.resolutionsVideoFps = confValue("resolutions/videoFps").toInt();
+
+    // Generic first so that the device specific values override them
+    loadMediaTypes(genericConf);
+    loadMediaTypes(deviceConf);
+  }
+
+  void loadMediaTypes(QSettings *conf) {
+    if (!conf) {
+      return;
+    }
+
+    conf->beginGroup("media-type");
+
+    foreach (const QString& key, conf->childKeys()) {
+      QVariant val = conf->value(key);
+      if (!val.isValid()) {
+	continue;
+      }
+
+      if (key.endsWith("-fourcc")) {
+	values.mediaFourccs[key.left(key.length() - 7)] = val.toString();
+      }
+      else {
+	values.mediaTypes[key] = val.toString();
+      }
+    }
+
+    conf->endGroup();
+  }
+
   QSize readResolution(const QString key) {
     QList<QString> parts = resolutions->value(key).toString().trimmed().split("x");
     return QSize(parts[0].toInt(), parts[1].toInt());
@@ -130,6 +289,7 @@ public:
   }
 
   QString model;
+  QtCamConfigValues values;
 
 private:
   QtCamConfig *q_ptr;
@@ -0,0 +1,192 @@
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "qtcamcontrastfocus.h"
+#include "qtcamgstsample.h"
+#include "qtcamsharpness.h"
+#include <QDebug>
+
+#ifndef GST_USE_UNSTABLE_API
+#define GST_USE_UNSTABLE_API
+#endif /* GST_USE_UNSTABLE_API */
+#include <gst/interfaces/photography.h>
+
+#define COARSE_STEPS                  9
+#define FINE_STEPS                    7
+// Frames to drop after moving the lens
+#define SETTLE_FRAMES                 2
+// Anything flatter than that means we had nothing to focus on.
+#define MIN_CONTRAST_GAIN             1.05
+
+QtCamContrastFocus::QtCamContrastFocus(GstElement *bin, GstElement *source,
+				       const QString& property) :
+  m_bin(bin),
+  m_source(source),
+  m_property(property.toUtf8()),
+  m_min(0),
+  m_max(0),
+  m_valid(false),
+  m_state(Idle),
+  m_skip(0),
+  m_coarseStep(0),
+  m_coarseMin(0),
+  m_coarseMax(0) {
+
+  gst_object_ref(m_bin);
+  gst_object_ref(m_source);
+
+  GParamSpec *pspec = g_object_class_find_property(G_OBJECT_GET_CLASS(m_source),
+						   m_property.constData());
+  if (!pspec || !G_IS_PARAM_SPEC_INT(pspec)) {
+    qWarning() << "Focus property" << property << "is not an integer";
+    return;
+  }
+
+  m_min = G_PARAM_SPEC_INT(pspec)->minimum;
+  m_max = G_PARAM_SPEC_INT(pspec)->maximum;
+  m_valid = m_max > m_min;
+}
+
+QtCamContrastFocus::~QtCamContrastFocus() {
+  gst_object_unref(m_source);
+  gst_object_unref(m_bin);
+}
+
+bool QtCamContrastFocus::isValid() const {
+  return m_valid;
+}
+
+void QtCamContrastFocus::start() {
+  if (!m_valid) {
+    return;
+  }
+
+  QMutexLocker locker(&m_mutex);
+
+  m_positions = positions(m_min, m_max, COARSE_STEPS);
+  m_coarseStep = (m_max - m_min) / (COARSE_STEPS - 1);
+  m_scores.clear();
+  m_state = Coarse;
+
+  moveTo(m_positions.first());
+}
+
+void QtCamContrastFocus::stop() {
+  QMutexLocker locker(&m_mutex);
+
+  m_state = Idle;
+}
+
+void QtCamContrastFocus::setRegion(const QRectF& region) {
+  QMutexLocker locker(&m_mutex);
+
+  m_region = region;
+}
+
+void QtCamContrastFocus::handleSample(const QtCamGstSample *sample) {
+  QMutexLocker locker(&m_mutex);
+
+  if (m_state == Idle) {
+    return;
+  }
+
+  if (m_skip > 0) {
+    --m_skip;
+    return;
+  }
+
+  QRectF region = m_region.isEmpty() ? QRectF(1.0/3.0, 1.0/3.0, 1.0/3.0, 1.0/3.0) : m_region;
+  QRect area(region.x() * sample->width(), region.y() * sample->height(),
+	     region.width() * sample->width(), region.height() * sample->height());
+
+  if (!m_plane.scale(sample, 1, area)) {
+    qWarning() << "Cannot measure sharpness of viewfinder frames";
+    m_state = Idle;
+    locker.unlock();
+    post(GST_PHOTOGRAPHY_FOCUS_STATUS_FAIL);
+    return;
+  }
+
+  m_scores << QtCamSharpness::measure(m_plane);
+
+  if (m_scores.size() < m_positions.size()) {
+    moveTo(m_positions[m_scores.size()]);
+    return;
+  }
+
+  int best = 0;
+  for (int x = 1; x < m_scores.size(); x++) {
+    if (m_scores[x] > m_scores[best]) {
+      best = x;
+    }
+  }
+
+  int position = m_positions[best];
+
+  if (m_state == Coarse) {
+    m_coarseMin = m_coarseMax = m_scores[best];
+    foreach (double score, m_scores) {
+      m_coarseMin = qMin(m_coarseMin, score);
+    }
+
+    m_positions = positions(qMax(m_min, position - m_coarseStep),
+			    qMin(m_max, position + m_coarseStep), FINE_STEPS);
+    m_scores.clear();
+    m_state = Fine;
+    moveTo(m_positions.first());
+    return;
+  }
+
+  moveTo(position);
+  m_state = Idle;
+
+  bool success = m_coarseMax > m_coarseMin * MIN_CONTRAST_GAIN;
+
+  locker.unlock();
+
+  post(success ? GST_PHOTOGRAPHY_FOCUS_STATUS_SUCCESS : GST_PHOTOGRAPHY_FOCUS_STATUS_FAIL);
+}
+
+QList<int> QtCamContrastFocus::positions(int from, int to, int count) {
+  QList<int> list;
+
+  for (int x = 0; x < count; x++) {
+    int position = from + (qint64)(to - from) * x / (count - 1);
+    if (list.isEmpty() || list.last() != position) {
+      list << position;
+    }
+  }
+
+  return list;
+}
+
+void QtCamContrastFocus::moveTo(int position) {
+  g_object_set(m_source, m_property.constData(), position, NULL);
+
+  m_skip = SETTLE_FRAMES;
+}
+
+void QtCamContrastFocus::post(int status) {
+  GstStructure *s = gst_structure_new(GST_PHOTOGRAPHY_AUTOFOCUS_DONE,
+				      "status", G_TYPE_INT, status,
+				      NULL);
+
+  gst_element_post_message(m_bin, gst_message_new_element(GST_OBJECT(m_bin), s));
+}
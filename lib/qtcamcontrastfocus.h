@@ -0,0 +1,83 @@
+// -*- c++ -*-
+
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef QT_CAM_CONTRAST_FOCUS_H
+#define QT_CAM_CONTRAST_FOCUS_H
+
+#include <QMutex>
+#include <QList>
+#include <QRectF>
+#include <gst/gst.h>
+#include "qtcamviewfinderbufferhandler.h"
+#include "qtcamlumaplane.h"
+
+// Contrast detection autofocus for sources that only expose a manual focus property.
+// Sweeps the lens over the whole range in coarse steps and then around the sharpest
+// position in finer steps, measuring sharpness of the region of interest on viewfinder
+// frames. The outcome is posted as an autofocus-done message, just like GstPhotography
+// sources do, so QtCamAutoFocus reports it the usual way.
+class QtCamContrastFocus : public QtCamViewfinderBufferHandler {
+public:
+  QtCamContrastFocus(GstElement *bin, GstElement *source, const QString& property);
+  ~QtCamContrastFocus();
+
+  bool isValid() const;
+
+  void start();
+  void stop();
+
+  // Normalized. An empty region means the center of the frame.
+  void setRegion(const QRectF& region);
+
+  void handleSample(const QtCamGstSample *sample);
+
+private:
+  typedef enum {
+    Idle,
+    Coarse,
+    Fine,
+  } State;
+
+  static QList<int> positions(int from, int to, int count);
+  void moveTo(int position);
+  void post(int status);
+
+  GstElement *m_bin;
+  GstElement *m_source;
+  QByteArray m_property;
+  int m_min;
+  int m_max;
+  bool m_valid;
+
+  QMutex m_mutex;
+  State m_state;
+  QRectF m_region;
+  QList<int> m_positions;
+  QList<double> m_scores;
+  int m_skip;
+  int m_coarseStep;
+  double m_coarseMin;
+  double m_coarseMax;
+  QtCamLumaPlane m_plane;
+};
+
+#endif /* QT_CAM_CONTRAST_FOCUS_H */
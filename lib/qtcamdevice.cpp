@@ -25,9 +25,13 @@
 #include <QDebug>
 #include <gst/gst.h>
 #include "qtcamgstmessagelistener.h"
+#include "qtcamgstmessagerecorder.h"
+#include "qtcamregiondetector.h"
+#include "qtcamcontrastfocus.h"
 #include "qtcammode.h"
 #include "qtcamimagemode.h"
 #include "qtcamvideomode.h"
+#include "qtcamvideomode_p.h"
 #include "qtcamnotifications.h"
 #include "qtcampropertysetter.h"
 #include "qtcamviewfinderbufferlistener.h"
@@ -114,9 +118,46 @@ QtCamDevice::QtCamDevice(QtCamConfig *config, const QString& name,
   }
 
   d_ptr->bufferListener = new QtCamViewfinderBufferListener(d_ptr, this);
+
+  // QtCamRoi is the only consumer of the detected regions.
+  if (d_ptr->conf->roiSoftwareDetection() &&
+      d_ptr->conf->roiSoftwareMessage() != d_ptr->conf->roiMessage()) {
+    qWarning() << "Software region detection disabled: nothing listens to"
+	       << d_ptr->conf->roiSoftwareMessage();
+  }
+  else if (d_ptr->conf->roiSoftwareDetection()) {
+    d_ptr->regionDetector = new QtCamRegionDetector(d_ptr->cameraBin,
+						    d_ptr->conf->roiSoftwareMessage(),
+						    d_ptr->conf->roiSoftwareScale(),
+						    d_ptr->conf->roiSoftwareInterval());
+    d_ptr->bufferListener->addHandler(d_ptr->regionDetector);
+  }
+
+  if (d_ptr->videoSource && !d_ptr->conf->softwareFocusProperty().isEmpty()) {
+    d_ptr->contrastFocus = new QtCamContrastFocus(d_ptr->cameraBin, d_ptr->videoSource,
+						  d_ptr->conf->softwareFocusProperty());
+    if (d_ptr->contrastFocus->isValid()) {
+      d_ptr->bufferListener->addHandler(d_ptr->contrastFocus);
+    }
+    else {
+      delete d_ptr->contrastFocus;
+      d_ptr->contrastFocus = 0;
+    }
+  }
   d_ptr->listener = new QtCamGstMessageListener(gst_element_get_bus(d_ptr->cameraBin),
 						d_ptr, this);
 
+  if (!d_ptr->conf->messageRecorderFile().isEmpty()) {
+    d_ptr->recorder = new QtCamGstMessageRecorder(d_ptr->conf->messageRecorderFile());
+    if (d_ptr->recorder->open()) {
+      d_ptr->listener->setRecorder(d_ptr->recorder);
+    }
+    else {
+      delete d_ptr->recorder;
+      d_ptr->recorder = 0;
+    }
+  }
+
   QObject::connect(d_ptr->listener, SIGNAL(error(const QString&, int, const QString&)),
 		   d_ptr, SLOT(_d_error(const QString&, int, const QString&)));
   QObject::connect(d_ptr->listener, SIGNAL(started()), d_ptr, SLOT(_d_started()));
@@ -152,6 +193,16 @@ QtCamDevice::~QtCamDevice() {
 
   d_ptr->bufferListener->d_ptr->setSink(0);
 
+  if (d_ptr->regionDetector) {
+    d_ptr->bufferListener->removeHandler(d_ptr->regionDetector);
+    delete d_ptr->regionDetector; d_ptr->regionDetector = 0;
+  }
+
+  if (d_ptr->contrastFocus) {
+    d_ptr->bufferListener->removeHandler(d_ptr->contrastFocus);
+    delete d_ptr->contrastFocus; d_ptr->contrastFocus = 0;
+  }
+
   d_ptr->image->deactivate();
   d_ptr->video->deactivate();
 
@@ -160,6 +211,11 @@ QtCamDevice::~QtCamDevice() {
 
   delete d_ptr->propertySetter;
 
+  if (d_ptr->recorder) {
+    d_ptr->listener->setRecorder(0);
+    delete d_ptr->recorder;
+  }
+
   if (d_ptr->cameraBin) {
     gst_object_unref(d_ptr->cameraBin);
   }
@@ -286,6 +342,9 @@ bool QtCamDevice::stop(bool force) {
     return true;
   }
 
+  // Video pre-roll keeps camerabin busy without recording anything.
+  d_ptr->video->d->disarmPreRoll(true);
+
   if (!isIdle()) {
     if (!force) {
       return false;
@@ -324,14 +383,12 @@ bool QtCamDevice::isRunning() {
 }
 
 bool QtCamDevice::isIdle() {
-  if (!d_ptr->cameraBin) {
+  if (d_ptr->isCameraBinIdle()) {
     return true;
   }
 
-  gboolean idle = FALSE;
-  g_object_get(d_ptr->cameraBin, "idle", &idle, NULL);
-
-  return idle == TRUE;
+  // An armed pre-roll keeps camerabin capturing but nothing is being recorded.
+  return d_ptr->video && d_ptr->video->d->preRollArmed;
 }
 
 QtCamImageMode *QtCamDevice::imageMode() const {
@@ -41,6 +41,9 @@ class QtCamVideoMode;
 class QtCamPropertySetter;
 class QtCamAnalysisBin;
 class QtCamViewfinderFrameListener;
+class QtCamGstMessageRecorder;
+class QtCamRegionDetector;
+class QtCamContrastFocus;
 
 class QtCamDevicePrivate : public QObject {
   Q_OBJECT
@@ -60,7 +63,10 @@ public:
     notifications(0),
     viewfinderFilters(0),
     imageSettings(0),
-    videoSettings(0) {
+    videoSettings(0),
+    recorder(0),
+    regionDetector(0),
+    contrastFocus(0) {
 
   }
 
@@ -257,6 +263,59 @@ public:
     return item;
   }
 
+#if GST_CHECK_VERSION(1,0,0)
+  static gint compare_klass(const GValue *val, const char *klass) {
+    GstElement *elem = (GstElement *)g_value_get_object (val);
+    gst_object_ref (elem);
+#else
+  static gint compare_klass(GstElement *elem, const char *klass) {
+#endif
+    GstElementFactory *f = gst_element_get_factory(elem);
+    if (!f) {
+      gst_object_unref (elem);
+      return -1;
+    }
+
+#if GST_CHECK_VERSION(1,0,0)
+    const char *k = gst_element_factory_get_metadata(f, GST_ELEMENT_METADATA_KLASS);
+#else
+    const char *k = gst_element_factory_get_klass(f);
+#endif
+    if (!k || !strstr(k, klass)) {
+      gst_object_unref (elem);
+      return -1;
+    }
+
+#if GST_CHECK_VERSION(1,0,0)
+    gst_object_unref (elem);
+#endif
+
+    return 0;
+  }
+
+  GstElement *findByClass(const char *klass) {
+    if (!cameraBin) {
+      return NULL;
+    }
+
+    GstIterator *iter = gst_bin_iterate_recurse (GST_BIN(cameraBin));
+
+#if GST_CHECK_VERSION(1,0,0)
+    GValue val = G_VALUE_INIT;
+    GstElement *item = NULL;
+    if (gst_iterator_find_custom (iter, (GCompareFunc)compare_klass, &val, (gpointer)klass)) {
+      item = (GstElement *)g_value_dup_object (&val);
+      g_value_unset (&val);
+    }
+#else
+    GstElement *item = (GstElement *)
+      gst_iterator_find_custom (iter, (GCompareFunc)compare_klass, (gpointer)klass);
+#endif
+    gst_iterator_free (iter);
+
+    return item;
+  }
+
   bool createAndAddViewfinderFilters() {
     QStringList filters = conf->viewfinderFilters();
     if (!filters.isEmpty()) {
@@ -303,6 +362,17 @@ public:
     return ready == TRUE;
   }
 
+  bool isCameraBinIdle() {
+    if (!cameraBin) {
+      return true;
+    }
+
+    gboolean idle = FALSE;
+    g_object_get(cameraBin, "idle", &idle, NULL);
+
+    return idle == TRUE;
+  }
+
   static void on_ready_for_capture_changed(GObject *obj, GParamSpec *pspec,
 					   QtCamDevicePrivate *d)  {
     Q_UNUSED(obj);
@@ -535,6 +605,9 @@ public:
   GstElement *viewfinderFilters;
   QtCamImageSettings *imageSettings;
   QtCamVideoSettings *videoSettings;
+  QtCamGstMessageRecorder *recorder;
+  QtCamRegionDetector *regionDetector;
+  QtCamContrastFocus *contrastFocus;
 };
 
 #endif /* QT_CAM_DEVICE_P_H */
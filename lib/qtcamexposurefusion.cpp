@@ -0,0 +1,550 @@
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "qtcamexposurefusion.h"
+#include "qtcamjpegmetadata.h"
+#include "qtcamjpegencoder.h"
+#include <QImageReader>
+#include <QFile>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QElapsedTimer>
+#include <QDebug>
+#include <cmath>
+
+// Frames are aligned at this width. Each pyramid level doubles the search
+// range so 4 levels find shifts of up to 15 pixels or 3% of the width.
+#define ALIGN_WIDTH              512
+#define ALIGN_LEVELS             4
+// Pixels that close to the median are left out of the bitmaps. They flip
+// with noise.
+#define ALIGN_NOISE              4
+// The weight maps are computed on a copy reduced by that factor.
+#define WEIGHT_SCALE             8
+#define WEIGHT_BLUR              2
+#define BAND_HEIGHT              64
+#define JPEG_QUALITY             90
+
+class QtCamExposureFusionBand : public QRunnable {
+public:
+  QtCamExposureFusionBand(const QList<QImage>& images, const QList<QPoint>& offsets,
+			  const QList<QtCamExposureFusion::Weights>& weights,
+			  int top, int bottom, uchar *bits, int bytesPerLine,
+			  const volatile bool *canceled) :
+    m_images(images),
+    m_offsets(offsets),
+    m_weights(weights),
+    m_top(top),
+    m_bottom(bottom),
+    m_bits(bits),
+    m_bytesPerLine(bytesPerLine),
+    m_canceled(canceled) {
+
+  }
+
+  void run() {
+    if (m_canceled && *m_canceled) {
+      return;
+    }
+
+    QtCamExposureFusion::fuseBand(m_images, m_offsets, m_weights, m_top, m_bottom, m_bits,
+				  m_bytesPerLine);
+  }
+
+private:
+  QList<QImage> m_images;
+  QList<QPoint> m_offsets;
+  QList<QtCamExposureFusion::Weights> m_weights;
+  int m_top;
+  int m_bottom;
+  uchar *m_bits;
+  int m_bytesPerLine;
+  const volatile bool *m_canceled;
+};
+
+static float wellExposed(int value) {
+  // Gaussian centered on mid gray with a sigma of 0.2
+  float v = value / 255.0f - 0.5f;
+  return expf(-v * v / 0.08f);
+}
+
+static const float *wellExposedTable() {
+  static float table[256];
+  static bool init = false;
+
+  if (!init) {
+    for (int x = 0; x < 256; x++) {
+      table[x] = wellExposed(x);
+    }
+
+    init = true;
+  }
+
+  return table;
+}
+
+static inline int luma(QRgb rgb) {
+  return (77 * qRed(rgb) + 150 * qGreen(rgb) + 29 * qBlue(rgb)) >> 8;
+}
+
+static QImage toLuma(const QImage& image, int width) {
+  QImage scaled = image.scaled(width, image.height() * width / image.width(),
+			       Qt::IgnoreAspectRatio, Qt::SmoothTransformation)
+    .convertToFormat(QImage::Format_RGB32);
+
+  QImage out(scaled.size(), QImage::Format_Indexed8);
+  for (int y = 0; y < scaled.height(); y++) {
+    const QRgb *in = (const QRgb *)scaled.constScanLine(y);
+    uchar *line = out.scanLine(y);
+    for (int x = 0; x < scaled.width(); x++) {
+      line[x] = luma(in[x]);
+    }
+  }
+
+  return out;
+}
+
+static QImage half(const QImage& image) {
+  int width = image.width() / 2;
+  int height = image.height() / 2;
+
+  QImage out(width, height, QImage::Format_Indexed8);
+  for (int y = 0; y < height; y++) {
+    const uchar *a = image.constScanLine(y * 2);
+    const uchar *b = image.constScanLine(y * 2 + 1);
+    uchar *line = out.scanLine(y);
+    for (int x = 0; x < width; x++) {
+      line[x] = (a[x * 2] + a[x * 2 + 1] + b[x * 2] + b[x * 2 + 1] + 2) >> 2;
+    }
+  }
+
+  return out;
+}
+
+class QtCamThresholdBitmap {
+public:
+  QtCamThresholdBitmap(const QImage& image) :
+    width(image.width()),
+    height(image.height()),
+    bits(width * height),
+    mask(width * height) {
+
+    int histogram[256] = {0};
+    for (int y = 0; y < height; y++) {
+      const uchar *line = image.constScanLine(y);
+      for (int x = 0; x < width; x++) {
+	++histogram[line[x]];
+      }
+    }
+
+    int median = 0;
+    for (int count = 0; median < 255; median++) {
+      count += histogram[median];
+      if (count * 2 >= width * height) {
+	break;
+      }
+    }
+
+    for (int y = 0; y < height; y++) {
+      const uchar *line = image.constScanLine(y);
+      for (int x = 0; x < width; x++) {
+	bits[y * width + x] = line[x] > median;
+	mask[y * width + x] = qAbs(line[x] - median) > ALIGN_NOISE;
+      }
+    }
+  }
+
+  int width;
+  int height;
+  QVector<uchar> bits;
+  QVector<uchar> mask;
+};
+
+static qint64 difference(const QtCamThresholdBitmap& a, const QtCamThresholdBitmap& b,
+			 int dx, int dy) {
+  qint64 count = 0;
+
+  // Only the overlap. The bitmaps have the same size.
+  int x0 = qMax(0, -dx), x1 = qMin(a.width, a.width - dx);
+  int y0 = qMax(0, -dy), y1 = qMin(a.height, a.height - dy);
+
+  for (int y = y0; y < y1; y++) {
+    const uchar *ab = a.bits.constData() + y * a.width;
+    const uchar *am = a.mask.constData() + y * a.width;
+    const uchar *bb = b.bits.constData() + (y + dy) * b.width + dx;
+    const uchar *bm = b.mask.constData() + (y + dy) * b.width + dx;
+
+    for (int x = x0; x < x1; x++) {
+      count += (ab[x] ^ bb[x]) & am[x] & bm[x];
+    }
+  }
+
+  return count;
+}
+
+static QtCamExposureFusion::Weights computeWeights(const QImage& image) {
+  QtCamExposureFusion::Weights w;
+  w.scale = WEIGHT_SCALE;
+  w.width = qMax(1, image.width() / w.scale);
+  w.height = qMax(1, image.height() / w.scale);
+
+  QImage small = image.scaled(w.width, w.height, Qt::IgnoreAspectRatio,
+			      Qt::SmoothTransformation).convertToFormat(QImage::Format_RGB32);
+
+  QVector<float> l(w.width * w.height);
+  for (int y = 0; y < w.height; y++) {
+    const QRgb *in = (const QRgb *)small.constScanLine(y);
+    for (int x = 0; x < w.width; x++) {
+      l[y * w.width + x] = luma(in[x]) / 255.0f;
+    }
+  }
+
+  const float *exposed = wellExposedTable();
+
+  w.values.resize(w.width * w.height);
+
+  for (int y = 0; y < w.height; y++) {
+    const QRgb *in = (const QRgb *)small.constScanLine(y);
+    const float *line = l.constData() + y * w.width;
+    const float *up = l.constData() + qMax(0, y - 1) * w.width;
+    const float *down = l.constData() + qMin(w.height - 1, y + 1) * w.width;
+
+    for (int x = 0; x < w.width; x++) {
+      float contrast = fabsf(4 * line[x] - line[qMax(0, x - 1)] -
+			     line[qMin(w.width - 1, x + 1)] - up[x] - down[x]);
+
+      float r = qRed(in[x]) / 255.0f, g = qGreen(in[x]) / 255.0f, b = qBlue(in[x]) / 255.0f;
+      float mean = (r + g + b) / 3;
+      float saturation = sqrtf(((r - mean) * (r - mean) + (g - mean) * (g - mean) +
+				(b - mean) * (b - mean)) / 3);
+
+      float exposure = exposed[qRed(in[x])] * exposed[qGreen(in[x])] * exposed[qBlue(in[x])];
+
+      w.values[y * w.width + x] = (contrast + 0.001f) * (saturation + 0.001f) *
+	(exposure + 0.001f);
+    }
+  }
+
+  // Separable box blur. Sharp weight transitions show up as seams.
+  QVector<float> tmp(w.values.size());
+  for (int y = 0; y < w.height; y++) {
+    for (int x = 0; x < w.width; x++) {
+      float sum = 0;
+      for (int k = -WEIGHT_BLUR; k <= WEIGHT_BLUR; k++) {
+	sum += w.values[y * w.width + qBound(0, x + k, w.width - 1)];
+      }
+
+      tmp[y * w.width + x] = sum;
+    }
+  }
+
+  for (int y = 0; y < w.height; y++) {
+    for (int x = 0; x < w.width; x++) {
+      float sum = 0;
+      for (int k = -WEIGHT_BLUR; k <= WEIGHT_BLUR; k++) {
+	sum += tmp[qBound(0, y + k, w.height - 1) * w.width + x];
+      }
+
+      w.values[y * w.width + x] = sum;
+    }
+  }
+
+  return w;
+}
+
+static inline float sampleWeight(const QtCamExposureFusion::Weights& w, float x, float y) {
+  x = qBound(0.0f, x, w.width - 1.0f);
+  y = qBound(0.0f, y, w.height - 1.0f);
+
+  int x0 = (int)x, y0 = (int)y;
+  int x1 = qMin(x0 + 1, w.width - 1), y1 = qMin(y0 + 1, w.height - 1);
+  float fx = x - x0, fy = y - y0;
+
+  const float *a = w.values.constData() + y0 * w.width;
+  const float *b = w.values.constData() + y1 * w.width;
+
+  return (a[x0] * (1 - fx) + a[x1] * fx) * (1 - fy) + (b[x0] * (1 - fx) + b[x1] * fx) * fy;
+}
+
+QtCamExposureFusion::QtCamExposureFusion(QObject *parent) :
+  QThread(parent),
+  m_msecsPerMegapixel(0),
+  m_canceled(false) {
+
+}
+
+QtCamExposureFusion::~QtCamExposureFusion() {
+  cancel();
+  wait();
+}
+
+bool QtCamExposureFusion::merge(const QStringList& fileNames, const QString& fileName) {
+  if (isRunning()) {
+    qWarning() << "Exposure fusion already in progress";
+    return false;
+  }
+
+  if (fileNames.size() < 2) {
+    return false;
+  }
+
+  m_mutex.lock();
+  m_fileNames = fileNames;
+  m_fileName = fileName;
+  m_canceled = false;
+  m_mutex.unlock();
+
+  start(QThread::LowPriority);
+
+  return true;
+}
+
+void QtCamExposureFusion::cancel() {
+  m_canceled = true;
+}
+
+qreal QtCamExposureFusion::msecsPerMegapixel() {
+  QMutexLocker locker(&m_mutex);
+
+  return m_msecsPerMegapixel;
+}
+
+void QtCamExposureFusion::run() {
+  m_mutex.lock();
+  QStringList fileNames = m_fileNames;
+  QString fileName = m_fileName;
+  m_mutex.unlock();
+
+  QElapsedTimer timer;
+  timer.start();
+
+  QList<QImage> images;
+
+  foreach (const QString& file, fileNames) {
+    if (m_canceled) {
+      emit failed();
+      return;
+    }
+
+    QImageReader reader(file);
+    QImage image = reader.read();
+    if (image.isNull()) {
+      qWarning() << "Failed to read" << file << reader.errorString();
+      emit failed();
+      return;
+    }
+
+    image = image.convertToFormat(QImage::Format_RGB32);
+    if (!images.isEmpty() && image.size() != images.first().size()) {
+      qWarning() << "Bracketed frames differ in size";
+      emit failed();
+      return;
+    }
+
+    images << image;
+    emit progress(0.4 * images.size() / fileNames.size());
+  }
+
+  int reference = images.size() / 2;
+  int width = qMin(ALIGN_WIDTH, images[reference].width());
+  qreal factor = (qreal)images[reference].width() / width;
+
+  QImage referenceLuma = toLuma(images[reference], width);
+
+  QList<QPoint> offsets;
+  for (int x = 0; x < images.size(); x++) {
+    if (x == reference) {
+      offsets << QPoint();
+      continue;
+    }
+
+    QPoint offset = align(referenceLuma, toLuma(images[x], width), ALIGN_LEVELS);
+    offsets << QPoint(qRound(offset.x() * factor), qRound(offset.y() * factor));
+  }
+
+  emit progress(0.5);
+
+  QThreadPool pool;
+  QImage out = fuse(images, offsets, &pool, &m_canceled);
+  images.clear();
+
+  if (out.isNull() || m_canceled) {
+    emit failed();
+    return;
+  }
+
+  emit progress(0.9);
+
+  // Capture time, camera settings, location, ... all come from the reference
+  // and the output is compressed like it was.
+  QByteArray referenceData;
+  QFile referenceFile(fileNames[reference]);
+  if (referenceFile.open(QFile::ReadOnly)) {
+    referenceData = referenceFile.readAll();
+  }
+
+  int quality = QtCamJpegEncoder::quality(referenceData);
+  if (quality <= 0) {
+    quality = JPEG_QUALITY;
+  }
+
+  if (!QtCamJpegEncoder::save(out, fileName, quality,
+			      QtCamJpegMetadata::segments(referenceData), &pool)) {
+    qWarning() << "Failed to save HDR image" << fileName;
+    emit failed();
+    return;
+  }
+
+  qreal megapixels = out.width() * out.height() / 1000000.0;
+
+  m_mutex.lock();
+  m_msecsPerMegapixel = timer.elapsed() / megapixels;
+  qDebug() << "Merged" << fileNames.size() << "frames in" << timer.elapsed() << "ms"
+	   << m_msecsPerMegapixel << "ms/MP";
+  m_mutex.unlock();
+
+  emit progress(1.0);
+  emit finished(fileName);
+}
+
+QPoint QtCamExposureFusion::align(const QImage& reference, const QImage& image, int levels) {
+  QList<QImage> a, b;
+  a << reference;
+  b << image;
+
+  for (int x = 1; x < levels; x++) {
+    if (a.last().width() < 16 || a.last().height() < 16) {
+      break;
+    }
+
+    a << half(a.last());
+    b << half(b.last());
+  }
+
+  QPoint shift;
+
+  for (int level = a.size() - 1; level >= 0; level--) {
+    QtCamThresholdBitmap ab(a[level]);
+    QtCamThresholdBitmap bb(b[level]);
+
+    shift *= 2;
+
+    QPoint best = shift;
+    qint64 min = -1;
+
+    for (int dy = -1; dy <= 1; dy++) {
+      for (int dx = -1; dx <= 1; dx++) {
+	qint64 diff = difference(ab, bb, shift.x() + dx, shift.y() + dy);
+	if (min == -1 || diff < min) {
+	  min = diff;
+	  best = QPoint(shift.x() + dx, shift.y() + dy);
+	}
+      }
+    }
+
+    shift = best;
+  }
+
+  return shift;
+}
+
+QImage QtCamExposureFusion::fuse(const QList<QImage>& images, const QList<QPoint>& offsets,
+				 QThreadPool *pool, const volatile bool *canceled) {
+  if (images.isEmpty() || images.size() != offsets.size()) {
+    return QImage();
+  }
+
+  QList<Weights> weights;
+  foreach (const QImage& image, images) {
+    if (canceled && *canceled) {
+      return QImage();
+    }
+
+    weights << computeWeights(image);
+  }
+
+  QImage out(images.first().size(), QImage::Format_RGB32);
+  if (out.isNull()) {
+    return out;
+  }
+
+  // Bands write to disjoint lines of the same image.
+  uchar *bits = out.bits();
+
+  for (int y = 0; y < out.height(); y += BAND_HEIGHT) {
+    pool->start(new QtCamExposureFusionBand(images, offsets, weights, y,
+					    qMin(y + BAND_HEIGHT, out.height()), bits,
+					    out.bytesPerLine(), canceled));
+  }
+
+  pool->waitForDone();
+
+  return out;
+}
+
+void QtCamExposureFusion::fuseBand(const QList<QImage>& images, const QList<QPoint>& offsets,
+				   const QList<Weights>& weights, int top, int bottom,
+				   uchar *bits, int bytesPerLine) {
+  const float *exposed = wellExposedTable();
+  int count = images.size();
+  int width = images.first().width();
+  int height = images.first().height();
+  int reference = count / 2;
+
+  QVector<const QRgb *> lines(count);
+
+  for (int y = top; y < bottom; y++) {
+    for (int i = 0; i < count; i++) {
+      lines[i] = (const QRgb *)images[i].constScanLine(qBound(0, y + offsets[i].y(), height - 1));
+    }
+
+    QRgb *line = (QRgb *)(bits + y * bytesPerLine);
+
+    for (int x = 0; x < width; x++) {
+      float r = 0, g = 0, b = 0, sum = 0;
+
+      for (int i = 0; i < count; i++) {
+	int sx = qBound(0, x + offsets[i].x(), width - 1);
+	int sy = qBound(0, y + offsets[i].y(), height - 1);
+	QRgb pixel = lines[i][sx];
+
+	// The smooth weights pick the frame, the full resolution term keeps clipped
+	// pixels out at the transitions.
+	const Weights& w = weights[i];
+	float weight = sampleWeight(w, (sx + 0.5f) / w.scale - 0.5f, (sy + 0.5f) / w.scale - 0.5f)
+	  * (exposed[luma(pixel)] + 0.001f);
+
+	r += qRed(pixel) * weight;
+	g += qGreen(pixel) * weight;
+	b += qBlue(pixel) * weight;
+	sum += weight;
+      }
+
+      if (sum <= 0) {
+	line[x] = lines[reference][qBound(0, x + offsets[reference].x(), width - 1)];
+	continue;
+      }
+
+      line[x] = qRgb(qBound(0, qRound(r / sum), 255), qBound(0, qRound(g / sum), 255),
+		     qBound(0, qRound(b / sum), 255));
+    }
+  }
+}
@@ -0,0 +1,92 @@
+// -*- c++ -*-
+
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef QT_CAM_EXPOSURE_FUSION_H
+#define QT_CAM_EXPOSURE_FUSION_H
+
+#include <QThread>
+#include <QMutex>
+#include <QStringList>
+#include <QImage>
+#include <QVector>
+
+class QThreadPool;
+
+// Merges an exposure bracket into a single JPEG on a worker thread.
+// Frames are aligned to the reference (middle) frame with a coarse to fine
+// search over median threshold bitmaps which, unlike plain image differences,
+// do not depend on the exposure. They are then blended using per pixel weights
+// favouring contrast, saturation and well exposed values (exposure fusion).
+// The weights are estimated and smoothed on a reduced copy to avoid seams and
+// the full resolution blend is done in bands on a thread pool.
+class QtCamExposureFusion : public QThread {
+  Q_OBJECT
+
+public:
+  QtCamExposureFusion(QObject *parent = 0);
+  ~QtCamExposureFusion();
+
+  // The middle file is the reference for alignment and metadata.
+  bool merge(const QStringList& fileNames, const QString& fileName);
+  void cancel();
+
+  // Time spent for the last merge normalized to the output size, including
+  // decoding and encoding.
+  qreal msecsPerMegapixel();
+
+  // Returns the offset such that image(x + offset.x, y + offset.y) matches
+  // reference(x, y). Both are 8 bit grayscale images of the same size.
+  static QPoint align(const QImage& reference, const QImage& image, int levels);
+
+  static QImage fuse(const QList<QImage>& images, const QList<QPoint>& offsets,
+		     QThreadPool *pool, const volatile bool *canceled = 0);
+
+  // Exposed for the band jobs
+  class Weights {
+  public:
+    QVector<float> values;
+    int width;
+    int height;
+    int scale;
+  };
+
+  static void fuseBand(const QList<QImage>& images, const QList<QPoint>& offsets,
+		       const QList<Weights>& weights, int top, int bottom,
+		       uchar *bits, int bytesPerLine);
+
+signals:
+  void progress(qreal progress);
+  void finished(const QString& fileName);
+  void failed();
+
+protected:
+  void run();
+
+private:
+  QMutex m_mutex;
+  QStringList m_fileNames;
+  QString m_fileName;
+  qreal m_msecsPerMegapixel;
+  volatile bool m_canceled;
+};
+
+#endif /* QT_CAM_EXPOSURE_FUSION_H */
@@ -0,0 +1,351 @@
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "qtcamfilewriter.h"
+#include <QElapsedTimer>
+#include <QFile>
+#include <QDebug>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/statvfs.h>
+
+#define ALIGNMENT                4096
+// Unit of the writes to the file once data is sequential.
+#define WRITE_SIZE               (256 * 1024)
+// How long data smaller than WRITE_SIZE may wait in the buffer.
+#define MAX_DELAY_MSECS          500
+#define PREALLOCATE_SECONDS      30
+#define MIN_PREALLOCATE          (4 * 1024 * 1024)
+// Never preallocate the last bit of the file system.
+#define FREE_SPACE_RESERVE       (32 * 1024 * 1024)
+
+QtCamFileWriter::QtCamFileWriter(int bufferSize, QObject *parent) :
+  QThread(parent),
+  m_capacity(qMax(WRITE_SIZE, (bufferSize + WRITE_SIZE - 1) / WRITE_SIZE * WRITE_SIZE)),
+  m_buffer(0),
+  m_fd(-1),
+  m_bytesPerSecond(0),
+  m_preallocate(false),
+  m_allocated(0),
+  m_size(0),
+  m_head(0),
+  m_used(0),
+  m_flush(false),
+  m_stop(false),
+  m_error(false),
+  m_maxStall(0),
+  m_maxWriteTime(0) {
+
+}
+
+QtCamFileWriter::~QtCamFileWriter() {
+  close();
+
+  free(m_buffer);
+  m_buffer = 0;
+}
+
+bool QtCamFileWriter::open(const QString& fileName, qint64 bytesPerSecond) {
+  if (isOpen()) {
+    qWarning() << "File writer is already open";
+    return false;
+  }
+
+  if (!m_buffer) {
+    void *buffer = 0;
+    if (posix_memalign(&buffer, ALIGNMENT, m_capacity) != 0) {
+      qWarning() << "Failed to allocate" << m_capacity << "bytes for writing";
+      return false;
+    }
+
+    m_buffer = (char *)buffer;
+  }
+
+  m_fd = ::open(QFile::encodeName(fileName).constData(), O_WRONLY | O_CREAT, 0644);
+  if (m_fd == -1) {
+    qWarning() << "Failed to open" << fileName << strerror(errno);
+    return false;
+  }
+
+  m_bytesPerSecond = bytesPerSecond;
+  m_preallocate = bytesPerSecond > 0;
+  m_allocated = 0;
+  m_size = 0;
+
+  m_chunks.clear();
+  m_head = 0;
+  m_used = 0;
+  m_flush = false;
+  m_stop = false;
+  m_error = false;
+  m_maxStall = 0;
+  m_maxWriteTime = 0;
+
+  start();
+
+  return true;
+}
+
+bool QtCamFileWriter::isOpen() const {
+  return m_fd != -1;
+}
+
+bool QtCamFileWriter::write(qint64 offset, const char *data, int size) {
+  QMutexLocker locker(&m_mutex);
+
+  QElapsedTimer timer;
+  bool waited = false;
+  bool wasEmpty = m_chunks.isEmpty();
+
+  while (size > 0) {
+    if (m_error || m_fd == -1) {
+      return false;
+    }
+
+    if (m_used == m_capacity) {
+      if (!waited) {
+	timer.start();
+	waited = true;
+      }
+
+      m_notEmpty.wakeOne();
+      m_notFull.wait(&m_mutex);
+      continue;
+    }
+
+    int tail = (m_head + m_used) % m_capacity;
+    int len = qMin(size, qMin(m_capacity - m_used, m_capacity - tail));
+
+    memcpy(m_buffer + tail, data, len);
+
+    if (!m_chunks.isEmpty() && m_chunks.last().offset + m_chunks.last().size == offset &&
+	m_chunks.last().start + m_chunks.last().size == tail) {
+      m_chunks.last().size += len;
+    } else {
+      QtCamFileWriterChunk chunk;
+      chunk.offset = offset;
+      chunk.start = tail;
+      chunk.size = len;
+      m_chunks << chunk;
+    }
+
+    m_used += len;
+    offset += len;
+    data += len;
+    size -= len;
+  }
+
+  if (waited) {
+    m_maxStall = qMax(m_maxStall, timer.nsecsElapsed() / 1000);
+  }
+
+  // The thread either has to start waiting for more data or has waited enough.
+  if (wasEmpty || m_used >= WRITE_SIZE) {
+    m_notEmpty.wakeOne();
+  }
+
+  return true;
+}
+
+bool QtCamFileWriter::flush() {
+  QMutexLocker locker(&m_mutex);
+
+  m_flush = true;
+  m_notEmpty.wakeOne();
+
+  while (!m_chunks.isEmpty() && !m_error) {
+    m_flushed.wait(&m_mutex);
+  }
+
+  m_flush = false;
+
+  return !m_error;
+}
+
+bool QtCamFileWriter::close() {
+  if (!isOpen()) {
+    return true;
+  }
+
+  flush();
+
+  m_mutex.lock();
+  m_stop = true;
+  m_notEmpty.wakeOne();
+  m_mutex.unlock();
+
+  wait();
+
+  bool ok = !m_error;
+
+  // Releases the preallocated blocks past the end of the data.
+  if (ftruncate(m_fd, m_size) != 0) {
+    qWarning() << "Failed to trim file" << strerror(errno);
+    ok = false;
+  }
+
+  if (::close(m_fd) != 0) {
+    qWarning() << "Failed to close file" << strerror(errno);
+    ok = false;
+  }
+
+  m_fd = -1;
+
+  return ok;
+}
+
+qint64 QtCamFileWriter::maxStall() {
+  QMutexLocker locker(&m_mutex);
+
+  return m_maxStall;
+}
+
+qint64 QtCamFileWriter::maxWriteTime() {
+  QMutexLocker locker(&m_mutex);
+
+  return m_maxWriteTime;
+}
+
+void QtCamFileWriter::run() {
+  m_mutex.lock();
+
+  while (true) {
+    if (m_chunks.isEmpty()) {
+      m_flushed.wakeAll();
+
+      if (m_stop) {
+	break;
+      }
+
+      m_notEmpty.wait(&m_mutex);
+      continue;
+    }
+
+    // Write behind: let small pieces pile up into bigger writes.
+    if (m_used < WRITE_SIZE && !m_flush && !m_stop &&
+	m_notEmpty.wait(&m_mutex, MAX_DELAY_MSECS)) {
+      continue;
+    }
+
+    QtCamFileWriterChunk chunk = m_chunks.first();
+    // Only the first write of a sequential run is not aligned to WRITE_SIZE.
+    int len = qMin((qint64)chunk.size, WRITE_SIZE - chunk.offset % WRITE_SIZE);
+
+    m_mutex.unlock();
+
+    preallocate(chunk.offset + len);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    const char *data = m_buffer + chunk.start;
+    qint64 offset = chunk.offset;
+    int left = len;
+    bool ok = true;
+
+    while (left > 0) {
+      ssize_t written = pwrite(m_fd, data, left, offset);
+      if (written < 0 && errno == EINTR) {
+	continue;
+      }
+
+      if (written <= 0) {
+	qWarning() << "Failed to write" << left << "bytes at" << offset << strerror(errno);
+	ok = false;
+	break;
+      }
+
+      data += written;
+      offset += written;
+      left -= written;
+    }
+
+    qint64 elapsed = timer.nsecsElapsed() / 1000;
+
+    m_mutex.lock();
+
+    m_maxWriteTime = qMax(m_maxWriteTime, elapsed);
+
+    if (!ok) {
+      // Nobody will get anything written from now on.
+      m_error = true;
+      m_chunks.clear();
+      m_head = 0;
+      m_used = 0;
+      m_notFull.wakeAll();
+      continue;
+    }
+
+    m_size = qMax(m_size, chunk.offset + len);
+
+    QtCamFileWriterChunk& first = m_chunks.first();
+    first.offset += len;
+    first.start += len;
+    first.size -= len;
+    if (first.size == 0) {
+      m_chunks.removeFirst();
+    }
+
+    m_head = (m_head + len) % m_capacity;
+    m_used -= len;
+
+    m_notFull.wakeAll();
+  }
+
+  m_mutex.unlock();
+}
+
+void QtCamFileWriter::preallocate(qint64 end) {
+  if (!m_preallocate || end <= m_allocated) {
+    return;
+  }
+
+  qint64 len = qMax((qint64)MIN_PREALLOCATE, m_bytesPerSecond * PREALLOCATE_SECONDS);
+  len = qMax(len, end - m_allocated);
+
+  struct statvfs buf;
+  if (fstatvfs(m_fd, &buf) == 0) {
+    qint64 available = (qint64)buf.f_bavail * buf.f_frsize - FREE_SPACE_RESERVE;
+    len = qMin(len, available);
+  }
+
+  if (len < end - m_allocated) {
+    // Not enough room left. The writes will tell.
+    return;
+  }
+
+  // FALLOC_FL_KEEP_SIZE: reserve the blocks without making them part of the file.
+  if (fallocate(m_fd, FALLOC_FL_KEEP_SIZE, m_allocated, len) != 0) {
+    if (errno == EOPNOTSUPP || errno == ENOSYS) {
+      qDebug() << "File system does not support preallocation";
+      m_preallocate = false;
+    } else {
+      qWarning() << "Failed to preallocate" << len << "bytes" << strerror(errno);
+    }
+
+    return;
+  }
+
+  m_allocated += len;
+}
@@ -0,0 +1,103 @@
+// -*- c++ -*-
+
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#ifndef QT_CAM_FILE_WRITER_H
+#define QT_CAM_FILE_WRITER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QList>
+#include <QString>
+
+class QtCamFileWriterChunk {
+public:
+  qint64 offset;
+  // Position in the ring buffer.
+  int start;
+  int size;
+};
+
+// Write-behind file output. write() copies into a large page aligned ring
+// buffer and only blocks when the ring is full. A thread of its own writes
+// the data out in big blocks aligned to the file offset. Space ahead of the
+// data is preallocated where the file system supports it and close()
+// releases whatever was not used.
+class QtCamFileWriter : public QThread {
+  Q_OBJECT
+
+public:
+  QtCamFileWriter(int bufferSize, QObject *parent = 0);
+  ~QtCamFileWriter();
+
+  // Opens an existing or new file without truncating it. bytesPerSecond is
+  // the expected data rate used to size preallocations, 0 disables them.
+  bool open(const QString& fileName, qint64 bytesPerSecond);
+
+  // Can be called from any thread but not concurrently.
+  bool write(qint64 offset, const char *data, int size);
+
+  // Waits until everything queued so far is on its way to the disk.
+  bool flush();
+
+  // Flushes, trims the file to the data written and closes it. Returns
+  // false if any write failed.
+  bool close();
+
+  bool isOpen() const;
+
+  // Longest time write() had to wait for room in the buffer in microseconds.
+  qint64 maxStall();
+  // Longest single write to the file in microseconds.
+  qint64 maxWriteTime();
+
+protected:
+  void run();
+
+private:
+  void preallocate(qint64 end);
+
+  int m_capacity;
+  char *m_buffer;
+
+  int m_fd;
+  qint64 m_bytesPerSecond;
+  bool m_preallocate;
+  qint64 m_allocated;
+  qint64 m_size;
+
+  QMutex m_mutex;
+  QWaitCondition m_notEmpty;
+  QWaitCondition m_notFull;
+  QWaitCondition m_flushed;
+  QList<QtCamFileWriterChunk> m_chunks;
+  int m_head;
+  int m_used;
+  bool m_flush;
+  bool m_stop;
+  bool m_error;
+  qint64 m_maxStall;
+  qint64 m_maxWriteTime;
+};
+
+#endif /* QT_CAM_FILE_WRITER_H */
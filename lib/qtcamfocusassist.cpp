@@ -0,0 +1,196 @@
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "qtcamfocusassist.h"
+#include "qtcamgstsample.h"
+#include "qtcamsharpness.h"
+#include <QMutexLocker>
+#include <QVector>
+
+// Long side of the masks. Edges are still visible when scaled up to the viewfinder.
+#define MASK_SIZE                320
+#define DEFAULT_THRESHOLD        48
+#define DEFAULT_LEVEL            240
+#define DEFAULT_LOAD             10
+
+#define PEAKING_COLOR            0xffff0000
+// Premultiplied translucent black
+#define ZEBRA_COLOR              0xa0000000
+#define ZEBRA_WIDTH              3
+
+QtCamFocusAssist::QtCamFocusAssist(QObject *parent) :
+  QObject(parent),
+  m_peaking(false),
+  m_zebra(false),
+  m_threshold(DEFAULT_THRESHOLD),
+  m_level(DEFAULT_LEVEL),
+  m_load(DEFAULT_LOAD),
+  m_cost(0) {
+
+}
+
+QtCamFocusAssist::~QtCamFocusAssist() {
+
+}
+
+bool QtCamFocusAssist::isPeakingEnabled() {
+  QMutexLocker locker(&m_mutex);
+
+  return m_peaking;
+}
+
+void QtCamFocusAssist::setPeakingEnabled(bool enabled) {
+  QMutexLocker locker(&m_mutex);
+
+  m_peaking = enabled;
+}
+
+bool QtCamFocusAssist::isZebraEnabled() {
+  QMutexLocker locker(&m_mutex);
+
+  return m_zebra;
+}
+
+void QtCamFocusAssist::setZebraEnabled(bool enabled) {
+  QMutexLocker locker(&m_mutex);
+
+  m_zebra = enabled;
+}
+
+int QtCamFocusAssist::peakingThreshold() {
+  QMutexLocker locker(&m_mutex);
+
+  return m_threshold;
+}
+
+void QtCamFocusAssist::setPeakingThreshold(int threshold) {
+  QMutexLocker locker(&m_mutex);
+
+  m_threshold = qBound(1, threshold, 255);
+}
+
+int QtCamFocusAssist::zebraLevel() {
+  QMutexLocker locker(&m_mutex);
+
+  return m_level;
+}
+
+void QtCamFocusAssist::setZebraLevel(int level) {
+  QMutexLocker locker(&m_mutex);
+
+  m_level = qBound(0, level, 255);
+}
+
+int QtCamFocusAssist::load() {
+  QMutexLocker locker(&m_mutex);
+
+  return m_load;
+}
+
+void QtCamFocusAssist::setLoad(int load) {
+  QMutexLocker locker(&m_mutex);
+
+  m_load = qBound(1, load, 100);
+}
+
+QImage QtCamFocusAssist::mask() {
+  QMutexLocker locker(&m_mutex);
+
+  return m_mask;
+}
+
+void QtCamFocusAssist::handleSample(const QtCamGstSample *sample) {
+  QMutexLocker locker(&m_mutex);
+
+  if (!m_peaking && !m_zebra) {
+    return;
+  }
+
+  // The slower the last frame was (CPU contention included) the longer we back off.
+  if (m_timer.isValid() && m_timer.nsecsElapsed() < m_cost * 100 / m_load) {
+    return;
+  }
+
+  bool peaking = m_peaking;
+  bool zebra = m_zebra;
+  int threshold = m_threshold;
+  int level = m_level;
+
+  locker.unlock();
+
+  QElapsedTimer timer;
+  timer.start();
+
+  int factor = qMax(1, (qMax(sample->width(), sample->height()) + MASK_SIZE - 1) / MASK_SIZE);
+
+  // Only this thread touches the plane.
+  if (!m_plane.scale(sample, factor)) {
+    return;
+  }
+
+  QImage mask;
+  createMask(m_plane, peaking, threshold, zebra, level, mask);
+
+  locker.relock();
+
+  m_mask = mask;
+  m_cost = timer.nsecsElapsed();
+  m_timer = timer;
+
+  locker.unlock();
+
+  emit updated();
+}
+
+void QtCamFocusAssist::createMask(const QtCamLumaPlane& plane, bool peaking, int threshold,
+				  bool zebra, int level, QImage& mask) {
+  int width = plane.width();
+  int height = plane.height();
+
+  mask = QImage(width, height, QImage::Format_ARGB32_Premultiplied);
+  mask.fill(0);
+
+  QVector<uchar> edges(width);
+
+  for (int y = 0; y < height; y++) {
+    const uchar *line = plane.line(y);
+    QRgb *out = (QRgb *)mask.scanLine(y);
+
+    if (zebra) {
+      for (int x = 0; x < width; x++) {
+	if (line[x] >= level && ((x + y) / ZEBRA_WIDTH) % 2) {
+	  out[x] = ZEBRA_COLOR;
+	}
+      }
+    }
+
+    if (peaking && y + 1 < height) {
+      QtCamSharpness::gradientMagnitude(line, plane.line(y + 1), edges.data(), width);
+
+      const uchar *e = edges.constData();
+      for (int x = 0; x < width; x++) {
+	if (e[x] >= threshold) {
+	  out[x] = PEAKING_COLOR;
+	}
+      }
+    }
+  }
+}
@@ -0,0 +1,85 @@
+// -*- c++ -*-
+
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef QT_CAM_FOCUS_ASSIST_H
+#define QT_CAM_FOCUS_ASSIST_H
+
+#include <QObject>
+#include <QMutex>
+#include <QImage>
+#include <QElapsedTimer>
+#include "qtcamviewfinderbufferhandler.h"
+#include "qtcamlumaplane.h"
+
+// Focus peaking and zebra masks for manual focus and exposure.
+// The masks are low resolution ARGB images meant to be scaled over the viewfinder.
+// Only as many frames are processed as fit in the configured share of the CPU.
+class QtCamFocusAssist : public QObject, public QtCamViewfinderBufferHandler {
+  Q_OBJECT
+
+public:
+  QtCamFocusAssist(QObject *parent = 0);
+  ~QtCamFocusAssist();
+
+  bool isPeakingEnabled();
+  void setPeakingEnabled(bool enabled);
+
+  bool isZebraEnabled();
+  void setZebraEnabled(bool enabled);
+
+  // Minimum |dx| + |dy| for a pixel to be considered an edge.
+  int peakingThreshold();
+  void setPeakingThreshold(int threshold);
+
+  // Minimum luma for a pixel to be considered over exposed.
+  int zebraLevel();
+  void setZebraLevel(int level);
+
+  // Percentage of the streaming thread time we are allowed to use.
+  int load();
+  void setLoad(int load);
+
+  QImage mask();
+
+  void handleSample(const QtCamGstSample *sample);
+
+  static void createMask(const QtCamLumaPlane& plane, bool peaking, int threshold,
+			 bool zebra, int level, QImage& mask);
+
+signals:
+  // Emitted from the streaming thread.
+  void updated();
+
+private:
+  QMutex m_mutex;
+  QElapsedTimer m_timer;
+  bool m_peaking;
+  bool m_zebra;
+  int m_threshold;
+  int m_level;
+  int m_load;
+  qint64 m_cost;
+  QtCamLumaPlane m_plane;
+  QImage m_mask;
+};
+
+#endif /* QT_CAM_FOCUS_ASSIST_H */
@@ -23,6 +23,7 @@
 class QtCamGstMessageHandlerPrivate {
 public:
   QString name;
+  GQuark quark;
 };
 
 QtCamGstMessageHandler::QtCamGstMessageHandler(const QString& messageName,
@@ -30,6 +31,7 @@ QtCamGstMessageHandler::QtCamGstMessageHandler(const QString& messageName,
   QObject(parent), d_ptr(new QtCamGstMessageHandlerPrivate) {
 
   d_ptr->name = messageName;
+  d_ptr->quark = g_quark_from_string(messageName.toUtf8().constData());
 }
 
 QtCamGstMessageHandler::~QtCamGstMessageHandler() {
@@ -40,6 +42,10 @@ QString QtCamGstMessageHandler::messageName() const {
   return d_ptr->name;
 }
 
+GQuark QtCamGstMessageHandler::messageQuark() const {
+  return d_ptr->quark;
+}
+
 void QtCamGstMessageHandler::handleMessage(GstMessage *message) {
   emit messageSent(message);
 }
@@ -24,6 +24,7 @@
 #define QT_CAM_GST_MESSAGE_HANDLER_H
 
 #include <QObject>
+#include <glib.h>
 
 class QtCamGstMessageHandlerPrivate;
 typedef struct _GstMessage GstMessage;
@@ -36,6 +37,7 @@ public:
   virtual ~QtCamGstMessageHandler();
 
   QString messageName() const;
+  GQuark messageQuark() const;
 
   virtual void handleMessage(GstMessage *message);
 
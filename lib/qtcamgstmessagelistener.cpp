@@ -20,17 +20,77 @@
 
 #include "qtcamgstmessagelistener.h"
 #include "qtcamgstmessagehandler.h"
-#include <QMultiMap>
-#include <QMutex>
+#include <QHash>
+#include <QThread>
 #include <QDebug>
 #include "qtcamdevice_p.h"
+#include "qtcamgstmessagerecorder.h"
+
+// Published sync tables live in one of these slots. The slot index shares an int with
+// the number of readers that picked the table up.
+#define SYNC_TABLE_SLOTS           16
+#define SYNC_TABLE_SLOT_MASK       0xf
+#define SYNC_TABLE_REF             0x10
+
+// Handlers keyed by the quark of the message structure name.
+// Tables are never modified once they are published to the streaming threads.
+// Adding or removing a handler builds a new table and swaps it in.
+class QtCamGstMessageHandlerTable {
+public:
+  QtCamGstMessageHandlerTable() :
+    recorder(0),
+    refs(0) {}
+
+  QtCamGstMessageHandlerTable(const QtCamGstMessageHandlerTable *other) :
+    handlers(other->handlers),
+    recorder(other->recorder),
+    refs(0) {
+    // Force a deep copy now. The table we copy from might be in use by another thread.
+    handlers.detach();
+  }
+
+  QHash<GQuark, QList<QtCamGstMessageHandler *> > handlers;
+  QtCamGstMessageRecorder *recorder;
+
+  // Readers still using the table after it has been replaced. Only meaningful once retired.
+  QAtomicInt refs;
+};
 
 class QtCamGstMessageListenerPrivate {
 public:
-  QMultiMap<QString, QtCamGstMessageHandler *> handlers;
-  QMultiMap<QString, QtCamGstMessageHandler *> syncHandlers;
+  QtCamGstMessageListenerPrivate() :
+    handlers(new QtCamGstMessageHandlerTable),
+    syncCurrent(0) {
+
+    for (int x = 0; x < SYNC_TABLE_SLOTS; x++) {
+      syncTables[x] = 0;
+    }
+
+    syncTables[0] = new QtCamGstMessageHandlerTable;
+  }
+
+  ~QtCamGstMessageListenerPrivate() {
+    delete handlers;
+
+    // The sync handler is gone so nobody can be holding a table.
+    for (int x = 0; x < SYNC_TABLE_SLOTS; x++) {
+      delete syncTables[x];
+    }
+  }
+
+  static int load(QAtomicInt& atomic) {
+#if defined(QT4)
+    return (int)atomic;
+#else
+    return atomic.load();
+#endif
+  }
+
+  int handleMessage(GstMessage *message, const QtCamGstMessageHandlerTable *table) {
+    if (table->handlers.isEmpty()) {
+      return 0;
+    }
 
-  int handleMessage(GstMessage *message, QMultiMap<QString, QtCamGstMessageHandler *>& map) {
     const GstStructure *s = gst_message_get_structure(message);
     if (!s) {
       return 0;
@@ -40,7 +100,14 @@ public:
     qDebug() << "Message" << gst_structure_get_name(s);
 #endif
 
-    QList<QtCamGstMessageHandler *> list = map.values(gst_structure_get_name(s));
+    QHash<GQuark, QList<QtCamGstMessageHandler *> >::const_iterator iter =
+      table->handlers.constFind(gst_structure_get_name_id(s));
+    if (iter == table->handlers.constEnd()) {
+      return 0;
+    }
+
+    // A handler might remove itself and free the table so do not hold a reference.
+    QList<QtCamGstMessageHandler *> list = iter.value();
 
     foreach (QtCamGstMessageHandler *handler, list) {
       handler->handleMessage(message);
@@ -101,7 +168,9 @@ public:
       break;
 
     case GST_MESSAGE_STATE_CHANGED: {
-      if (GST_ELEMENT(GST_MESSAGE_SRC(message)) != dev->cameraBin) {
+      // Replayed messages do not have a source. Those are always from the pipeline.
+      if (GST_MESSAGE_SRC(message) &&
+	  (!dev || GST_ELEMENT(GST_MESSAGE_SRC(message)) != dev->cameraBin)) {
 	break;
       }
 
@@ -127,31 +196,145 @@ public:
     }
   }
 
+  // Called from whatever thread posted the message. Does not lock.
   bool handleSyncMessage(GstMessage *message) {
-    QMutexLocker locker(&syncMutex);
+    int slot = acquireSyncTable();
+
+    int handled = handleSyncMessage(message, slot);
+
+    releaseSyncTable(slot);
+
+    return handled != 0;
+  }
+
+  int handleSyncMessage(GstMessage *message, int slot) {
+    const QtCamGstMessageHandlerTable *table = syncTables[slot];
+
+    if (table->recorder) {
+      table->recorder->record(message);
+    }
+
+    return handleMessage(message, table);
+  }
+
+  // Counting ourselves and learning which table is current is a single atomic operation
+  // so the table cannot be retired and freed in between.
+  int acquireSyncTable() {
+    return syncCurrent.fetchAndAddOrdered(SYNC_TABLE_REF) & SYNC_TABLE_SLOT_MASK;
+  }
+
+  void releaseSyncTable(int slot) {
+    int current = load(syncCurrent);
+
+    // Still published: take our reference back from the shared count.
+    while ((current & SYNC_TABLE_SLOT_MASK) == slot) {
+      if (syncCurrent.testAndSetOrdered(current, current - SYNC_TABLE_REF)) {
+	return;
+      }
+
+      current = load(syncCurrent);
+    }
+
+    // Retired while we were using it. Our reference has been moved to the table
+    // and whoever drops the last one frees it.
+    if (syncTables[slot]->refs.fetchAndAddOrdered(-1) == 1) {
+      freeSyncTable(slot);
+    }
+  }
+
+  void freeSyncTable(int slot) {
+    delete syncTables[slot];
+    g_atomic_pointer_set(&syncTables[slot], 0);
+  }
 
-    if (handleMessage(message, syncHandlers) != 0) {
-      return true;
+  // Main thread only.
+  void publishSyncHandlers(QtCamGstMessageHandlerTable *table) {
+    int slot = freeSyncSlot();
+    syncTables[slot] = table;
+
+    int old = syncCurrent.fetchAndStoreOrdered(slot);
+    int oldSlot = old & SYNC_TABLE_SLOT_MASK;
+    int readers = (unsigned int)old / SYNC_TABLE_REF;
+
+    // Readers that picked up the old table now release it through its own count.
+    if (syncTables[oldSlot]->refs.fetchAndAddOrdered(readers) + readers == 0) {
+      freeSyncTable(oldSlot);
+      return;
+    }
+
+    // After we return the caller is free to delete a handler or a recorder that was removed.
+    // Only readers that started before the swap are waited for so this cannot starve.
+    int own = injectSlots.count(oldSlot);
+    if (own == 0) {
+      while (g_atomic_pointer_get(&syncTables[oldSlot])) {
+	QThread::yieldCurrentThread();
+      }
+
+      return;
+    }
+
+    // Called from a handler of an injected message which holds the old table itself.
+    // Our references keep it alive. Wait for everybody else and let our last release free it.
+    while (load(syncTables[oldSlot]->refs) > own) {
+      QThread::yieldCurrentThread();
+    }
+  }
+
+  int freeSyncSlot() {
+    forever {
+      for (int x = 0; x < SYNC_TABLE_SLOTS; x++) {
+	if (!g_atomic_pointer_get(&syncTables[x])) {
+	  return x;
+	}
+      }
+
+      // Every slot is held by a retired table that a reader has not released yet.
+      QThread::yieldCurrentThread();
     }
+  }
 
-    return false;
+  const QtCamGstMessageHandlerTable *currentSyncTable() {
+    return syncTables[load(syncCurrent) & SYNC_TABLE_SLOT_MASK];
   }
 
-  void addHandler(QtCamGstMessageHandler *handler,
-		  QMultiMap<QString, QtCamGstMessageHandler *>& map) {
-    if (!map.contains(handler->messageName(), handler)) {
-      map.insert(handler->messageName(), handler);
-      handler->setParent(q_ptr);
+  static QtCamGstMessageHandlerTable *addHandler(QtCamGstMessageHandler *handler,
+						 const QtCamGstMessageHandlerTable *table) {
+    GQuark quark = handler->messageQuark();
+
+    if (table->handlers.value(quark).contains(handler)) {
+      return 0;
     }
+
+    QtCamGstMessageHandlerTable *copy = new QtCamGstMessageHandlerTable(table);
+    copy->handlers[quark] << handler;
+    return copy;
   }
 
-  void removeHandler(QtCamGstMessageHandler *handler,
-		     QMultiMap<QString, QtCamGstMessageHandler *>& map) {
-    map.remove(handler->messageName(), handler);
-    handler->setParent(0);
+  static QtCamGstMessageHandlerTable *removeHandler(QtCamGstMessageHandler *handler,
+						    const QtCamGstMessageHandlerTable *table) {
+    GQuark quark = handler->messageQuark();
+
+    if (!table->handlers.value(quark).contains(handler)) {
+      return 0;
+    }
+
+    QtCamGstMessageHandlerTable *copy = new QtCamGstMessageHandlerTable(table);
+    copy->handlers[quark].removeAll(handler);
+    if (copy->handlers[quark].isEmpty()) {
+      // So that messages nobody cares about are rejected without touching a list.
+      copy->handlers.remove(quark);
+    }
+
+    return copy;
   }
 
-  QMutex syncMutex;
+  QtCamGstMessageHandlerTable *handlers;
+
+  QtCamGstMessageHandlerTable *syncTables[SYNC_TABLE_SLOTS];
+  QAtomicInt syncCurrent;
+
+  // Sync tables held by the injectMessage() calls in progress. Main thread only.
+  QList<int> injectSlots;
 
   GstBus *bus;
 
@@ -217,11 +400,20 @@ QtCamGstMessageListener::~QtCamGstMessageListener() {
   gst_bus_set_sync_handler(d_ptr->bus, NULL, NULL);
 #endif
 
-  qDeleteAll(d_ptr->handlers);
+  QList<QtCamGstMessageHandler *> handlers;
+  foreach (const QList<QtCamGstMessageHandler *>& list, d_ptr->handlers->handlers) {
+    handlers << list;
+  }
+
+  qDeleteAll(handlers);
 
-  d_ptr->syncMutex.lock();
-  qDeleteAll(d_ptr->syncHandlers);
-  d_ptr->syncMutex.unlock();
+  // The sync handler has been removed so nobody else can be using the table.
+  handlers.clear();
+  foreach (const QList<QtCamGstMessageHandler *>& list, d_ptr->currentSyncTable()->handlers) {
+    handlers << list;
+  }
+
+  qDeleteAll(handlers);
 
   gst_object_unref(d_ptr->bus);
 
@@ -229,23 +421,60 @@ QtCamGstMessageListener::~QtCamGstMessageListener() {
 }
 
 void QtCamGstMessageListener::addHandler(QtCamGstMessageHandler *handler) {
-  d_ptr->addHandler(handler, d_ptr->handlers);
+  QtCamGstMessageHandlerTable *table = d_ptr->addHandler(handler, d_ptr->handlers);
+  if (table) {
+    delete d_ptr->handlers;
+    d_ptr->handlers = table;
+    handler->setParent(this);
+  }
 }
 
 void QtCamGstMessageListener::removeHandler(QtCamGstMessageHandler *handler) {
-  d_ptr->removeHandler(handler, d_ptr->handlers);
+  QtCamGstMessageHandlerTable *table = d_ptr->removeHandler(handler, d_ptr->handlers);
+  if (table) {
+    delete d_ptr->handlers;
+    d_ptr->handlers = table;
+  }
+
+  handler->setParent(0);
 }
 
 void QtCamGstMessageListener::addSyncHandler(QtCamGstMessageHandler *handler) {
-  QMutexLocker locker(&d_ptr->syncMutex);
-
-  d_ptr->addHandler(handler, d_ptr->syncHandlers);
+  QtCamGstMessageHandlerTable *table = d_ptr->addHandler(handler, d_ptr->currentSyncTable());
+  if (table) {
+    d_ptr->publishSyncHandlers(table);
+    handler->setParent(this);
+  }
 }
 
 void QtCamGstMessageListener::removeSyncHandler(QtCamGstMessageHandler *handler) {
-  QMutexLocker locker(&d_ptr->syncMutex);
+  QtCamGstMessageHandlerTable *table = d_ptr->removeHandler(handler, d_ptr->currentSyncTable());
+  if (table) {
+    d_ptr->publishSyncHandlers(table);
+  }
+
+  handler->setParent(0);
+}
+
+void QtCamGstMessageListener::setRecorder(QtCamGstMessageRecorder *recorder) {
+  QtCamGstMessageHandlerTable *table =
+    new QtCamGstMessageHandlerTable(d_ptr->currentSyncTable());
+  table->recorder = recorder;
 
-  d_ptr->removeHandler(handler, d_ptr->syncHandlers);
+  d_ptr->publishSyncHandlers(table);
+}
+
+void QtCamGstMessageListener::injectMessage(GstMessage *message) {
+  // The same order a bus would deliver the message in but on the calling thread.
+  int slot = d_ptr->acquireSyncTable();
+  d_ptr->injectSlots << slot;
+
+  d_ptr->handleSyncMessage(message, slot);
+
+  d_ptr->injectSlots.removeLast();
+  d_ptr->releaseSyncTable(slot);
+
+  d_ptr->handleMessage(message);
 }
 
 void QtCamGstMessageListener::flushMessages() {
@@ -28,7 +28,9 @@
 class QtCamGstMessageListenerPrivate;
 class QtCamGstMessageHandler;
 class QtCamDevicePrivate;
+class QtCamGstMessageRecorder;
 typedef struct _GstBus GstBus;
+typedef struct _GstMessage GstMessage;
 
 class QtCamGstMessageListener : public QObject {
   Q_OBJECT
@@ -44,6 +46,12 @@ public:
 
   void flushMessages();
 
+  // The recorder is not owned by the listener. Pass 0 before deleting it.
+  void setRecorder(QtCamGstMessageRecorder *recorder);
+
+  // Delivers a message to sync and async handlers from the calling thread.
+  void injectMessage(GstMessage *message);
+
 signals:
   void error(const QString& message, int code, const QString& debug);
   void starting();
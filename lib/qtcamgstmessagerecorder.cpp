@@ -0,0 +1,755 @@
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "qtcamgstmessagerecorder.h"
+#include "qtcamgstmessagelistener.h"
+#include <QTimer>
+#include <QSet>
+#include <QDebug>
+#include <cstring>
+
+#ifndef G_VALUE_INIT
+#define G_VALUE_INIT  { 0, { { 0 } } }
+#endif /* G_VALUE_INIT */
+
+#define ERROR_STRUCTURE_NAME           "qtcam-error"
+#define STATE_CHANGED_STRUCTURE_NAME   "qtcam-state-changed"
+
+static GstStructure *errorToStructure(GError *err, gchar *debug) {
+  return gst_structure_new(ERROR_STRUCTURE_NAME,
+			   "domain", G_TYPE_STRING, g_quark_to_string(err->domain),
+			   "code", G_TYPE_INT, err->code,
+			   "message", G_TYPE_STRING, err->message,
+			   "debug", G_TYPE_STRING, debug ? debug : "",
+			   NULL);
+}
+
+static GError *structureToError(const GstStructure *s, QByteArray& debug) {
+  int code = 0;
+  gst_structure_get_int(s, "code", &code);
+  const gchar *domain = gst_structure_get_string(s, "domain");
+  const gchar *message = gst_structure_get_string(s, "message");
+  debug = gst_structure_get_string(s, "debug");
+
+  return g_error_new_literal(g_quark_from_string(domain ? domain : ""), code,
+			     message ? message : "");
+}
+
+#define LOG_MAGIC                      "QTCAMMSG\x01"
+#define LOG_MAGIC_SIZE                 9
+
+#define FIELD_INT                      'i'
+#define FIELD_UINT                     'u'
+#define FIELD_INT64                    'I'
+#define FIELD_UINT64                   'U'
+#define FIELD_BOOLEAN                  'b'
+#define FIELD_DOUBLE                   'd'
+#define FIELD_STRING                   's'
+// Anything else: type name and gst_value_serialize() output.
+#define FIELD_SERIALIZED               'v'
+
+class QtCamGstMessageRecorderEntry {
+public:
+  qint64 timestamp;
+  GstMessage *message;
+  QtCamGstMessageRecorderEntry *next;
+};
+
+static void writeVarint(QByteArray& data, quint64 val) {
+  while (val >= 0x80) {
+    data.append((char)((val & 0x7f) | 0x80));
+    val >>= 7;
+  }
+
+  data.append((char)val);
+}
+
+static void writeSigned(QByteArray& data, qint64 val) {
+  // Zigzag so small negative numbers stay small.
+  writeVarint(data, ((quint64)val << 1) ^ (quint64)(val >> 63));
+}
+
+static void writeString(QByteArray& data, const char *str) {
+  // 0 is NULL, otherwise the length plus one.
+  if (!str) {
+    writeVarint(data, 0);
+    return;
+  }
+
+  int len = strlen(str);
+  writeVarint(data, len + 1);
+  data.append(str, len);
+}
+
+static bool readVarint(const QByteArray& data, int& pos, quint64 *val) {
+  *val = 0;
+
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (pos >= data.size()) {
+      return false;
+    }
+
+    uchar c = data[pos++];
+    *val |= (quint64)(c & 0x7f) << shift;
+    if (!(c & 0x80)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+static bool readSigned(const QByteArray& data, int& pos, qint64 *val) {
+  quint64 v;
+  if (!readVarint(data, pos, &v)) {
+    return false;
+  }
+
+  *val = (qint64)(v >> 1) ^ -(qint64)(v & 1);
+  return true;
+}
+
+static bool readString(const QByteArray& data, int& pos, QByteArray *str, bool *isNull = 0) {
+  quint64 len;
+  if (!readVarint(data, pos, &len) || len > (quint64)(data.size() - pos + 1)) {
+    return false;
+  }
+
+  if (isNull) {
+    *isNull = len == 0;
+  }
+
+  *str = len ? data.mid(pos, len - 1) : QByteArray();
+  pos += len ? len - 1 : 0;
+  return true;
+}
+
+static void writeField(QByteArray& data, const gchar *name, const GValue *value) {
+  writeString(data, name);
+
+  switch (G_VALUE_TYPE(value)) {
+  case G_TYPE_INT:
+    data.append(FIELD_INT);
+    writeSigned(data, g_value_get_int(value));
+    return;
+
+  case G_TYPE_UINT:
+    data.append(FIELD_UINT);
+    writeVarint(data, g_value_get_uint(value));
+    return;
+
+  case G_TYPE_INT64:
+    data.append(FIELD_INT64);
+    writeSigned(data, g_value_get_int64(value));
+    return;
+
+  case G_TYPE_UINT64:
+    data.append(FIELD_UINT64);
+    writeVarint(data, g_value_get_uint64(value));
+    return;
+
+  case G_TYPE_BOOLEAN:
+    data.append(FIELD_BOOLEAN);
+    data.append((char)(g_value_get_boolean(value) ? 1 : 0));
+    return;
+
+  case G_TYPE_DOUBLE: {
+    gdouble d = g_value_get_double(value);
+    data.append(FIELD_DOUBLE);
+    data.append((const char *)&d, sizeof(d));
+  }
+    return;
+
+  case G_TYPE_STRING:
+    data.append(FIELD_STRING);
+    writeString(data, g_value_get_string(value));
+    return;
+
+  default: {
+    gchar *str = gst_value_serialize(value);
+    data.append(FIELD_SERIALIZED);
+    writeString(data, g_type_name(G_VALUE_TYPE(value)));
+    writeString(data, str);
+    g_free(str);
+  }
+    return;
+  }
+}
+
+static bool readField(const QByteArray& data, int& pos, GstStructure *s) {
+  QByteArray name;
+  if (!readString(data, pos, &name) || pos >= data.size()) {
+    return false;
+  }
+
+  char type = data[pos++];
+  GValue value = G_VALUE_INIT;
+  quint64 u;
+  qint64 i;
+
+  switch (type) {
+  case FIELD_INT:
+    if (!readSigned(data, pos, &i)) {
+      return false;
+    }
+
+    g_value_init(&value, G_TYPE_INT);
+    g_value_set_int(&value, i);
+    break;
+
+  case FIELD_UINT:
+    if (!readVarint(data, pos, &u)) {
+      return false;
+    }
+
+    g_value_init(&value, G_TYPE_UINT);
+    g_value_set_uint(&value, u);
+    break;
+
+  case FIELD_INT64:
+    if (!readSigned(data, pos, &i)) {
+      return false;
+    }
+
+    g_value_init(&value, G_TYPE_INT64);
+    g_value_set_int64(&value, i);
+    break;
+
+  case FIELD_UINT64:
+    if (!readVarint(data, pos, &u)) {
+      return false;
+    }
+
+    g_value_init(&value, G_TYPE_UINT64);
+    g_value_set_uint64(&value, u);
+    break;
+
+  case FIELD_BOOLEAN:
+    if (pos >= data.size()) {
+      return false;
+    }
+
+    g_value_init(&value, G_TYPE_BOOLEAN);
+    g_value_set_boolean(&value, data[pos++] ? TRUE : FALSE);
+    break;
+
+  case FIELD_DOUBLE: {
+    gdouble d;
+    if (pos + (int)sizeof(d) > data.size()) {
+      return false;
+    }
+
+    memcpy(&d, data.constData() + pos, sizeof(d));
+    pos += sizeof(d);
+
+    g_value_init(&value, G_TYPE_DOUBLE);
+    g_value_set_double(&value, d);
+  }
+    break;
+
+  case FIELD_STRING: {
+    QByteArray str;
+    bool isNull;
+    if (!readString(data, pos, &str, &isNull)) {
+      return false;
+    }
+
+    g_value_init(&value, G_TYPE_STRING);
+    g_value_set_string(&value, isNull ? NULL : str.constData());
+  }
+    break;
+
+  case FIELD_SERIALIZED: {
+    QByteArray typeName, str;
+    if (!readString(data, pos, &typeName) || !readString(data, pos, &str)) {
+      return false;
+    }
+
+    GType t = g_type_from_name(typeName.constData());
+    if (!t) {
+      // Not something we can recreate. Skip the field but keep the rest.
+      return true;
+    }
+
+    g_value_init(&value, t);
+    if (!gst_value_deserialize(&value, str.constData())) {
+      g_value_unset(&value);
+      return true;
+    }
+  }
+    break;
+
+  default:
+    return false;
+  }
+
+  gst_structure_set_value(s, name.constData(), &value);
+  g_value_unset(&value);
+
+  return true;
+}
+
+static void writeStructure(QByteArray& data, const GstStructure *s) {
+  int fields = gst_structure_n_fields(s);
+
+  writeString(data, gst_structure_get_name(s));
+  writeVarint(data, fields);
+
+  for (int x = 0; x < fields; x++) {
+    const gchar *name = gst_structure_nth_field_name(s, x);
+    writeField(data, name, gst_structure_get_value(s, name));
+  }
+}
+
+static GstStructure *readStructure(const QByteArray& data, int& pos) {
+  QByteArray name;
+  quint64 fields;
+  if (!readString(data, pos, &name) || name.isEmpty() || !readVarint(data, pos, &fields)) {
+    return 0;
+  }
+
+#if GST_CHECK_VERSION(1,0,0)
+  GstStructure *s = gst_structure_new_empty(name.constData());
+#else
+  GstStructure *s = gst_structure_empty_new(name.constData());
+#endif
+
+  for (quint64 x = 0; x < fields; x++) {
+    if (!readField(data, pos, s)) {
+      gst_structure_free(s);
+      return 0;
+    }
+  }
+
+  return s;
+}
+
+// Logs opened by this process. Reopening one appends to it.
+static QSet<QString> _logs;
+
+QtCamGstMessageRecorder::QtCamGstMessageRecorder(const QString& fileName, QObject *parent) :
+  QThread(parent),
+  m_file(fileName),
+  m_last(0),
+  m_head(0),
+  m_open(0),
+  m_quit(false) {
+
+}
+
+QtCamGstMessageRecorder::~QtCamGstMessageRecorder() {
+  close();
+}
+
+bool QtCamGstMessageRecorder::open() {
+  // A new device, e.g. after switching cameras, continues the log of the previous one.
+  QFile::OpenMode mode = _logs.contains(m_file.fileName()) ?
+    QFile::WriteOnly | QFile::Append : QFile::WriteOnly | QFile::Truncate;
+
+  if (!m_file.open(mode)) {
+    qWarning() << "Failed to open" << m_file.fileName() << m_file.errorString();
+    return false;
+  }
+
+  if (m_file.size() == 0 &&
+      (m_file.write(LOG_MAGIC, LOG_MAGIC_SIZE) != LOG_MAGIC_SIZE || !m_file.flush())) {
+    qWarning() << "Failed to write to" << m_file.fileName() << m_file.errorString();
+    m_file.close();
+    return false;
+  }
+
+  _logs << m_file.fileName();
+
+  m_last = 0;
+  m_quit = false;
+  m_timer.start();
+  m_open.fetchAndStoreOrdered(1);
+
+  start(QThread::LowPriority);
+
+  return true;
+}
+
+void QtCamGstMessageRecorder::close() {
+  if (!m_file.isOpen()) {
+    return;
+  }
+
+  m_open.fetchAndStoreOrdered(0);
+
+  m_mutex.lock();
+  m_quit = true;
+  m_cond.wakeOne();
+  m_mutex.unlock();
+
+  wait();
+
+  // Anything queued by a record() call that raced with us.
+  write(takeAll());
+
+  m_file.close();
+}
+
+void QtCamGstMessageRecorder::record(GstMessage *message) {
+#if defined(QT4)
+  if (!(int)m_open) {
+#else
+  if (!m_open.load()) {
+#endif
+    return;
+  }
+
+  // The message keeps its source alive so the writer can still ask for its name.
+  QtCamGstMessageRecorderEntry *entry = new QtCamGstMessageRecorderEntry;
+  entry->timestamp = m_timer.nsecsElapsed() / 1000;
+  entry->message = gst_message_ref(message);
+
+  QtCamGstMessageRecorderEntry *head;
+
+  do {
+#if defined(QT4)
+    head = m_head;
+#else
+    head = m_head.load();
+#endif
+    entry->next = head;
+  } while (!m_head.testAndSetOrdered(head, entry));
+
+  if (!head) {
+    // The writer might be sleeping. It does not hold the mutex while writing so this
+    // is only ever contended by another producer.
+    m_mutex.lock();
+    m_cond.wakeOne();
+    m_mutex.unlock();
+  }
+}
+
+QtCamGstMessageRecorderEntry *QtCamGstMessageRecorder::takeAll() {
+  QtCamGstMessageRecorderEntry *entries = m_head.fetchAndStoreOrdered(0);
+
+  // Pushed newest first.
+  QtCamGstMessageRecorderEntry *ordered = 0;
+
+  while (entries) {
+    QtCamGstMessageRecorderEntry *next = entries->next;
+    entries->next = ordered;
+    ordered = entries;
+    entries = next;
+  }
+
+  return ordered;
+}
+
+void QtCamGstMessageRecorder::run() {
+  forever {
+    m_mutex.lock();
+
+#if defined(QT4)
+    while (!m_quit && !(QtCamGstMessageRecorderEntry *)m_head) {
+#else
+    while (!m_quit && !m_head.load()) {
+#endif
+      m_cond.wait(&m_mutex);
+    }
+
+    bool quit = m_quit;
+
+    m_mutex.unlock();
+
+    write(takeAll());
+
+    if (quit) {
+      return;
+    }
+  }
+}
+
+void QtCamGstMessageRecorder::write(QtCamGstMessageRecorderEntry *entries) {
+  if (!entries) {
+    return;
+  }
+
+  QByteArray data;
+  QByteArray record;
+
+  while (entries) {
+    GstMessage *message = entries->message;
+    GstStructure *s = 0;
+
+    switch (GST_MESSAGE_TYPE(message)) {
+    case GST_MESSAGE_ERROR:
+    case GST_MESSAGE_WARNING:
+    case GST_MESSAGE_INFO: {
+      // GError cannot be serialized so we keep what we need in a structure of our own.
+      GError *err = NULL;
+      gchar *debug = NULL;
+
+      if (GST_MESSAGE_TYPE(message) == GST_MESSAGE_ERROR) {
+	gst_message_parse_error(message, &err, &debug);
+      }
+      else if (GST_MESSAGE_TYPE(message) == GST_MESSAGE_WARNING) {
+	gst_message_parse_warning(message, &err, &debug);
+      }
+      else {
+	gst_message_parse_info(message, &err, &debug);
+      }
+
+      s = errorToStructure(err, debug);
+
+      g_error_free(err);
+      g_free(debug);
+    }
+      break;
+
+    case GST_MESSAGE_STATE_CHANGED: {
+      GstState oldState, newState, pending;
+      gst_message_parse_state_changed(message, &oldState, &newState, &pending);
+      s = gst_structure_new(STATE_CHANGED_STRUCTURE_NAME,
+			    "old", G_TYPE_INT, oldState,
+			    "new", G_TYPE_INT, newState,
+			    "pending", G_TYPE_INT, pending,
+			    NULL);
+    }
+      break;
+
+    default:
+      break;
+    }
+
+    record.clear();
+
+    writeVarint(record, qMax<qint64>(0, entries->timestamp - m_last));
+    m_last = entries->timestamp;
+
+    writeVarint(record, GST_MESSAGE_TYPE(message));
+
+    // Messages from the pipeline itself are recorded without a source name.
+    if (GST_MESSAGE_SRC(message) && GST_OBJECT_PARENT(GST_MESSAGE_SRC(message))) {
+      gchar *name = gst_object_get_name(GST_MESSAGE_SRC(message));
+      writeString(record, name ? name : "");
+      g_free(name);
+    }
+    else {
+      writeString(record, "");
+    }
+
+    const GstStructure *structure = s ? s : gst_message_get_structure(message);
+    if (structure) {
+      writeStructure(record, structure);
+    }
+    else {
+      writeString(record, "");
+    }
+
+    if (s) {
+      gst_structure_free(s);
+    }
+
+    writeVarint(data, record.size());
+    data.append(record);
+
+    gst_message_unref(message);
+
+    QtCamGstMessageRecorderEntry *next = entries->next;
+    delete entries;
+    entries = next;
+  }
+
+  // We are mostly used to debug crashes so do not keep anything buffered.
+  m_file.write(data);
+  m_file.flush();
+}
+
+QtCamGstMessageReplay::QtCamGstMessageReplay(QtCamGstMessageListener *listener, QObject *parent) :
+  QObject(parent),
+  m_listener(listener),
+  m_timer(new QTimer(this)),
+  m_pos(0) {
+
+  m_timer->setSingleShot(true);
+  QObject::connect(m_timer, SIGNAL(timeout()), this, SLOT(next()));
+}
+
+QtCamGstMessageReplay::~QtCamGstMessageReplay() {
+  clear();
+}
+
+bool QtCamGstMessageReplay::load(const QString& fileName) {
+  clear();
+
+  QFile file(fileName);
+  if (!file.open(QFile::ReadOnly)) {
+    qWarning() << "Failed to open" << fileName << file.errorString();
+    return false;
+  }
+
+  QByteArray data = file.readAll();
+  if (!data.startsWith(QByteArray(LOG_MAGIC, LOG_MAGIC_SIZE))) {
+    qWarning() << fileName << "is not a message log";
+    return false;
+  }
+
+  return loadBinary(data);
+}
+
+bool QtCamGstMessageReplay::loadBinary(const QByteArray& data) {
+  int skipped = 0;
+  int pos = LOG_MAGIC_SIZE;
+  qint64 timestamp = 0;
+
+  while (pos < data.size()) {
+    quint64 size;
+    if (!readVarint(data, pos, &size) || size > (quint64)(data.size() - pos)) {
+      // Most likely cut short by a crash.
+      qWarning() << "Truncated record at" << pos;
+      break;
+    }
+
+    QByteArray record = data.mid(pos, size);
+    pos += size;
+
+    int p = 0;
+    quint64 delta, type;
+    QByteArray src;
+    if (!readVarint(record, p, &delta) || !readVarint(record, p, &type) ||
+	!readString(record, p, &src)) {
+      ++skipped;
+      continue;
+    }
+
+    timestamp += delta;
+
+    // An empty name means the message had no structure.
+    GstStructure *s = readStructure(record, p);
+
+    Entry entry;
+    entry.timestamp = timestamp;
+    entry.message = s ? toMessage((GstMessageType)type, src, s) : 0;
+    if (entry.message) {
+      m_messages << entry;
+    }
+    else {
+      ++skipped;
+    }
+  }
+
+  if (skipped) {
+    qDebug() << "Skipped" << skipped << "messages that cannot be replayed";
+  }
+
+  return true;
+}
+
+void QtCamGstMessageReplay::clear() {
+  stop();
+
+  while (!m_messages.isEmpty()) {
+    gst_message_unref(m_messages.takeFirst().message);
+  }
+}
+
+int QtCamGstMessageReplay::size() const {
+  return m_messages.size();
+}
+
+void QtCamGstMessageReplay::replay() {
+  stop();
+
+  foreach (const Entry& entry, m_messages) {
+    m_listener->injectMessage(entry.message);
+  }
+
+  emit finished();
+}
+
+void QtCamGstMessageReplay::start() {
+  stop();
+
+  if (m_messages.isEmpty()) {
+    emit finished();
+    return;
+  }
+
+  m_elapsed.start();
+  m_timer->start(0);
+}
+
+void QtCamGstMessageReplay::stop() {
+  m_timer->stop();
+  m_pos = 0;
+}
+
+void QtCamGstMessageReplay::next() {
+  if (m_pos >= m_messages.size()) {
+    return;
+  }
+
+  m_listener->injectMessage(m_messages[m_pos++].message);
+
+  if (m_pos == m_messages.size()) {
+    m_pos = 0;
+    emit finished();
+    return;
+  }
+
+  qint64 due = (m_messages[m_pos].timestamp - m_messages[0].timestamp) / 1000;
+  m_timer->start(qMax<qint64>(0, due - m_elapsed.elapsed()));
+}
+
+GstMessage *QtCamGstMessageReplay::toMessage(GstMessageType type, const QByteArray& src,
+					     GstStructure *s) {
+  GstMessage *message = 0;
+
+  if (type == GST_MESSAGE_ELEMENT) {
+    // Takes ownership of the structure
+    return gst_message_new_element(NULL, s);
+  }
+  else if (type == GST_MESSAGE_STATE_CHANGED) {
+    // Only the pipeline state is of interest to the listener.
+    int oldState = 0, newState = 0, pending = 0;
+    if (src.isEmpty() &&
+	gst_structure_get_int(s, "old", &oldState) &&
+	gst_structure_get_int(s, "new", &newState) &&
+	gst_structure_get_int(s, "pending", &pending)) {
+      message = gst_message_new_state_changed(NULL, (GstState)oldState,
+					      (GstState)newState, (GstState)pending);
+    }
+  }
+  else if (gst_structure_has_name(s, ERROR_STRUCTURE_NAME)) {
+    QByteArray debug;
+    GError *err = structureToError(s, debug);
+
+    if (type == GST_MESSAGE_ERROR) {
+      message = gst_message_new_error(NULL, err, debug.constData());
+    }
+    else if (type == GST_MESSAGE_WARNING) {
+      message = gst_message_new_warning(NULL, err, debug.constData());
+    }
+    else if (type == GST_MESSAGE_INFO) {
+      message = gst_message_new_info(NULL, err, debug.constData());
+    }
+
+    g_error_free(err);
+  }
+
+  gst_structure_free(s);
+
+  return message;
+}
@@ -0,0 +1,123 @@
+// -*- c++ -*-
+
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef QT_CAM_GST_MESSAGE_RECORDER_H
+#define QT_CAM_GST_MESSAGE_RECORDER_H
+
+#include <QObject>
+#include <QThread>
+#include <QList>
+#include <QFile>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicPointer>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <gst/gst.h>
+
+class QtCamGstMessageListener;
+class QtCamGstMessageRecorderEntry;
+class QTimer;
+
+// Writes every message seen by a QtCamGstMessageListener to a file. record() only queues
+// the message and a thread of its own encodes and writes it. The file starts with
+// "QTCAMMSG" and a version byte followed by one record per message:
+// <size><usecs since previous><message type><source name or empty for the pipeline><structure>
+// Numbers are varints and strings are prefixed with their size.
+class QtCamGstMessageRecorder : public QThread {
+  Q_OBJECT
+
+public:
+  QtCamGstMessageRecorder(const QString& fileName, QObject *parent = 0);
+  ~QtCamGstMessageRecorder();
+
+  bool open();
+
+  // Writes out whatever is still queued.
+  void close();
+
+  // Can be called from any thread. Does not lock.
+  void record(GstMessage *message);
+
+protected:
+  void run();
+
+private:
+  QtCamGstMessageRecorderEntry *takeAll();
+  void write(QtCamGstMessageRecorderEntry *entries);
+
+  QFile m_file;
+  QElapsedTimer m_timer;
+  qint64 m_last;
+
+  QAtomicPointer<QtCamGstMessageRecorderEntry> m_head;
+  QAtomicInt m_open;
+  bool m_quit;
+  QMutex m_mutex;
+  QWaitCondition m_cond;
+};
+
+// Feeds messages saved by QtCamGstMessageRecorder to a listener and its handlers.
+class QtCamGstMessageReplay : public QObject {
+  Q_OBJECT
+
+public:
+  QtCamGstMessageReplay(QtCamGstMessageListener *listener, QObject *parent = 0);
+  ~QtCamGstMessageReplay();
+
+  bool load(const QString& fileName);
+  void clear();
+
+  int size() const;
+
+  // Delivers all messages before returning. Recorded timing is ignored.
+  void replay();
+
+  // Delivers messages from the event loop, spaced the way they were recorded.
+  void start();
+  void stop();
+
+signals:
+  void finished();
+
+private slots:
+  void next();
+
+private:
+  class Entry {
+  public:
+    qint64 timestamp;
+    GstMessage *message;
+  };
+
+  bool loadBinary(const QByteArray& data);
+
+  static GstMessage *toMessage(GstMessageType type, const QByteArray& src, GstStructure *s);
+
+  QtCamGstMessageListener *m_listener;
+  QList<Entry> m_messages;
+  QTimer *m_timer;
+  QElapsedTimer m_elapsed;
+  int m_pos;
+};
+
+#endif /* QT_CAM_GST_MESSAGE_RECORDER_H */
@@ -0,0 +1,306 @@
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "qtcamhistogram.h"
+#include "qtcamgstsample.h"
+#include <gst/video/video.h>
+#include <QMutexLocker>
+#include <cmath>
+#include <cstring>
+
+// Enough samples for a stable histogram whatever the viewfinder resolution is.
+#define SAMPLES_PER_FRAME        32768
+#define DEFAULT_INTERVAL         100
+#define SHADOWS_LEVEL            2
+#define HIGHLIGHTS_LEVEL         253
+
+// Interleaved sub histograms so consecutive samples falling into the same
+// bin do not serialize on a single counter.
+#define LANES                    4
+
+class QtCamHistogramComponent {
+public:
+  const uchar *data;
+  int stride;
+  int pixelStride;
+  int xShift;
+  int yShift;
+};
+
+static inline uchar clamp(int val) {
+  return val < 0 ? 0 : val > 255 ? 255 : val;
+}
+
+QtCamHistogramData::QtCamHistogramData() :
+  luma(256, 0),
+  red(256, 0),
+  green(256, 0),
+  blue(256, 0),
+  samples(0),
+  shadowsClipped(0),
+  highlightsClipped(0),
+  mean(0),
+  median(0) {
+
+}
+
+QtCamHistogram::QtCamHistogram(QObject *parent) :
+  QObject(parent),
+  m_interval(DEFAULT_INTERVAL) {
+
+}
+
+QtCamHistogram::~QtCamHistogram() {
+
+}
+
+int QtCamHistogram::interval() {
+  QMutexLocker locker(&m_mutex);
+
+  return m_interval;
+}
+
+void QtCamHistogram::setInterval(int interval) {
+  QMutexLocker locker(&m_mutex);
+
+  m_interval = qMax(0, interval);
+}
+
+QtCamHistogramData QtCamHistogram::data() {
+  QMutexLocker locker(&m_mutex);
+
+  return m_data;
+}
+
+void QtCamHistogram::handleSample(const QtCamGstSample *sample) {
+  m_mutex.lock();
+
+  if (m_timer.isValid() && m_timer.elapsed() < m_interval) {
+    m_mutex.unlock();
+    return;
+  }
+
+  m_timer.start();
+  m_mutex.unlock();
+
+  // Computed outside the lock so readers never wait for a frame.
+  QtCamHistogramData data;
+  if (!compute(sample, data)) {
+    return;
+  }
+
+  m_mutex.lock();
+  m_data = data;
+  m_mutex.unlock();
+
+  emit updated();
+}
+
+bool QtCamHistogram::compute(const QtCamGstSample *sample, QtCamHistogramData& data) {
+  int width = sample->width();
+  int height = sample->height();
+
+  if (width <= 0 || height <= 0) {
+    return false;
+  }
+
+  QtCamHistogramComponent comps[3];
+  bool rgb;
+  const uchar *src = 0;
+  qint64 size = 0;
+
+#if GST_CHECK_VERSION(1,0,0)
+  GstVideoInfo info;
+  if (!gst_video_info_from_caps(&info, sample->caps())) {
+    return false;
+  }
+
+  if (GST_VIDEO_INFO_N_COMPONENTS(&info) < 3) {
+    return false;
+  }
+
+  rgb = GST_VIDEO_INFO_IS_RGB(&info);
+
+  for (int x = 0; x < 3; x++) {
+    if (GST_VIDEO_INFO_COMP_DEPTH(&info, x) != 8) {
+      return false;
+    }
+
+    comps[x].data = (const uchar *)GST_VIDEO_INFO_COMP_OFFSET(&info, x);
+    comps[x].stride = GST_VIDEO_INFO_COMP_STRIDE(&info, x);
+    comps[x].pixelStride = GST_VIDEO_INFO_COMP_PSTRIDE(&info, x);
+    comps[x].xShift = info.finfo->w_sub[x];
+    comps[x].yShift = info.finfo->h_sub[x];
+  }
+
+  GstMapInfo map;
+  if (!gst_buffer_map(sample->buffer(), &map, GST_MAP_READ)) {
+    return false;
+  }
+
+  src = map.data;
+  size = map.size;
+#else
+  GstVideoFormat format = sample->format();
+  if (format == GST_VIDEO_FORMAT_UNKNOWN || gst_video_format_is_gray(format)) {
+    return false;
+  }
+
+  rgb = gst_video_format_is_rgb(format);
+
+  for (int x = 0; x < 3; x++) {
+    if (gst_video_format_get_component_depth(format, x) != 8) {
+      return false;
+    }
+
+    comps[x].data =
+      (const uchar *)gst_video_format_get_component_offset(format, x, width, height);
+    comps[x].stride = gst_video_format_get_row_stride(format, x, width);
+    comps[x].pixelStride = gst_video_format_get_pixel_stride(format, x);
+    comps[x].xShift =
+      gst_video_format_get_component_width(format, x, width) < width ? 1 : 0;
+    comps[x].yShift =
+      gst_video_format_get_component_height(format, x, height) < height ? 1 : 0;
+  }
+
+  src = GST_BUFFER_DATA(sample->buffer());
+  size = GST_BUFFER_SIZE(sample->buffer());
+#endif
+
+  bool ok = src != 0;
+
+  for (int x = 0; ok && x < 3; x++) {
+    QtCamHistogramComponent& c = comps[x];
+    qint64 offset = (qint64)c.data;
+    qint64 last = offset + (qint64)((height - 1) >> c.yShift) * c.stride +
+      (qint64)((width - 1) >> c.xShift) * c.pixelStride;
+
+    ok = last < size;
+    c.data = src + offset;
+  }
+
+  if (ok) {
+    int step = qMax(1, (int)sqrt((double)width * height / SAMPLES_PER_FRAME));
+
+    quint32 luma[LANES][256];
+    quint32 red[LANES][256];
+    quint32 green[LANES][256];
+    quint32 blue[LANES][256];
+
+    memset(luma, 0x0, sizeof(luma));
+    memset(red, 0x0, sizeof(red));
+    memset(green, 0x0, sizeof(green));
+    memset(blue, 0x0, sizeof(blue));
+
+    const QtCamHistogramComponent& c0 = comps[0];
+    const QtCamHistogramComponent& c1 = comps[1];
+    const QtCamHistogramComponent& c2 = comps[2];
+
+    quint32 samples = 0;
+
+    for (int y = step / 2; y < height; y += step) {
+      const uchar *l0 = c0.data + (y >> c0.yShift) * c0.stride;
+      const uchar *l1 = c1.data + (y >> c1.yShift) * c1.stride;
+      const uchar *l2 = c2.data + (y >> c2.yShift) * c2.stride;
+
+      int lane = 0;
+
+      for (int x = step / 2; x < width; x += step) {
+	int v0 = l0[(x >> c0.xShift) * c0.pixelStride];
+	int v1 = l1[(x >> c1.xShift) * c1.pixelStride];
+	int v2 = l2[(x >> c2.xShift) * c2.pixelStride];
+
+	int r, g, b, l;
+
+	if (rgb) {
+	  r = v0;
+	  g = v1;
+	  b = v2;
+	  l = (77 * r + 150 * g + 29 * b) >> 8;
+	}
+	else {
+	  // BT.601, video range.
+	  int c = 298 * (v0 - 16);
+	  int d = v1 - 128;
+	  int e = v2 - 128;
+
+	  r = clamp((c + 409 * e + 128) >> 8);
+	  g = clamp((c - 100 * d - 208 * e + 128) >> 8);
+	  b = clamp((c + 516 * d + 128) >> 8);
+	  l = clamp((c + 128) >> 8);
+	}
+
+	++luma[lane][l];
+	++red[lane][r];
+	++green[lane][g];
+	++blue[lane][b];
+
+	lane = (lane + 1) & (LANES - 1);
+	++samples;
+      }
+    }
+
+    quint64 total = 0;
+
+    for (int x = 0; x < 256; x++) {
+      data.luma[x] = luma[0][x] + luma[1][x] + luma[2][x] + luma[3][x];
+      data.red[x] = red[0][x] + red[1][x] + red[2][x] + red[3][x];
+      data.green[x] = green[0][x] + green[1][x] + green[2][x] + green[3][x];
+      data.blue[x] = blue[0][x] + blue[1][x] + blue[2][x] + blue[3][x];
+
+      total += (quint64)x * data.luma[x];
+    }
+
+    data.samples = samples;
+
+    if (samples > 0) {
+      quint32 shadows = 0;
+      quint32 highlights = 0;
+
+      for (int x = 0; x <= SHADOWS_LEVEL; x++) {
+	shadows += data.luma[x];
+      }
+
+      for (int x = HIGHLIGHTS_LEVEL; x < 256; x++) {
+	highlights += data.luma[x];
+      }
+
+      data.shadowsClipped = shadows * 100.0 / samples;
+      data.highlightsClipped = highlights * 100.0 / samples;
+      data.mean = total / samples;
+
+      quint32 count = 0;
+      for (int x = 0; x < 256; x++) {
+	count += data.luma[x];
+	if (count * 2 >= samples) {
+	  data.median = x;
+	  break;
+	}
+      }
+    }
+  }
+
+#if GST_CHECK_VERSION(1,0,0)
+  gst_buffer_unmap(sample->buffer(), &map);
+#endif
+
+  return ok;
+}
@@ -0,0 +1,81 @@
+// -*- c++ -*-
+
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef QT_CAM_HISTOGRAM_H
+#define QT_CAM_HISTOGRAM_H
+
+#include <QObject>
+#include <QVector>
+#include <QMutex>
+#include <QElapsedTimer>
+#include "qtcamviewfinderbufferhandler.h"
+
+class QtCamHistogramData {
+public:
+  QtCamHistogramData();
+
+  QVector<quint32> luma;
+  QVector<quint32> red;
+  QVector<quint32> green;
+  QVector<quint32> blue;
+
+  quint32 samples;
+
+  // Percentage of samples at the ends of the luma range.
+  qreal shadowsClipped;
+  qreal highlightsClipped;
+
+  int mean;
+  int median;
+};
+
+// Luma and RGB histograms of viewfinder frames.
+// Frames are sampled on a sparse grid and at most once every interval milliseconds.
+class QtCamHistogram : public QObject, public QtCamViewfinderBufferHandler {
+  Q_OBJECT
+
+public:
+  QtCamHistogram(QObject *parent = 0);
+  ~QtCamHistogram();
+
+  int interval();
+  void setInterval(int interval);
+
+  QtCamHistogramData data();
+
+  void handleSample(const QtCamGstSample *sample);
+
+  // Exposed for benchmarking
+  static bool compute(const QtCamGstSample *sample, QtCamHistogramData& data);
+
+signals:
+  // Emitted from the streaming thread.
+  void updated();
+
+private:
+  QMutex m_mutex;
+  QElapsedTimer m_timer;
+  int m_interval;
+  QtCamHistogramData m_data;
+};
+
+#endif /* QT_CAM_HISTOGRAM_H */
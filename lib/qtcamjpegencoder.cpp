@@ -0,0 +1,603 @@
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "qtcamjpegencoder.h"
+#include <QImage>
+#include <QSize>
+#include <QFile>
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QVector>
+#include <QDebug>
+#include <cstdio>
+#include <csetjmp>
+#include <climits>
+extern "C" {
+#include <jpeglib.h>
+}
+
+#define MARKER_SOI               0xd8
+#define MARKER_EOI               0xd9
+#define MARKER_SOS               0xda
+#define MARKER_DRI               0xdd
+#define MARKER_RST0              0xd0
+#define MARKER_SOF0              0xc0
+// 4:2:0 chroma subsampling
+#define MCU_SIZE                 16
+// More bands than threads evens out the load.
+#define BANDS_PER_THREAD         2
+#define OUTPUT_CHUNK             (64 * 1024)
+// Pixels of a band save() asks a source for.
+#define STREAM_BAND_PIXELS       (1024 * 1024)
+
+// Luminance table of the JPEG specification, section K.1.
+static const int std_luminance_quant_tbl[DCTSIZE2] = {
+  16,  11,  10,  16,  24,  40,  51,  61,
+  12,  12,  14,  19,  26,  58,  60,  55,
+  14,  13,  16,  24,  40,  57,  69,  56,
+  14,  17,  22,  29,  51,  87,  80,  62,
+  18,  22,  37,  56,  68, 109, 103,  77,
+  24,  35,  55,  64,  81, 104, 113,  92,
+  49,  64,  78,  87, 103, 121, 120, 101,
+  72,  92,  95,  98, 112, 100, 103,  99
+};
+
+class QtCamJpegEncoderError {
+public:
+  struct jpeg_error_mgr mgr;
+  jmp_buf jump;
+};
+
+class QtCamJpegEncoderDestination {
+public:
+  struct jpeg_destination_mgr mgr;
+  QByteArray *out;
+};
+
+static void error_exit(j_common_ptr cinfo) {
+  char buffer[JMSG_LENGTH_MAX];
+  (*cinfo->err->format_message)(cinfo, buffer);
+  qWarning() << "JPEG encoding failed:" << buffer;
+
+  QtCamJpegEncoderError *err = (QtCamJpegEncoderError *)cinfo->err;
+  longjmp(err->jump, 1);
+}
+
+static void init_destination(j_compress_ptr cinfo) {
+  QtCamJpegEncoderDestination *dest = (QtCamJpegEncoderDestination *)cinfo->dest;
+  dest->out->resize(OUTPUT_CHUNK);
+  dest->mgr.next_output_byte = (JOCTET *)dest->out->data();
+  dest->mgr.free_in_buffer = dest->out->size();
+}
+
+static boolean empty_output_buffer(j_compress_ptr cinfo) {
+  // libjpeg wants the whole buffer flushed no matter what free_in_buffer says.
+  QtCamJpegEncoderDestination *dest = (QtCamJpegEncoderDestination *)cinfo->dest;
+  int used = dest->out->size();
+  dest->out->resize(used * 2);
+  dest->mgr.next_output_byte = (JOCTET *)dest->out->data() + used;
+  dest->mgr.free_in_buffer = dest->out->size() - used;
+  return TRUE;
+}
+
+static void term_destination(j_compress_ptr cinfo) {
+  QtCamJpegEncoderDestination *dest = (QtCamJpegEncoderDestination *)cinfo->dest;
+  dest->out->resize(dest->out->size() - dest->mgr.free_in_buffer);
+}
+
+// Compresses lines top to bottom of image as a JPEG of its own without any APPn.
+static bool encodeBand(const QImage& image, int top, int bottom, int quality, QByteArray *out) {
+  struct jpeg_compress_struct cinfo;
+  QtCamJpegEncoderError err;
+  QtCamJpegEncoderDestination dest;
+
+  cinfo.err = jpeg_std_error(&err.mgr);
+  err.mgr.error_exit = error_exit;
+
+  // Declared before setjmp() so longjmp() cannot clobber it.
+  QVector<JSAMPLE> line;
+
+  if (setjmp(err.jump)) {
+    jpeg_destroy_compress(&cinfo);
+    return false;
+  }
+
+  jpeg_create_compress(&cinfo);
+
+  dest.out = out;
+  dest.mgr.init_destination = init_destination;
+  dest.mgr.empty_output_buffer = empty_output_buffer;
+  dest.mgr.term_destination = term_destination;
+  cinfo.dest = &dest.mgr;
+
+  cinfo.image_width = image.width();
+  cinfo.image_height = bottom - top;
+  cinfo.input_components = 3;
+  cinfo.in_color_space = JCS_RGB;
+
+#if defined(JCS_EXTENSIONS) && Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+  // libjpeg-turbo reads the RGB32 lines as they are.
+  cinfo.input_components = 4;
+  cinfo.in_color_space = JCS_EXT_BGRX;
+#endif
+
+  jpeg_set_defaults(&cinfo);
+  jpeg_set_quality(&cinfo, quality, TRUE);
+
+  // The bands must share their tables so no per band Huffman tables.
+  cinfo.optimize_coding = FALSE;
+  cinfo.write_JFIF_header = FALSE;
+  cinfo.write_Adobe_marker = FALSE;
+  cinfo.comp_info[0].h_samp_factor = 2;
+  cinfo.comp_info[0].v_samp_factor = 2;
+  cinfo.comp_info[1].h_samp_factor = 1;
+  cinfo.comp_info[1].v_samp_factor = 1;
+  cinfo.comp_info[2].h_samp_factor = 1;
+  cinfo.comp_info[2].v_samp_factor = 1;
+
+  jpeg_start_compress(&cinfo, TRUE);
+
+  if (cinfo.input_components == 3) {
+    line.resize(image.width() * 3);
+  }
+
+  while (cinfo.next_scanline < cinfo.image_height) {
+    const QRgb *in = (const QRgb *)image.constScanLine(top + cinfo.next_scanline);
+    JSAMPROW row;
+
+    if (cinfo.input_components == 3) {
+      JSAMPLE *out = line.data();
+      for (int x = 0; x < image.width(); x++) {
+	*out++ = qRed(in[x]);
+	*out++ = qGreen(in[x]);
+	*out++ = qBlue(in[x]);
+      }
+
+      row = line.data();
+    } else {
+      row = (JSAMPROW)in;
+    }
+
+    jpeg_write_scanlines(&cinfo, &row, 1);
+  }
+
+  jpeg_finish_compress(&cinfo);
+  jpeg_destroy_compress(&cinfo);
+
+  return true;
+}
+
+class QtCamJpegEncoderBand : public QRunnable {
+public:
+  QtCamJpegEncoderBand(const QImage& image, int top, int bottom, int quality,
+		       QByteArray *out, bool *ok, QSemaphore *done) :
+    m_image(image),
+    m_top(top),
+    m_bottom(bottom),
+    m_quality(quality),
+    m_out(out),
+    m_ok(ok),
+    m_done(done) {
+
+  }
+
+  void run() {
+    *m_ok = encodeBand(m_image, m_top, m_bottom, m_quality, m_out);
+    m_done->release();
+  }
+
+private:
+  const QImage& m_image;
+  int m_top;
+  int m_bottom;
+  int m_quality;
+  QByteArray *m_out;
+  bool *m_ok;
+  QSemaphore *m_done;
+};
+
+// Offsets of the SOS segment and of the entropy coded data following it.
+static bool findScan(const QByteArray& data, int *sos, int *scan) {
+  const uchar *d = (const uchar *)data.constData();
+  int size = data.size();
+
+  if (size < 4 || d[0] != 0xff || d[1] != MARKER_SOI) {
+    return false;
+  }
+
+  int pos = 2;
+  while (pos + 4 <= size) {
+    if (d[pos] != 0xff) {
+      return false;
+    }
+
+    int length = (d[pos + 2] << 8) | d[pos + 3];
+    if (d[pos + 1] == MARKER_SOS) {
+      *sos = pos;
+      *scan = pos + 2 + length;
+      return *scan <= size - 2;
+    }
+
+    pos += 2 + length;
+  }
+
+  return false;
+}
+
+static QByteArray jfifHeader() {
+  static const char app0[] = {
+    '\xff', '\xe0', 0, 16, 'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0
+  };
+
+  return QByteArray(app0, sizeof(app0));
+}
+
+static void appendMarker(QByteArray *out, uchar marker) {
+  out->append((char)0xff);
+  out->append((char)marker);
+}
+
+// Everything up to the entropy coded data of an image of the given size made of
+// count bands, taking the tables from the first one.
+static QByteArray header(const QByteArray& first, const QList<QByteArray>& metadata,
+			 int width, int height, int bandHeight, int count) {
+  int sos = 0;
+  int scan = 0;
+  if (!findScan(first, &sos, &scan)) {
+    return QByteArray();
+  }
+
+  QByteArray out;
+
+  appendMarker(&out, MARKER_SOI);
+
+  if (metadata.isEmpty()) {
+    out.append(jfifHeader());
+  } else {
+    foreach (const QByteArray& segment, metadata) {
+      out.append(segment);
+    }
+  }
+
+  // Tables and frame header of the first band with the height of the whole image.
+  int headers = out.size();
+  out.append(first.mid(2, sos - 2));
+
+  for (int pos = headers; pos + 9 <= out.size(); ) {
+    uchar marker = (uchar)out[pos + 1];
+    int length = ((uchar)out[pos + 2] << 8) | (uchar)out[pos + 3];
+    if (marker == MARKER_SOF0) {
+      out[pos + 5] = (char)(height >> 8);
+      out[pos + 6] = (char)(height & 0xff);
+      break;
+    }
+
+    pos += 2 + length;
+  }
+
+  if (count > 1) {
+    // Each band is exactly one restart interval.
+    int interval = ((width + MCU_SIZE - 1) / MCU_SIZE) * (bandHeight / MCU_SIZE);
+    appendMarker(&out, MARKER_DRI);
+    out.append((char)0);
+    out.append((char)4);
+    out.append((char)(interval >> 8));
+    out.append((char)(interval & 0xff));
+  }
+
+  out.append(first.mid(sos, scan - sos));
+
+  return out;
+}
+
+// Appends the entropy coded data of band number index.
+static bool appendBand(QByteArray *out, const QByteArray& band, int index) {
+  int sos = 0;
+  int scan = 0;
+  if (!findScan(band, &sos, &scan)) {
+    return false;
+  }
+
+  if (index > 0) {
+    appendMarker(out, MARKER_RST0 + ((index - 1) % 8));
+  }
+
+  // Everything up to EOI.
+  out->append(band.constData() + scan, band.size() - scan - 2);
+
+  return true;
+}
+
+QByteArray QtCamJpegEncoder::encode(const QImage& image, int quality,
+				    const QList<QByteArray>& metadata,
+				    QThreadPool *pool, int threads) {
+  if (image.isNull()) {
+    return QByteArray();
+  }
+
+  QImage rgb = image.format() == QImage::Format_RGB32 || image.format() == QImage::Format_ARGB32 ?
+    image : image.convertToFormat(QImage::Format_RGB32);
+
+  QThreadPool localPool;
+  if (!pool) {
+    pool = &localPool;
+  }
+
+  if (threads <= 0) {
+    threads = pool->maxThreadCount();
+  }
+
+  int height = bandHeight(rgb.width(), rgb.height(), threads);
+  int count = (rgb.height() + height - 1) / height;
+
+  QVector<QByteArray> bands(count);
+  QVector<bool> ok(count);
+  QSemaphore done;
+
+  // The calling thread takes the first band instead of waiting idle.
+  for (int x = 1; x < count; x++) {
+    pool->start(new QtCamJpegEncoderBand(rgb, x * height, qMin((x + 1) * height, rgb.height()),
+					 quality, &bands[x], &ok[x], &done));
+  }
+
+  ok[0] = encodeBand(rgb, 0, qMin(height, rgb.height()), quality, &bands[0]);
+
+  done.acquire(count - 1);
+
+  for (int x = 0; x < count; x++) {
+    if (!ok[x]) {
+      return QByteArray();
+    }
+  }
+
+  QByteArray out = header(bands[0], metadata, rgb.width(), rgb.height(), height, count);
+  if (out.isEmpty()) {
+    return QByteArray();
+  }
+
+  out.reserve(bands[0].size() * count + 4096);
+
+  for (int x = 0; x < count; x++) {
+    if (!appendBand(&out, bands[x], x)) {
+      return QByteArray();
+    }
+
+    // Do not keep all the bands in memory twice.
+    bands[x].clear();
+  }
+
+  appendMarker(&out, MARKER_EOI);
+
+  return out;
+}
+
+bool QtCamJpegEncoder::save(const QImage& image, const QString& fileName, int quality,
+			    const QList<QByteArray>& metadata, QThreadPool *pool) {
+  QByteArray data = encode(image, quality, metadata, pool);
+  if (data.isEmpty()) {
+    return false;
+  }
+
+  QFile file(fileName);
+  if (!file.open(QFile::WriteOnly | QFile::Truncate)) {
+    qWarning() << "Failed to open" << fileName << file.errorString();
+    return false;
+  }
+
+  if (file.write(data) != data.size()) {
+    qWarning() << "Failed to write" << fileName << file.errorString();
+    return false;
+  }
+
+  return true;
+}
+
+// Compresses the image source produces band by band and writes it to file.
+static bool writeBands(QtCamJpegSource *source, const QSize& size, QFile *file, int quality,
+		       const QList<QByteArray>& metadata, QThreadPool *pool) {
+  int threads = qMax(1, pool->maxThreadCount());
+  int height = QtCamJpegEncoder::streamBandHeight(size.width());
+  int count = (size.height() + height - 1) / height;
+
+  QVector<QImage> images(threads);
+  QVector<QByteArray> bands(threads);
+  QVector<bool> ok(threads);
+
+  for (int first = 0; first < count; first += threads) {
+    int batch = qMin(threads, count - first);
+
+    for (int x = 0; x < batch; x++) {
+      int top = (first + x) * height;
+      int lines = qMin(height, size.height() - top);
+      if (images[x].height() != lines) {
+	images[x] = QImage(size.width(), lines, QImage::Format_RGB32);
+      }
+
+      if (images[x].isNull() || !source->read(top, images[x])) {
+	return false;
+      }
+    }
+
+    QSemaphore done;
+
+    // The calling thread takes the first band instead of waiting idle.
+    for (int x = 1; x < batch; x++) {
+      pool->start(new QtCamJpegEncoderBand(images[x], 0, images[x].height(), quality,
+					   &bands[x], &ok[x], &done));
+    }
+
+    ok[0] = encodeBand(images[0], 0, images[0].height(), quality, &bands[0]);
+
+    done.acquire(batch - 1);
+
+    QByteArray out;
+
+    for (int x = 0; x < batch; x++) {
+      if (!ok[x]) {
+	return false;
+      }
+
+      if (first + x == 0) {
+	out = header(bands[0], metadata, size.width(), size.height(), height, count);
+	if (out.isEmpty()) {
+	  return false;
+	}
+      }
+
+      if (!appendBand(&out, bands[x], first + x)) {
+	return false;
+      }
+
+      bands[x].clear();
+    }
+
+    if (first + batch == count) {
+      appendMarker(&out, MARKER_EOI);
+    }
+
+    if (file->write(out) != out.size()) {
+      qWarning() << "Failed to write" << file->fileName() << file->errorString();
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool QtCamJpegEncoder::save(QtCamJpegSource *source, const QSize& size,
+			    const QString& fileName, int quality,
+			    const QList<QByteArray>& metadata, QThreadPool *pool) {
+  if (size.isEmpty()) {
+    return false;
+  }
+
+  QThreadPool localPool;
+  if (!pool) {
+    pool = &localPool;
+  }
+
+  QFile file(fileName);
+  if (!file.open(QFile::WriteOnly | QFile::Truncate)) {
+    qWarning() << "Failed to open" << fileName << file.errorString();
+    return false;
+  }
+
+  if (!writeBands(source, size, &file, quality, metadata, pool)) {
+    file.remove();
+    return false;
+  }
+
+  return true;
+}
+
+int QtCamJpegEncoder::quality(const QByteArray& jpeg) {
+  const uchar *d = (const uchar *)jpeg.constData();
+  int size = jpeg.size();
+
+  if (size < 4 || d[0] != 0xff || d[1] != MARKER_SOI) {
+    return -1;
+  }
+
+  int sum = -1;
+  int pos = 2;
+
+  while (sum == -1 && pos + 4 <= size && d[pos] == 0xff && d[pos + 1] != MARKER_SOS) {
+    int length = (d[pos + 2] << 8) | d[pos + 3];
+    int end = qMin(pos + 2 + length, size);
+
+    if (d[pos + 1] == 0xdb) {
+      // DQT: a segment can hold several tables.
+      int t = pos + 4;
+      while (t < end) {
+	int precision = d[t] >> 4;
+	int id = d[t] & 0x0f;
+	int bytes = precision ? 2 : 1;
+	if (t + 1 + DCTSIZE2 * bytes > end) {
+	  break;
+	}
+
+	if (id == 0) {
+	  sum = 0;
+	  for (int x = 0; x < DCTSIZE2; x++) {
+	    sum += precision ? (d[t + 1 + 2 * x] << 8) | d[t + 2 + 2 * x] : d[t + 1 + x];
+	  }
+
+	  break;
+	}
+
+	t += 1 + DCTSIZE2 * bytes;
+      }
+    }
+
+    pos += 2 + length;
+  }
+
+  if (sum <= 0) {
+    return -1;
+  }
+
+  // Scale the standard table like jpeg_set_quality() does and pick the closest.
+  int best = -1;
+  int bestDiff = INT_MAX;
+
+  for (int q = 1; q <= 100; q++) {
+    int scale = q < 50 ? 5000 / q : 200 - q * 2;
+    int total = 0;
+
+    for (int x = 0; x < DCTSIZE2; x++) {
+      total += qBound(1, (std_luminance_quant_tbl[x] * scale + 50) / 100, 255);
+    }
+
+    int diff = qAbs(total - sum);
+    if (diff < bestDiff) {
+      bestDiff = diff;
+      best = q;
+    }
+  }
+
+  return best;
+}
+
+int QtCamJpegEncoder::bandHeight(int width, int height, int threads) {
+  int mcuColumns = (width + MCU_SIZE - 1) / MCU_SIZE;
+  int mcuRows = (height + MCU_SIZE - 1) / MCU_SIZE;
+
+  int bands = qMax(1, threads) * BANDS_PER_THREAD;
+  int rows = qMax(1, (mcuRows + bands - 1) / bands);
+
+  // DRI holds a 16 bit number of MCUs.
+  rows = qMin(rows, qMax(1, 65535 / qMax(1, mcuColumns)));
+
+  return rows * MCU_SIZE;
+}
+
+int QtCamJpegEncoder::streamBandHeight(int width) {
+  int mcuColumns = (width + MCU_SIZE - 1) / MCU_SIZE;
+
+  int rows = qMax(1, STREAM_BAND_PIXELS / (mcuColumns * MCU_SIZE * MCU_SIZE));
+
+  // DRI holds a 16 bit number of MCUs.
+  rows = qMin(rows, qMax(1, 65535 / qMax(1, mcuColumns)));
+
+  return rows * MCU_SIZE;
+}
@@ -0,0 +1,78 @@
+// -*- c++ -*-
+
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef QT_CAM_JPEG_ENCODER_H
+#define QT_CAM_JPEG_ENCODER_H
+
+#include <QByteArray>
+#include <QList>
+
+class QImage;
+class QString;
+class QSize;
+class QThreadPool;
+
+// Produces the lines of an image too large to be held in memory at once.
+class QtCamJpegSource {
+public:
+  virtual ~QtCamJpegSource() {}
+
+  // Fills lines, an RGB32 image as wide as the whole one, starting at line top.
+  // Called on the thread calling QtCamJpegEncoder::save() from top to bottom.
+  virtual bool read(int top, QImage& lines) = 0;
+};
+
+// Encodes large images with libjpeg on several threads. The image is cut into
+// horizontal bands which are compressed independently and joined back in
+// order as the restart intervals of a single baseline JPEG. The result decodes
+// to exactly what a single threaded encoder would have produced.
+class QtCamJpegEncoder {
+public:
+  // metadata holds complete APPn segments (see QtCamJpegMetadata::segments())
+  // to be written right after SOI. Without any a JFIF header is written.
+  // A local pool with one thread per core is used if pool is 0.
+  static QByteArray encode(const QImage& image, int quality,
+			   const QList<QByteArray>& metadata = QList<QByteArray>(),
+			   QThreadPool *pool = 0, int threads = 0);
+
+  static bool save(const QImage& image, const QString& fileName, int quality,
+		   const QList<QByteArray>& metadata = QList<QByteArray>(),
+		   QThreadPool *pool = 0);
+
+  // Same as above but only a few bands of lines are asked from source at a time
+  // and written out as soon as they are compressed.
+  static bool save(QtCamJpegSource *source, const QSize& size, const QString& fileName,
+		   int quality, const QList<QByteArray>& metadata = QList<QByteArray>(),
+		   QThreadPool *pool = 0);
+
+  // Estimates the IJG quality (1 - 100) the luminance table of jpeg was made
+  // with. Returns -1 if there is no such table.
+  static int quality(const QByteArray& jpeg);
+
+  // Height of the bands for an image of the given size split for threads.
+  static int bandHeight(int width, int height, int threads);
+
+  // Height of the bands save() asks a source for.
+  static int streamBandHeight(int width);
+};
+
+#endif /* QT_CAM_JPEG_ENCODER_H */
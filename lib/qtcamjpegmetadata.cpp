@@ -0,0 +1,213 @@
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "qtcamjpegmetadata.h"
+#include <QFile>
+#include <QDebug>
+
+#define MARKER_SOI               0xd8
+#define MARKER_SOS               0xda
+#define MARKER_APP0              0xe0
+#define MARKER_APP1              0xe1
+#define MARKER_APP15             0xef
+
+// Calls func for every segment before the start of scan. Returns the offset of
+// the first byte following the last segment header visited or -1 on error.
+template <typename T> static int walk(const QByteArray& data, T func) {
+  const uchar *d = (const uchar *)data.constData();
+  int size = data.size();
+
+  if (size < 4 || d[0] != 0xff || d[1] != MARKER_SOI) {
+    return -1;
+  }
+
+  int pos = 2;
+
+  while (pos + 4 <= size) {
+    if (d[pos] != 0xff) {
+      return -1;
+    }
+
+    uchar marker = d[pos + 1];
+    if (marker == MARKER_SOS) {
+      return pos;
+    }
+
+    int length = (d[pos + 2] << 8) | d[pos + 3];
+    if (length < 2 || pos + 2 + length > size) {
+      return -1;
+    }
+
+    func(marker, pos, length + 2);
+
+    pos += length + 2;
+  }
+
+  return -1;
+}
+
+class QtCamJpegSegmentCollector {
+public:
+  QtCamJpegSegmentCollector(const QByteArray& data, QList<QByteArray> *segments) :
+    m_data(data),
+    m_segments(segments) {
+
+  }
+
+  void operator()(uchar marker, int pos, int length) {
+    if (marker >= MARKER_APP1 && marker <= MARKER_APP15) {
+      *m_segments << m_data.mid(pos, length);
+    }
+  }
+
+private:
+  const QByteArray& m_data;
+  QList<QByteArray> *m_segments;
+};
+
+class QtCamJpegSegmentFilter {
+public:
+  QtCamJpegSegmentFilter(const QByteArray& data, QByteArray *out) :
+    m_data(data),
+    m_out(out) {
+
+  }
+
+  void operator()(uchar marker, int pos, int length) {
+    // JFIF must stay first so we write it ourselves.
+    if (marker < MARKER_APP0 || marker > MARKER_APP15) {
+      m_out->append(m_data.mid(pos, length));
+    }
+  }
+
+private:
+  const QByteArray& m_data;
+  QByteArray *m_out;
+};
+
+class QtCamJpegApp0Finder {
+public:
+  QtCamJpegApp0Finder(const QByteArray& data, QByteArray *out) :
+    m_data(data),
+    m_out(out) {
+
+  }
+
+  void operator()(uchar marker, int pos, int length) {
+    if (marker == MARKER_APP0 && m_out->isEmpty()) {
+      m_out->append(m_data.mid(pos, length));
+    }
+  }
+
+private:
+  const QByteArray& m_data;
+  QByteArray *m_out;
+};
+
+QList<QByteArray> QtCamJpegMetadata::segments(const QByteArray& data) {
+  QList<QByteArray> segments;
+
+  if (walk(data, QtCamJpegSegmentCollector(data, &segments)) == -1) {
+    segments.clear();
+  }
+
+  return segments;
+}
+
+QByteArray QtCamJpegMetadata::replace(const QByteArray& jpeg, const QList<QByteArray>& segments) {
+  QByteArray app0;
+  QByteArray rest;
+
+  if (walk(jpeg, QtCamJpegApp0Finder(jpeg, &app0)) == -1) {
+    return QByteArray();
+  }
+
+  int sos = walk(jpeg, QtCamJpegSegmentFilter(jpeg, &rest));
+
+  QByteArray out;
+  out.reserve(jpeg.size() + 65536);
+  out.append(jpeg.left(2));
+
+  // EXIF readers expect APP1 right after SOI but JFIF readers expect APP0.
+  // Files written by the camera have no APP0 so we only keep it if we have no EXIF.
+  bool hasExif = false;
+  foreach (const QByteArray& segment, segments) {
+    if ((uchar)segment[1] == MARKER_APP1 && segment.mid(4, 4) == "Exif") {
+      hasExif = true;
+      break;
+    }
+  }
+
+  if (!hasExif) {
+    out.append(app0);
+  }
+
+  foreach (const QByteArray& segment, segments) {
+    out.append(segment);
+  }
+
+  out.append(rest);
+  out.append(jpeg.mid(sos));
+
+  return out;
+}
+
+bool QtCamJpegMetadata::copy(const QString& from, const QString& to) {
+  QFile source(from);
+  if (!source.open(QFile::ReadOnly)) {
+    qWarning() << "Failed to open" << from << source.errorString();
+    return false;
+  }
+
+  // Metadata is in the first 64k segments. Stop reading at the first scan.
+  QList<QByteArray> segments = QtCamJpegMetadata::segments(source.read(1024 * 1024));
+  source.close();
+
+  if (segments.isEmpty()) {
+    return false;
+  }
+
+  QFile target(to);
+  if (!target.open(QFile::ReadOnly)) {
+    qWarning() << "Failed to open" << to << target.errorString();
+    return false;
+  }
+
+  QByteArray data = replace(target.readAll(), segments);
+  target.close();
+
+  if (data.isEmpty()) {
+    qWarning() << "Malformed JPEG" << to;
+    return false;
+  }
+
+  if (!target.open(QFile::WriteOnly | QFile::Truncate)) {
+    qWarning() << "Failed to open" << to << target.errorString();
+    return false;
+  }
+
+  if (target.write(data) != data.size()) {
+    qWarning() << "Failed to write" << to << target.errorString();
+    return false;
+  }
+
+  return true;
+}
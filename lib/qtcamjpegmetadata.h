@@ -0,0 +1,43 @@
+// -*- c++ -*-
+
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef QT_CAM_JPEG_METADATA_H
+#define QT_CAM_JPEG_METADATA_H
+
+#include <QByteArray>
+#include <QList>
+
+class QString;
+
+// Moves metadata segments (EXIF, XMP, ...) between JPEG files without
+// touching the compressed image data.
+class QtCamJpegMetadata {
+public:
+  // Returns the APP1 to APP15 segments of data, markers included.
+  static QList<QByteArray> segments(const QByteArray& data);
+
+  // Replaces the metadata segments of to with those of from.
+  static bool copy(const QString& from, const QString& to);
+  static QByteArray replace(const QByteArray& jpeg, const QList<QByteArray>& segments);
+};
+
+#endif /* QT_CAM_JPEG_METADATA_H */
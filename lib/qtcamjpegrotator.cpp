@@ -0,0 +1,592 @@
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "qtcamjpegrotator.h"
+#include "qtcamjpegmetadata.h"
+#include <QFile>
+#include <QImageReader>
+#include <QElapsedTimer>
+#include <QDebug>
+#include <cstdio>
+#include <cstring>
+#include <csetjmp>
+#include <climits>
+extern "C" {
+#include <jpeglib.h>
+}
+
+// Enough to reach the first scan past all the APPn segments.
+#define HEADER_SIZE              (1024 * 1024)
+#define EXIF_HEADER_SIZE         6
+
+#define TAG_ORIENTATION          0x0112
+#define TAG_EXIF_IFD             0x8769
+#define TAG_PIXEL_X_DIMENSION    0xa002
+#define TAG_PIXEL_Y_DIMENSION    0xa003
+
+#define TYPE_SHORT               3
+#define TYPE_LONG                4
+
+// Reads and patches the TIFF structure of an EXIF APP1 payload in place.
+class QtCamJpegRotatorExif {
+public:
+  QtCamJpegRotatorExif(uchar *data, int size) :
+    m_tiff(data + EXIF_HEADER_SIZE),
+    m_size(size - EXIF_HEADER_SIZE),
+    m_valid(false),
+    m_bigEndian(false) {
+
+    if (size < EXIF_HEADER_SIZE + 8 || memcmp(data, "Exif\0\0", EXIF_HEADER_SIZE)) {
+      return;
+    }
+
+    if (!memcmp(m_tiff, "MM\0\x2a", 4)) {
+      m_bigEndian = true;
+    } else if (memcmp(m_tiff, "II\x2a\0", 4)) {
+      return;
+    }
+
+    m_valid = true;
+  }
+
+  bool isValid() const {
+    return m_valid;
+  }
+
+  int ifd0() {
+    return read32(4);
+  }
+
+  // Offset of the entry for tag in the IFD at offset or -1.
+  int entry(int ifd, int tag) {
+    int count = read16(ifd);
+    for (int x = 0; x < count; x++) {
+      int pos = ifd + 2 + x * 12;
+      if (pos + 12 > m_size) {
+	return -1;
+      }
+
+      if (read16(pos) == tag) {
+	return pos;
+      }
+    }
+
+    return -1;
+  }
+
+  // Value of an entry holding a single SHORT or LONG.
+  int value(int entry) {
+    switch (read16(entry + 2)) {
+    case TYPE_SHORT:
+      return read16(entry + 8);
+    case TYPE_LONG:
+      return read32(entry + 8);
+    default:
+      return -1;
+    }
+  }
+
+  void setValue(int entry, int value) {
+    switch (read16(entry + 2)) {
+    case TYPE_SHORT:
+      write16(entry + 8, value);
+      break;
+    case TYPE_LONG:
+      write32(entry + 8, value);
+      break;
+    }
+  }
+
+  // Offset of the field linking the IFD at offset to the next one.
+  int next(int ifd) {
+    return ifd + 2 + read16(ifd) * 12;
+  }
+
+  int read16(int pos) {
+    if (pos < 0 || pos + 2 > m_size) {
+      return -1;
+    }
+
+    return m_bigEndian ? (m_tiff[pos] << 8) | m_tiff[pos + 1] :
+      (m_tiff[pos + 1] << 8) | m_tiff[pos];
+  }
+
+  int read32(int pos) {
+    if (pos < 0 || pos + 4 > m_size) {
+      return -1;
+    }
+
+    quint32 val = m_bigEndian ?
+      ((quint32)m_tiff[pos] << 24) | (m_tiff[pos + 1] << 16) | (m_tiff[pos + 2] << 8) | m_tiff[pos + 3] :
+      ((quint32)m_tiff[pos + 3] << 24) | (m_tiff[pos + 2] << 16) | (m_tiff[pos + 1] << 8) | m_tiff[pos];
+
+    return val > INT_MAX ? -1 : (int)val;
+  }
+
+  void write16(int pos, int val) {
+    if (pos < 0 || pos + 2 > m_size) {
+      return;
+    }
+
+    if (m_bigEndian) {
+      m_tiff[pos] = val >> 8;
+      m_tiff[pos + 1] = val;
+    } else {
+      m_tiff[pos] = val;
+      m_tiff[pos + 1] = val >> 8;
+    }
+  }
+
+  void write32(int pos, int val) {
+    if (pos < 0 || pos + 4 > m_size) {
+      return;
+    }
+
+    if (m_bigEndian) {
+      write16(pos, val >> 16);
+      write16(pos + 2, val);
+    } else {
+      write16(pos, val);
+      write16(pos + 2, val >> 16);
+    }
+  }
+
+private:
+  uchar *m_tiff;
+  int m_size;
+  bool m_valid;
+  bool m_bigEndian;
+};
+
+// Marks the image as upright and fixes the dimensions to match the rotated image.
+static void resetExif(uchar *data, int size, int width, int height) {
+  QtCamJpegRotatorExif exif(data, size);
+  if (!exif.isValid()) {
+    return;
+  }
+
+  int ifd0 = exif.ifd0();
+
+  int orientation = exif.entry(ifd0, TAG_ORIENTATION);
+  if (orientation != -1) {
+    exif.setValue(orientation, 1);
+  }
+
+  int pointer = exif.entry(ifd0, TAG_EXIF_IFD);
+  int ifd = pointer == -1 ? -1 : exif.value(pointer);
+  if (ifd > 0) {
+    int x = exif.entry(ifd, TAG_PIXEL_X_DIMENSION);
+    if (x != -1) {
+      exif.setValue(x, width);
+    }
+
+    int y = exif.entry(ifd, TAG_PIXEL_Y_DIMENSION);
+    if (y != -1) {
+      exif.setValue(y, height);
+    }
+  }
+
+  // The thumbnail would still need the orientation. Unlinking IFD1 is cheaper
+  // than rotating it and viewers will generate their own.
+  exif.write32(exif.next(ifd0), 0);
+}
+
+class QtCamJpegRotatorError {
+public:
+  struct jpeg_error_mgr mgr;
+  jmp_buf jump;
+};
+
+static void error_exit(j_common_ptr cinfo) {
+  char buffer[JMSG_LENGTH_MAX];
+  (*cinfo->err->format_message)(cinfo, buffer);
+  qWarning() << "JPEG rotation failed:" << buffer;
+
+  QtCamJpegRotatorError *err = (QtCamJpegRotatorError *)cinfo->err;
+  longjmp(err->jump, 1);
+}
+
+// Flipping a block in space negates its odd frequencies in that direction.
+// Coefficients are stored row (vertical frequency) by row.
+static void rotateBlock(JCOEFPTR dst, JCOEFPTR src, int angle) {
+  for (int i = 0; i < DCTSIZE; i++) {
+    for (int j = 0; j < DCTSIZE; j++) {
+      switch (angle) {
+      case 90:
+	// Transpose then flip horizontally.
+	dst[i * DCTSIZE + j] = (j & 1) ? -src[j * DCTSIZE + i] : src[j * DCTSIZE + i];
+	break;
+      case 180:
+	dst[i * DCTSIZE + j] = ((i + j) & 1) ? -src[i * DCTSIZE + j] : src[i * DCTSIZE + j];
+	break;
+      case 270:
+	// Transpose then flip vertically.
+	dst[i * DCTSIZE + j] = (i & 1) ? -src[j * DCTSIZE + i] : src[j * DCTSIZE + i];
+	break;
+      }
+    }
+  }
+}
+
+QtCamJpegRotator::QtCamJpegRotator(QObject *parent) :
+  QThread(parent),
+  m_msecsPerMegapixel(0),
+  m_quit(false) {
+
+}
+
+QtCamJpegRotator::~QtCamJpegRotator() {
+  // Whatever is still queued keeps its orientation tag.
+  m_mutex.lock();
+  m_quit = true;
+  m_cond.wakeOne();
+  m_mutex.unlock();
+
+  wait();
+}
+
+void QtCamJpegRotator::rotate(const QString& fileName) {
+  QMutexLocker locker(&m_mutex);
+
+  m_queue << fileName;
+  m_cond.wakeOne();
+
+  if (!isRunning()) {
+    // The next capture comes first.
+    start(QThread::LowPriority);
+  }
+}
+
+qreal QtCamJpegRotator::msecsPerMegapixel() {
+  QMutexLocker locker(&m_mutex);
+
+  return m_msecsPerMegapixel;
+}
+
+void QtCamJpegRotator::run() {
+  while (true) {
+    m_mutex.lock();
+
+    while (m_queue.isEmpty() && !m_quit) {
+      m_cond.wait(&m_mutex);
+    }
+
+    if (m_quit) {
+      m_mutex.unlock();
+      return;
+    }
+
+    QString fileName = m_queue.takeFirst();
+    m_mutex.unlock();
+
+    if (process(fileName)) {
+      emit finished(fileName);
+    } else {
+      emit failed(fileName);
+    }
+  }
+}
+
+bool QtCamJpegRotator::process(const QString& fileName) {
+  QFile file(fileName);
+  if (!file.open(QFile::ReadOnly)) {
+    qWarning() << "Failed to open" << fileName << file.errorString();
+    return false;
+  }
+
+  int angle = orientationAngle(QtCamJpegMetadata::segments(file.read(HEADER_SIZE)));
+  file.close();
+
+  if (angle <= 0) {
+    // Upright already or mirrored which we never produce.
+    return true;
+  }
+
+  QElapsedTimer timer;
+  timer.start();
+
+  // Written next to the original and renamed so a crash cannot lose the picture.
+  QString tmp = fileName + ".rotating";
+
+  if (!transform(fileName, tmp, angle)) {
+    QFile::remove(tmp);
+    return false;
+  }
+
+  if (::rename(QFile::encodeName(tmp).constData(), QFile::encodeName(fileName).constData()) != 0) {
+    qWarning() << "Failed to replace" << fileName;
+    QFile::remove(tmp);
+    return false;
+  }
+
+  QSize size = QImageReader(fileName).size();
+  qreal megapixels = qMax(1, size.width() * size.height()) / 1000000.0;
+
+  m_mutex.lock();
+  m_msecsPerMegapixel = timer.elapsed() / megapixels;
+  qDebug() << "Rotated" << fileName << "by" << angle << "in" << timer.elapsed() << "ms"
+	   << m_msecsPerMegapixel << "ms/MP";
+  m_mutex.unlock();
+
+  return true;
+}
+
+int QtCamJpegRotator::orientationAngle(const QList<QByteArray>& segments) {
+  foreach (const QByteArray& segment, segments) {
+    // Skip the marker and the length.
+    QByteArray payload = segment.mid(4);
+    QtCamJpegRotatorExif exif((uchar *)payload.data(), payload.size());
+    if (!exif.isValid()) {
+      continue;
+    }
+
+    int entry = exif.entry(exif.ifd0(), TAG_ORIENTATION);
+    switch (entry == -1 ? 1 : exif.value(entry)) {
+    case 1:
+      return 0;
+    case 3:
+      return 180;
+    case 6:
+      return 90;
+    case 8:
+      return 270;
+    default:
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+bool QtCamJpegRotator::transform(const QString& from, const QString& to, int angle) {
+  if (angle != 90 && angle != 180 && angle != 270) {
+    return false;
+  }
+
+  FILE *in = fopen(QFile::encodeName(from).constData(), "rb");
+  if (!in) {
+    qWarning() << "Failed to open" << from;
+    return false;
+  }
+
+  FILE *out = fopen(QFile::encodeName(to).constData(), "wb");
+  if (!out) {
+    qWarning() << "Failed to open" << to;
+    fclose(in);
+    return false;
+  }
+
+  struct jpeg_decompress_struct src;
+  struct jpeg_compress_struct dst;
+  QtCamJpegRotatorError err;
+
+  src.err = jpeg_std_error(&err.mgr);
+  dst.err = src.err;
+  err.mgr.error_exit = error_exit;
+
+  if (setjmp(err.jump)) {
+    jpeg_destroy_compress(&dst);
+    jpeg_destroy_decompress(&src);
+    fclose(in);
+    fclose(out);
+    return false;
+  }
+
+  jpeg_create_decompress(&src);
+  jpeg_create_compress(&dst);
+
+  jpeg_stdio_src(&src, in);
+
+  jpeg_save_markers(&src, JPEG_COM, 0xffff);
+  for (int x = 1; x < 16; x++) {
+    jpeg_save_markers(&src, JPEG_APP0 + x, 0xffff);
+  }
+
+  jpeg_read_header(&src, TRUE);
+
+  int mcuWidth = src.max_h_samp_factor * DCTSIZE;
+  int mcuHeight = src.max_v_samp_factor * DCTSIZE;
+  int mcuColumns = (src.image_width + mcuWidth - 1) / mcuWidth;
+  int mcuRows = (src.image_height + mcuHeight - 1) / mcuHeight;
+
+  // An edge can only move to the top or left in whole MCUs.
+  int fullColumns = src.image_width / mcuWidth;
+  int fullRows = src.image_height / mcuHeight;
+
+  bool transpose = angle != 180;
+  int width, height;
+
+  switch (angle) {
+  case 90:
+    width = fullRows * mcuHeight;
+    height = src.image_width;
+    break;
+  case 180:
+    width = fullColumns * mcuWidth;
+    height = fullRows * mcuHeight;
+    break;
+  default:
+    width = src.image_height;
+    height = fullColumns * mcuWidth;
+    break;
+  }
+
+  if (width == 0 || height == 0) {
+    qWarning() << "Image too small to rotate" << from;
+    jpeg_destroy_compress(&dst);
+    jpeg_destroy_decompress(&src);
+    fclose(in);
+    fclose(out);
+    return false;
+  }
+
+  // Requested before jpeg_read_coefficients() so they are realized with the source.
+  jvirt_barray_ptr arrays[MAX_COMPONENTS];
+  for (int ci = 0; ci < src.num_components; ci++) {
+    jpeg_component_info *comp = &src.comp_info[ci];
+    int columns, rows;
+
+    switch (angle) {
+    case 90:
+      columns = fullRows * comp->v_samp_factor;
+      rows = mcuColumns * comp->h_samp_factor;
+      break;
+    case 180:
+      columns = fullColumns * comp->h_samp_factor;
+      rows = fullRows * comp->v_samp_factor;
+      break;
+    default:
+      columns = mcuRows * comp->v_samp_factor;
+      rows = fullColumns * comp->h_samp_factor;
+      break;
+    }
+
+    // The whole destination is accessed at once. Source rows are visited one by one.
+    arrays[ci] = (*src.mem->request_virt_barray)((j_common_ptr)&src, JPOOL_IMAGE, FALSE,
+						 columns, rows, rows);
+  }
+
+  jvirt_barray_ptr *coefficients = jpeg_read_coefficients(&src);
+
+  jpeg_copy_critical_parameters(&src, &dst);
+  dst.image_width = width;
+  dst.image_height = height;
+
+  if (transpose) {
+    for (int ci = 0; ci < dst.num_components; ci++) {
+      jpeg_component_info *comp = &dst.comp_info[ci];
+      qSwap(comp->h_samp_factor, comp->v_samp_factor);
+    }
+
+    // Coefficients swap places within the blocks so their quantizers must too.
+    for (int x = 0; x < NUM_QUANT_TBLS; x++) {
+      JQUANT_TBL *table = dst.quant_tbl_ptrs[x];
+      if (!table) {
+	continue;
+      }
+
+      for (int i = 0; i < DCTSIZE; i++) {
+	for (int j = i + 1; j < DCTSIZE; j++) {
+	  qSwap(table->quantval[i * DCTSIZE + j], table->quantval[j * DCTSIZE + i]);
+	}
+      }
+    }
+  }
+
+  for (int ci = 0; ci < src.num_components; ci++) {
+    jpeg_component_info *comp = &src.comp_info[ci];
+    int columns = (angle == 90 ? mcuColumns : fullColumns) * comp->h_samp_factor;
+    int rows = (angle == 270 ? mcuRows : fullRows) * comp->v_samp_factor;
+    int dstRows = angle == 180 ? rows : columns;
+
+    JBLOCKARRAY out = (*src.mem->access_virt_barray)((j_common_ptr)&src, arrays[ci], 0,
+						     dstRows, TRUE);
+
+    for (int y = 0; y < rows; y++) {
+      JBLOCKROW in = (*src.mem->access_virt_barray)((j_common_ptr)&src, coefficients[ci],
+						    y, 1, FALSE)[0];
+
+      for (int x = 0; x < columns; x++) {
+	JCOEFPTR block;
+
+	switch (angle) {
+	case 90:
+	  block = out[x][rows - 1 - y];
+	  break;
+	case 180:
+	  block = out[rows - 1 - y][columns - 1 - x];
+	  break;
+	default:
+	  block = out[columns - 1 - x][y];
+	  break;
+	}
+
+	rotateBlock(block, in[x], angle);
+      }
+    }
+  }
+
+  bool hasExif = false;
+  for (jpeg_saved_marker_ptr marker = src.marker_list; marker; marker = marker->next) {
+    if (marker->marker == JPEG_APP0 + 1 && marker->data_length >= EXIF_HEADER_SIZE &&
+	!memcmp(marker->data, "Exif\0\0", EXIF_HEADER_SIZE)) {
+      hasExif = true;
+      resetExif(marker->data, marker->data_length, width, height);
+    }
+  }
+
+  jpeg_stdio_dest(&dst, out);
+
+  // EXIF readers expect APP1 right after SOI.
+  if (hasExif) {
+    dst.write_JFIF_header = FALSE;
+  }
+
+  jpeg_write_coefficients(&dst, arrays);
+
+  for (jpeg_saved_marker_ptr marker = src.marker_list; marker; marker = marker->next) {
+    // libjpeg writes its own Adobe marker when it needs one.
+    if (dst.write_Adobe_marker && marker->marker == JPEG_APP0 + 14 &&
+	marker->data_length >= 5 && !memcmp(marker->data, "Adobe", 5)) {
+      continue;
+    }
+
+    jpeg_write_marker(&dst, marker->marker, marker->data, marker->data_length);
+  }
+
+  jpeg_finish_compress(&dst);
+  jpeg_destroy_compress(&dst);
+
+  jpeg_finish_decompress(&src);
+  jpeg_destroy_decompress(&src);
+
+  fclose(in);
+
+  bool ok = !ferror(out);
+  if (fclose(out) != 0) {
+    ok = false;
+  }
+
+  if (!ok) {
+    qWarning() << "Failed to write" << to;
+  }
+
+  return ok;
+}
@@ -0,0 +1,75 @@
+// -*- c++ -*-
+
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef QT_CAM_JPEG_ROTATOR_H
+#define QT_CAM_JPEG_ROTATOR_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QStringList>
+#include <QList>
+#include <QByteArray>
+
+// Turns saved pictures upright instead of leaving it to the EXIF orientation
+// tag which many viewers and services ignore. The DCT coefficients are moved
+// around by libjpeg without decoding so nothing is lost to recompression.
+// Files are queued and processed one by one on a low priority worker thread.
+class QtCamJpegRotator : public QThread {
+  Q_OBJECT
+
+public:
+  QtCamJpegRotator(QObject *parent = 0);
+  ~QtCamJpegRotator();
+
+  // Never blocks. The file is rewritten in place.
+  void rotate(const QString& fileName);
+
+  qreal msecsPerMegapixel();
+
+  // Clockwise rotation the EXIF orientation in segments asks for: 0, 90, 180 or 270.
+  // 0 without any orientation and -1 if the image is mirrored.
+  static int orientationAngle(const QList<QByteArray>& segments);
+
+  // Rotates from clockwise by angle into to and resets the orientation. Partial
+  // MCUs that would end up at the top or left edge are dropped like jpegtran -trim.
+  static bool transform(const QString& from, const QString& to, int angle);
+
+signals:
+  // Emitted from the worker thread. finished() also covers upright files.
+  void finished(const QString& fileName);
+  void failed(const QString& fileName);
+
+protected:
+  void run();
+
+private:
+  bool process(const QString& fileName);
+
+  QMutex m_mutex;
+  QWaitCondition m_cond;
+  QStringList m_queue;
+  qreal m_msecsPerMegapixel;
+  bool m_quit;
+};
+
+#endif /* QT_CAM_JPEG_ROTATOR_H */
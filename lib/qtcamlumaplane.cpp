@@ -0,0 +1,198 @@
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "qtcamlumaplane.h"
+#include "qtcamgstsample.h"
+#include <gst/video/video.h>
+#include <cstring>
+
+QtCamLumaPlane::QtCamLumaPlane() :
+  m_width(0),
+  m_height(0),
+  m_factor(1) {
+
+}
+
+QtCamLumaPlane::~QtCamLumaPlane() {
+
+}
+
+bool QtCamLumaPlane::scale(const QtCamGstSample *sample, int factor, const QRect& area) {
+  factor = qMax(1, factor);
+
+  int width = sample->width();
+  int height = sample->height();
+
+  QRect rect = area.isNull() ? QRect(0, 0, width, height) :
+    area.intersected(QRect(0, 0, width, height));
+
+  if (rect.width() < factor || rect.height() < factor) {
+    return false;
+  }
+
+  int offset, stride, pixelStride;
+  const uchar *src = 0;
+  qint64 size = 0;
+
+#if GST_CHECK_VERSION(1,0,0)
+  GstVideoInfo info;
+  if (!gst_video_info_from_caps(&info, sample->caps())) {
+    return false;
+  }
+
+  // Green is close enough to luma for what we need.
+  int comp = GST_VIDEO_INFO_IS_RGB(&info) ? 1 : 0;
+  if (GST_VIDEO_INFO_COMP_DEPTH(&info, comp) != 8) {
+    return false;
+  }
+
+  offset = GST_VIDEO_INFO_COMP_OFFSET(&info, comp);
+  stride = GST_VIDEO_INFO_COMP_STRIDE(&info, comp);
+  pixelStride = GST_VIDEO_INFO_COMP_PSTRIDE(&info, comp);
+
+  GstMapInfo map;
+  if (!gst_buffer_map(sample->buffer(), &map, GST_MAP_READ)) {
+    return false;
+  }
+
+  src = map.data;
+  size = map.size;
+#else
+  GstVideoFormat format = sample->format();
+  if (format == GST_VIDEO_FORMAT_UNKNOWN) {
+    return false;
+  }
+
+  int comp = gst_video_format_is_rgb(format) ? 1 : 0;
+  if (gst_video_format_get_component_depth(format, comp) != 8) {
+    return false;
+  }
+
+  offset = gst_video_format_get_component_offset(format, comp, width, height);
+  stride = gst_video_format_get_row_stride(format, comp, width);
+  pixelStride = gst_video_format_get_pixel_stride(format, comp);
+
+  src = GST_BUFFER_DATA(sample->buffer());
+  size = GST_BUFFER_SIZE(sample->buffer());
+#endif
+
+  bool ok = src &&
+    offset + (qint64)(height - 1) * stride + (qint64)(width - 1) * pixelStride < size;
+
+  if (ok) {
+    int w = rect.width() / factor;
+    int h = rect.height() / factor;
+    int blockSize = factor * factor;
+    int step = factor * pixelStride;
+
+    resize(w, h, QSize(width, height), factor);
+    m_area = QRect(rect.topLeft(), QSize(w * factor, h * factor));
+    m_sums.resize(w);
+
+    uchar *dst = m_data.data();
+    quint32 *sums = m_sums.data();
+
+    src += offset + rect.y() * stride + rect.x() * pixelStride;
+
+    if (factor == 1 && pixelStride == 1) {
+      // Plain copy of a planar luma
+      for (int y = 0; y < h; y++) {
+	memcpy(dst, src + y * stride, w);
+	dst += w;
+      }
+    }
+    else {
+      for (int y = 0; y < h; y++) {
+	memset(sums, 0x0, w * sizeof(quint32));
+
+	for (int r = 0; r < factor; r++) {
+	  const uchar *p = src + (y * factor + r) * stride;
+
+	  for (int x = 0; x < w; x++) {
+	    quint32 sum = 0;
+	    for (int k = 0; k < factor; k++) {
+	      sum += p[k * pixelStride];
+	    }
+
+	    sums[x] += sum;
+	    p += step;
+	  }
+	}
+
+	for (int x = 0; x < w; x++) {
+	  dst[x] = sums[x] / blockSize;
+	}
+
+	dst += w;
+      }
+    }
+  }
+
+#if GST_CHECK_VERSION(1,0,0)
+  gst_buffer_unmap(sample->buffer(), &map);
+#endif
+
+  return ok;
+}
+
+int QtCamLumaPlane::width() const {
+  return m_width;
+}
+
+int QtCamLumaPlane::height() const {
+  return m_height;
+}
+
+const uchar *QtCamLumaPlane::data() const {
+  return m_data.constData();
+}
+
+const uchar *QtCamLumaPlane::line(int y) const {
+  return m_data.constData() + y * m_width;
+}
+
+QSize QtCamLumaPlane::sourceSize() const {
+  return m_sourceSize;
+}
+
+int QtCamLumaPlane::factor() const {
+  return m_factor;
+}
+
+QRect QtCamLumaPlane::area() const {
+  return m_area;
+}
+
+bool QtCamLumaPlane::isEmpty() const {
+  return m_width == 0 || m_height == 0;
+}
+
+void QtCamLumaPlane::resize(int width, int height, const QSize& sourceSize, int factor) {
+  m_width = width;
+  m_height = height;
+  m_sourceSize = sourceSize;
+  m_area = QRect(QPoint(0, 0), QSize(width * factor, height * factor));
+  m_factor = factor;
+  m_data.resize(width * height);
+}
+
+uchar *QtCamLumaPlane::bits() {
+  return m_data.data();
+}
@@ -0,0 +1,69 @@
+// -*- c++ -*-
+
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef QT_CAM_LUMA_PLANE_H
+#define QT_CAM_LUMA_PLANE_H
+
+#include <QVector>
+#include <QSize>
+#include <QRect>
+
+class QtCamGstSample;
+
+// A downscaled, tightly packed 8 bit luma copy of a viewfinder sample or a part of it.
+// Each output pixel is the average of a factor x factor block of the input.
+class QtCamLumaPlane {
+public:
+  QtCamLumaPlane();
+  ~QtCamLumaPlane();
+
+  // area is in sample pixels. A null area means the whole sample.
+  bool scale(const QtCamGstSample *sample, int factor, const QRect& area = QRect());
+
+  int width() const;
+  int height() const;
+  const uchar *data() const;
+  const uchar *line(int y) const;
+
+  // Size of the sample the plane was created from.
+  QSize sourceSize() const;
+  int factor() const;
+  // The part of the sample covered by the plane, in sample pixels.
+  QRect area() const;
+
+  bool isEmpty() const;
+
+  // For callers producing planes from something other than a sample.
+  void resize(int width, int height, const QSize& sourceSize, int factor);
+  uchar *bits();
+
+private:
+  QVector<uchar> m_data;
+  QVector<quint32> m_sums;
+  int m_width;
+  int m_height;
+  int m_factor;
+  QSize m_sourceSize;
+  QRect m_area;
+};
+
+#endif /* QT_CAM_LUMA_PLANE_H */
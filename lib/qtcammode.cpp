@@ -27,6 +27,91 @@
 #include <gst/video/video.h>
 #include <QImage>
 #include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QHash>
+#include <QMutex>
+
+class EncodingProfileCache {
+public:
+  ~EncodingProfileCache() {
+    foreach (const Entry& entry, entries) {
+      clear(entry);
+    }
+  }
+
+  GstEncodingProfile *profile(const QString& targetPath, const QString& name) {
+    QMutexLocker locker(&mutex);
+
+    QDateTime modified = QFileInfo(targetPath).lastModified();
+
+    QHash<QString, Entry>::iterator iter = entries.find(targetPath);
+    if (iter != entries.end() && iter->modified != modified) {
+      // File has changed on disk
+      clear(*iter);
+      entries.erase(iter);
+      iter = entries.end();
+    }
+
+    if (iter == entries.end()) {
+      GError *error = NULL;
+      GstEncodingTarget *target =
+	gst_encoding_target_load_from_file(targetPath.toUtf8().constData(), &error);
+      if (!target) {
+	qCritical() << "Failed to load encoding target from" << targetPath << error->message;
+	g_error_free(error);
+	return 0;
+      }
+
+      Entry entry;
+      entry.modified = modified;
+      entry.target = target;
+      iter = entries.insert(targetPath, entry);
+    }
+
+    GstEncodingProfile *profile = iter->profiles.value(name);
+    if (!profile) {
+      profile = gst_encoding_target_get_profile(iter->target, name.toUtf8().constData());
+      if (!profile) {
+	qCritical() << "Failed to load encoding profile" << name << "from" << targetPath;
+	return 0;
+      }
+
+      iter->profiles.insert(name, profile);
+    }
+
+    // Callers own the returned reference. The cache keeps its own.
+    return (GstEncodingProfile *)gst_encoding_profile_ref(profile);
+  }
+
+private:
+  class Entry {
+  public:
+    Entry() : target(0) {}
+
+    QDateTime modified;
+    GstEncodingTarget *target;
+    QHash<QString, GstEncodingProfile *> profiles;
+  };
+
+  void clear(const Entry& entry) {
+    foreach (GstEncodingProfile *profile, entry.profiles) {
+      gst_encoding_profile_unref(profile);
+    }
+
+    gst_encoding_target_unref(entry.target);
+  }
+
+  QMutex mutex;
+  QHash<QString, Entry> entries;
+};
+
+Q_GLOBAL_STATIC(EncodingProfileCache, encodingProfileCache);
+
+GstEncodingProfile *QtCamModePrivate::cachedProfile(const QString& targetPath,
+						    const QString& name) {
+  return encodingProfileCache()->profile(targetPath, name);
+}
 
 class PreviewImageHandler : public QtCamGstMessageHandler {
 public:
@@ -119,6 +204,8 @@ void QtCamMode::activate() {
 
   d_ptr->dev->active = this;
 
+  d_ptr->forgetCaps();
+
   g_object_set(d_ptr->dev->cameraBin, "mode", d_ptr->id, NULL);
 
   d_ptr->dev->listener->addHandler(d_ptr->previewImageHandler);
@@ -141,14 +228,16 @@ void QtCamMode::deactivate() {
     return;
   }
 
+  // Stopping might need to wait for the done message so do it while
+  // our handlers are still installed.
+  stop();
+
   d_ptr->dev->listener->removeHandler(d_ptr->previewImageHandler);
   d_ptr->dev->listener->removeSyncHandler(d_ptr->doneHandler);
 
   d_ptr->previewImageHandler->setParent(this);
   d_ptr->doneHandler->setParent(this);
 
-  stop();
-
   d_ptr->dev->active = 0;
 
   QMetaObject::invokeMethod(d_ptr->dev->q_ptr, "modeChanged");
@@ -173,6 +262,14 @@ void QtCamMode::disablePreview() {
   d_ptr->setPreviewSize(QSize());
 }
 
+int QtCamMode::capsRequests() const {
+  return d_ptr->capsRequests;
+}
+
+int QtCamMode::capsRenegotiations() const {
+  return d_ptr->capsRenegotiations;
+}
+
 void QtCamMode::setEncodingProfile(GstEncodingProfile *profile,
 				   const QLatin1String& propertyName) {
   if (d_ptr->dev->cameraBin) {
@@ -57,6 +57,9 @@ public:
   virtual void enablePreview() = 0;
   void disablePreview();
 
+  int capsRequests() const;
+  int capsRenegotiations() const;
+
 public slots:
   void activate();
 
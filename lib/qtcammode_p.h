@@ -26,6 +26,7 @@
 #include <QSize>
 #include <QFileInfo>
 #include <QDir>
+#include <QHash>
 #include "qtcamdevice_p.h"
 #include <gst/pbutils/encoding-profile.h>
 #include <gst/pbutils/encoding-target.h>
@@ -45,14 +46,135 @@
 #define CAPS_NO_FPS "%s, width=(int)%d,height=(int)%d"
 #define CAPS_FPS "%s, width=(int)%d,height=(int)%d,framerate=(fraction)[%d/%d,%d/%d]"
 
+#define CAPS_CACHE_SIZE 16
+
 class QtCamDevicePrivate;
 class PreviewImageHandler;
 class DoneHandler;
 
+class CapsKey {
+public:
+  CapsKey(const char *prop, const QString& mediaType, const QString& fourcc,
+	  const QSize& res, int framerate) :
+    property(prop),
+    media(mediaType),
+    format(fourcc),
+    resolution(res),
+    fps(framerate) {
+
+  }
+
+  bool operator==(const CapsKey& other) const {
+    return resolution == other.resolution && fps == other.fps &&
+      !qstrcmp(property, other.property) && media == other.media && format == other.format;
+  }
+
+  // Points to a string literal
+  const char *property;
+  QString media;
+  QString format;
+  QSize resolution;
+  int fps;
+};
+
+inline uint qHash(const CapsKey& key) {
+  return qHash(QByteArray::fromRawData(key.property, qstrlen(key.property))) ^
+    qHash(key.resolution.width() << 16 | key.resolution.height()) ^ qHash(key.fps);
+}
+
 class QtCamModePrivate {
 public:
-  QtCamModePrivate(QtCamDevicePrivate *d) : id(-1), dev(d) {}
-  virtual ~QtCamModePrivate() {}
+  QtCamModePrivate(QtCamDevicePrivate *d) :
+    id(-1),
+    dev(d),
+    capsRequests(0),
+    capsRenegotiations(0) {}
+
+  virtual ~QtCamModePrivate() {
+    clearCaps();
+    forgetCaps();
+  }
+
+  void clearCaps() {
+    foreach (GstCaps *caps, capsCache) {
+      gst_caps_unref(caps);
+    }
+
+    capsCache.clear();
+  }
+
+  // Another mode might have touched camerabin caps so we cannot trust what we set last.
+  void forgetCaps() {
+    foreach (GstCaps *caps, lastCaps) {
+      gst_caps_unref(caps);
+    }
+
+    lastCaps.clear();
+  }
+
+  void forgetCaps(const char *property) {
+    GstCaps *caps = lastCaps.take(property);
+    if (caps) {
+      gst_caps_unref(caps);
+    }
+  }
+
+  void rememberCaps(const char *property, GstCaps *caps) {
+    forgetCaps(property);
+    lastCaps.insert(property, gst_caps_ref(caps));
+  }
+
+  // Returns a new reference
+  GstCaps *cachedCaps(const CapsKey& key) {
+    GstCaps *caps = capsCache.value(key);
+    if (caps) {
+      return gst_caps_ref(caps);
+    }
+
+    return 0;
+  }
+
+  void cacheCaps(const CapsKey& key, GstCaps *caps) {
+    if (capsCache.size() >= CAPS_CACHE_SIZE) {
+      // We only cycle between a handful of resolutions so this should not happen often
+      clearCaps();
+    }
+
+    capsCache.insert(key, gst_caps_ref(caps));
+  }
+
+  // Sets caps on camerabin only if they differ from what is there.
+  // Returns true if camerabin had to renegotiate
+  bool updateCaps(const char *property, GstCaps *caps) {
+    ++capsRequests;
+
+    if (lastCaps.value(property) == caps) {
+      // Same object as the last time we set this property
+      return false;
+    }
+
+    GstCaps *old = 0;
+
+    g_object_get(dev->cameraBin, property, &old, NULL);
+
+    if (old && gst_caps_is_equal(caps, old)) {
+      gst_caps_unref(old);
+      rememberCaps(property, caps);
+      return false;
+    }
+
+    g_object_set(dev->cameraBin, property, caps, NULL);
+
+    if (old) {
+      gst_caps_unref(old);
+    }
+
+    rememberCaps(property, caps);
+
+    ++capsRenegotiations;
+
+    return true;
+  }
 
   void init(DoneHandler *handler) {
     doneHandler = handler;
@@ -86,7 +208,6 @@ public:
   }
 
   GstEncodingProfile *loadProfile(const QString& path, const QString& name) {
-    GError *error = NULL;
     QString targetPath;
     QFileInfo info(path);
     if (!info.isAbsolute()) {
@@ -96,31 +217,19 @@ public:
       targetPath = info.filePath();
     }
 
-    GstEncodingTarget *target = gst_encoding_target_load_from_file(targetPath.toUtf8().constData(),
-								   &error);
-    if (!target) {
-      qCritical() << "Failed to load encoding target from" << path << error->message;
-      g_error_free(error);
-      return 0;
-    }
-
-    GstEncodingProfile *profile = gst_encoding_target_get_profile(target, name.toUtf8().data());
-    if (!profile) {
-      qCritical() << "Failed to load encoding profile from" << path;
-      gst_encoding_target_unref(target);
-      return 0;
-    }
-
-    gst_encoding_target_unref(target);
-
-    return profile;
+    return cachedProfile(targetPath, name);
   }
 
+  // Parsed targets are shared by all devices and modes in the process
+  static GstEncodingProfile *cachedProfile(const QString& targetPath, const QString& name);
+
   void resetCaps(const char *property) {
     if (!dev->cameraBin) {
       return;
     }
 
+    forgetCaps(property);
+
     g_object_set(dev->cameraBin, property, NULL, NULL);
   }
 
@@ -136,12 +245,38 @@ public:
     return val == GST_PHOTOGRAPHY_SCENE_MODE_NIGHT;
   }
 
-  void setCaps(const char *property, const QSize& resolution, int fps) {
+  bool setCaps(const char *property, const QSize& resolution, int fps) {
+    if (!dev->cameraBin) {
+      return false;
+    }
+
+    if (resolution.width() <= 0 || resolution.height() <= 0) {
+      return false;
+    }
+
     QString mediaType = dev->conf->mediaType(property);
+    QString format = dev->conf->mediaFourcc(property);
+
+    CapsKey key(property, mediaType, format, resolution, fps);
+    GstCaps *caps = cachedCaps(key);
+
+    if (!caps) {
+      caps = createCaps(mediaType, format, resolution, fps);
+      cacheCaps(key, caps);
+    }
+
+    bool renegotiated = updateCaps(property, caps);
+
+    gst_caps_unref(caps);
+
+    return renegotiated;
+  }
+
+  GstCaps *createCaps(const QString& mediaType, const QString& format,
+		      const QSize& resolution, int fps) {
     QByteArray arr = mediaType.toLatin1();
     const gchar *media = arr.isEmpty() ? NULL : arr.constData();
 
-    QString format = dev->conf->mediaFourcc(property);
     QByteArray mediaArr = format.toLatin1();
 
 #if GST_CHECK_VERSION(1,0,0)
@@ -150,14 +285,6 @@ public:
     unsigned long fourcc = GST_STR_FOURCC(mediaArr.constData());
 #endif
 
-    if (!dev->cameraBin) {
-      return;
-    }
-
-    if (resolution.width() <= 0 || resolution.height() <= 0) {
-      return;
-    }
-
     GstCaps *caps = 0;
 
     if (fps <= 0) {
@@ -184,22 +311,7 @@ public:
 #endif
     }
 
-    GstCaps *old = 0;
-
-    g_object_get(dev->cameraBin, property, &old, NULL);
-
-    if (gst_caps_is_equal(caps, old)) {
-      gst_caps_unref(old);
-      gst_caps_unref(caps);
-
-      return;
-    }
-
-    g_object_set(dev->cameraBin, property, caps, NULL);
-
-    if (old) {
-      gst_caps_unref(old);
-    }
+    return caps;
   }
 
   void setPreviewSize(const QSize& size) {
@@ -208,20 +320,27 @@ public:
     }
 
     if (size.width() <= 0 && size.height() <= 0) {
+      forgetCaps("preview-caps");
       g_object_set(dev->cameraBin, "preview-caps", NULL, "post-previews", FALSE, NULL);
     }
     else {
-      QString preview = QString(PREVIEW_CAPS).arg(size.width()).arg(size.height());
-
-      GstCaps *caps = gst_caps_from_string(preview.toLatin1());
-
       if (!dev->conf->isPreviewSupported()) {
 	qWarning() << "Cannot set preview caps. Preview not supported";
-	gst_caps_unref(caps);
 	return;
       }
 
-      g_object_set(dev->cameraBin, "preview-caps", caps, "post-previews", TRUE, NULL);
+      CapsKey key("preview-caps", QString(), QString(), size, -1);
+      GstCaps *caps = cachedCaps(key);
+
+      if (!caps) {
+	QString preview = QString(PREVIEW_CAPS).arg(size.width()).arg(size.height());
+	caps = gst_caps_from_string(preview.toLatin1());
+	cacheCaps(key, caps);
+      }
+
+      if (updateCaps("preview-caps", caps)) {
+	g_object_set(dev->cameraBin, "post-previews", TRUE, NULL);
+      }
 
       gst_caps_unref(caps);
     }
@@ -264,6 +383,11 @@ public:
   DoneHandler *doneHandler;
   QString fileName;
   QString tempFileName;
+
+  QHash<CapsKey, GstCaps *> capsCache;
+  QHash<QByteArray, GstCaps *> lastCaps;
+  int capsRequests;
+  int capsRenegotiations;
 };
 
 class DoneHandler : public QtCamGstMessageHandler {
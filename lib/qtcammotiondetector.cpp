@@ -0,0 +1,227 @@
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "qtcammotiondetector.h"
+#include "qtcamgstsample.h"
+#include <QMutexLocker>
+
+#define GRID_COLUMNS             32
+#define DEFAULT_SENSITIVITY      50
+#define DEFAULT_COOL_DOWN        3000
+#define DEFAULT_INTERVAL         200
+// The background follows the scene with a 1/8 weight per analysed frame.
+#define BACKGROUND_SHIFT         3
+// Too many changed blocks is a lighting or exposure change, not motion.
+#define LIGHTING_CHANGE          0.8
+
+QtCamMotionDetector::QtCamMotionDetector(QObject *parent) :
+  QObject(parent),
+  m_sensitivity(DEFAULT_SENSITIVITY),
+  m_coolDown(DEFAULT_COOL_DOWN),
+  m_interval(DEFAULT_INTERVAL),
+  m_motion(false) {
+
+}
+
+QtCamMotionDetector::~QtCamMotionDetector() {
+
+}
+
+int QtCamMotionDetector::sensitivity() {
+  QMutexLocker locker(&m_mutex);
+
+  return m_sensitivity;
+}
+
+void QtCamMotionDetector::setSensitivity(int sensitivity) {
+  QMutexLocker locker(&m_mutex);
+
+  m_sensitivity = qBound(1, sensitivity, 100);
+}
+
+int QtCamMotionDetector::coolDown() {
+  QMutexLocker locker(&m_mutex);
+
+  return m_coolDown;
+}
+
+void QtCamMotionDetector::setCoolDown(int coolDown) {
+  QMutexLocker locker(&m_mutex);
+
+  m_coolDown = qMax(0, coolDown);
+}
+
+int QtCamMotionDetector::interval() {
+  QMutexLocker locker(&m_mutex);
+
+  return m_interval;
+}
+
+void QtCamMotionDetector::setInterval(int interval) {
+  QMutexLocker locker(&m_mutex);
+
+  m_interval = qMax(0, interval);
+}
+
+QList<QRectF> QtCamMotionDetector::masks() {
+  QMutexLocker locker(&m_mutex);
+
+  return m_masks;
+}
+
+void QtCamMotionDetector::setMasks(const QList<QRectF>& masks) {
+  QMutexLocker locker(&m_mutex);
+
+  m_masks = masks;
+  // Recomputed for the next frame.
+  m_masked.clear();
+}
+
+bool QtCamMotionDetector::hasMotion() {
+  QMutexLocker locker(&m_mutex);
+
+  return m_motion;
+}
+
+void QtCamMotionDetector::reset() {
+  QMutexLocker locker(&m_mutex);
+
+  m_background.clear();
+  m_masked.clear();
+  m_motion = false;
+  m_frameTimer.invalidate();
+  m_motionTimer.invalidate();
+}
+
+void QtCamMotionDetector::handleSample(const QtCamGstSample *sample) {
+  QMutexLocker locker(&m_mutex);
+
+  if (m_frameTimer.isValid() && m_frameTimer.elapsed() < m_interval) {
+    return;
+  }
+
+  m_frameTimer.start();
+
+  // One plane pixel per block. The scaler does the block averaging for us.
+  int factor = qMax(1, sample->width() / GRID_COLUMNS);
+  if (!m_plane.scale(sample, factor)) {
+    return;
+  }
+
+  qreal changed = compare(m_plane);
+
+  // Smaller changes are enough when the sensitivity is high.
+  qreal area = (101 - m_sensitivity) / 1000.0;
+
+  if (changed > 0 && changed >= area) {
+    m_motionTimer.start();
+
+    if (!m_motion) {
+      m_motion = true;
+      locker.unlock();
+      emit motionStarted();
+    }
+  }
+  else if (m_motion && (!m_motionTimer.isValid() || m_motionTimer.elapsed() >= m_coolDown)) {
+    m_motion = false;
+    locker.unlock();
+    emit motionStopped();
+  }
+}
+
+qreal QtCamMotionDetector::compare(const QtCamLumaPlane& plane) {
+  int size = plane.width() * plane.height();
+  if (size == 0) {
+    return 0;
+  }
+
+  const uchar *data = plane.data();
+
+  if (m_background.size() != size) {
+    m_background.resize(size);
+    m_masked.clear();
+
+    for (int x = 0; x < size; x++) {
+      m_background[x] = data[x] << 4;
+    }
+
+    return -1;
+  }
+
+  if (m_masked.size() != size) {
+    m_masked.fill(false, size);
+
+    for (int y = 0; y < plane.height(); y++) {
+      for (int x = 0; x < plane.width(); x++) {
+	QPointF center((x + 0.5) / plane.width(), (y + 0.5) / plane.height());
+
+	foreach (const QRectF& mask, m_masks) {
+	  if (mask.contains(center)) {
+	    m_masked[y * plane.width() + x] = true;
+	    break;
+	  }
+	}
+      }
+    }
+  }
+
+  // Block averages are already smooth so the threshold can be low.
+  // Between 40 levels at the lowest sensitivity and 4 at the highest.
+  int threshold = (40 - (m_sensitivity - 1) * 36 / 99) << 4;
+
+  int *background = m_background.data();
+  const bool *masked = m_masked.constData();
+  int blocks = 0;
+  int changed = 0;
+
+  for (int x = 0; x < size; x++) {
+    if (masked[x]) {
+      continue;
+    }
+
+    int value = data[x] << 4;
+    int diff = value - background[x];
+
+    ++blocks;
+
+    if (qAbs(diff) > threshold) {
+      ++changed;
+    }
+
+    background[x] += diff >> BACKGROUND_SHIFT;
+  }
+
+  if (blocks == 0) {
+    return 0;
+  }
+
+  qreal fraction = (qreal)changed / blocks;
+
+  if (fraction > LIGHTING_CHANGE) {
+    for (int x = 0; x < size; x++) {
+      background[x] = data[x] << 4;
+    }
+
+    return -1;
+  }
+
+  return fraction;
+}
@@ -0,0 +1,88 @@
+// -*- c++ -*-
+
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef QT_CAM_MOTION_DETECTOR_H
+#define QT_CAM_MOTION_DETECTOR_H
+
+#include <QObject>
+#include <QMutex>
+#include <QElapsedTimer>
+#include <QVector>
+#include <QRectF>
+#include "qtcamviewfinderbufferhandler.h"
+#include "qtcamlumaplane.h"
+
+// Detects motion by comparing the block averages of viewfinder frames against a slowly
+// adapting background. Frames are analysed at most once every interval milliseconds.
+class QtCamMotionDetector : public QObject, public QtCamViewfinderBufferHandler {
+  Q_OBJECT
+
+public:
+  QtCamMotionDetector(QObject *parent = 0);
+  ~QtCamMotionDetector();
+
+  // 1 to 100. Higher values trigger on smaller and fainter changes.
+  int sensitivity();
+  void setSensitivity(int sensitivity);
+
+  // How long the scene has to be still before motion is considered over.
+  int coolDown();
+  void setCoolDown(int coolDown);
+
+  int interval();
+  void setInterval(int interval);
+
+  // Areas to ignore, normalized to the frame size.
+  QList<QRectF> masks();
+  void setMasks(const QList<QRectF>& masks);
+
+  bool hasMotion();
+
+  void reset();
+
+  void handleSample(const QtCamGstSample *sample);
+
+  // Exposed for testing. Returns the fraction of unmasked blocks that changed or
+  // -1 if the background had to be reset.
+  qreal compare(const QtCamLumaPlane& plane);
+
+signals:
+  // Emitted from the streaming thread.
+  void motionStarted();
+  void motionStopped();
+
+private:
+  QMutex m_mutex;
+  QElapsedTimer m_frameTimer;
+  QElapsedTimer m_motionTimer;
+  int m_sensitivity;
+  int m_coolDown;
+  int m_interval;
+  bool m_motion;
+  QList<QRectF> m_masks;
+  QtCamLumaPlane m_plane;
+  // Background block averages in 1/16th units.
+  QVector<int> m_background;
+  QVector<bool> m_masked;
+};
+
+#endif /* QT_CAM_MOTION_DETECTOR_H */
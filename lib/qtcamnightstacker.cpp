@@ -0,0 +1,631 @@
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "qtcamnightstacker.h"
+#include "qtcamexposurefusion.h"
+#include "qtcamjpegmetadata.h"
+#include "qtcamjpegencoder.h"
+#include <QImageReader>
+#include <QFile>
+#include <QImage>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QAtomicInt>
+#include <QSemaphore>
+#include <QDebug>
+#include <cstdio>
+#include <cstring>
+#include <csetjmp>
+extern "C" {
+#include <jpeglib.h>
+}
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+// 16 bit sums of 8 bit samples.
+#define MAX_FRAMES               64
+#define ALIGN_WIDTH              512
+#define ALIGN_LEVELS             4
+// Lines of every frame held by a band job.
+#define BAND_HEIGHT              64
+// Samples further than 3 sigmas of the frame to reference difference are rejected.
+// The median absolute deviation is 0.6745 sigma.
+#define SIGMA_FACTOR             445
+#define MIN_THRESHOLD            6
+#define MAX_THRESHOLD            48
+#define JPEG_QUALITY             90
+
+class QtCamNightStackerError {
+public:
+  struct jpeg_error_mgr mgr;
+  jmp_buf jump;
+};
+
+static void error_exit(j_common_ptr cinfo) {
+  char buffer[JMSG_LENGTH_MAX];
+  (*cinfo->err->format_message)(cinfo, buffer);
+  qWarning() << "JPEG decoding failed:" << buffer;
+
+  QtCamNightStackerError *err = (QtCamNightStackerError *)cinfo->err;
+  longjmp(err->jump, 1);
+}
+
+// Decodes a frame once from top to bottom, a band of lines at a time.
+class QtCamNightStackerReader {
+public:
+  QtCamNightStackerReader() :
+    m_file(0),
+    m_created(false) {
+
+  }
+
+  ~QtCamNightStackerReader() {
+    if (m_created) {
+      jpeg_destroy_decompress(&m_cinfo);
+    }
+
+    if (m_file) {
+      fclose(m_file);
+    }
+  }
+
+  bool open(const QString& fileName, const QSize& size) {
+    m_file = fopen(QFile::encodeName(fileName).constData(), "rb");
+    if (!m_file) {
+      qWarning() << "Failed to open" << fileName;
+      return false;
+    }
+
+    m_cinfo.err = jpeg_std_error(&m_err.mgr);
+    m_err.mgr.error_exit = error_exit;
+
+    if (setjmp(m_err.jump)) {
+      return false;
+    }
+
+    jpeg_create_decompress(&m_cinfo);
+    m_created = true;
+
+    jpeg_stdio_src(&m_cinfo, m_file);
+    jpeg_read_header(&m_cinfo, TRUE);
+
+#if defined(JCS_EXTENSIONS) && Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    // libjpeg-turbo writes RGB32 lines as they are.
+    m_cinfo.out_color_space = JCS_EXT_BGRX;
+#else
+    m_cinfo.out_color_space = JCS_RGB;
+#endif
+
+    jpeg_start_decompress(&m_cinfo);
+
+    if ((int)m_cinfo.output_width != size.width() ||
+	(int)m_cinfo.output_height != size.height()) {
+      qWarning() << "Stacked frames differ in size";
+      return false;
+    }
+
+    if (m_cinfo.output_components == 3) {
+      m_line.resize(size.width() * 3);
+    }
+
+    return true;
+  }
+
+  // Lines first to last - 1. Lines before first are skipped but cannot be asked
+  // for anymore, just like those read already.
+  bool read(int first, int last, QImage *lines) {
+    QImage image(m_cinfo.output_width, last - first, QImage::Format_RGB32);
+    if (image.isNull() || first < (int)m_cinfo.output_scanline) {
+      return false;
+    }
+
+    if (setjmp(m_err.jump)) {
+      return false;
+    }
+
+    while ((int)m_cinfo.output_scanline < first) {
+      readLine(image.scanLine(0));
+    }
+
+    for (int y = 0; y < image.height(); y++) {
+      readLine(image.scanLine(y));
+    }
+
+    *lines = image;
+
+    return true;
+  }
+
+private:
+  void readLine(uchar *out) {
+    if (m_cinfo.output_components != 3) {
+      JSAMPROW row = out;
+      jpeg_read_scanlines(&m_cinfo, &row, 1);
+      return;
+    }
+
+    JSAMPROW row = m_line.data();
+    jpeg_read_scanlines(&m_cinfo, &row, 1);
+
+    QRgb *rgb = (QRgb *)out;
+    const JSAMPLE *in = m_line.constData();
+    for (unsigned x = 0; x < m_cinfo.output_width; x++) {
+      rgb[x] = qRgb(in[x * 3], in[x * 3 + 1], in[x * 3 + 2]);
+    }
+  }
+
+  struct jpeg_decompress_struct m_cinfo;
+  QtCamNightStackerError m_err;
+  FILE *m_file;
+  bool m_created;
+  QVector<JSAMPLE> m_line;
+};
+
+class QtCamNightStackerDecode : public QRunnable {
+public:
+  QtCamNightStackerDecode(QtCamNightStackerReader *reader, int first, int last,
+			  QImage *lines, bool *ok, QSemaphore *done) :
+    m_reader(reader),
+    m_first(first),
+    m_last(last),
+    m_lines(lines),
+    m_ok(ok),
+    m_done(done) {
+
+  }
+
+  void run() {
+    *m_ok = m_reader->read(m_first, m_last, m_lines);
+    m_done->release();
+  }
+
+private:
+  QtCamNightStackerReader *m_reader;
+  int m_first;
+  int m_last;
+  QImage *m_lines;
+  bool *m_ok;
+  QSemaphore *m_done;
+};
+
+class QtCamNightStackerBand : public QRunnable {
+public:
+  QtCamNightStackerBand(const QList<QtCamNightStacker::Frame>& frames, int reference,
+			const QList<QImage>& lines, const QSize& size, int top, int bottom,
+			uchar *bits, int bytesPerLine, const volatile bool *canceled,
+			QAtomicInt *done, QSemaphore *slots) :
+    m_frames(frames),
+    m_reference(reference),
+    m_lines(lines),
+    m_size(size),
+    m_top(top),
+    m_bottom(bottom),
+    m_bits(bits),
+    m_bytesPerLine(bytesPerLine),
+    m_canceled(canceled),
+    m_done(done),
+    m_slots(slots) {
+
+  }
+
+  void run() {
+    if (!*m_canceled) {
+      QtCamNightStacker::stackBand(m_frames, m_reference, m_lines, m_size, m_top, m_bottom,
+				   m_bits, m_bytesPerLine);
+    }
+
+    // The lines go before the next band is let in.
+    m_lines.clear();
+
+    m_done->ref();
+    m_slots->release();
+  }
+
+private:
+  QList<QtCamNightStacker::Frame> m_frames;
+  int m_reference;
+  QList<QImage> m_lines;
+  QSize m_size;
+  int m_top;
+  int m_bottom;
+  uchar *m_bits;
+  int m_bytesPerLine;
+  const volatile bool *m_canceled;
+  QAtomicInt *m_done;
+  QSemaphore *m_slots;
+};
+
+static QImage readLuma(const QString& fileName, int width) {
+  QImageReader reader(fileName);
+  QSize size = reader.size();
+  if (!size.isValid() || size.width() == 0) {
+    return QImage();
+  }
+
+  reader.setScaledSize(QSize(width, size.height() * width / size.width()));
+
+  QImage image = reader.read();
+  if (image.isNull()) {
+    return image;
+  }
+
+  image = image.convertToFormat(QImage::Format_RGB32);
+
+  QImage luma(image.size(), QImage::Format_Indexed8);
+  for (int y = 0; y < image.height(); y++) {
+    const QRgb *in = (const QRgb *)image.constScanLine(y);
+    uchar *out = luma.scanLine(y);
+    for (int x = 0; x < image.width(); x++) {
+      out[x] = (77 * qRed(in[x]) + 150 * qGreen(in[x]) + 29 * qBlue(in[x])) >> 8;
+    }
+  }
+
+  return luma;
+}
+
+// Lines top to bottom of the reference grid taken from a frame shifted by offset.
+// lines holds the frame lines the band covers. Parts not covered are taken from fill.
+static QImage alignBand(const QImage& lines, const QPoint& offset, const QSize& size,
+			int top, int bottom, const QImage& fill) {
+  QRect band(0, top, size.width(), bottom - top);
+  QRect area = band.translated(offset).intersected(QRect(QPoint(), size));
+  if (area.isEmpty()) {
+    return fill;
+  }
+
+  if (area == band.translated(offset)) {
+    return lines;
+  }
+
+  QImage out = fill.copy();
+  QPoint pos = area.topLeft() - offset - band.topLeft();
+
+  for (int y = 0; y < area.height(); y++) {
+    memcpy(out.scanLine(pos.y() + y) + pos.x() * 4, lines.constScanLine(y) + area.x() * 4,
+	   area.width() * 4);
+  }
+
+  return out;
+}
+
+QtCamNightStacker::QtCamNightStacker(QObject *parent) :
+  QThread(parent),
+  m_canceled(false) {
+
+}
+
+QtCamNightStacker::~QtCamNightStacker() {
+  cancel();
+  wait();
+}
+
+bool QtCamNightStacker::stack(const QStringList& fileNames, const QString& fileName) {
+  if (isRunning()) {
+    qWarning() << "Night stacking already in progress";
+    return false;
+  }
+
+  if (fileNames.size() < 2 || fileNames.size() > MAX_FRAMES) {
+    return false;
+  }
+
+  m_mutex.lock();
+  m_fileNames = fileNames;
+  m_fileName = fileName;
+  m_canceled = false;
+  m_mutex.unlock();
+
+  start(QThread::LowPriority);
+
+  return true;
+}
+
+void QtCamNightStacker::cancel() {
+  m_canceled = true;
+}
+
+void QtCamNightStacker::run() {
+  m_mutex.lock();
+  QStringList fileNames = m_fileNames;
+  QString fileName = m_fileName;
+  m_mutex.unlock();
+
+  int reference = fileNames.size() / 2;
+
+  QSize size = QImageReader(fileNames[reference]).size();
+  if (!size.isValid() || size.isEmpty()) {
+    emit failed();
+    return;
+  }
+
+  int width = qMin(ALIGN_WIDTH, size.width());
+  qreal factor = (qreal)size.width() / width;
+
+  QImage referenceLuma = readLuma(fileNames[reference], width);
+  if (referenceLuma.isNull()) {
+    emit failed();
+    return;
+  }
+
+  QList<Frame> frames;
+
+  for (int x = 0; x < fileNames.size(); x++) {
+    if (m_canceled) {
+      emit failed();
+      return;
+    }
+
+    Frame frame;
+    frame.fileName = fileNames[x];
+
+    if (x != reference) {
+      if (QImageReader(frame.fileName).size() != size) {
+	qWarning() << "Stacked frames differ in size";
+	emit failed();
+	return;
+      }
+
+      QImage luma = readLuma(frame.fileName, width);
+      if (luma.size() != referenceLuma.size()) {
+	emit failed();
+	return;
+      }
+
+      QPoint offset = QtCamExposureFusion::align(referenceLuma, luma, ALIGN_LEVELS);
+      frame.offset = QPoint(qRound(offset.x() * factor), qRound(offset.y() * factor));
+    }
+
+    frames << frame;
+    emit progress(0.1 * frames.size() / fileNames.size());
+  }
+
+  QImage out(size, QImage::Format_RGB32);
+  if (out.isNull()) {
+    emit failed();
+    return;
+  }
+
+  // Bands write to disjoint lines of the same image.
+  uchar *bits = out.bits();
+
+  QList<QtCamNightStackerReader *> readers;
+  bool ok = true;
+
+  for (int x = 0; x < frames.size() && ok; x++) {
+    readers << new QtCamNightStackerReader;
+    ok = readers[x]->open(frames[x].fileName, size);
+  }
+
+  QThreadPool pool;
+  QAtomicInt done(0);
+  // Bands waiting to be stacked hold a few lines of every frame.
+  QSemaphore slots(qMax(1, pool.maxThreadCount()));
+  int bands = (size.height() + BAND_HEIGHT - 1) / BAND_HEIGHT;
+
+  for (int y = 0; y < size.height() && ok && !m_canceled; y += BAND_HEIGHT) {
+    int bottom = qMin(y + BAND_HEIGHT, size.height());
+
+    QVector<QImage> lines(frames.size());
+    QVector<bool> decoded(frames.size());
+    QSemaphore ready;
+    int jobs = 0;
+
+    // The frames are decoded side by side while earlier bands are being stacked.
+    for (int x = 0; x < frames.size(); x++) {
+      int first = qMax(0, y + frames[x].offset.y());
+      int last = qMin(size.height(), bottom + frames[x].offset.y());
+
+      decoded[x] = true;
+
+      if (first < last) {
+	pool.start(new QtCamNightStackerDecode(readers[x], first, last, &lines[x],
+					       &decoded[x], &ready));
+	++jobs;
+      }
+    }
+
+    ready.acquire(jobs);
+
+    for (int x = 0; x < frames.size(); x++) {
+      ok = ok && decoded[x];
+    }
+
+    if (!ok) {
+      break;
+    }
+
+    slots.acquire();
+
+    pool.start(new QtCamNightStackerBand(frames, reference, lines.toList(), size, y, bottom,
+					 bits, out.bytesPerLine(), &m_canceled, &done, &slots));
+
+#if defined(QT4)
+    emit progress(0.1 + 0.8 * (int)done / bands);
+#else
+    emit progress(0.1 + 0.8 * done.load() / bands);
+#endif
+  }
+
+  pool.waitForDone();
+
+  qDeleteAll(readers);
+
+  if (!ok || m_canceled) {
+    emit failed();
+    return;
+  }
+
+  // Capture time, camera settings, location, ... all come from the reference
+  // and the output is compressed like it was.
+  QByteArray referenceData;
+  QFile referenceFile(fileNames[reference]);
+  if (referenceFile.open(QFile::ReadOnly)) {
+    referenceData = referenceFile.readAll();
+  }
+
+  int quality = QtCamJpegEncoder::quality(referenceData);
+  if (quality <= 0) {
+    quality = JPEG_QUALITY;
+  }
+
+  if (!QtCamJpegEncoder::save(out, fileName, quality,
+			      QtCamJpegMetadata::segments(referenceData), &pool)) {
+    qWarning() << "Failed to save night image" << fileName;
+    emit failed();
+    return;
+  }
+
+  emit progress(1.0);
+  emit finished(fileName);
+}
+
+void QtCamNightStacker::stackBand(const QList<Frame>& frames, int reference,
+				  const QList<QImage>& lines, const QSize& size,
+				  int top, int bottom, uchar *bits, int bytesPerLine) {
+  const QImage& ref = lines[reference];
+
+  int lineBytes = size.width() * 4;
+  int bytes = lineBytes * (bottom - top);
+
+  // RGB32 lines have no padding.
+  const uchar *r = ref.constBits();
+
+  QVector<quint16> sum(bytes);
+  QVector<quint16> count(bytes, 1);
+  for (int x = 0; x < bytes; x++) {
+    sum[x] = r[x];
+  }
+
+  for (int x = 0; x < frames.size(); x++) {
+    if (x == reference) {
+      continue;
+    }
+
+    QImage band = alignBand(lines[x], frames[x].offset, size, top, bottom, ref);
+
+    const uchar *f = band.constBits();
+    accumulate(f, r, sum.data(), count.data(), bytes, threshold(f, r, bytes));
+  }
+
+  for (int y = 0; y < bottom - top; y++) {
+    resolve(sum.constData() + y * lineBytes, count.constData() + y * lineBytes,
+	    bits + (top + y) * bytesPerLine, lineBytes);
+  }
+}
+
+void QtCamNightStacker::accumulate(const uchar *frame, const uchar *reference,
+				   quint16 *sum, quint16 *count, int bytes, int threshold) {
+  int x = 0;
+
+#if defined(__SSE2__)
+  __m128i zero = _mm_setzero_si128();
+  __m128i one = _mm_set1_epi8(1);
+  __m128i t = _mm_set1_epi8((char)threshold);
+
+  for (; x + 16 <= bytes; x += 16) {
+    __m128i f = _mm_loadu_si128((const __m128i *)(frame + x));
+    __m128i r = _mm_loadu_si128((const __m128i *)(reference + x));
+
+    // |f - r| <= t: the saturated difference to the threshold is 0.
+    __m128i d = _mm_or_si128(_mm_subs_epu8(f, r), _mm_subs_epu8(r, f));
+    __m128i mask = _mm_cmpeq_epi8(_mm_subs_epu8(d, t), zero);
+
+    __m128i a = _mm_and_si128(f, mask);
+    __m128i c = _mm_and_si128(one, mask);
+
+    __m128i *s = (__m128i *)(sum + x);
+    __m128i *n = (__m128i *)(count + x);
+
+    _mm_storeu_si128(s, _mm_add_epi16(_mm_loadu_si128(s), _mm_unpacklo_epi8(a, zero)));
+    _mm_storeu_si128(s + 1, _mm_add_epi16(_mm_loadu_si128(s + 1), _mm_unpackhi_epi8(a, zero)));
+    _mm_storeu_si128(n, _mm_add_epi16(_mm_loadu_si128(n), _mm_unpacklo_epi8(c, zero)));
+    _mm_storeu_si128(n + 1, _mm_add_epi16(_mm_loadu_si128(n + 1), _mm_unpackhi_epi8(c, zero)));
+  }
+#elif defined(__ARM_NEON__)
+  uint8x16_t one = vdupq_n_u8(1);
+  uint8x16_t t = vdupq_n_u8(threshold);
+
+  for (; x + 16 <= bytes; x += 16) {
+    uint8x16_t f = vld1q_u8(frame + x);
+    uint8x16_t r = vld1q_u8(reference + x);
+
+    uint8x16_t mask = vcleq_u8(vabdq_u8(f, r), t);
+    uint8x16_t a = vandq_u8(f, mask);
+    uint8x16_t c = vandq_u8(one, mask);
+
+    vst1q_u16(sum + x, vaddw_u8(vld1q_u16(sum + x), vget_low_u8(a)));
+    vst1q_u16(sum + x + 8, vaddw_u8(vld1q_u16(sum + x + 8), vget_high_u8(a)));
+    vst1q_u16(count + x, vaddw_u8(vld1q_u16(count + x), vget_low_u8(c)));
+    vst1q_u16(count + x + 8, vaddw_u8(vld1q_u16(count + x + 8), vget_high_u8(c)));
+  }
+#endif
+
+  for (; x < bytes; x++) {
+    if (qAbs(frame[x] - reference[x]) <= threshold) {
+      sum[x] += frame[x];
+      ++count[x];
+    }
+  }
+}
+
+void QtCamNightStacker::resolve(const quint16 *sum, const quint16 *count, uchar *out,
+				int bytes) {
+  // Fixed point reciprocals. count is at least 1 since the reference is always in.
+  quint32 reciprocal[MAX_FRAMES + 1];
+  reciprocal[0] = 0;
+  for (int x = 1; x <= MAX_FRAMES; x++) {
+    reciprocal[x] = (65536 + x / 2) / x;
+  }
+
+  for (int x = 0; x < bytes; x++) {
+    quint32 value = (sum[x] * reciprocal[count[x]] + 32768) >> 16;
+    out[x] = value > 255 ? 255 : value;
+  }
+}
+
+int QtCamNightStacker::threshold(const uchar *frame, const uchar *reference, int bytes) {
+  int histogram[256] = {0};
+  int samples = 0;
+
+  // Every 7th byte hits all channels. Alpha is skipped since it never differs.
+  for (int x = 0; x < bytes; x += 7) {
+    if ((x & 3) == 3) {
+      continue;
+    }
+
+    ++histogram[qAbs(frame[x] - reference[x])];
+    ++samples;
+  }
+
+  int median = 0;
+  for (int count = 0; median < 255; median++) {
+    count += histogram[median];
+    if (count * 2 >= samples) {
+      break;
+    }
+  }
+
+  return qBound(MIN_THRESHOLD, (median * SIGMA_FACTOR + 50) / 100, MAX_THRESHOLD);
+}
@@ -0,0 +1,86 @@
+// -*- c++ -*-
+
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef QT_CAM_NIGHT_STACKER_H
+#define QT_CAM_NIGHT_STACKER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QStringList>
+#include <QList>
+#include <QPoint>
+#include <QImage>
+
+// Averages a burst of short exposures into a single low noise image on a
+// worker thread. Frames are aligned to the reference (middle) frame first.
+// Every frame is then decoded once with libjpeg, top to bottom and side by side
+// on a thread pool, a band of lines at a time. Each band is handed to a job of
+// its own which runs it through a 16 bit accumulator, skipping the samples too
+// far from the reference (moving objects, misalignment), while the next band
+// is decoded. Only the bands in flight are in memory besides the output.
+class QtCamNightStacker : public QThread {
+  Q_OBJECT
+
+public:
+  QtCamNightStacker(QObject *parent = 0);
+  ~QtCamNightStacker();
+
+  // The middle file is the reference for alignment, rejection and metadata.
+  bool stack(const QStringList& fileNames, const QString& fileName);
+  void cancel();
+
+  // Exposed for the band jobs and the tests
+  class Frame {
+  public:
+    QString fileName;
+    QPoint offset;
+  };
+
+  // lines holds the lines of each frame covering the band once shifted by its offset.
+  static void stackBand(const QList<Frame>& frames, int reference,
+			const QList<QImage>& lines, const QSize& size,
+			int top, int bottom, uchar *bits, int bytesPerLine);
+
+  // Adds the bytes of frame within threshold of reference to sum and counts them.
+  static void accumulate(const uchar *frame, const uchar *reference,
+			 quint16 *sum, quint16 *count, int bytes, int threshold);
+  static void resolve(const quint16 *sum, const quint16 *count, uchar *out, int bytes);
+
+  // Rejection threshold for frame from the spread of its differences to reference.
+  static int threshold(const uchar *frame, const uchar *reference, int bytes);
+
+signals:
+  void progress(qreal progress);
+  void finished(const QString& fileName);
+  void failed();
+
+protected:
+  void run();
+
+private:
+  QMutex m_mutex;
+  QStringList m_fileNames;
+  QString m_fileName;
+  volatile bool m_canceled;
+};
+
+#endif /* QT_CAM_NIGHT_STACKER_H */
@@ -0,0 +1,240 @@
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "qtcampanorama.h"
+#include "qtcamgstsample.h"
+#include "qtcamphasecorrelation.h"
+#include <cmath>
+
+// Width of the tracked plane. Plenty for translation and cheap to correlate.
+#define TRACKING_WIDTH           160
+#define DEFAULT_STEP             0.5
+// A frame to frame motion above that cannot be trusted.
+#define MAX_MOTION               0.25
+#define MIN_CONFIDENCE           0.1
+
+QtCamPanorama::QtCamPanorama(QObject *parent) :
+  QThread(parent),
+  m_lastKeyframe(0),
+  m_step(DEFAULT_STEP),
+  m_active(false),
+  m_running(true),
+  m_busy(false),
+  m_hasFrame(false),
+  m_waitingForKeyframe(false) {
+
+  start(QThread::LowPriority);
+}
+
+QtCamPanorama::~QtCamPanorama() {
+  m_mutex.lock();
+  m_running = false;
+  m_cond.wakeOne();
+  m_mutex.unlock();
+
+  wait();
+}
+
+qreal QtCamPanorama::step() {
+  QMutexLocker locker(&m_mutex);
+
+  return m_step;
+}
+
+void QtCamPanorama::setStep(qreal step) {
+  QMutexLocker locker(&m_mutex);
+
+  m_step = qBound(0.1, step, 0.9);
+}
+
+void QtCamPanorama::begin() {
+  QMutexLocker locker(&m_mutex);
+
+  m_active = true;
+  m_position = QPointF();
+  m_lastKeyframe = 0;
+  m_columns.clear();
+  m_rows.clear();
+  m_keyframes.clear();
+
+  // The first keyframe is taken right away.
+  m_waitingForKeyframe = true;
+  locker.unlock();
+
+  emit keyframeNeeded();
+}
+
+void QtCamPanorama::end() {
+  QMutexLocker locker(&m_mutex);
+
+  m_active = false;
+  m_waitingForKeyframe = false;
+}
+
+bool QtCamPanorama::isActive() {
+  QMutexLocker locker(&m_mutex);
+
+  return m_active;
+}
+
+QPointF QtCamPanorama::position() {
+  QMutexLocker locker(&m_mutex);
+
+  return m_position;
+}
+
+void QtCamPanorama::addKeyframe(const QString& fileName) {
+  QMutexLocker locker(&m_mutex);
+
+  QtCamPanoramaFrame frame;
+  frame.fileName = fileName;
+  frame.position = m_position;
+  m_keyframes << frame;
+
+  m_lastKeyframe = m_position.x();
+  m_waitingForKeyframe = false;
+}
+
+void QtCamPanorama::keyframeSkipped() {
+  QMutexLocker locker(&m_mutex);
+
+  m_waitingForKeyframe = false;
+}
+
+QList<QtCamPanoramaFrame> QtCamPanorama::keyframes() {
+  QMutexLocker locker(&m_mutex);
+
+  return m_keyframes;
+}
+
+void QtCamPanorama::handleSample(const QtCamGstSample *sample) {
+  QMutexLocker locker(&m_mutex);
+
+  if (!m_active || m_busy) {
+    return;
+  }
+
+  m_busy = true;
+
+  locker.unlock();
+  bool ok = m_plane.scale(sample, qMax(1, sample->width() / TRACKING_WIDTH));
+  locker.relock();
+
+  if (!ok) {
+    m_busy = false;
+    return;
+  }
+
+  m_hasFrame = true;
+  m_cond.wakeOne();
+}
+
+void QtCamPanorama::run() {
+  m_mutex.lock();
+
+  while (m_running) {
+    if (!m_hasFrame) {
+      m_cond.wait(&m_mutex);
+      continue;
+    }
+
+    m_hasFrame = false;
+    m_mutex.unlock();
+
+    track();
+
+    m_mutex.lock();
+    m_busy = false;
+  }
+
+  m_mutex.unlock();
+}
+
+void QtCamPanorama::track() {
+  int width = m_plane.width();
+  int height = m_plane.height();
+
+  QVector<float> columns =
+    QtCamPhaseCorrelation::columnProfile(m_plane.data(), width, height, width);
+  QVector<float> rows =
+    QtCamPhaseCorrelation::rowProfile(m_plane.data(), width, height, width);
+
+  QMutexLocker locker(&m_mutex);
+
+  if (!m_active) {
+    return;
+  }
+
+  if (m_columns.size() != columns.size() || m_rows.size() != rows.size()) {
+    m_columns = columns;
+    m_rows = rows;
+    return;
+  }
+
+  QVector<float> lastColumns = m_columns;
+  QVector<float> lastRows = m_rows;
+
+  locker.unlock();
+
+  double confidence;
+  // The scene moves opposite to the camera.
+  double dx = -QtCamPhaseCorrelation::shift(lastColumns, columns, &confidence) / width;
+  double dy = -QtCamPhaseCorrelation::shift(lastRows, rows) / height;
+
+  locker.relock();
+
+  if (!m_active) {
+    return;
+  }
+
+  if (fabs(dx) > MAX_MOTION || fabs(dy) > MAX_MOTION) {
+    // Keep the reference frame and hope the user slows down.
+    locker.unlock();
+    emit tooFast();
+    return;
+  }
+
+  m_columns = columns;
+  m_rows = rows;
+
+  if (confidence < MIN_CONFIDENCE) {
+    // Featureless view. Assume we did not move rather than accumulate noise.
+    return;
+  }
+
+  m_position += QPointF(dx, dy);
+
+  QPointF position = m_position;
+  // A skipped first keyframe is asked for again right away.
+  bool needKeyframe = !m_waitingForKeyframe &&
+    (m_keyframes.isEmpty() || fabs(position.x() - m_lastKeyframe) >= m_step);
+  if (needKeyframe) {
+    m_waitingForKeyframe = true;
+  }
+
+  locker.unlock();
+
+  emit moved(position);
+
+  if (needKeyframe) {
+    emit keyframeNeeded();
+  }
+}
@@ -0,0 +1,97 @@
+// -*- c++ -*-
+
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef QT_CAM_PANORAMA_H
+#define QT_CAM_PANORAMA_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QList>
+#include <QPointF>
+#include "qtcamviewfinderbufferhandler.h"
+#include "qtcamlumaplane.h"
+
+class QtCamPanoramaFrame {
+public:
+  QString fileName;
+  // Position of the frame relative to the first one in frame widths and heights.
+  QPointF position;
+};
+
+// Follows a horizontal sweep on downscaled viewfinder frames and asks for a full
+// resolution capture whenever the view moved far enough from the last one.
+// All signals are emitted from the worker thread.
+class QtCamPanorama : public QThread, public QtCamViewfinderBufferHandler {
+  Q_OBJECT
+
+public:
+  QtCamPanorama(QObject *parent = 0);
+  ~QtCamPanorama();
+
+  // Distance between keyframes in frame widths.
+  qreal step();
+  void setStep(qreal step);
+
+  void begin();
+  void end();
+  bool isActive();
+
+  QPointF position();
+
+  // Records a keyframe captured at the current position.
+  void addKeyframe(const QString& fileName);
+  // The requested keyframe could not be captured. It will be asked for again.
+  void keyframeSkipped();
+  QList<QtCamPanoramaFrame> keyframes();
+
+  void handleSample(const QtCamGstSample *sample);
+
+signals:
+  void moved(const QPointF& position);
+  void keyframeNeeded();
+  // The view moved too much between two frames to be followed.
+  void tooFast();
+
+protected:
+  void run();
+
+private:
+  void track();
+
+  QMutex m_mutex;
+  QWaitCondition m_cond;
+  QtCamLumaPlane m_plane;
+  QVector<float> m_columns;
+  QVector<float> m_rows;
+  QPointF m_position;
+  qreal m_lastKeyframe;
+  qreal m_step;
+  bool m_active;
+  bool m_running;
+  bool m_busy;
+  bool m_hasFrame;
+  bool m_waitingForKeyframe;
+  QList<QtCamPanoramaFrame> m_keyframes;
+};
+
+#endif /* QT_CAM_PANORAMA_H */
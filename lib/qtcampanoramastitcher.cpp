@@ -0,0 +1,491 @@
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "qtcampanoramastitcher.h"
+#include "qtcamphasecorrelation.h"
+#include "qtcamjpegencoder.h"
+#include <QImageReader>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QTemporaryFile>
+#include <QImage>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QAtomicInt>
+#include <QtAlgorithms>
+#include <QDebug>
+#include <cmath>
+#include <climits>
+
+#define DEFAULT_HEIGHT           1200
+// The largest width a JPEG can have.
+#define MAX_WIDTH                65500
+// Output columns blended by one job. Small enough to keep the accumulators
+// of all the running jobs in the low megabytes.
+#define TILE_WIDTH               256
+// Keyframes are decoded at this width to refine their positions.
+#define REFINE_WIDTH             256
+#define MIN_CONFIDENCE           0.2
+// A refined offset further than that from the viewfinder estimate is a mismatch.
+#define MAX_CORRECTION           0.2
+#define JPEG_QUALITY             90
+
+class QtCamPanoramaTile : public QRunnable {
+public:
+  QtCamPanoramaTile(const QList<QtCamPanoramaStitcher::Layout>& frames, const QSize& frameSize,
+		    const QRect& tile, QRgb *out, int bytesPerLine,
+		    const volatile bool *canceled, QAtomicInt *done) :
+    m_frames(frames),
+    m_frameSize(frameSize),
+    m_tile(tile),
+    m_out(out),
+    m_bytesPerLine(bytesPerLine),
+    m_canceled(canceled),
+    m_done(done) {
+
+  }
+
+  void run() {
+    QtCamPanoramaStitcher::blendTile(m_frames, m_frameSize, m_tile, m_out, m_bytesPerLine,
+				     m_canceled);
+    m_done->fetchAndAddRelaxed(m_tile.width());
+  }
+
+private:
+  QList<QtCamPanoramaStitcher::Layout> m_frames;
+  QSize m_frameSize;
+  QRect m_tile;
+  QRgb *m_out;
+  int m_bytesPerLine;
+  const volatile bool *m_canceled;
+  QAtomicInt *m_done;
+};
+
+// Reads the blended strip back from the scratch file for the encoder.
+class QtCamPanoramaSource : public QtCamJpegSource {
+public:
+  QtCamPanoramaSource(QFile *file) : m_file(file) {}
+
+  bool read(int top, QImage& lines) {
+    qint64 size = (qint64)lines.bytesPerLine() * lines.height();
+
+    return m_file->seek((qint64)top * lines.bytesPerLine()) &&
+      m_file->read((char *)lines.bits(), size) == size;
+  }
+
+private:
+  QFile *m_file;
+};
+
+static QImage readLuma(const QString& fileName, int width) {
+  QImageReader reader(fileName);
+  QSize size = reader.size();
+  if (!size.isValid() || size.width() == 0) {
+    return QImage();
+  }
+
+  reader.setScaledSize(QSize(width, size.height() * width / size.width()));
+
+  QImage image = reader.read();
+  if (image.isNull()) {
+    return image;
+  }
+
+  image = image.convertToFormat(QImage::Format_RGB32);
+
+  QImage luma(image.size(), QImage::Format_Indexed8);
+  for (int y = 0; y < image.height(); y++) {
+    const QRgb *in = (const QRgb *)image.constScanLine(y);
+    uchar *out = luma.scanLine(y);
+    for (int x = 0; x < image.width(); x++) {
+      out[x] = (77 * qRed(in[x]) + 150 * qGreen(in[x]) + 29 * qBlue(in[x])) >> 8;
+    }
+  }
+
+  return luma;
+}
+
+static bool leftOf(const QtCamPanoramaStitcher::Layout& a, const QtCamPanoramaStitcher::Layout& b) {
+  return a.rect.x() < b.rect.x();
+}
+
+// Stores the columns of group starting at column x of a strip as wide as width.
+static bool writeGroup(QFile *file, const QImage& group, int x, int width) {
+  int size = group.width() * 4;
+
+  for (int y = 0; y < group.height(); y++) {
+    if (!file->seek(((qint64)y * width + x) * 4) ||
+	file->write((const char *)group.constScanLine(y), size) != size) {
+      qWarning() << "Failed to write" << file->fileName() << file->errorString();
+      return false;
+    }
+  }
+
+  return true;
+}
+
+QtCamPanoramaStitcher::QtCamPanoramaStitcher(QObject *parent) :
+  QThread(parent),
+  m_height(DEFAULT_HEIGHT),
+  m_canceled(false) {
+
+}
+
+QtCamPanoramaStitcher::~QtCamPanoramaStitcher() {
+  cancel();
+  wait();
+}
+
+int QtCamPanoramaStitcher::height() {
+  QMutexLocker locker(&m_mutex);
+
+  return m_height;
+}
+
+void QtCamPanoramaStitcher::setHeight(int height) {
+  QMutexLocker locker(&m_mutex);
+
+  m_height = qMax(64, height);
+}
+
+bool QtCamPanoramaStitcher::stitch(const QList<QtCamPanoramaFrame>& frames,
+				   const QString& fileName) {
+  if (isRunning()) {
+    qWarning() << "Panorama stitching already in progress";
+    return false;
+  }
+
+  if (frames.size() < 2) {
+    return false;
+  }
+
+  m_mutex.lock();
+  m_frames = frames;
+  m_fileName = fileName;
+  m_canceled = false;
+  m_mutex.unlock();
+
+  start(QThread::LowPriority);
+
+  return true;
+}
+
+void QtCamPanoramaStitcher::cancel() {
+  m_canceled = true;
+}
+
+void QtCamPanoramaStitcher::run() {
+  m_mutex.lock();
+  QList<QtCamPanoramaFrame> frames = m_frames;
+  QString fileName = m_fileName;
+  int height = m_height;
+  m_mutex.unlock();
+
+  if (!refine(frames) || m_canceled) {
+    emit failed();
+    return;
+  }
+
+  QSize size = QImageReader(frames[0].fileName).size();
+  if (!size.isValid() || size.height() == 0) {
+    emit failed();
+    return;
+  }
+
+  QSize frameSize;
+  QList<Layout> layouts;
+  QRect bounds;
+
+  // Twice at most: the second pass only if the strip is too wide for a JPEG.
+  for (int pass = 0; pass < 2; pass++) {
+    frameSize = QSize(height * size.width() / size.height(), height);
+    layouts.clear();
+
+    int minX = INT_MAX, maxX = INT_MIN, minY = INT_MAX, maxY = INT_MIN;
+
+    foreach (const QtCamPanoramaFrame& frame, frames) {
+      Layout layout;
+      layout.fileName = frame.fileName;
+      layout.rect = QRect(QPoint(qRound(frame.position.x() * frameSize.width()),
+				 qRound(frame.position.y() * frameSize.height())), frameSize);
+      layouts << layout;
+
+      minX = qMin(minX, layout.rect.x());
+      maxX = qMax(maxX, layout.rect.x());
+      minY = qMin(minY, layout.rect.y());
+      maxY = qMax(maxY, layout.rect.y());
+    }
+
+    // Only keep the band covered by all the frames.
+    bounds = QRect(minX, maxY, maxX - minX + frameSize.width(),
+		   minY + frameSize.height() - maxY);
+
+    if (bounds.width() <= MAX_WIDTH) {
+      break;
+    }
+
+    height = height * MAX_WIDTH / bounds.width();
+  }
+
+  if (bounds.height() < frameSize.height() / 2 || bounds.width() > MAX_WIDTH) {
+    qWarning() << "Panorama drifted too much to be stitched";
+    emit failed();
+    return;
+  }
+
+  for (int x = 0; x < layouts.size(); x++) {
+    layouts[x].rect.translate(-bounds.topLeft());
+  }
+
+  // Finished column groups are parked next to the output rather than in memory
+  // or in a temporary directory that might be backed by memory itself.
+  QTemporaryFile scratch(QFileInfo(fileName).dir().filePath(".panorama-XXXXXX"));
+  if (!scratch.open() || !scratch.resize((qint64)bounds.width() * bounds.height() * 4)) {
+    qWarning() << "Failed to create" << scratch.fileName() << scratch.errorString();
+    emit failed();
+    return;
+  }
+
+  QThreadPool pool;
+  QAtomicInt done(0);
+
+  // Keyframes in sweep order. A group spans from the left edge of a keyframe
+  // to the left edge of the next one.
+  qStableSort(layouts.begin(), layouts.end(), leftOf);
+
+  QList<Layout> decoded;
+  int next = 0;
+  QImage group;
+  int groupX = 0;
+  bool ok = true;
+
+  for (int x = 0; x < layouts.size() && !m_canceled; x++) {
+    int start = qMax(0, layouts[x].rect.x());
+    int end = x + 1 < layouts.size() ? layouts[x + 1].rect.x() : bounds.width();
+    end = qMin(end, bounds.width());
+    if (start >= end) {
+      continue;
+    }
+
+    // Tiles still running keep their own reference to the dropped keyframes.
+    for (int i = decoded.size() - 1; i >= 0; i--) {
+      if (decoded[i].rect.right() < start) {
+	decoded.removeAt(i);
+      }
+    }
+
+    while (next < layouts.size() && layouts[next].rect.x() < end && !m_canceled) {
+      Layout layout = layouts[next++];
+
+      QImageReader reader(layout.fileName);
+      reader.setScaledSize(frameSize);
+
+      layout.image = reader.read();
+      if (layout.image.isNull()) {
+	qWarning() << "Failed to read" << layout.fileName << reader.errorString();
+	continue;
+      }
+
+      layout.image = layout.image.convertToFormat(QImage::Format_RGB32);
+      decoded << layout;
+    }
+
+    // The previous group is blended while the keyframes above are decoded.
+    waitForTiles(&pool, &done, bounds.width());
+
+    if (!group.isNull() && !writeGroup(&scratch, group, groupX, bounds.width())) {
+      ok = false;
+      break;
+    }
+
+    group = QImage(end - start, bounds.height(), QImage::Format_RGB32);
+    groupX = start;
+    if (group.isNull()) {
+      ok = false;
+      break;
+    }
+
+    for (int col = start; col < end; col += TILE_WIDTH) {
+      QRect tile(col, 0, qMin(TILE_WIDTH, end - col), bounds.height());
+      pool.start(new QtCamPanoramaTile(decoded, frameSize, tile,
+				       (QRgb *)group.scanLine(0) + col - start,
+				       group.bytesPerLine(), &m_canceled, &done));
+    }
+  }
+
+  decoded.clear();
+  waitForTiles(&pool, &done, bounds.width());
+
+  if (ok && !group.isNull() && !m_canceled) {
+    ok = writeGroup(&scratch, group, groupX, bounds.width());
+  }
+
+  group = QImage();
+
+  if (!ok || m_canceled) {
+    emit failed();
+    return;
+  }
+
+  // The keyframes cover a different area so their metadata does not apply.
+  QByteArray keyframe;
+  QFile keyframeFile(frames[0].fileName);
+  if (keyframeFile.open(QFile::ReadOnly)) {
+    keyframe = keyframeFile.readAll();
+  }
+
+  int quality = QtCamJpegEncoder::quality(keyframe);
+  if (quality <= 0) {
+    quality = JPEG_QUALITY;
+  }
+
+  QtCamPanoramaSource source(&scratch);
+  if (!QtCamJpegEncoder::save(&source, bounds.size(), fileName, quality, QList<QByteArray>(),
+			      &pool)) {
+    qWarning() << "Failed to save panorama" << fileName;
+    emit failed();
+    return;
+  }
+
+  emit progress(1.0);
+  emit finished(fileName);
+}
+
+void QtCamPanoramaStitcher::waitForTiles(QThreadPool *pool, QAtomicInt *done, int width) {
+  while (!pool->waitForDone(100)) {
+#if defined(QT4)
+    emit progress((qreal)(int)*done / width);
+#else
+    emit progress((qreal)done->load() / width);
+#endif
+  }
+}
+
+bool QtCamPanoramaStitcher::refine(QList<QtCamPanoramaFrame>& frames) {
+  // The viewfinder estimates accumulate error. Measure each pair again
+  // on the keyframes themselves and keep the result if it agrees.
+  QImage previous = readLuma(frames[0].fileName, REFINE_WIDTH);
+  if (previous.isNull()) {
+    return false;
+  }
+
+  QPointF position = frames[0].position;
+
+  for (int x = 1; x < frames.size() && !m_canceled; x++) {
+    QImage current = readLuma(frames[x].fileName, REFINE_WIDTH);
+    if (current.isNull() || current.size() != previous.size()) {
+      return false;
+    }
+
+    QPointF estimate = frames[x].position - frames[x - 1].position;
+
+    double cx, cy;
+    double dx = -QtCamPhaseCorrelation::shift(
+      QtCamPhaseCorrelation::columnProfile(previous.constBits(), previous.width(),
+					   previous.height(), previous.bytesPerLine()),
+      QtCamPhaseCorrelation::columnProfile(current.constBits(), current.width(),
+					   current.height(), current.bytesPerLine()),
+      &cx) / current.width();
+    double dy = -QtCamPhaseCorrelation::shift(
+      QtCamPhaseCorrelation::rowProfile(previous.constBits(), previous.width(),
+					previous.height(), previous.bytesPerLine()),
+      QtCamPhaseCorrelation::rowProfile(current.constBits(), current.width(),
+					current.height(), current.bytesPerLine()),
+      &cy) / current.height();
+
+    if (cx >= MIN_CONFIDENCE && fabs(dx - estimate.x()) < MAX_CORRECTION) {
+      estimate.setX(dx);
+    }
+
+    if (cy >= MIN_CONFIDENCE && fabs(dy - estimate.y()) < MAX_CORRECTION) {
+      estimate.setY(dy);
+    }
+
+    frames[x - 1].position = position;
+    position += estimate;
+    previous = current;
+  }
+
+  frames.last().position = position;
+
+  return true;
+}
+
+void QtCamPanoramaStitcher::blendTile(const QList<Layout>& frames, const QSize& frameSize,
+				      const QRect& tile, QRgb *out, int bytesPerLine,
+				      const volatile bool *canceled) {
+  int width = tile.width();
+  int height = tile.height();
+
+  // Premultiplied by weight sums and the weights themselves.
+  QVector<quint32> acc(width * height * 3, 0);
+  QVector<quint32> weights(width * height, 0);
+
+  // Frames fade out linearly over that many columns at their left and right edges.
+  int feather = qMax(1, frameSize.width() / 8);
+
+  foreach (const Layout& frame, frames) {
+    if (*canceled) {
+      return;
+    }
+
+    QRect area = frame.rect.intersected(tile);
+    if (area.isEmpty()) {
+      continue;
+    }
+
+    const QImage& image = frame.image;
+    QPoint origin = area.topLeft() - frame.rect.topLeft();
+
+    for (int y = 0; y < area.height(); y++) {
+      const QRgb *in = (const QRgb *)image.constScanLine(origin.y() + y) + origin.x();
+      int row = area.y() - tile.y() + y;
+
+      for (int x = 0; x < area.width(); x++) {
+	int frameX = origin.x() + x;
+	int edge = qMin(frameX + 1, frameSize.width() - frameX);
+	quint32 w = qMin(edge, feather) * 256 / feather;
+	if (w == 0) {
+	  continue;
+	}
+
+	int index = row * width + area.x() - tile.x() + x;
+
+	acc[index * 3] += qRed(in[x]) * w;
+	acc[index * 3 + 1] += qGreen(in[x]) * w;
+	acc[index * 3 + 2] += qBlue(in[x]) * w;
+	weights[index] += w;
+      }
+    }
+  }
+
+  for (int y = 0; y < height; y++) {
+    QRgb *line = (QRgb *)((uchar *)out + y * bytesPerLine);
+    const quint32 *a = acc.constData() + y * width * 3;
+    const quint32 *w = weights.constData() + y * width;
+
+    for (int x = 0; x < width; x++) {
+      quint32 weight = w[x] ? w[x] : 1;
+      line[x] = qRgb(a[x * 3] / weight, a[x * 3 + 1] / weight, a[x * 3 + 2] / weight);
+    }
+  }
+}
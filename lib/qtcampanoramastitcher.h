@@ -0,0 +1,91 @@
+// -*- c++ -*-
+
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef QT_CAM_PANORAMA_STITCHER_H
+#define QT_CAM_PANORAMA_STITCHER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QList>
+#include <QRect>
+#include <QImage>
+#include "qtcampanorama.h"
+
+class QThreadPool;
+class QAtomicInt;
+
+// Blends panorama keyframes into a single strip on a worker thread.
+// The output is built in column groups, one per keyframe, from left to right.
+// Each keyframe is decoded once when the first group it covers comes up and
+// dropped after the last one so only the few overlapping keyframes are in
+// memory at the same time. The groups are blended in tiles on a thread pool
+// while the keyframes of the next group are decoded. Finished groups go to a
+// scratch file next to the output which is then compressed a band of lines at
+// a time, so memory use does not grow with the length of the sweep.
+class QtCamPanoramaStitcher : public QThread {
+  Q_OBJECT
+
+public:
+  QtCamPanoramaStitcher(QObject *parent = 0);
+  ~QtCamPanoramaStitcher();
+
+  // Height of the keyframes in the output. The strip is a bit lower after
+  // cropping the vertical drift.
+  int height();
+  void setHeight(int height);
+
+  bool stitch(const QList<QtCamPanoramaFrame>& frames, const QString& fileName);
+  void cancel();
+
+  // Exposed for the tile jobs
+  class Layout {
+  public:
+    QString fileName;
+    QRect rect;
+    QImage image;
+  };
+
+  // out points to the top left pixel of tile in an RGB32 buffer.
+  static void blendTile(const QList<Layout>& frames, const QSize& frameSize,
+			const QRect& tile, QRgb *out, int bytesPerLine,
+			const volatile bool *canceled);
+
+signals:
+  void progress(qreal progress);
+  void finished(const QString& fileName);
+  void failed();
+
+protected:
+  void run();
+
+private:
+  bool refine(QList<QtCamPanoramaFrame>& frames);
+  void waitForTiles(QThreadPool *pool, QAtomicInt *done, int width);
+
+  QMutex m_mutex;
+  QList<QtCamPanoramaFrame> m_frames;
+  QString m_fileName;
+  int m_height;
+  volatile bool m_canceled;
+};
+
+#endif /* QT_CAM_PANORAMA_STITCHER_H */
@@ -0,0 +1,182 @@
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "qtcamphasecorrelation.h"
+#include <complex>
+#include <cmath>
+
+typedef std::complex<double> Complex;
+
+static void fft(QVector<Complex>& data, bool inverse) {
+  int n = data.size();
+
+  // Bit reversal
+  for (int i = 1, j = 0; i < n; i++) {
+    int bit = n >> 1;
+    for (; j & bit; bit >>= 1) {
+      j ^= bit;
+    }
+
+    j ^= bit;
+
+    if (i < j) {
+      qSwap(data[i], data[j]);
+    }
+  }
+
+  for (int len = 2; len <= n; len <<= 1) {
+    double angle = 2 * M_PI / len * (inverse ? 1 : -1);
+    Complex step(cos(angle), sin(angle));
+
+    for (int i = 0; i < n; i += len) {
+      Complex w(1);
+
+      for (int j = 0; j < len / 2; j++) {
+	Complex u = data[i + j];
+	Complex v = data[i + j + len / 2] * w;
+	data[i + j] = u + v;
+	data[i + j + len / 2] = u - v;
+	w *= step;
+      }
+    }
+  }
+
+  if (inverse) {
+    for (int i = 0; i < n; i++) {
+      data[i] /= n;
+    }
+  }
+}
+
+// Zero mean and a Hann window so the ends of the profile do not correlate.
+static QVector<Complex> prepare(const QVector<float>& profile, int size) {
+  QVector<Complex> out(size, Complex(0));
+
+  int n = profile.size();
+  if (n == 0) {
+    return out;
+  }
+
+  double mean = 0;
+  for (int i = 0; i < n; i++) {
+    mean += profile[i];
+  }
+
+  mean /= n;
+
+  for (int i = 0; i < n; i++) {
+    double window = 0.5 - 0.5 * cos(2 * M_PI * i / qMax(1, n - 1));
+    out[i] = (profile[i] - mean) * window;
+  }
+
+  return out;
+}
+
+QVector<float> QtCamPhaseCorrelation::columnProfile(const uchar *data, int width,
+						    int height, int stride) {
+  QVector<float> profile(width, 0.0f);
+
+  for (int y = 0; y < height; y++) {
+    const uchar *line = data + y * stride;
+    for (int x = 0; x < width; x++) {
+      profile[x] += line[x];
+    }
+  }
+
+  for (int x = 0; x < width; x++) {
+    profile[x] /= qMax(1, height);
+  }
+
+  return profile;
+}
+
+QVector<float> QtCamPhaseCorrelation::rowProfile(const uchar *data, int width,
+						 int height, int stride) {
+  QVector<float> profile(height, 0.0f);
+
+  for (int y = 0; y < height; y++) {
+    const uchar *line = data + y * stride;
+    quint32 sum = 0;
+    for (int x = 0; x < width; x++) {
+      sum += line[x];
+    }
+
+    profile[y] = (float)sum / qMax(1, width);
+  }
+
+  return profile;
+}
+
+double QtCamPhaseCorrelation::shift(const QVector<float>& a, const QVector<float>& b,
+				    double *confidence) {
+  // Padding to twice the length keeps the correlation from wrapping around.
+  int size = 1;
+  while (size < 2 * qMax(a.size(), b.size())) {
+    size <<= 1;
+  }
+
+  QVector<Complex> fa = prepare(a, size);
+  QVector<Complex> fb = prepare(b, size);
+
+  fft(fa, false);
+  fft(fb, false);
+
+  QVector<Complex> r(size);
+  for (int i = 0; i < size; i++) {
+    Complex c = fb[i] * std::conj(fa[i]);
+    double magnitude = std::abs(c);
+    r[i] = magnitude > 1e-9 ? c / magnitude : Complex(0);
+  }
+
+  fft(r, true);
+
+  // Shifts of more than half the profile leave too little overlap to be trusted.
+  int range = qMax(a.size(), b.size()) / 2;
+
+  int peak = 0;
+  for (int i = 1; i < size; i++) {
+    if (i > range && i < size - range) {
+      continue;
+    }
+
+    if (r[i].real() > r[peak].real()) {
+      peak = i;
+    }
+  }
+
+  // Parabolic interpolation around the peak.
+  double left = r[(peak + size - 1) % size].real();
+  double center = r[peak].real();
+  double right = r[(peak + 1) % size].real();
+  double denominator = left - 2 * center + right;
+  double offset = fabs(denominator) > 1e-9 ? 0.5 * (left - right) / denominator : 0.0;
+
+  if (confidence) {
+    *confidence = qBound(0.0, center, 1.0);
+  }
+
+  double d = peak + offset;
+  if (d > size / 2) {
+    d -= size;
+  }
+
+  return d;
+}
@@ -0,0 +1,41 @@
+// -*- c++ -*-
+
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef QT_CAM_PHASE_CORRELATION_H
+#define QT_CAM_PHASE_CORRELATION_H
+
+#include <QVector>
+
+// Translation estimation between two images by phase correlation of their
+// column (or row) mean profiles. Enough for panning where the motion is
+// mostly a translation and a lot cheaper than a 2D transform.
+class QtCamPhaseCorrelation {
+public:
+  static QVector<float> columnProfile(const uchar *data, int width, int height, int stride);
+  static QVector<float> rowProfile(const uchar *data, int width, int height, int stride);
+
+  // Returns d such that b[i] best matches a[i - d], with sub pixel precision.
+  // confidence is the height of the correlation peak, between 0 and 1.
+  static double shift(const QVector<float>& a, const QVector<float>& b, double *confidence = 0);
+};
+
+#endif /* QT_CAM_PHASE_CORRELATION_H */
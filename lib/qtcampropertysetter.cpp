@@ -22,9 +22,36 @@
 #include "qtcamdevice_p.h"
 #include <QSettings>
 #include <QDebug>
+#include <QHash>
+#include <QMutex>
+#include <QPair>
+
+#ifndef G_VALUE_INIT
+#define G_VALUE_INIT  { 0, { { 0 } } }
+#endif /* G_VALUE_INIT */
 
 class QtCamPropertySetterPrivate {
 public:
+  class Property {
+  public:
+    Property(const QByteArray& n) :
+      name(n) {
+      GValue init = G_VALUE_INIT;
+      value = init;
+    }
+
+    ~Property() {
+      if (G_IS_VALUE(&value)) {
+	g_value_unset(&value);
+      }
+    }
+
+    QByteArray name;
+    GValue value;
+  };
+
+  typedef QList<Property *> PropertyPlan;
+
   void binAdded(GstElement *bin) {
     g_signal_connect(bin, "element-added",
 		     G_CALLBACK(QtCamPropertySetterPrivate::element_added), this);
@@ -83,68 +110,96 @@ public:
   }
 
   void setProperties(GstElement *element) {
+    const PropertyPlan *plan = propertyPlan(element);
+    if (!plan) {
+      return;
+    }
+
+    foreach (const Property *prop, *plan) {
+      g_object_set_property(G_OBJECT(element), prop->name.constData(), &prop->value);
+    }
+  }
+
+  const PropertyPlan *propertyPlan(GstElement *element) {
     QLatin1String name = elementName(element);
     if (!name.latin1()) {
-      return;
+      return 0;
     }
 
-    QVariantMap map = properties(name);
-    if (map.isEmpty()) {
-      return;
+    // properties.ini is per factory and a GType can be registered by more than one
+    QByteArray factory(name.latin1());
+
+    // element-added can be emitted from any streaming thread
+    QMutexLocker locker(&mutex);
+
+    QHash<QByteArray, PropertyPlan *>::const_iterator iter = plans.constFind(factory);
+    if (iter != plans.constEnd()) {
+      return iter.value();
     }
 
-    QStringList keys = map.keys();
-    foreach (const QString& key, keys) {
-      QVariant value = map[key];
-      GParamSpec *pspec = g_object_class_find_property(G_OBJECT_GET_CLASS(element),
-						       key.toUtf8().constData());
+    PropertyPlan *plan = new PropertyPlan;
+
+    QList<QPair<QByteArray, QVariant> > props = properties.value(factory);
+
+    for (int x = 0; x < props.size(); x++) {
+      const QByteArray& key = props[x].first;
+      const QVariant& value = props[x].second;
+
+      GParamSpec *pspec = paramSpec(element, key);
       if (!pspec) {
 	qWarning() << "Property" << key << "not available for" << name;
 	continue;
       }
 
-      GType type = getType(pspec->value_type);
-
-      switch (type) {
-      case G_TYPE_INT:
-      case G_TYPE_ENUM:
-	setInt(element, key, value);
-	break;
-      case G_TYPE_UINT:
-	setUnsignedInt(element, key, value);
-	break;
-      case G_TYPE_STRING:
-	setString(element, key, value);
-	break;
-      case G_TYPE_BOOLEAN:
-	setBoolean(element, key, value);
-	break;
-      default:
-	if (type == gstFraction) {
-	  setFraction(element, key, value);
-	  break;
-	}
+      Property *prop = new Property(key);
 
+      if (!toValue(pspec, value, &prop->value)) {
 	qWarning() << "Unsupported property type"
-		   << g_type_name(pspec->value_type) << "of parent" << g_type_name(type)
+		   << g_type_name(pspec->value_type) << "of parent"
+		   << g_type_name(getType(pspec->value_type))
 		   << "for" << key << "of element" << name;
-	break;
+	delete prop;
+	continue;
       }
+
+      *plan << prop;
     }
-  }
 
-  QVariantMap properties(const QLatin1String& name) {
-    QVariantMap map;
+    // Elements without anything to set get an empty plan so we can skip them quickly
+    plans.insert(factory, plan);
 
-    conf->beginGroup(name);
+    return plan;
+  }
 
-    QStringList keys = conf->allKeys();
-    foreach (const QString& key, keys) {
-      map[key] = conf->value(key);
+  GParamSpec *paramSpec(GstElement *element, const QByteArray& key) {
+    QHash<QByteArray, GParamSpec *>& specs = paramSpecs[G_OBJECT_TYPE(element)];
+
+    QHash<QByteArray, GParamSpec *>::const_iterator iter = specs.constFind(key);
+    if (iter != specs.constEnd()) {
+      return iter.value();
     }
 
-    conf->endGroup();
-    return map;
+    GParamSpec *pspec = g_object_class_find_property(G_OBJECT_GET_CLASS(element),
+						     key.constData());
+    specs.insert(key, pspec);
+
+    return pspec;
+  }
+
+  void compile(QSettings& conf) {
+    foreach (const QString& group, conf.childGroups()) {
+      QList<QPair<QByteArray, QVariant> > props;
+
+      conf.beginGroup(group);
+
+      foreach (const QString& key, conf.allKeys()) {
+	props << qMakePair(key.toUtf8(), conf.value(key));
+      }
+
+      conf.endGroup();
+
+      properties.insert(group.toLatin1(), props);
+    }
   }
 
   QLatin1String elementName(GstElement *elem) {
@@ -163,63 +218,89 @@ public:
     return name;
   }
 
-  void setInt(GstElement *elem, const QString& key, const QVariant& value) {
-    if (!value.canConvert(QVariant::Int)) {
-      qWarning() << "Cannot convert" << value << "to int";
-      return;
-    }
+  bool toValue(GParamSpec *pspec, const QVariant& value, GValue *val) {
+    GType type = getType(pspec->value_type);
 
-    g_object_set(elem, key.toUtf8().constData(), value.toInt(), NULL);
-  }
+    switch (type) {
+    case G_TYPE_INT:
+      if (!value.canConvert(QVariant::Int)) {
+	qWarning() << "Cannot convert" << value << "to int";
+	return false;
+      }
 
-  void setUnsignedInt(GstElement *elem, const QString& key, const QVariant& value) {
-    if (!value.canConvert(QVariant::UInt)) {
-      qWarning() << "Cannot convert" << value << "to unsigned int";
-      return;
-    }
+      g_value_init(val, pspec->value_type);
+      g_value_set_int(val, value.toInt());
+      return true;
 
-    g_object_set(elem, key.toUtf8().constData(), value.toUInt(), NULL);
-  }
+    case G_TYPE_ENUM:
+      if (!value.canConvert(QVariant::Int)) {
+	qWarning() << "Cannot convert" << value << "to int";
+	return false;
+      }
 
-  void setString(GstElement *elem, const QString& key, const QVariant& value) {
-    if (!value.canConvert(QVariant::String)) {
-      qWarning() << "Cannot convert" << value << "to string";
-      return;
-    }
+      g_value_init(val, pspec->value_type);
+      g_value_set_enum(val, value.toInt());
+      return true;
 
-    g_object_set(elem, key.toUtf8().constData(), value.toString().toUtf8().constData(), NULL);
-  }
+    case G_TYPE_UINT:
+      if (!value.canConvert(QVariant::UInt)) {
+	qWarning() << "Cannot convert" << value << "to unsigned int";
+	return false;
+      }
 
-  void setBoolean(GstElement *elem, const QString& key, const QVariant& value) {
-    if (!value.canConvert(QVariant::Bool)) {
-      qWarning() << "Cannot convert" << value << "to bool";
-      return;
-    }
+      g_value_init(val, pspec->value_type);
+      g_value_set_uint(val, value.toUInt());
+      return true;
 
-    g_object_set(elem, key.toUtf8().constData(), value.toBool() ? TRUE : FALSE, NULL);
+    case G_TYPE_STRING:
+      if (!value.canConvert(QVariant::String)) {
+	qWarning() << "Cannot convert" << value << "to string";
+	return false;
+      }
+
+      g_value_init(val, pspec->value_type);
+      g_value_set_string(val, value.toString().toUtf8().constData());
+      return true;
+
+    case G_TYPE_BOOLEAN:
+      if (!value.canConvert(QVariant::Bool)) {
+	qWarning() << "Cannot convert" << value << "to bool";
+	return false;
+      }
+
+      g_value_init(val, pspec->value_type);
+      g_value_set_boolean(val, value.toBool() ? TRUE : FALSE);
+      return true;
+
+    default:
+      if (type == gstFraction) {
+	return toFraction(value, val);
+      }
+
+      return false;
+    }
   }
 
-  void setFraction(GstElement *elem, const QString& key, const QVariant& value) {
+  bool toFraction(const QVariant& value, GValue *val) {
     if (!value.canConvert(QVariant::List)) {
       qWarning() << "Cannot convert" << value << "to list";
-      return;
+      return false;
     }
 
     QList<QVariant> list = value.toList();
     if (list.size() != 2) {
       qWarning() << "fraction list must contain 2 items";
-      return;
+      return false;
     }
 
     if (!list[0].canConvert(QVariant::Int) || !list[1].canConvert(QVariant::Int)) {
       qWarning() << "list items cannot be converted to int";
-      return;
+      return false;
     }
 
-    int val1 = list[0].toInt();
-    int val2 = list[1].toInt();
-
-    g_object_set(elem, key.toUtf8().constData(), val1, val2, NULL);
+    g_value_init(val, GST_TYPE_FRACTION);
+    gst_value_set_fraction(val, list[0].toInt(), list[1].toInt());
+    return true;
   }
 
   GType getType(GType parent) {
@@ -243,7 +324,16 @@ public:
     }
   }
 
-  QSettings *conf;
+  // Factory name -> properties from properties.ini
+  QHash<QByteArray, QList<QPair<QByteArray, QVariant> > > properties;
+
+  // Factory name -> converted values, resolved the first time we see the factory
+  QHash<QByteArray, PropertyPlan *> plans;
+
+  // Element type -> property name -> param spec. Shared by factories of the same type.
+  QHash<GType, QHash<QByteArray, GParamSpec *> > paramSpecs;
+  QMutex mutex;
+
   GType gstFraction;
 };
 
@@ -251,12 +341,19 @@ QtCamPropertySetter::QtCamPropertySetter(QtCamDevicePrivate *pvt) :
   d_ptr(new QtCamPropertySetterPrivate) {
   d_ptr->gstFraction = GST_TYPE_FRACTION;
 
-  d_ptr->conf = new QSettings(pvt->conf->lookUp("properties.ini"), QSettings::IniFormat);
+  QSettings conf(pvt->conf->lookUp("properties.ini"), QSettings::IniFormat);
+  d_ptr->compile(conf);
 
   d_ptr->binAdded(pvt->cameraBin);
 }
 
 QtCamPropertySetter::~QtCamPropertySetter() {
-  delete d_ptr->conf; d_ptr->conf = 0;
+  foreach (QtCamPropertySetterPrivate::PropertyPlan *plan, d_ptr->plans) {
+    qDeleteAll(*plan);
+    delete plan;
+  }
+
+  d_ptr->plans.clear();
+
   delete d_ptr; d_ptr = 0;
 }
@@ -0,0 +1,604 @@
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "qtcamrecordingmonitor.h"
+#include <QTimer>
+#include <QFile>
+#include <QAtomicInt>
+#include <QDebug>
+
+#define QUEUE_SAMPLE_INTERVAL    250
+// pulsesrc and friends jitter a bit
+#define AUDIO_GAP_TOLERANCE      (10 * GST_MSECOND)
+
+static GstClockTime bufferTimestamp(GstBuffer *buffer) {
+#if GST_CHECK_VERSION(1,0,0)
+  if (GST_CLOCK_TIME_IS_VALID(GST_BUFFER_DTS(buffer))) {
+    return GST_BUFFER_DTS(buffer);
+  }
+
+  return GST_BUFFER_PTS(buffer);
+#else
+  return GST_BUFFER_TIMESTAMP(buffer);
+#endif
+}
+
+static qint64 bufferSize(GstBuffer *buffer) {
+#if GST_CHECK_VERSION(1,0,0)
+  return gst_buffer_get_size(buffer);
+#else
+  return GST_BUFFER_SIZE(buffer);
+#endif
+}
+
+// Deleted once GStreamer releases the last of its callbacks, which might
+// still be running when remove() returns.
+class QtCamRecordingMonitorProbe {
+public:
+  QtCamRecordingMonitorProbe(QtCamRecordingMonitor *monitor,
+			     QtCamRecordingMonitor::Point point, GstPad *pad) :
+    m(monitor),
+    p(point),
+    lastTs(GST_CLOCK_TIME_NONE),
+    lastDuration(GST_CLOCK_TIME_NONE),
+    interval(monitor->m_frameInterval),
+    lastWall(-1),
+    removed(false),
+    m_pad(pad),
+    m_probe(0),
+    m_idleProbe(0),
+    m_refs(1) {
+
+    m_refs.ref();
+#if GST_CHECK_VERSION(1,0,0)
+    m_probe = gst_pad_add_probe(m_pad, GST_PAD_PROBE_TYPE_BUFFER, gst1_buffer_probe, this,
+				destroy_notify);
+
+    // Idle probes run once the push returns, which tells how long the
+    // downstream chain took.
+    if (p == QtCamRecordingMonitor::Sink) {
+      m_refs.ref();
+      m_idleProbe = gst_pad_add_probe(m_pad, GST_PAD_PROBE_TYPE_IDLE, gst1_idle_probe, this,
+				      destroy_notify);
+    }
+#else
+    m_probe = gst_pad_add_buffer_probe_full(m_pad, G_CALLBACK(buffer_probe), this,
+					    destroy_notify);
+#endif
+  }
+
+  // Called with the monitor mutex held.
+  void remove() {
+    removed = true;
+
+#if GST_CHECK_VERSION(1,0,0)
+    gst_pad_remove_probe(m_pad, m_probe);
+    if (m_idleProbe) {
+      gst_pad_remove_probe(m_pad, m_idleProbe);
+    }
+#else
+    gst_pad_remove_buffer_probe(m_pad, m_probe);
+#endif
+
+    unref();
+  }
+
+  QtCamRecordingMonitor *m;
+  QtCamRecordingMonitor::Point p;
+
+  // Only touched with the monitor mutex held.
+  GstClockTime lastTs;
+  GstClockTime lastDuration;
+  GstClockTime interval;
+  gint64 lastWall;
+  bool removed;
+
+private:
+  ~QtCamRecordingMonitorProbe() {
+    gst_object_unref(m_pad);
+  }
+
+  void unref() {
+    if (!m_refs.deref()) {
+      delete this;
+    }
+  }
+
+  static void destroy_notify(gpointer user_data) {
+    ((QtCamRecordingMonitorProbe *) user_data)->unref();
+  }
+
+#if GST_CHECK_VERSION(1,0,0)
+  static GstPadProbeReturn gst1_buffer_probe(GstPad *pad, GstPadProbeInfo *info,
+					     gpointer user_data) {
+    Q_UNUSED(pad);
+
+    if (info->data) {
+      _buffer_probe((GstBuffer *)info->data, user_data);
+    }
+
+    return GST_PAD_PROBE_OK;
+  }
+
+  static GstPadProbeReturn gst1_idle_probe(GstPad *pad, GstPadProbeInfo *info,
+					   gpointer user_data) {
+    Q_UNUSED(pad);
+    Q_UNUSED(info);
+
+    QtCamRecordingMonitorProbe *probe = (QtCamRecordingMonitorProbe *) user_data;
+    probe->m->sinkIdle(probe);
+
+    return GST_PAD_PROBE_OK;
+  }
+#else
+  static gboolean buffer_probe(GstPad *pad, GstMiniObject *mini_obj, gpointer user_data) {
+    Q_UNUSED(pad);
+
+    _buffer_probe(GST_BUFFER(mini_obj), user_data);
+
+    return TRUE;
+  }
+#endif
+
+  static void _buffer_probe(GstBuffer *buffer, gpointer user_data) {
+    QtCamRecordingMonitorProbe *probe = (QtCamRecordingMonitorProbe *) user_data;
+
+    switch (probe->p) {
+    case QtCamRecordingMonitor::VideoSource:
+    case QtCamRecordingMonitor::VideoEncoder:
+    case QtCamRecordingMonitor::VideoMuxer:
+      probe->m->videoBuffer(probe, buffer);
+      break;
+
+    case QtCamRecordingMonitor::AudioSource:
+    case QtCamRecordingMonitor::AudioMuxer:
+      probe->m->audioBuffer(probe, buffer);
+      break;
+
+    case QtCamRecordingMonitor::Sink:
+      probe->m->sinkBuffer(probe, buffer);
+      break;
+    }
+  }
+
+  GstPad *m_pad;
+  gulong m_probe;
+  gulong m_idleProbe;
+  QAtomicInt m_refs;
+};
+
+QtCamRecordingStats::QtCamRecordingStats() :
+  longestFrameGap(0),
+  audioBuffers(0),
+  audioGaps(0),
+  audioMissing(0),
+  avDrift(0),
+  minAvDrift(G_MAXINT64),
+  maxAvDrift(G_MININT64),
+  bytesWritten(0),
+  longestWriteStall(0) {
+
+  for (int x = 0; x < Stages; x++) {
+    frames[x] = 0;
+    missingFrames[x] = 0;
+    discontinuities[x] = 0;
+  }
+}
+
+QString QtCamRecordingStats::toString() const {
+  static const char *names[Stages] = {"source", "encoder", "muxer"};
+
+  QString out;
+
+  for (int x = 0; x < Stages; x++) {
+    out += QString("%1-frames: %2\n").arg(names[x]).arg(frames[x]);
+    out += QString("%1-missing-frames: %2\n").arg(names[x]).arg(missingFrames[x]);
+    out += QString("%1-discontinuities: %2\n").arg(names[x]).arg(discontinuities[x]);
+  }
+
+  out += QString("longest-frame-gap: %1\n").arg(longestFrameGap / GST_MSECOND);
+  out += QString("audio-buffers: %1\n").arg(audioBuffers);
+  out += QString("audio-gaps: %1\n").arg(audioGaps);
+  out += QString("audio-missing: %1\n").arg(audioMissing / GST_MSECOND);
+
+  if (minAvDrift <= maxAvDrift) {
+    // Signed division. The drift can be negative.
+    const GstClockTimeDiff msecs = GST_MSECOND;
+    out += QString("av-drift: %1\n").arg(avDrift / msecs);
+    out += QString("av-drift-min: %1\n").arg(minAvDrift / msecs);
+    out += QString("av-drift-max: %1\n").arg(maxAvDrift / msecs);
+  }
+
+  out += QString("bytes-written: %1\n").arg(bytesWritten);
+  out += QString("longest-write-stall: %1\n").arg(longestWriteStall / 1000);
+
+  QMap<QString, int>::const_iterator iter = queueFill.constBegin();
+  while (iter != queueFill.constEnd()) {
+    out += QString("queue-fill-%1: %2\n").arg(iter.key()).arg(iter.value());
+    ++iter;
+  }
+
+  return out;
+}
+
+QtCamRecordingMonitor::QtCamRecordingMonitor(QObject *parent) :
+  QObject(parent),
+  m_frameInterval(GST_CLOCK_TIME_NONE),
+  m_lastMuxerAudio(GST_CLOCK_TIME_NONE),
+  m_timer(new QTimer(this)),
+  m_running(false) {
+
+  m_timer->setInterval(QUEUE_SAMPLE_INTERVAL);
+  QObject::connect(m_timer, SIGNAL(timeout()), this, SLOT(sampleQueues()));
+}
+
+QtCamRecordingMonitor::~QtCamRecordingMonitor() {
+  stop();
+}
+
+void QtCamRecordingMonitor::start(GstClockTime frameInterval) {
+  stop();
+
+  QMutexLocker locker(&m_mutex);
+
+  m_stats = QtCamRecordingStats();
+  m_frameInterval = frameInterval;
+  m_lastMuxerAudio = GST_CLOCK_TIME_NONE;
+
+  m_running = true;
+  m_timer->start();
+}
+
+void QtCamRecordingMonitor::stop() {
+  if (!isRunning()) {
+    return;
+  }
+
+  m_running = false;
+  m_timer->stop();
+
+  // One last look at the queues.
+  sampleQueues();
+
+  QMutexLocker locker(&m_mutex);
+
+  while (!m_probes.isEmpty()) {
+    m_probes.takeFirst()->remove();
+  }
+
+  while (!m_queues.isEmpty()) {
+    gst_object_unref(m_queues.takeFirst());
+  }
+}
+
+bool QtCamRecordingMonitor::isRunning() const {
+  return m_running;
+}
+
+void QtCamRecordingMonitor::addPad(Point point, GstPad *pad) {
+  if (!pad) {
+    return;
+  }
+
+  // Not under the mutex. An idle probe is called right away.
+  QtCamRecordingMonitorProbe *probe = new QtCamRecordingMonitorProbe(this, point, pad);
+
+  QMutexLocker locker(&m_mutex);
+
+  m_probes << probe;
+}
+
+void QtCamRecordingMonitor::addMuxer(GstElement *muxer) {
+  GstIterator *iter = gst_element_iterate_sink_pads(muxer);
+  if (iter) {
+    bool done = false;
+    GstPad *pad = 0;
+
+#if GST_CHECK_VERSION(1,0,0)
+    GValue val = G_VALUE_INIT;
+#endif
+
+    while (!done) {
+#if GST_CHECK_VERSION(1,0,0)
+      switch (gst_iterator_next(iter, &val)) {
+#else
+      switch (gst_iterator_next(iter, (gpointer *)&pad)) {
+#endif
+      case GST_ITERATOR_OK:
+#if GST_CHECK_VERSION(1,0,0)
+	pad = (GstPad *)g_value_dup_object(&val);
+	g_value_reset(&val);
+#endif
+	if (g_str_has_prefix(GST_PAD_NAME(pad), "video")) {
+	  addPad(VideoMuxer, pad);
+	} else if (g_str_has_prefix(GST_PAD_NAME(pad), "audio")) {
+	  addPad(AudioMuxer, pad);
+	} else {
+	  gst_object_unref(pad);
+	}
+
+	break;
+
+      case GST_ITERATOR_RESYNC:
+	gst_iterator_resync(iter);
+	break;
+
+      case GST_ITERATOR_ERROR:
+      case GST_ITERATOR_DONE:
+	done = true;
+	break;
+      }
+    }
+
+#if GST_CHECK_VERSION(1,0,0)
+    g_value_unset(&val);
+#endif
+
+    gst_iterator_free(iter);
+  }
+
+  // Everything downstream of the muxer runs in its push.
+  addPad(Sink, gst_element_get_static_pad(muxer, "src"));
+}
+
+void QtCamRecordingMonitor::addQueues(GstElement *bin) {
+  if (!GST_IS_BIN(bin)) {
+    return;
+  }
+
+  GstIterator *iter = gst_bin_iterate_recurse(GST_BIN(bin));
+  if (!iter) {
+    return;
+  }
+
+  bool done = false;
+  GstElement *elem = 0;
+  GstElementFactory *factory = 0;
+
+#if GST_CHECK_VERSION(1,0,0)
+  GValue val = G_VALUE_INIT;
+#endif
+
+  while (!done) {
+#if GST_CHECK_VERSION(1,0,0)
+    switch (gst_iterator_next(iter, &val)) {
+#else
+    switch (gst_iterator_next(iter, (gpointer *)&elem)) {
+#endif
+    case GST_ITERATOR_OK:
+#if GST_CHECK_VERSION(1,0,0)
+      elem = (GstElement *)g_value_dup_object(&val);
+      g_value_reset(&val);
+#endif
+      factory = gst_element_get_factory(elem);
+      if (factory && !qstrcmp(gst_plugin_feature_get_name(GST_PLUGIN_FEATURE(factory)), "queue")) {
+	m_mutex.lock();
+	m_queues << elem;
+	m_mutex.unlock();
+      } else {
+	gst_object_unref(elem);
+      }
+
+      break;
+
+    case GST_ITERATOR_RESYNC:
+      gst_iterator_resync(iter);
+      break;
+
+    case GST_ITERATOR_ERROR:
+    case GST_ITERATOR_DONE:
+      done = true;
+      break;
+    }
+  }
+
+#if GST_CHECK_VERSION(1,0,0)
+  g_value_unset(&val);
+#endif
+
+  gst_iterator_free(iter);
+}
+
+void QtCamRecordingMonitor::resync() {
+  QMutexLocker locker(&m_mutex);
+
+  foreach (QtCamRecordingMonitorProbe *probe, m_probes) {
+    probe->lastWall = -1;
+  }
+}
+
+QtCamRecordingStats QtCamRecordingMonitor::stats() {
+  QMutexLocker locker(&m_mutex);
+
+  return m_stats;
+}
+
+bool QtCamRecordingMonitor::writeSummary(const QString& fileName) {
+  QFile file(fileName);
+  if (!file.open(QFile::WriteOnly | QFile::Truncate)) {
+    qWarning() << "Failed to open" << fileName << file.errorString();
+    return false;
+  }
+
+  QByteArray data = stats().toString().toUtf8();
+  if (file.write(data) != data.size()) {
+    qWarning() << "Failed to write" << fileName << file.errorString();
+    return false;
+  }
+
+  return true;
+}
+
+void QtCamRecordingMonitor::sampleQueues() {
+  m_mutex.lock();
+  QList<GstElement *> queues(m_queues);
+  m_mutex.unlock();
+
+  foreach (GstElement *queue, queues) {
+    guint buffers = 0, maxBuffers = 0, bytes = 0, maxBytes = 0;
+    guint64 time = 0, maxTime = 0;
+
+    g_object_get(queue,
+		 "current-level-buffers", &buffers, "max-size-buffers", &maxBuffers,
+		 "current-level-bytes", &bytes, "max-size-bytes", &maxBytes,
+		 "current-level-time", &time, "max-size-time", &maxTime,
+		 NULL);
+
+    // Zero means no limit.
+    int fill = 0;
+    if (maxBuffers > 0) {
+      fill = qMax(fill, (int)(buffers * 100 / maxBuffers));
+    }
+
+    if (maxBytes > 0) {
+      fill = qMax(fill, (int)((quint64)bytes * 100 / maxBytes));
+    }
+
+    if (maxTime > 0) {
+      fill = qMax(fill, (int)(time * 100 / maxTime));
+    }
+
+    QString name = QString::fromUtf8(GST_OBJECT_NAME(queue));
+
+    QMutexLocker locker(&m_mutex);
+    m_stats.queueFill[name] = qMax(m_stats.queueFill.value(name), fill);
+  }
+
+  emit statsChanged();
+}
+
+void QtCamRecordingMonitor::videoBuffer(QtCamRecordingMonitorProbe *probe, GstBuffer *buffer) {
+  int stage = probe->p == VideoSource ? QtCamRecordingStats::Source :
+    probe->p == VideoEncoder ? QtCamRecordingStats::Encoder : QtCamRecordingStats::Muxer;
+
+  GstClockTime ts = bufferTimestamp(buffer);
+
+  QMutexLocker locker(&m_mutex);
+
+  if (probe->removed) {
+    return;
+  }
+
+  if (++m_stats.frames[stage] > 1 && GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_DISCONT)) {
+    ++m_stats.discontinuities[stage];
+  }
+
+  if (!GST_CLOCK_TIME_IS_VALID(ts)) {
+    return;
+  }
+
+  if (GST_CLOCK_TIME_IS_VALID(probe->lastTs) && ts > probe->lastTs) {
+    GstClockTime delta = ts - probe->lastTs;
+
+    if (GST_CLOCK_TIME_IS_VALID(probe->interval) && delta > probe->interval * 3 / 2) {
+      m_stats.missingFrames[stage] += (delta + probe->interval / 2) / probe->interval - 1;
+    } else {
+      // Follows the frame rate changes of the source.
+      probe->interval = GST_CLOCK_TIME_IS_VALID(probe->interval) ?
+	(probe->interval * 7 + delta) / 8 : delta;
+    }
+
+    if (stage == QtCamRecordingStats::Source) {
+      m_stats.longestFrameGap = qMax(m_stats.longestFrameGap, delta);
+    }
+  }
+
+  // Encoded frames can arrive out of order.
+  if (!GST_CLOCK_TIME_IS_VALID(probe->lastTs) || ts > probe->lastTs) {
+    probe->lastTs = ts;
+  }
+
+  if (stage == QtCamRecordingStats::Muxer && GST_CLOCK_TIME_IS_VALID(m_lastMuxerAudio)) {
+    GstClockTimeDiff drift = GST_CLOCK_DIFF(m_lastMuxerAudio, ts);
+    m_stats.avDrift = drift;
+    m_stats.minAvDrift = qMin(m_stats.minAvDrift, drift);
+    m_stats.maxAvDrift = qMax(m_stats.maxAvDrift, drift);
+  }
+}
+
+void QtCamRecordingMonitor::audioBuffer(QtCamRecordingMonitorProbe *probe, GstBuffer *buffer) {
+  GstClockTime ts = bufferTimestamp(buffer);
+
+  QMutexLocker locker(&m_mutex);
+
+  if (probe->removed) {
+    return;
+  }
+
+  if (probe->p == AudioMuxer) {
+    if (GST_CLOCK_TIME_IS_VALID(ts)) {
+      m_lastMuxerAudio = ts;
+    }
+
+    return;
+  }
+
+  ++m_stats.audioBuffers;
+
+  if (GST_CLOCK_TIME_IS_VALID(ts) && GST_CLOCK_TIME_IS_VALID(probe->lastTs) &&
+      GST_CLOCK_TIME_IS_VALID(probe->lastDuration)) {
+    GstClockTime expected = probe->lastTs + probe->lastDuration;
+    if (ts > expected + AUDIO_GAP_TOLERANCE) {
+      ++m_stats.audioGaps;
+      m_stats.audioMissing += ts - expected;
+    }
+  }
+
+  probe->lastTs = ts;
+  probe->lastDuration = GST_BUFFER_DURATION(buffer);
+}
+
+void QtCamRecordingMonitor::sinkBuffer(QtCamRecordingMonitorProbe *probe, GstBuffer *buffer) {
+  gint64 now = g_get_monotonic_time();
+
+  QMutexLocker locker(&m_mutex);
+
+  if (probe->removed) {
+    return;
+  }
+
+  m_stats.bytesWritten += bufferSize(buffer);
+
+#if !GST_CHECK_VERSION(1,0,0)
+  // No idle probes. The time between two buffers bounds the time spent downstream.
+  if (probe->lastWall >= 0) {
+    m_stats.longestWriteStall = qMax(m_stats.longestWriteStall, (qint64)(now - probe->lastWall));
+  }
+#endif
+
+  probe->lastWall = now;
+}
+
+#if GST_CHECK_VERSION(1,0,0)
+void QtCamRecordingMonitor::sinkIdle(QtCamRecordingMonitorProbe *probe) {
+  gint64 now = g_get_monotonic_time();
+
+  QMutexLocker locker(&m_mutex);
+
+  if (probe->removed || probe->lastWall < 0) {
+    // Events and the call made when the probe is added.
+    return;
+  }
+
+  m_stats.longestWriteStall = qMax(m_stats.longestWriteStall, (qint64)(now - probe->lastWall));
+  probe->lastWall = -1;
+}
+#endif
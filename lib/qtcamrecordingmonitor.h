@@ -0,0 +1,144 @@
+// -*- c++ -*-
+
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#ifndef QT_CAM_RECORDING_MONITOR_H
+#define QT_CAM_RECORDING_MONITOR_H
+
+#include <QObject>
+#include <QMutex>
+#include <QList>
+#include <QMap>
+#include <QString>
+#include <gst/gst.h>
+
+class QTimer;
+class QtCamRecordingMonitorProbe;
+
+class QtCamRecordingStats {
+public:
+  typedef enum {
+    Source = 0,
+    Encoder = 1,
+    Muxer = 2,
+    Stages = 3,
+  } Stage;
+
+  QtCamRecordingStats();
+
+  // One "key: value" per line. Times are in milliseconds.
+  QString toString() const;
+
+  // Video frames seen at each stage.
+  qint64 frames[Stages];
+  // Frames missing according to the timestamps at each stage.
+  qint64 missingFrames[Stages];
+  // Buffers flagged as discontinuous at each stage.
+  qint64 discontinuities[Stages];
+  // Largest timestamp difference between two frames at the source.
+  GstClockTime longestFrameGap;
+
+  qint64 audioBuffers;
+  qint64 audioGaps;
+  GstClockTime audioMissing;
+
+  // Video minus audio timestamp of the latest buffers reaching the muxer.
+  GstClockTimeDiff avDrift;
+  GstClockTimeDiff minAvDrift;
+  GstClockTimeDiff maxAvDrift;
+
+  qint64 bytesWritten;
+  // Longest time a buffer took to get through everything downstream of the
+  // muxer, writing included, in microseconds. GStreamer 0.10 has no way to
+  // tell when a push returns so there it is the longest time between two
+  // buffers leaving the muxer.
+  qint64 longestWriteStall;
+
+  // Highest fill level seen per queue, in percent.
+  QMap<QString, int> queueFill;
+};
+
+// Watches the buffers flowing through the stages of the video branch while
+// recording to tell where frames get lost and how far audio and video drift.
+class QtCamRecordingMonitor : public QObject {
+  Q_OBJECT
+
+public:
+  typedef enum {
+    VideoSource,
+    VideoEncoder,
+    VideoMuxer,
+    AudioSource,
+    AudioMuxer,
+    // The source pad of the muxer.
+    Sink,
+  } Point;
+
+  QtCamRecordingMonitor(QObject *parent = 0);
+  ~QtCamRecordingMonitor();
+
+  // frameInterval is the nominal duration of a frame or GST_CLOCK_TIME_NONE.
+  void start(GstClockTime frameInterval);
+  void stop();
+  bool isRunning() const;
+
+  // Takes over the pad reference.
+  void addPad(Point point, GstPad *pad);
+  // Monitors the audio and video sink pads of the muxer and what it writes.
+  void addMuxer(GstElement *muxer);
+  // Samples the fill level of all queues in bin.
+  void addQueues(GstElement *bin);
+
+  // Recording resumed. Time spent paused is not a stall.
+  void resync();
+
+  QtCamRecordingStats stats();
+
+  bool writeSummary(const QString& fileName);
+
+signals:
+  void statsChanged();
+
+private slots:
+  void sampleQueues();
+
+private:
+  friend class QtCamRecordingMonitorProbe;
+
+  void videoBuffer(QtCamRecordingMonitorProbe *probe, GstBuffer *buffer);
+  void audioBuffer(QtCamRecordingMonitorProbe *probe, GstBuffer *buffer);
+  void sinkBuffer(QtCamRecordingMonitorProbe *probe, GstBuffer *buffer);
+#if GST_CHECK_VERSION(1,0,0)
+  void sinkIdle(QtCamRecordingMonitorProbe *probe);
+#endif
+
+  QMutex m_mutex;
+  QtCamRecordingStats m_stats;
+  GstClockTime m_frameInterval;
+  GstClockTime m_lastMuxerAudio;
+  QList<QtCamRecordingMonitorProbe *> m_probes;
+  QList<GstElement *> m_queues;
+  QTimer *m_timer;
+  bool m_running;
+};
+
+#endif /* QT_CAM_RECORDING_MONITOR_H */
@@ -0,0 +1,280 @@
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "qtcamregiondetector.h"
+#include <QVector>
+#include <algorithm>
+
+#ifndef G_VALUE_INIT
+#define G_VALUE_INIT  { 0, { { 0 } } }
+#endif /* G_VALUE_INIT */
+
+#define MAX_REGIONS                    5
+// Windows smaller than that are not worth reporting (pixels in the plane)
+#define MIN_WINDOW_SIZE                8
+// A region must have that much more detail than the frame as a whole
+#define VARIANCE_RATIO                 1.5
+#define MIN_VARIANCE                   100.0
+// Regions overlapping more than that are considered the same
+#define MAX_OVERLAP                    0.3
+
+class QtCamRegionCandidate {
+public:
+  QRect rect;
+  double score;
+
+  bool operator<(const QtCamRegionCandidate& other) const {
+    // Best first
+    return score > other.score;
+  }
+};
+
+static double overlap(const QRect& a, const QRect& b) {
+  QRect i = a.intersected(b);
+  if (i.isEmpty()) {
+    return 0.0;
+  }
+
+  int smaller = qMin(a.width() * a.height(), b.width() * b.height());
+
+  return (double)(i.width() * i.height()) / smaller;
+}
+
+QtCamRegionDetector::QtCamRegionDetector(GstElement *bin, const QString& messageName,
+					 int factor, int interval, QObject *parent) :
+  QThread(parent),
+  m_bin(bin),
+  m_messageName(messageName.toUtf8()),
+  m_factor(factor == 8 ? 8 : 4),
+  m_interval(qMax(0, interval)),
+  m_enabled(false),
+  m_running(true),
+  m_busy(false),
+  m_hasFrame(false) {
+
+  gst_object_ref(m_bin);
+
+  start(QThread::LowPriority);
+}
+
+QtCamRegionDetector::~QtCamRegionDetector() {
+  m_mutex.lock();
+  m_running = false;
+  m_cond.wakeOne();
+  m_mutex.unlock();
+
+  wait();
+
+  gst_object_unref(m_bin);
+}
+
+void QtCamRegionDetector::setEnabled(bool enabled) {
+  QMutexLocker locker(&m_mutex);
+
+  m_enabled = enabled;
+  m_timer.invalidate();
+}
+
+bool QtCamRegionDetector::isEnabled() {
+  QMutexLocker locker(&m_mutex);
+
+  return m_enabled;
+}
+
+void QtCamRegionDetector::handleSample(const QtCamGstSample *sample) {
+  QMutexLocker locker(&m_mutex);
+
+  if (!m_enabled || m_busy) {
+    return;
+  }
+
+  if (m_timer.isValid() && m_timer.elapsed() < m_interval) {
+    return;
+  }
+
+  // The worker does not touch the plane until we hand it over.
+  m_busy = true;
+
+  locker.unlock();
+  bool ok = m_plane.scale(sample, m_factor);
+  locker.relock();
+
+  if (!ok) {
+    m_busy = false;
+    return;
+  }
+
+  m_timer.start();
+  m_hasFrame = true;
+  m_cond.wakeOne();
+}
+
+void QtCamRegionDetector::run() {
+  m_mutex.lock();
+
+  while (m_running) {
+    if (!m_hasFrame) {
+      m_cond.wait(&m_mutex);
+      continue;
+    }
+
+    m_hasFrame = false;
+    m_mutex.unlock();
+
+    post(findRegions(m_plane, MAX_REGIONS));
+
+    m_mutex.lock();
+    m_busy = false;
+  }
+
+  m_mutex.unlock();
+}
+
+void QtCamRegionDetector::post(const QList<QRect>& regions) {
+  // Same layout as the messages posted by droidcamsrc.
+  GValue regionList = G_VALUE_INIT;
+  g_value_init(&regionList, GST_TYPE_LIST);
+
+  for (int x = 0; x < regions.size(); x++) {
+    const QRect& rect = regions[x];
+
+    GstStructure *region = gst_structure_new("region0",
+					     "region-x", G_TYPE_UINT, rect.x() * m_plane.factor(),
+					     "region-y", G_TYPE_UINT, rect.y() * m_plane.factor(),
+					     "region-w", G_TYPE_UINT, rect.width() * m_plane.factor(),
+					     "region-h", G_TYPE_UINT, rect.height() * m_plane.factor(),
+					     "region-priority", G_TYPE_UINT, 1,
+					     "region-id", G_TYPE_UINT, x,
+					     NULL);
+
+    GValue regionValue = G_VALUE_INIT;
+    g_value_init(&regionValue, GST_TYPE_STRUCTURE);
+    gst_value_set_structure(&regionValue, region);
+    gst_value_list_append_value(&regionList, &regionValue);
+    g_value_unset(&regionValue);
+    gst_structure_free(region);
+  }
+
+  GstStructure *s = gst_structure_new(m_messageName.constData(),
+				      "frame-width", G_TYPE_UINT, m_plane.sourceSize().width(),
+				      "frame-height", G_TYPE_UINT, m_plane.sourceSize().height(),
+				      NULL);
+  gst_structure_set_value(s, "regions", &regionList);
+  g_value_unset(&regionList);
+
+  gst_element_post_message(m_bin, gst_message_new_element(GST_OBJECT(m_bin), s));
+}
+
+QList<QRect> QtCamRegionDetector::findRegions(const QtCamLumaPlane& plane, int maxRegions) {
+  QList<QRect> regions;
+
+  int w = plane.width();
+  int h = plane.height();
+
+  if (w < MIN_WINDOW_SIZE || h < MIN_WINDOW_SIZE) {
+    return regions;
+  }
+
+  // Integral images of the values and their squares.
+  int stride = w + 1;
+  QVector<quint32> sums(stride * (h + 1), 0);
+  QVector<quint64> squares(stride * (h + 1), 0);
+
+  for (int y = 0; y < h; y++) {
+    const uchar *line = plane.line(y);
+    quint32 *s = sums.data() + (y + 1) * stride + 1;
+    quint64 *q = squares.data() + (y + 1) * stride + 1;
+    const quint32 *sAbove = s - stride;
+    const quint64 *qAbove = q - stride;
+
+    quint32 rowSum = 0;
+    quint64 rowSquares = 0;
+
+    for (int x = 0; x < w; x++) {
+      rowSum += line[x];
+      rowSquares += line[x] * line[x];
+      s[x] = sAbove[x] + rowSum;
+      q[x] = qAbove[x] + rowSquares;
+    }
+  }
+
+  double n = (double)w * h;
+  double mean = sums[h * stride + w] / n;
+  double globalVariance = squares[h * stride + w] / n - mean * mean;
+  double minVariance = qMax(MIN_VARIANCE, globalVariance * VARIANCE_RATIO);
+
+  QVector<QtCamRegionCandidate> candidates;
+
+  const float scales[] = {0.15f, 0.25f, 0.4f};
+  int minSide = qMin(w, h);
+
+  for (unsigned i = 0; i < sizeof(scales) / sizeof(scales[0]); i++) {
+    int size = minSide * scales[i];
+    if (size < MIN_WINDOW_SIZE) {
+      continue;
+    }
+
+    int step = qMax(2, size / 4);
+    double area = (double)size * size;
+
+    for (int y = 0; y + size <= h; y += step) {
+      const quint32 *sTop = sums.constData() + y * stride;
+      const quint32 *sBottom = sTop + size * stride;
+      const quint64 *qTop = squares.constData() + y * stride;
+      const quint64 *qBottom = qTop + size * stride;
+
+      for (int x = 0; x + size <= w; x += step) {
+	double sum = (double)sBottom[x + size] - sBottom[x] - sTop[x + size] + sTop[x];
+	double square = (double)qBottom[x + size] - qBottom[x] - qTop[x + size] + qTop[x];
+	double m = sum / area;
+	double variance = square / area - m * m;
+
+	if (variance >= minVariance) {
+	  QtCamRegionCandidate candidate;
+	  candidate.rect = QRect(x, y, size, size);
+	  candidate.score = variance;
+	  candidates << candidate;
+	}
+      }
+    }
+  }
+
+  std::sort(candidates.begin(), candidates.end());
+
+  foreach (const QtCamRegionCandidate& candidate, candidates) {
+    bool suppressed = false;
+
+    foreach (const QRect& region, regions) {
+      if (overlap(candidate.rect, region) > MAX_OVERLAP) {
+	suppressed = true;
+	break;
+      }
+    }
+
+    if (!suppressed) {
+      regions << candidate.rect;
+      if (regions.size() == maxRegions) {
+	break;
+      }
+    }
+  }
+
+  return regions;
+}
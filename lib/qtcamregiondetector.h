@@ -0,0 +1,80 @@
+// -*- c++ -*-
+
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef QT_CAM_REGION_DETECTOR_H
+#define QT_CAM_REGION_DETECTOR_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+#include <QList>
+#include <QRect>
+#include <gst/gst.h>
+#include "qtcamviewfinderbufferhandler.h"
+#include "qtcamlumaplane.h"
+
+// Software fallback for sources that cannot detect regions of interest.
+// Looks for high detail areas in a downscaled luma copy of the viewfinder
+// and posts the result from the pipeline in the same layout as a regions of
+// interest message. The message is named by roi/software-message which defaults
+// to roi/message so that QtCamRoi picks the regions up.
+class QtCamRegionDetector : public QThread, public QtCamViewfinderBufferHandler {
+  Q_OBJECT
+
+public:
+  // factor is how much the luma plane gets downscaled and interval is the minimum
+  // time between the start of two detections in milliseconds.
+  QtCamRegionDetector(GstElement *bin, const QString& messageName,
+		      int factor, int interval, QObject *parent = 0);
+  ~QtCamRegionDetector();
+
+  void setEnabled(bool enabled);
+  bool isEnabled();
+
+  void handleSample(const QtCamGstSample *sample);
+
+  // Returns regions in plane coordinates sorted by decreasing detail.
+  static QList<QRect> findRegions(const QtCamLumaPlane& plane, int maxRegions);
+
+protected:
+  void run();
+
+private:
+  void post(const QList<QRect>& regions);
+
+  GstElement *m_bin;
+  QByteArray m_messageName;
+  int m_factor;
+  int m_interval;
+
+  QMutex m_mutex;
+  QWaitCondition m_cond;
+  QElapsedTimer m_timer;
+  QtCamLumaPlane m_plane;
+  bool m_enabled;
+  bool m_running;
+  bool m_busy;
+  bool m_hasFrame;
+};
+
+#endif /* QT_CAM_REGION_DETECTOR_H */
@@ -20,6 +20,8 @@
 
 #include "qtcamroi.h"
 #include "qtcamroi_p.h"
+#include "qtcamregiondetector.h"
+#include "qtcamcontrastfocus.h"
 
 #ifndef G_VALUE_INIT
 #define G_VALUE_INIT  { 0, { { 0 } } }
@@ -42,6 +44,10 @@ void QtCamRoi::setRegionOfInterest(const QRectF& roi) {
     return;
   }
 
+  if (d_ptr->dev->d_ptr->contrastFocus) {
+    d_ptr->dev->d_ptr->contrastFocus->setRegion(roi);
+  }
+
   QSizeF vf = d_ptr->dev->viewfinder()->videoResolution();
   if (vf.isEmpty()) {
     return;
@@ -102,6 +108,10 @@ void QtCamRoi::setEnabled(bool enabled) {
 
   d_ptr->enabled = enabled;
 
+  if (d_ptr->dev->d_ptr->regionDetector) {
+    d_ptr->dev->d_ptr->regionDetector->setEnabled(enabled);
+  }
+
   if (!d_ptr->roi) {
     return;
   }
@@ -30,7 +30,8 @@
 #include "qtcamroi.h"
 #include <QDebug>
 #include <QPointer>
-#include <cmath>
+#include <QThread>
+#include "qtcamroitracker.h"
 
 class QtCamRoiPrivate : public QObject {
   Q_OBJECT
@@ -42,8 +43,16 @@ public:
     dev(device),
     roi(0),
     enabled(false),
-    msg(0) {
-
+    tracker(new QtCamRoiTracker) {
+
+    // Parsing and tracking happen away from the GUI thread.
+    tracker->moveToThread(&thread);
+    QObject::connect(tracker,
+		     SIGNAL(regionsChanged(const QList<QRectF>&, const QRectF&, const QList<QRectF>&)),
+		     this,
+		     SLOT(regionsChanged(const QList<QRectF>&, const QRectF&, const QList<QRectF>&)),
+		     Qt::QueuedConnection);
+    thread.start();
   }
 
   ~QtCamRoiPrivate() {
@@ -57,21 +66,15 @@ public:
       delete handler.data();
     }
 
-    mutex.lock();
-    if (msg) {
-      gst_message_unref(msg);
-      msg = 0;
-    }
-    mutex.unlock();
+    QMetaObject::invokeMethod(tracker, "stop", Qt::BlockingQueuedConnection);
+    thread.quit();
+    thread.wait();
+
+    delete tracker;
   }
 
   void clear() {
-    mutex.lock();
-    if (msg) {
-      gst_message_unref(msg);
-      msg = 0;
-    }
-    mutex.unlock();
+    QMetaObject::invokeMethod(tracker, "reset", Qt::QueuedConnection);
   }
 
   bool sendEventToSource(GstEvent *event) {
@@ -99,40 +102,11 @@ public:
     }
   }
 
-  int primaryRegion(const QRectF& area, const QList<QRectF>& rects) {
-    int index = -1;
-    qreal distance = 0.0;
-    QPointF center = area.center();
-
-    for (int x = 0; x < rects.size(); x++) {
-      const QRectF& rect = rects.at(x);
-
-      QPointF val = rect.center() - center;
-
-      qreal newDistance = sqrt(pow(val.x(), 2) + pow(val.y(), 2));
-      if (index == -1 || newDistance < distance) {
-	index = x;
-	distance = newDistance;
-      }
-    }
-
-    return index;
-  }
-
 public slots:
   void handleMessage(GstMessage *message) {
-    gst_message_ref(message);
-
-    mutex.lock();
-    if (msg) {
-      gst_message_unref(msg);
+    if (enabled) {
+      tracker->post(message);
     }
-
-    msg = message;
-
-    mutex.unlock();
-
-    QMetaObject::invokeMethod(this, "processMessage", Qt::QueuedConnection);
   }
 
 private slots:
@@ -149,67 +123,18 @@ private slots:
 
     q_ptr->setEnabled(enabled);
 
+    clear();
+
     emit q_ptr->reset();
   }
 
-  void processMessage() {
-    mutex.lock();
-    GstMessage *message = msg;
-    msg = 0;
-    mutex.unlock();
-
-    if (!message) {
-      return;
-    }
-
+  void regionsChanged(const QList<QRectF>& regions, const QRectF& primary,
+		      const QList<QRectF>& rest) {
     if (!enabled) {
       return;
     }
 
-    QList<QRectF> rects;
-    unsigned width = 0, height = 0;
-
-    const GstStructure *s = gst_message_get_structure(message);
-    if (!gst_structure_get_uint(s, "frame-width", &width) ||
-	!gst_structure_get_uint(s, "frame-height", &height)) {
-
-      qWarning() << "Failed to obtain frame dimensions for ROI message";
-      gst_message_unref(message);
-      return;
-    }
-
-    const GValue *regions = gst_structure_get_value(s, "regions");
-    if (!regions) {
-      qWarning() << "No regions in ROI message";
-      gst_message_unref(message);
-      return;
-    }
-
-    guint size = gst_value_list_get_size(regions);
-    for (unsigned i = 0; i < size; i++) {
-      const GValue *region = gst_value_list_get_value(regions, i);
-      const GstStructure *structure = gst_value_get_structure(region);
-
-      unsigned x = 0, y = 0, w = 0, h = 0;
-
-      gst_structure_get_uint(structure, "region-x", &x);
-      gst_structure_get_uint(structure, "region-y", &y);
-      gst_structure_get_uint(structure, "region-w", &w);
-      gst_structure_get_uint(structure, "region-h", &h);
-
-      QRectF rect((qreal)x/width, (qreal)y/height, (qreal)w/width, (qreal)h/height);
-
-      rects << rect;
-    }
-
-    int index = primaryRegion(QRectF(0, 0, 1, 1), rects);
-
-    QList<QRectF> rest(rects);
-    QRectF primary = index == -1 ? QRectF() : rest.takeAt(index);
-
-    gst_message_unref(message);
-
-    emit q_ptr->regionsOfInterestUpdated(rects, primary, rest);
+    emit q_ptr->regionsOfInterestUpdated(regions, primary, rest);
   }
 
 public:
@@ -218,8 +143,8 @@ public:
   GstElement *roi;
   bool enabled;
   QPointer<QtCamGstMessageHandler> handler;
-  QMutex mutex;
-  GstMessage *msg;
+  QThread thread;
+  QtCamRoiTracker *tracker;
 };
 
 #endif /* QT_CAM_ROI_P_H */
@@ -0,0 +1,343 @@
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "qtcamroitracker.h"
+#include <QTimer>
+#include <QVector>
+#include <QMetaType>
+#include <QDebug>
+#include <algorithm>
+
+// How often we predict positions between two detector updates (ms)
+#define PREDICTION_INTERVAL              33
+// We do not extrapolate further than that after the last detection (ms)
+#define PREDICTION_HORIZON               250
+// A region that is not detected for that long is dropped (ms)
+#define TRACK_TIMEOUT                    500
+// Maximum distance between centers for a detection to belong to a track
+#define TRACK_GATE                       0.2
+// alpha-beta filter gains
+#define FILTER_ALPHA                     0.5
+#define FILTER_BETA                      0.1
+// Changes smaller than that are not worth a repaint
+#define CHANGE_THRESHOLD                 0.005
+
+class QtCamRoiTrackerMatch {
+public:
+  qreal distance;
+  int track;
+  int rect;
+
+  bool operator<(const QtCamRoiTrackerMatch& other) const {
+    return distance < other.distance;
+  }
+};
+
+static qreal squaredDistance(const QPointF& a, const QPointF& b) {
+  QPointF d = a - b;
+  return d.x() * d.x() + d.y() * d.y();
+}
+
+QRectF QtCamRoiTracker::Track::rect(qint64 now) const {
+  qreal dt = qMin<qint64>(now - updated, PREDICTION_HORIZON);
+
+  qreal x = cx + vx * dt;
+  qreal y = cy + vy * dt;
+
+  return QRectF(x - w / 2.0, y - h / 2.0, w, h);
+}
+
+QtCamRoiTracker::QtCamRoiTracker(QObject *parent) :
+  QObject(parent),
+  m_message(0),
+  m_pending(false),
+  m_nextId(0),
+  m_primaryId(-1),
+  m_publishedPrimary(-1),
+  m_timer(new QTimer(this)) {
+
+  qRegisterMetaType<QList<QRectF> >("QList<QRectF>");
+
+  m_timer->setInterval(PREDICTION_INTERVAL);
+  QObject::connect(m_timer, SIGNAL(timeout()), this, SLOT(predict()));
+
+  m_clock.start();
+}
+
+QtCamRoiTracker::~QtCamRoiTracker() {
+  if (m_message) {
+    gst_message_unref(m_message);
+    m_message = 0;
+  }
+}
+
+void QtCamRoiTracker::post(GstMessage *message) {
+  gst_message_ref(message);
+
+  QMutexLocker locker(&m_mutex);
+
+  if (m_message) {
+    gst_message_unref(m_message);
+  }
+
+  m_message = message;
+
+  if (!m_pending) {
+    m_pending = true;
+    QMetaObject::invokeMethod(this, "processMessage", Qt::QueuedConnection);
+  }
+}
+
+void QtCamRoiTracker::reset() {
+  m_mutex.lock();
+  if (m_message) {
+    gst_message_unref(m_message);
+    m_message = 0;
+  }
+  m_mutex.unlock();
+
+  m_timer->stop();
+  m_tracks.clear();
+  m_primaryId = -1;
+  m_published.clear();
+  m_publishedPrimary = -1;
+}
+
+void QtCamRoiTracker::stop() {
+  m_timer->stop();
+}
+
+void QtCamRoiTracker::processMessage() {
+  m_mutex.lock();
+  GstMessage *message = m_message;
+  m_message = 0;
+  m_pending = false;
+  m_mutex.unlock();
+
+  if (!message) {
+    return;
+  }
+
+  QList<QRectF> rects;
+  bool ok = parse(message, rects);
+  gst_message_unref(message);
+
+  if (!ok) {
+    return;
+  }
+
+  qint64 now = m_clock.elapsed();
+
+  update(rects, now);
+  publish(now);
+
+  if (m_tracks.isEmpty()) {
+    m_timer->stop();
+  }
+  else if (!m_timer->isActive()) {
+    m_timer->start();
+  }
+}
+
+void QtCamRoiTracker::predict() {
+  qint64 now = m_clock.elapsed();
+
+  for (int x = m_tracks.size() - 1; x >= 0; x--) {
+    if (now - m_tracks[x].updated > TRACK_TIMEOUT) {
+      m_tracks.removeAt(x);
+    }
+  }
+
+  publish(now);
+
+  if (m_tracks.isEmpty()) {
+    m_timer->stop();
+  }
+}
+
+bool QtCamRoiTracker::parse(GstMessage *message, QList<QRectF>& rects) {
+  unsigned width = 0, height = 0;
+
+  const GstStructure *s = gst_message_get_structure(message);
+  if (!gst_structure_get_uint(s, "frame-width", &width) ||
+      !gst_structure_get_uint(s, "frame-height", &height) ||
+      width == 0 || height == 0) {
+
+    qWarning() << "Failed to obtain frame dimensions for ROI message";
+    return false;
+  }
+
+  const GValue *regions = gst_structure_get_value(s, "regions");
+  if (!regions) {
+    qWarning() << "No regions in ROI message";
+    return false;
+  }
+
+  guint size = gst_value_list_get_size(regions);
+  for (unsigned i = 0; i < size; i++) {
+    const GValue *region = gst_value_list_get_value(regions, i);
+    const GstStructure *structure = gst_value_get_structure(region);
+
+    unsigned x = 0, y = 0, w = 0, h = 0;
+
+    gst_structure_get_uint(structure, "region-x", &x);
+    gst_structure_get_uint(structure, "region-y", &y);
+    gst_structure_get_uint(structure, "region-w", &w);
+    gst_structure_get_uint(structure, "region-h", &h);
+
+    rects << QRectF((qreal)x/width, (qreal)y/height, (qreal)w/width, (qreal)h/height);
+  }
+
+  return true;
+}
+
+void QtCamRoiTracker::update(const QList<QRectF>& rects, qint64 now) {
+  for (int x = m_tracks.size() - 1; x >= 0; x--) {
+    if (now - m_tracks[x].updated > TRACK_TIMEOUT) {
+      m_tracks.removeAt(x);
+    }
+  }
+
+  // Greedy nearest neighbour between predicted tracks and detections.
+  QVector<QtCamRoiTrackerMatch> matches;
+  for (int t = 0; t < m_tracks.size(); t++) {
+    QPointF predicted = m_tracks[t].rect(now).center();
+
+    for (int r = 0; r < rects.size(); r++) {
+      qreal distance = squaredDistance(rects[r].center(), predicted);
+      if (distance < TRACK_GATE * TRACK_GATE) {
+	QtCamRoiTrackerMatch match;
+	match.distance = distance;
+	match.track = t;
+	match.rect = r;
+	matches << match;
+      }
+    }
+  }
+
+  std::sort(matches.begin(), matches.end());
+
+  QVector<bool> trackMatched(m_tracks.size(), false);
+  QVector<bool> rectMatched(rects.size(), false);
+
+  foreach (const QtCamRoiTrackerMatch& match, matches) {
+    if (trackMatched[match.track] || rectMatched[match.rect]) {
+      continue;
+    }
+
+    trackMatched[match.track] = true;
+    rectMatched[match.rect] = true;
+
+    Track& track = m_tracks[match.track];
+    const QRectF& rect = rects[match.rect];
+
+    qreal dt = qMax<qint64>(1, now - track.updated);
+    qreal px = track.cx + track.vx * dt;
+    qreal py = track.cy + track.vy * dt;
+    qreal rx = rect.center().x() - px;
+    qreal ry = rect.center().y() - py;
+
+    track.cx = px + FILTER_ALPHA * rx;
+    track.cy = py + FILTER_ALPHA * ry;
+    track.vx += FILTER_BETA * rx / dt;
+    track.vy += FILTER_BETA * ry / dt;
+    track.w += FILTER_ALPHA * (rect.width() - track.w);
+    track.h += FILTER_ALPHA * (rect.height() - track.h);
+    track.updated = now;
+  }
+
+  // New ids are always bigger so the list stays sorted by id.
+  for (int r = 0; r < rects.size(); r++) {
+    if (rectMatched[r]) {
+      continue;
+    }
+
+    Track track;
+    track.id = m_nextId++;
+    track.cx = rects[r].center().x();
+    track.cy = rects[r].center().y();
+    track.w = rects[r].width();
+    track.h = rects[r].height();
+    track.vx = track.vy = 0;
+    track.updated = now;
+    m_tracks << track;
+  }
+}
+
+void QtCamRoiTracker::publish(qint64 now) {
+  QList<QRectF> rects;
+  int primary = -1;
+
+  for (int x = 0; x < m_tracks.size(); x++) {
+    rects << m_tracks[x].rect(now);
+
+    if (m_tracks[x].id == m_primaryId) {
+      primary = x;
+    }
+  }
+
+  if (primary == -1) {
+    // Our primary region is gone. Pick the one closest to the center.
+    QPointF center(0.5, 0.5);
+    qreal distance = 0;
+
+    for (int x = 0; x < rects.size(); x++) {
+      qreal newDistance = squaredDistance(rects[x].center(), center);
+      if (primary == -1 || newDistance < distance) {
+	primary = x;
+	distance = newDistance;
+      }
+    }
+
+    m_primaryId = primary == -1 ? -1 : m_tracks[primary].id;
+  }
+
+  if (!hasChanged(rects, primary)) {
+    return;
+  }
+
+  m_published = rects;
+  m_publishedPrimary = primary;
+
+  QList<QRectF> rest(rects);
+  QRectF primaryRect = primary == -1 ? QRectF() : rest.takeAt(primary);
+
+  emit regionsChanged(rects, primaryRect, rest);
+}
+
+bool QtCamRoiTracker::hasChanged(const QList<QRectF>& rects, int primary) const {
+  if (rects.size() != m_published.size() || primary != m_publishedPrimary) {
+    return true;
+  }
+
+  for (int x = 0; x < rects.size(); x++) {
+    const QRectF& a = rects[x];
+    const QRectF& b = m_published[x];
+
+    if (qAbs(a.left() - b.left()) > CHANGE_THRESHOLD ||
+	qAbs(a.top() - b.top()) > CHANGE_THRESHOLD ||
+	qAbs(a.right() - b.right()) > CHANGE_THRESHOLD ||
+	qAbs(a.bottom() - b.bottom()) > CHANGE_THRESHOLD) {
+      return true;
+    }
+  }
+
+  return false;
+}
@@ -0,0 +1,93 @@
+// -*- c++ -*-
+
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef QT_CAM_ROI_TRACKER_H
+#define QT_CAM_ROI_TRACKER_H
+
+#include <QObject>
+#include <QList>
+#include <QRectF>
+#include <QMutex>
+#include <QElapsedTimer>
+#include <gst/gst.h>
+
+class QTimer;
+
+// Turns regions-of-interest messages into a stable set of tracked regions.
+// Meant to live in its own thread. post() can be called from any thread.
+class QtCamRoiTracker : public QObject {
+  Q_OBJECT
+
+public:
+  QtCamRoiTracker(QObject *parent = 0);
+  ~QtCamRoiTracker();
+
+  // Only the latest message is kept if we are slower than the source.
+  void post(GstMessage *message);
+
+public slots:
+  void reset();
+  void stop();
+
+signals:
+  // Regions are sorted by track id so a region keeps its position in the list
+  // for as long as it is tracked.
+  void regionsChanged(const QList<QRectF>& regions,
+		      const QRectF& primary,
+		      const QList<QRectF>& rest);
+
+private slots:
+  void processMessage();
+  void predict();
+
+private:
+  class Track {
+  public:
+    int id;
+    qreal cx, cy, w, h;
+    qreal vx, vy;
+    qint64 updated;
+
+    QRectF rect(qint64 now) const;
+  };
+
+  bool parse(GstMessage *message, QList<QRectF>& rects);
+  void update(const QList<QRectF>& rects, qint64 now);
+  void publish(qint64 now);
+  bool hasChanged(const QList<QRectF>& rects, int primary) const;
+
+  QMutex m_mutex;
+  GstMessage *m_message;
+  bool m_pending;
+
+  QList<Track> m_tracks;
+  int m_nextId;
+  int m_primaryId;
+
+  QList<QRectF> m_published;
+  int m_publishedPrimary;
+
+  QElapsedTimer m_clock;
+  QTimer *m_timer;
+};
+
+#endif /* QT_CAM_ROI_TRACKER_H */
@@ -0,0 +1,149 @@
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "qtcamsharpness.h"
+#include "qtcamlumaplane.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+// Energy of one line. Needs the next line for the vertical differences.
+static quint64 lineEnergy(const uchar *line, const uchar *below, int width) {
+  quint64 sum = 0;
+  int x = 0;
+
+#if defined(__SSE2__)
+  // 32 bit lanes are flushed every line so they cannot overflow for sane widths.
+  __m128i zero = _mm_setzero_si128();
+  __m128i acc = zero;
+
+  for (; x + 17 <= width; x += 16) {
+    __m128i a = _mm_loadu_si128((const __m128i *)(line + x));
+    __m128i r = _mm_loadu_si128((const __m128i *)(line + x + 1));
+    __m128i b = _mm_loadu_si128((const __m128i *)(below + x));
+
+    __m128i aLo = _mm_unpacklo_epi8(a, zero);
+    __m128i aHi = _mm_unpackhi_epi8(a, zero);
+
+    __m128i dxLo = _mm_sub_epi16(_mm_unpacklo_epi8(r, zero), aLo);
+    __m128i dxHi = _mm_sub_epi16(_mm_unpackhi_epi8(r, zero), aHi);
+    __m128i dyLo = _mm_sub_epi16(_mm_unpacklo_epi8(b, zero), aLo);
+    __m128i dyHi = _mm_sub_epi16(_mm_unpackhi_epi8(b, zero), aHi);
+
+    acc = _mm_add_epi32(acc, _mm_madd_epi16(dxLo, dxLo));
+    acc = _mm_add_epi32(acc, _mm_madd_epi16(dxHi, dxHi));
+    acc = _mm_add_epi32(acc, _mm_madd_epi16(dyLo, dyLo));
+    acc = _mm_add_epi32(acc, _mm_madd_epi16(dyHi, dyHi));
+  }
+
+  quint32 lanes[4];
+  _mm_storeu_si128((__m128i *)lanes, acc);
+  sum = (quint64)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#elif defined(__ARM_NEON__)
+  uint32x4_t acc = vdupq_n_u32(0);
+
+  for (; x + 9 <= width; x += 8) {
+    uint8x8_t a = vld1_u8(line + x);
+    uint8x8_t r = vld1_u8(line + x + 1);
+    uint8x8_t b = vld1_u8(below + x);
+
+    int16x8_t dx = vreinterpretq_s16_u16(vsubl_u8(r, a));
+    int16x8_t dy = vreinterpretq_s16_u16(vsubl_u8(b, a));
+
+    int32x4_t s = vmull_s16(vget_low_s16(dx), vget_low_s16(dx));
+    s = vmlal_s16(s, vget_high_s16(dx), vget_high_s16(dx));
+    s = vmlal_s16(s, vget_low_s16(dy), vget_low_s16(dy));
+    s = vmlal_s16(s, vget_high_s16(dy), vget_high_s16(dy));
+
+    acc = vaddq_u32(acc, vreinterpretq_u32_s32(s));
+  }
+
+  quint32 lanes[4];
+  vst1q_u32(lanes, acc);
+  sum = (quint64)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#endif
+
+  for (; x + 1 < width; x++) {
+    int dx = line[x + 1] - line[x];
+    int dy = below[x] - line[x];
+    sum += dx * dx + dy * dy;
+  }
+
+  return sum;
+}
+
+quint64 QtCamSharpness::gradientEnergy(const uchar *data, int width, int height, int stride) {
+  quint64 sum = 0;
+
+  for (int y = 0; y + 1 < height; y++) {
+    sum += lineEnergy(data + y * stride, data + (y + 1) * stride, width);
+  }
+
+  return sum;
+}
+
+void QtCamSharpness::gradientMagnitude(const uchar *line, const uchar *below,
+				       uchar *out, int width) {
+  int x = 0;
+
+#if defined(__SSE2__)
+  for (; x + 17 <= width; x += 16) {
+    __m128i a = _mm_loadu_si128((const __m128i *)(line + x));
+    __m128i r = _mm_loadu_si128((const __m128i *)(line + x + 1));
+    __m128i b = _mm_loadu_si128((const __m128i *)(below + x));
+
+    // Unsigned absolute difference: one of the two saturated differences is 0.
+    __m128i dx = _mm_or_si128(_mm_subs_epu8(r, a), _mm_subs_epu8(a, r));
+    __m128i dy = _mm_or_si128(_mm_subs_epu8(b, a), _mm_subs_epu8(a, b));
+
+    _mm_storeu_si128((__m128i *)(out + x), _mm_adds_epu8(dx, dy));
+  }
+#elif defined(__ARM_NEON__)
+  for (; x + 17 <= width; x += 16) {
+    uint8x16_t a = vld1q_u8(line + x);
+    uint8x16_t r = vld1q_u8(line + x + 1);
+    uint8x16_t b = vld1q_u8(below + x);
+
+    vst1q_u8(out + x, vqaddq_u8(vabdq_u8(r, a), vabdq_u8(b, a)));
+  }
+#endif
+
+  for (; x + 1 < width; x++) {
+    int m = qAbs(line[x + 1] - line[x]) + qAbs(below[x] - line[x]);
+    out[x] = m > 255 ? 255 : m;
+  }
+
+  if (width > 0) {
+    out[width - 1] = 0;
+  }
+}
+
+double QtCamSharpness::measure(const QtCamLumaPlane& plane) {
+  if (plane.width() < 2 || plane.height() < 2) {
+    return 0.0;
+  }
+
+  quint64 energy = gradientEnergy(plane.data(), plane.width(), plane.height(), plane.width());
+
+  return (double)energy / ((plane.width() - 1) * (plane.height() - 1));
+}
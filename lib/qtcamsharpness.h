@@ -0,0 +1,43 @@
+// -*- c++ -*-
+
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef QT_CAM_SHARPNESS_H
+#define QT_CAM_SHARPNESS_H
+
+#include <QtGlobal>
+
+class QtCamLumaPlane;
+
+class QtCamSharpness {
+public:
+  // Mean squared gradient (a Tenengrad variant using forward differences).
+  // Only meaningful when comparing planes of the same size and content.
+  static double measure(const QtCamLumaPlane& plane);
+
+  // Sum of squared horizontal and vertical forward differences.
+  static quint64 gradientEnergy(const uchar *data, int width, int height, int stride);
+
+  // Saturated |dx| + |dy| of one line into out. The last column is 0.
+  static void gradientMagnitude(const uchar *line, const uchar *below, uchar *out, int width);
+};
+
+#endif /* QT_CAM_SHARPNESS_H */
@@ -0,0 +1,312 @@
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "qtcamtimelapse.h"
+#include "qtcamconfig.h"
+#include "qtcamgstsample.h"
+#include "qtcammode_p.h"
+#include <QFile>
+#include <QDebug>
+#include <cstring>
+
+#define DEFAULT_INTERVAL         5000
+#define DEFAULT_FRAME_RATE       25
+// The encoder finalizing the file
+#define EOS_TIMEOUT              (10 * GST_SECOND)
+
+QtCamTimeLapse::QtCamTimeLapse(QObject *parent) :
+  QObject(parent),
+  m_pipeline(0),
+  m_src(0),
+  m_caps(0),
+  m_format(GST_VIDEO_FORMAT_UNKNOWN),
+  m_next(0),
+  m_interval(DEFAULT_INTERVAL),
+  m_frameRate(DEFAULT_FRAME_RATE),
+  m_frames(0),
+  m_error(false) {
+
+}
+
+QtCamTimeLapse::~QtCamTimeLapse() {
+  stop();
+}
+
+int QtCamTimeLapse::interval() {
+  QMutexLocker locker(&m_mutex);
+
+  return m_interval;
+}
+
+void QtCamTimeLapse::setInterval(int interval) {
+  QMutexLocker locker(&m_mutex);
+
+  m_interval = qMax(100, interval);
+}
+
+int QtCamTimeLapse::frameRate() {
+  QMutexLocker locker(&m_mutex);
+
+  return m_frameRate;
+}
+
+void QtCamTimeLapse::setFrameRate(int frameRate) {
+  QMutexLocker locker(&m_mutex);
+
+  // Timestamps are computed from it while recording.
+  if (!m_pipeline) {
+    m_frameRate = qBound(1, frameRate, 60);
+  }
+}
+
+bool QtCamTimeLapse::isRecording() {
+  QMutexLocker locker(&m_mutex);
+
+  return m_pipeline != 0;
+}
+
+int QtCamTimeLapse::frames() {
+  QMutexLocker locker(&m_mutex);
+
+  return m_frames;
+}
+
+bool QtCamTimeLapse::start(QtCamConfig *config, const QString& fileName) {
+  if (isRecording()) {
+    qWarning() << "Time-lapse already recording";
+    return false;
+  }
+
+  QString path = config->videoEncodingProfilePath();
+  QString name = config->videoEncodingProfileName();
+
+  if (!QFileInfo(path).isAbsolute()) {
+    path = config->lookUp(path);
+  }
+
+  GstEncodingProfile *profile = QtCamModePrivate::cachedProfile(path, name);
+  if (!profile) {
+    return false;
+  }
+
+  GstElement *pipeline = gst_pipeline_new("time-lapse");
+  GstElement *src = gst_element_factory_make("appsrc", "time-lapse-src");
+  GstElement *encoder = gst_element_factory_make("encodebin", "time-lapse-encoder");
+  GstElement *sink = gst_element_factory_make("filesink", "time-lapse-sink");
+
+  if (!pipeline || !src || !encoder || !sink) {
+    qCritical() << "Failed to create time-lapse elements";
+
+    if (pipeline) gst_object_unref(pipeline);
+    if (src) gst_object_unref(src);
+    if (encoder) gst_object_unref(encoder);
+    if (sink) gst_object_unref(sink);
+
+    gst_encoding_profile_unref(profile);
+    return false;
+  }
+
+  // Frames are far apart so there is nothing to gain from queueing more than a few.
+  g_object_set(src, "format", GST_FORMAT_TIME, "is-live", FALSE, "block", FALSE,
+	       "max-bytes", (guint64)(16 * 1024 * 1024), NULL);
+  g_object_set(encoder, "profile", profile, NULL);
+  gst_encoding_profile_unref(profile);
+  g_object_set(sink, "location", fileName.toUtf8().constData(), NULL);
+
+  gst_bin_add_many(GST_BIN(pipeline), src, encoder, sink, NULL);
+
+#if GST_CHECK_VERSION(1,0,0)
+  GstPad *pad = gst_element_get_request_pad(encoder, "video_%u");
+#else
+  GstPad *pad = gst_element_get_request_pad(encoder, "video_%d");
+#endif
+  GstPad *srcPad = gst_element_get_static_pad(src, "src");
+
+  bool linked = pad && srcPad && GST_PAD_LINK_SUCCESSFUL(gst_pad_link(srcPad, pad)) &&
+    gst_element_link(encoder, sink);
+
+  if (srcPad) {
+    gst_object_unref(srcPad);
+  }
+
+  if (pad) {
+    gst_object_unref(pad);
+  }
+
+  if (!linked) {
+    qCritical() << "Failed to link time-lapse pipeline";
+    gst_object_unref(pipeline);
+    return false;
+  }
+
+  if (gst_element_set_state(pipeline, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
+    qCritical() << "Failed to start time-lapse pipeline";
+    gst_element_set_state(pipeline, GST_STATE_NULL);
+    gst_object_unref(pipeline);
+    return false;
+  }
+
+  QMutexLocker locker(&m_mutex);
+  m_pipeline = pipeline;
+  m_src = src;
+  m_fileName = fileName;
+  m_frames = 0;
+  m_error = false;
+  m_timer.invalidate();
+
+  return true;
+}
+
+void QtCamTimeLapse::stop() {
+  m_mutex.lock();
+
+  if (!m_pipeline) {
+    m_mutex.unlock();
+    return;
+  }
+
+  GstElement *pipeline = m_pipeline;
+  GstElement *src = m_src;
+  QString fileName = m_fileName;
+  int frames = m_frames;
+  bool error = m_error;
+
+  // handleSample() will not touch the pipeline anymore.
+  m_pipeline = 0;
+  m_src = 0;
+
+  if (m_caps) {
+    gst_caps_unref(m_caps);
+    m_caps = 0;
+  }
+
+  m_mutex.unlock();
+
+  if (frames > 0 && !error) {
+    GstFlowReturn ret;
+    g_signal_emit_by_name(src, "end-of-stream", &ret);
+
+    GstBus *bus = gst_element_get_bus(pipeline);
+    GstMessage *message =
+      gst_bus_timed_pop_filtered(bus, EOS_TIMEOUT,
+				 (GstMessageType)(GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+    if (!message) {
+      qWarning() << "Timed out finalizing time-lapse" << fileName;
+      error = true;
+    }
+    else {
+      if (GST_MESSAGE_TYPE(message) == GST_MESSAGE_ERROR) {
+	GError *err = NULL;
+	gst_message_parse_error(message, &err, NULL);
+	qWarning() << "Time-lapse encoding failed" << err->message;
+	g_error_free(err);
+	error = true;
+      }
+
+      gst_message_unref(message);
+    }
+
+    gst_object_unref(bus);
+  }
+
+  gst_element_set_state(pipeline, GST_STATE_NULL);
+  gst_object_unref(pipeline);
+
+  if (frames == 0 || error) {
+    QFile::remove(fileName);
+    emit failed();
+  }
+  else {
+    emit finished(fileName);
+  }
+}
+
+void QtCamTimeLapse::handleSample(const QtCamGstSample *sample) {
+  QMutexLocker locker(&m_mutex);
+
+  if (!m_pipeline || m_error) {
+    return;
+  }
+
+  if (m_timer.isValid() && m_timer.elapsed() < m_next) {
+    return;
+  }
+
+  if (!m_timer.isValid()) {
+    m_timer.start();
+    m_next = 0;
+  }
+
+  // Keep the schedule even if a frame comes late.
+  while (m_next <= m_timer.elapsed()) {
+    m_next += m_interval;
+  }
+
+  if (!m_caps) {
+    // Same format but played back at our rate.
+    m_caps = gst_caps_copy(sample->caps());
+    gst_caps_set_simple(m_caps, "framerate", GST_TYPE_FRACTION, m_frameRate, 1, NULL);
+    g_object_set(m_src, "caps", m_caps, NULL);
+
+    m_size = QSize(sample->width(), sample->height());
+    m_format = sample->format();
+  }
+  else if (m_size != QSize(sample->width(), sample->height()) ||
+	   m_format != sample->format()) {
+    // The viewfinder changed under us. The encoder cannot follow.
+    return;
+  }
+
+  // A copy so the viewfinder buffer goes back to the source right away.
+#if GST_CHECK_VERSION(1,0,0)
+  GstMapInfo map;
+  if (!gst_buffer_map(sample->buffer(), &map, GST_MAP_READ)) {
+    return;
+  }
+
+  GstBuffer *buffer = gst_buffer_new_allocate(NULL, map.size, NULL);
+  gst_buffer_fill(buffer, 0, map.data, map.size);
+  gst_buffer_unmap(sample->buffer(), &map);
+
+  GST_BUFFER_PTS(buffer) = gst_util_uint64_scale(m_frames, GST_SECOND, m_frameRate);
+#else
+  GstBuffer *buffer = gst_buffer_new_and_alloc(GST_BUFFER_SIZE(sample->buffer()));
+  memcpy(GST_BUFFER_DATA(buffer), GST_BUFFER_DATA(sample->buffer()),
+	 GST_BUFFER_SIZE(sample->buffer()));
+
+  GST_BUFFER_TIMESTAMP(buffer) = gst_util_uint64_scale(m_frames, GST_SECOND, m_frameRate);
+#endif
+  GST_BUFFER_DURATION(buffer) = gst_util_uint64_scale(1, GST_SECOND, m_frameRate);
+
+  GstFlowReturn ret = GST_FLOW_OK;
+  g_signal_emit_by_name(m_src, "push-buffer", buffer, &ret);
+  gst_buffer_unref(buffer);
+
+  if (ret != GST_FLOW_OK) {
+    qWarning() << "Failed to push time-lapse frame" << ret;
+    m_error = true;
+    return;
+  }
+
+  ++m_frames;
+
+  emit frameRecorded(m_frames);
+}
@@ -0,0 +1,85 @@
+// -*- c++ -*-
+
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef QT_CAM_TIME_LAPSE_H
+#define QT_CAM_TIME_LAPSE_H
+
+#include <QObject>
+#include <QMutex>
+#include <QElapsedTimer>
+#include <QSize>
+#include <gst/gst.h>
+#include <gst/video/video.h>
+#include "qtcamviewfinderbufferhandler.h"
+
+class QtCamConfig;
+
+// Records a time-lapse from the viewfinder. One frame every interval is copied
+// out of the viewfinder and pushed into a separate appsrc ! encodebin ! filesink
+// pipeline with timestamps at the output frame rate. The encoder uses the video
+// encoding profile of the configuration and only runs when a frame is pushed.
+class QtCamTimeLapse : public QObject, public QtCamViewfinderBufferHandler {
+  Q_OBJECT
+
+public:
+  QtCamTimeLapse(QObject *parent = 0);
+  ~QtCamTimeLapse();
+
+  // Milliseconds between kept frames
+  int interval();
+  void setInterval(int interval);
+
+  // Frame rate of the recorded video
+  int frameRate();
+  void setFrameRate(int frameRate);
+
+  bool isRecording();
+  int frames();
+
+  bool start(QtCamConfig *config, const QString& fileName);
+  // Blocks until the file has been finalized.
+  void stop();
+
+  void handleSample(const QtCamGstSample *sample);
+
+signals:
+  void frameRecorded(int frames);
+  void finished(const QString& fileName);
+  void failed();
+
+private:
+  QMutex m_mutex;
+  GstElement *m_pipeline;
+  GstElement *m_src;
+  GstCaps *m_caps;
+  QSize m_size;
+  GstVideoFormat m_format;
+  QString m_fileName;
+  QElapsedTimer m_timer;
+  qint64 m_next;
+  int m_interval;
+  int m_frameRate;
+  int m_frames;
+  bool m_error;
+};
+
+#endif /* QT_CAM_TIME_LAPSE_H */
@@ -0,0 +1,281 @@
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "qtcamvideofileoutput.h"
+#include "qtcamfilewriter.h"
+#include <QDebug>
+
+QtCamVideoFileOutput::QtCamVideoFileOutput(int bufferSize) :
+  m_writer(new QtCamFileWriter(bufferSize)),
+  m_sink(0),
+  m_pad(0),
+  m_probe(0),
+  m_bytesPerSecond(0),
+  m_offset(0),
+  m_state(Idle) {
+
+}
+
+QtCamVideoFileOutput::~QtCamVideoFileOutput() {
+  detach();
+
+  delete m_writer;
+  m_writer = 0;
+}
+
+bool QtCamVideoFileOutput::attach(GstElement *sink, qint64 bytesPerSecond) {
+  detach();
+
+  GstPad *pad = gst_element_get_static_pad(sink, "sink");
+  if (!pad) {
+    return false;
+  }
+
+  QMutexLocker locker(&m_mutex);
+
+  m_sink = GST_ELEMENT(gst_object_ref(sink));
+  m_pad = pad;
+  m_bytesPerSecond = bytesPerSecond;
+  m_offset = 0;
+  m_state = Idle;
+
+#if GST_CHECK_VERSION(1,0,0)
+  m_probe = gst_pad_add_probe(m_pad, (GstPadProbeType)(GST_PAD_PROBE_TYPE_BUFFER |
+						       GST_PAD_PROBE_TYPE_BUFFER_LIST |
+						       GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM),
+			      gst1_data_probe, this, NULL);
+#else
+  m_probe = gst_pad_add_data_probe(m_pad, G_CALLBACK(data_probe), this);
+#endif
+
+  return true;
+}
+
+void QtCamVideoFileOutput::detach() {
+  QMutexLocker locker(&m_mutex);
+
+  if (!m_pad) {
+    return;
+  }
+
+#if GST_CHECK_VERSION(1,0,0)
+  gst_pad_remove_probe(m_pad, m_probe);
+#else
+  gst_pad_remove_data_probe(m_pad, m_probe);
+#endif
+
+  gst_object_unref(m_pad);
+  m_pad = 0;
+  m_probe = 0;
+
+  gst_object_unref(m_sink);
+  m_sink = 0;
+
+  // We did not see EOS. Whatever we have is better than nothing.
+  if (m_writer->isOpen()) {
+    m_writer->close();
+  }
+
+  m_state = Idle;
+}
+
+bool QtCamVideoFileOutput::isAttached() {
+  QMutexLocker locker(&m_mutex);
+
+  return m_pad != 0;
+}
+
+#if GST_CHECK_VERSION(1,0,0)
+GstPadProbeReturn QtCamVideoFileOutput::gst1_data_probe(GstPad *pad, GstPadProbeInfo *info,
+							gpointer user_data) {
+  Q_UNUSED(pad);
+
+  QtCamVideoFileOutput *output = (QtCamVideoFileOutput *) user_data;
+  bool pass = true;
+
+  if (info->type & GST_PAD_PROBE_TYPE_BUFFER) {
+    pass = output->handleBuffer(GST_PAD_PROBE_INFO_BUFFER(info));
+  } else if (info->type & GST_PAD_PROBE_TYPE_BUFFER_LIST) {
+    GstBufferList *list = GST_PAD_PROBE_INFO_BUFFER_LIST(info);
+
+    // Only the first buffer decides whether we take over.
+    if (gst_buffer_list_length(list) > 0) {
+      pass = output->handleBuffer(gst_buffer_list_get(list, 0));
+      if (!pass) {
+	QMutexLocker locker(&output->m_mutex);
+	gst_buffer_list_foreach(list, write_list_buffer, output);
+      }
+    }
+  } else if (info->type & GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM) {
+    pass = output->handleEvent(GST_PAD_PROBE_INFO_EVENT(info));
+  }
+
+  return pass ? GST_PAD_PROBE_OK : GST_PAD_PROBE_DROP;
+}
+
+gboolean QtCamVideoFileOutput::write_list_buffer(GstBuffer **buffer, guint idx,
+						 gpointer user_data) {
+  QtCamVideoFileOutput *output = (QtCamVideoFileOutput *) user_data;
+
+  // handleBuffer() took care of the first one.
+  if (idx == 0) {
+    return TRUE;
+  }
+
+  return output->write(*buffer) ? TRUE : FALSE;
+}
+#else
+gboolean QtCamVideoFileOutput::data_probe(GstPad *pad, GstMiniObject *mini_obj,
+					  gpointer user_data) {
+  Q_UNUSED(pad);
+
+  QtCamVideoFileOutput *output = (QtCamVideoFileOutput *) user_data;
+
+  if (GST_IS_BUFFER(mini_obj)) {
+    return output->handleBuffer(GST_BUFFER(mini_obj)) ? TRUE : FALSE;
+  } else if (GST_IS_EVENT(mini_obj)) {
+    return output->handleEvent(GST_EVENT(mini_obj)) ? TRUE : FALSE;
+  }
+
+  return TRUE;
+}
+#endif
+
+bool QtCamVideoFileOutput::handleBuffer(GstBuffer *buffer) {
+  QMutexLocker locker(&m_mutex);
+
+  if (m_state == Idle) {
+    m_state = open() ? Writing : PassThrough;
+  }
+
+  if (m_state != Writing) {
+    // PassThrough lets the sink write. Done drops anything after a failure.
+    return m_state == PassThrough;
+  }
+
+  write(buffer);
+
+  return false;
+}
+
+bool QtCamVideoFileOutput::handleEvent(GstEvent *event) {
+  QMutexLocker locker(&m_mutex);
+
+  switch (GST_EVENT_TYPE(event)) {
+#if GST_CHECK_VERSION(1,0,0)
+  case GST_EVENT_SEGMENT: {
+    const GstSegment *segment = 0;
+    gst_event_parse_segment(event, &segment);
+    if (segment->format == GST_FORMAT_BYTES) {
+      // Muxers seek back like this to rewrite headers.
+      m_offset = segment->start;
+    }
+  }
+    break;
+#else
+  case GST_EVENT_NEWSEGMENT: {
+    GstFormat format;
+    gint64 start;
+    gst_event_parse_new_segment(event, NULL, NULL, &format, &start, NULL, NULL);
+    if (format == GST_FORMAT_BYTES) {
+      // Muxers seek back like this to rewrite headers.
+      m_offset = start;
+    }
+  }
+    break;
+#endif
+
+  case GST_EVENT_EOS:
+    if (m_state == Writing) {
+      // Trim the preallocation before the sink lets everyone know we are done.
+      if (!m_writer->close()) {
+	error();
+      }
+
+      m_state = Done;
+    }
+
+    break;
+
+  default:
+    break;
+  }
+
+  return true;
+}
+
+bool QtCamVideoFileOutput::open() {
+  gchar *location = NULL;
+  g_object_get(m_sink, "location", &location, NULL);
+  if (!location) {
+    qWarning() << "Video file sink has no location";
+    return false;
+  }
+
+  QString fileName = QString::fromUtf8(location);
+  g_free(location);
+
+  // The sink has already created the file. We must not truncate it.
+  if (!m_writer->open(fileName, m_bytesPerSecond)) {
+    qWarning() << "Failed to open" << fileName << "for writing. Letting the sink write it";
+    return false;
+  }
+
+  return true;
+}
+
+bool QtCamVideoFileOutput::write(GstBuffer *buffer) {
+  if (m_state != Writing) {
+    return false;
+  }
+
+#if GST_CHECK_VERSION(1,0,0)
+  GstMapInfo info;
+  if (!gst_buffer_map(buffer, &info, GST_MAP_READ)) {
+    qWarning() << "Failed to map buffer";
+    error();
+    return false;
+  }
+
+  bool ok = m_writer->write(m_offset, (const char *)info.data, info.size);
+  m_offset += info.size;
+
+  gst_buffer_unmap(buffer, &info);
+#else
+  bool ok = m_writer->write(m_offset, (const char *)GST_BUFFER_DATA(buffer),
+			    GST_BUFFER_SIZE(buffer));
+  m_offset += GST_BUFFER_SIZE(buffer);
+#endif
+
+  if (!ok) {
+    error();
+  }
+
+  return ok;
+}
+
+void QtCamVideoFileOutput::error() {
+  m_state = Done;
+
+  m_writer->close();
+
+  GST_ELEMENT_ERROR(m_sink, RESOURCE, WRITE, ("Error while writing to file."), (NULL));
+}
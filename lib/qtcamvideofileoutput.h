@@ -0,0 +1,78 @@
+// -*- c++ -*-
+
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#ifndef QT_CAM_VIDEO_FILE_OUTPUT_H
+#define QT_CAM_VIDEO_FILE_OUTPUT_H
+
+#include <QMutex>
+#include <gst/gst.h>
+
+class QtCamFileWriter;
+
+// Takes over the writing from the video file sink of camerabin. The data
+// the muxer pushes is dropped before it reaches the sink and goes through
+// a QtCamFileWriter instead. The sink still gets the events so it posts
+// EOS as usual. The file is trimmed before EOS reaches the sink.
+class QtCamVideoFileOutput {
+public:
+  QtCamVideoFileOutput(int bufferSize);
+  ~QtCamVideoFileOutput();
+
+  bool attach(GstElement *sink, qint64 bytesPerSecond);
+  void detach();
+
+  bool isAttached();
+
+private:
+  typedef enum {
+    Idle,
+    Writing,
+    PassThrough,
+    Done
+  } State;
+
+#if GST_CHECK_VERSION(1,0,0)
+  static GstPadProbeReturn gst1_data_probe(GstPad *pad, GstPadProbeInfo *info,
+					   gpointer user_data);
+  static gboolean write_list_buffer(GstBuffer **buffer, guint idx, gpointer user_data);
+#else
+  static gboolean data_probe(GstPad *pad, GstMiniObject *mini_obj, gpointer user_data);
+#endif
+
+  bool handleBuffer(GstBuffer *buffer);
+  bool handleEvent(GstEvent *event);
+  bool open();
+  bool write(GstBuffer *buffer);
+  void error();
+
+  QtCamFileWriter *m_writer;
+  GstElement *m_sink;
+  GstPad *m_pad;
+  gulong m_probe;
+  qint64 m_bytesPerSecond;
+  qint64 m_offset;
+  State m_state;
+  QMutex m_mutex;
+};
+
+#endif /* QT_CAM_VIDEO_FILE_OUTPUT_H */
@@ -26,8 +26,20 @@
 #include "qtcamdevice.h"
 #include "qtcamvideosettings.h"
 #include "qtcamnotifications.h"
+#include "qtcamvideopreroll.h"
+#include "qtcamvideosnapshot.h"
+#include "qtcamaudiolevel.h"
+#include "qtcamrecordingmonitor.h"
+#include "qtcamvideofileoutput.h"
+#include "qtcambitrategovernor.h"
 #include <QMutex>
 #include <QWaitCondition>
+#include <QFile>
+#include <QFileInfo>
+
+#define PRE_ROLL_DEFAULT_MAX_SIZE             (32 * 1024 * 1024)
+#define DEFAULT_VIDEO_BYTE_RATE               (2 * 1024 * 1024)
+#define AUDIO_BYTE_RATE                       (32 * 1024)
 
 class StreamRewriter {
 public:
@@ -180,15 +192,26 @@ QtCamVideoModePrivate::QtCamVideoModePrivate(QtCamDevicePrivate *dev) :
   QtCamModePrivate(dev),
   resolution(QtCamResolution(QtCamResolution::ModeVideo)),
   audio(0),
-  video(0) {
+  video(0),
+  preRoll(0),
+  preRollDuration(0),
+  preRollArmed(false),
+  discardRecording(false),
+  snapshot(0),
+  audioLevel(0),
+  monitor(0),
+  fileOutput(0),
+  governor(0) {
 
   }
 
 QtCamVideoModePrivate::~QtCamVideoModePrivate() {
+  delete preRoll; preRoll = 0;
+  delete snapshot; snapshot = 0;
+  delete fileOutput; fileOutput = 0;
 }
 
-StreamRewriter *QtCamVideoModePrivate::createRewriter(const char *prop,
-						      const char *name, bool copy) {
+GstPad *QtCamVideoModePrivate::sourcePad(const char *prop, const char *name) {
   GstPad *pad = NULL;
   GstElement *elem = NULL;
 
@@ -206,6 +229,29 @@ StreamRewriter *QtCamVideoModePrivate::createRewriter(const char *prop,
 
   gst_object_unref(elem);
 
+  return pad;
+}
+
+GstPad *QtCamVideoModePrivate::sourcePeer(const char *prop, const char *name) {
+  GstPad *pad = sourcePad(prop, name);
+  if (!pad) {
+    return NULL;
+  }
+
+  GstPad *peer = gst_pad_get_peer(pad);
+  if (!peer) {
+    qWarning() << "Pad" << name << "of element" << prop << "is not linked";
+  }
+
+  gst_object_unref(pad);
+
+  return peer;
+}
+
+StreamRewriter *QtCamVideoModePrivate::createRewriter(const char *prop,
+						      const char *name, bool copy) {
+  GstPad *pad = sourcePad(prop, name);
+
   if (pad) {
     return new StreamRewriter(pad, copy);
   }
@@ -236,19 +282,60 @@ void QtCamVideoModePrivate::clearRewriters() {
 }
 
 void QtCamVideoModePrivate::_d_idleStateChanged(bool isIdle) {
+  if (isIdle && preRollArmed) {
+    // Pre-roll has just been armed. Nothing was recorded.
+    return;
+  }
+
+  if (isIdle && snapshot) {
+    snapshot->detach();
+  }
+
+  if (isIdle) {
+    audioLevel->detach();
+    stopMonitor();
+
+    if (fileOutput) {
+      fileOutput->detach();
+    }
+  }
+
   if (isIdle && dev->active == dev->video) {
     QMetaObject::invokeMethod(dev->video, "recordingStateChanged");
     QMetaObject::invokeMethod(dev->video, "canCaptureChanged");
+
+    // The recording which consumed the pre-roll is done. Start buffering again.
+    if (preRoll) {
+      preRoll->detach();
+    }
+
+    armPreRoll();
   }
 }
 
+void QtCamVideoModePrivate::_d_started() {
+  applyBitrate();
+  armPreRoll();
+}
+
+void QtCamVideoModePrivate::_d_bitrateChanged() {
+  applyBitrate();
+}
+
 class VideoDoneHandler : public DoneHandler {
 public:
-  VideoDoneHandler(QtCamModePrivate *d, QObject *parent = 0) :
-    DoneHandler(d, "video-done", parent), m_done(false) {}
+  VideoDoneHandler(QtCamVideoModePrivate *d, QObject *parent = 0) :
+    DoneHandler(d, "video-done", parent), m_video(d), m_done(false) {}
 
   virtual void handleMessage(GstMessage *message) {
-    DoneHandler::handleMessage(message);
+    if (m_video->discardRecording) {
+      // Pre-roll was torn down without anything being recorded.
+      QFile::remove(m_video->preRollFileName);
+      m_video->discardRecording = false;
+    } else {
+      DoneHandler::handleMessage(message);
+    }
+
     wake();
   }
 
@@ -280,18 +367,305 @@ private:
     unlock();
   }
 
+  QtCamVideoModePrivate *m_video;
   bool m_done;
   QMutex m_mutex;
   QWaitCondition m_cond;
 };
 
+void QtCamVideoModePrivate::stopCapture(bool sync) {
+  VideoDoneHandler *handler = dynamic_cast<VideoDoneHandler *>(doneHandler);
+  if (sync) {
+    handler->lock();
+
+    if (handler->isDone()) {
+      handler->unlock();
+      return;
+    }
+  }
+
+  g_signal_emit_by_name(dev->cameraBin, "stop-capture", NULL);
+
+  if (sync) {
+    // TODO: this can block forever
+    handler->wait();
+    handler->unlock();
+  }
+}
+
+void QtCamVideoModePrivate::armPreRoll() {
+  if (preRollDuration <= 0 || preRollArmed || preRollFileName.isEmpty()) {
+    return;
+  }
+
+  if (dev->active != dev->video || dev->error ||
+      !dev->q_ptr->isRunning() || !dev->isCameraBinIdle()) {
+    return;
+  }
+
+  GstElement *muxer = dev->findByClass("Muxer");
+  if (!muxer) {
+    qWarning() << "Cannot find video muxer. Pre-roll is not available";
+    return;
+  }
+
+  if (!preRoll) {
+    qint64 maxSize = dev->conf->videoPreRollMaxSize();
+    preRoll = new QtCamVideoPreRoll(preRollDuration * GST_SECOND,
+				    maxSize > 0 ? maxSize : PRE_ROLL_DEFAULT_MAX_SIZE);
+  }
+
+  bool attached = preRoll->attach(muxer);
+  gst_object_unref(muxer);
+
+  if (!attached) {
+    qWarning() << "Failed to attach pre-roll to the video muxer";
+    return;
+  }
+
+  setFileName(QString());
+  setTempFileName(QString());
+
+  // Set before starting so the idle notification already sees us as idle.
+  preRollArmed = true;
+
+  // The video branch runs from now on. The muxer does not get any data until
+  // recording is requested.
+  g_object_set(dev->cameraBin, "location", preRollFileName.toUtf8().data(), NULL);
+  g_signal_emit_by_name(dev->cameraBin, "start-capture", NULL);
+
+  VideoDoneHandler *handler = dynamic_cast<VideoDoneHandler *>(doneHandler);
+  handler->reset();
+}
+
+void QtCamVideoModePrivate::disarmPreRoll(bool sync) {
+  if (!preRollArmed) {
+    return;
+  }
+
+  preRollArmed = false;
+  discardRecording = true;
+
+  stopCapture(sync);
+
+  preRoll->detach();
+}
+
+bool QtCamVideoModePrivate::attachSnapshot() {
+  // We probe the peer because the pause rewriter chains its own buffers
+  // to it and drops the originals on GStreamer 0.10.
+  return snapshot->attach(sourcePeer("camera-source", "vidsrc"));
+}
+
+void QtCamVideoModePrivate::attachAudioLevel() {
+  GstPad *pad = sourcePad("audio-source", "src");
+  if (pad) {
+    audioLevel->attach(pad);
+  }
+}
+
+void QtCamVideoModePrivate::startMonitor() {
+  int fps = inNightMode() ? resolution.nightFrameRate() : resolution.frameRate();
+
+  monitor->start(fps > 0 ? GST_SECOND / fps : GST_CLOCK_TIME_NONE);
+
+  // Peers for the same reason as the snapshots. It also keeps time spent
+  // paused out of the audio timestamps.
+  monitor->addPad(QtCamRecordingMonitor::VideoSource, sourcePeer("camera-source", "vidsrc"));
+  monitor->addPad(QtCamRecordingMonitor::AudioSource, sourcePeer("audio-source", "src"));
+
+  GstElement *encoder = dev->findByClass("Encoder/Video");
+  if (encoder) {
+    monitor->addPad(QtCamRecordingMonitor::VideoEncoder,
+		    gst_element_get_static_pad(encoder, "sink"));
+    gst_object_unref(encoder);
+  }
+
+  GstElement *muxer = dev->findByClass("Muxer");
+  if (muxer) {
+    monitor->addMuxer(muxer);
+
+    // The queues in front of the encoders live in the same bin as the muxer.
+    GstObject *bin = gst_object_get_parent(GST_OBJECT(muxer));
+    if (bin) {
+      monitor->addQueues(GST_ELEMENT(bin));
+      gst_object_unref(bin);
+    }
+
+    gst_object_unref(muxer);
+  }
+}
+
+void QtCamVideoModePrivate::stopMonitor() {
+  if (!monitor->isRunning()) {
+    return;
+  }
+
+  monitor->stop();
+
+  if (dev->conf->recordingStats() && !fileName.isEmpty()) {
+    monitor->writeSummary(fileName + ".stats");
+  }
+}
+
+// Encoders do not agree on the name or the unit of their bitrate property.
+static GParamSpec *bitrateProperty(GstElement *encoder) {
+  GObjectClass *klass = G_OBJECT_GET_CLASS(encoder);
+
+  GParamSpec *pspec = g_object_class_find_property(klass, "target-bitrate");
+  if (!pspec) {
+    pspec = g_object_class_find_property(klass, "bitrate");
+  }
+
+  return pspec;
+}
+
+static qint64 encoderProperty(GstElement *encoder, GParamSpec *pspec) {
+  qint64 value = 0;
+
+  GValue val = { 0, };
+  g_value_init(&val, G_PARAM_SPEC_VALUE_TYPE(pspec));
+  g_object_get_property(G_OBJECT(encoder), pspec->name, &val);
+
+  GValue res = { 0, };
+  g_value_init(&res, G_TYPE_INT64);
+  if (g_value_transform(&val, &res)) {
+    value = g_value_get_int64(&res);
+  }
+
+  g_value_unset(&res);
+  g_value_unset(&val);
+
+  return value;
+}
+
+static qint64 encoderBitrate(GstElement *encoder, int scale) {
+  GParamSpec *pspec = bitrateProperty(encoder);
+  if (!pspec) {
+    return 0;
+  }
+
+  return encoderProperty(encoder, pspec) * scale;
+}
+
+static bool setEncoderBitrate(GstElement *encoder, qint64 bitrate, int scale) {
+  GParamSpec *pspec = bitrateProperty(encoder);
+  if (!pspec) {
+    return false;
+  }
+
+  GValue val = { 0, };
+  g_value_init(&val, G_TYPE_INT64);
+  g_value_set_int64(&val, bitrate / scale);
+
+  GValue res = { 0, };
+  g_value_init(&res, G_PARAM_SPEC_VALUE_TYPE(pspec));
+
+  bool ok = g_value_transform(&val, &res) == TRUE;
+  if (ok) {
+    g_object_set_property(G_OBJECT(encoder), pspec->name, &res);
+  }
+
+  g_value_unset(&res);
+  g_value_unset(&val);
+
+  return ok;
+}
+
+qint64 QtCamVideoModePrivate::videoByteRate() {
+  GstElement *encoder = dev->findByClass("Encoder/Video");
+  if (!encoder) {
+    return DEFAULT_VIDEO_BYTE_RATE;
+  }
+
+  qint64 bitRate = encoderBitrate(encoder, dev->conf->bitrateGovernorBitrateScale());
+
+  gst_object_unref(encoder);
+
+  // Leave room for audio and the container.
+  return bitRate > 0 ? bitRate / 8 + AUDIO_BYTE_RATE : DEFAULT_VIDEO_BYTE_RATE;
+}
+
+void QtCamVideoModePrivate::attachFileOutput() {
+  int bufferSize = dev->conf->videoOutputBufferSize();
+  if (bufferSize <= 0) {
+    return;
+  }
+
+  GstElement *sink = gst_bin_get_by_name(GST_BIN(dev->cameraBin), "videobin-filesink");
+  if (!sink) {
+    qWarning() << "Cannot find video file sink. Letting the muxer write directly";
+    return;
+  }
+
+  if (!fileOutput) {
+    fileOutput = new QtCamVideoFileOutput(bufferSize);
+  }
+
+  if (!fileOutput->attach(sink, videoByteRate())) {
+    qWarning() << "Failed to attach to the video file sink";
+  }
+
+  gst_object_unref(sink);
+}
+
+void QtCamVideoModePrivate::applyBitrate() {
+  int bitrate = governor->bitrate();
+  if (bitrate <= 0) {
+    // No ceiling configured. The encoder keeps what properties.ini gave it.
+    return;
+  }
+
+  GstElement *encoder = dev->findByClass("Encoder/Video");
+  if (!encoder) {
+    return;
+  }
+
+  int scale = dev->conf->bitrateGovernorBitrateScale();
+
+  // Encoders pick the new value up the next time they are configured.
+  if (bitrate != encoderBitrate(encoder, scale)) {
+    if (!setEncoderBitrate(encoder, bitrate, scale)) {
+      qWarning() << "Failed to set encoder bitrate to" << bitrate;
+    }
+  }
+
+  gst_object_unref(encoder);
+}
+
 QtCamVideoMode::QtCamVideoMode(QtCamDevicePrivate *dev, QObject *parent) :
   QtCamMode(new QtCamVideoModePrivate(dev), "mode-video", parent) {
 
-  d_ptr->init(new VideoDoneHandler(d_ptr, this));
-
   d = (QtCamVideoModePrivate *)QtCamMode::d_ptr;
 
+  d_ptr->init(new VideoDoneHandler(d, this));
+
+  d->audioLevel = new QtCamAudioLevel(this);
+  QObject::connect(d->audioLevel, SIGNAL(levelsChanged()), this, SIGNAL(audioLevelsChanged()));
+
+  d->monitor = new QtCamRecordingMonitor(this);
+  QObject::connect(d->monitor, SIGNAL(statsChanged()), this, SIGNAL(recordingStatsChanged()));
+
+  QtCamConfig *conf = d_ptr->dev->conf;
+  d->governor = new QtCamBitrateGovernor(this);
+  d->governor->setThermalZone(conf->bitrateGovernorThermalZone());
+  if (conf->bitrateGovernorWarmTemperature() > 0 && conf->bitrateGovernorHotTemperature() > 0) {
+    d->governor->setThermalLimits(conf->bitrateGovernorWarmTemperature(),
+				  conf->bitrateGovernorHotTemperature());
+  }
+
+  if (conf->bitrateGovernorMinimumBitrate() > 0) {
+    d->governor->setMinimumBitrate(conf->bitrateGovernorMinimumBitrate());
+  }
+
+  // The ceiling does not depend on whatever the encoder was last set to.
+  d->governor->setNominalBitrate(conf->bitrateGovernorMaximumBitrate());
+
+  QObject::connect(d->governor, SIGNAL(bitrateChanged()), d, SLOT(_d_bitrateChanged()));
+  QObject::connect(d->governor, SIGNAL(bitrateChanged()), this, SIGNAL(bitrateGovernorChanged()));
+  QObject::connect(d->governor, SIGNAL(remainingTimeChanged()),
+		   this, SIGNAL(bitrateGovernorChanged()));
+
   QString name = d_ptr->dev->conf->videoEncodingProfileName();
   QString path = d_ptr->dev->conf->videoEncodingProfilePath();
 
@@ -304,6 +678,8 @@ QtCamVideoMode::QtCamVideoMode(QtCamDevicePrivate *dev, QObject *parent) :
 
   QObject::connect(d_ptr->dev->q_ptr, SIGNAL(idleStateChanged(bool)),
 		   d, SLOT(_d_idleStateChanged(bool)));
+  QObject::connect(d_ptr->dev->q_ptr, SIGNAL(started()),
+		   d, SLOT(_d_started()));
 }
 
 QtCamVideoMode::~QtCamVideoMode() {
@@ -336,12 +712,29 @@ void QtCamVideoMode::applySettings() {
 
 void QtCamVideoMode::start() {
   d_ptr->disableViewfinderFilters();
+
+  d->governor->start();
 }
 
 void QtCamVideoMode::stop() {
   if (isRecording()) {
     stopRecording(true);
+  } else {
+    d->disarmPreRoll(true);
+  }
+
+  if (d->snapshot) {
+    d->snapshot->detach();
+  }
+
+  d->audioLevel->detach();
+  d->stopMonitor();
+
+  if (d->fileOutput) {
+    d->fileOutput->detach();
   }
+
+  d->governor->stop();
 }
 
 bool QtCamVideoMode::isRecording() {
@@ -369,6 +762,31 @@ bool QtCamVideoMode::startRecording(const QString& fileName, const QString& tmpF
     return false;
   }
 
+  if (d->preRollArmed) {
+    // We are already capturing to the pre-roll file. Just let the data reach the muxer.
+    d->preRollArmed = false;
+
+    d_ptr->setFileName(fileName);
+    d_ptr->setTempFileName(d->preRollFileName);
+
+    d->attachFileOutput();
+    d->preRoll->flush();
+
+    d->attachAudioLevel();
+    d->startMonitor();
+
+    QMetaObject::invokeMethod(d_ptr->dev->notifications, "videoRecordingStarted");
+
+    // camerabin was busy all along so it will not tell anyone.
+    QMetaObject::invokeMethod(d_ptr->dev->q_ptr, "idleStateChanged", Q_ARG(bool, false));
+
+    emit recordingStateChanged();
+
+    emit canCaptureChanged();
+
+    return true;
+  }
+
   d_ptr->setFileName(fileName);
   d_ptr->setTempFileName(tmpFileName);
 
@@ -376,12 +794,24 @@ bool QtCamVideoMode::startRecording(const QString& fileName, const QString& tmpF
 
   QMetaObject::invokeMethod(d_ptr->dev->notifications, "videoRecordingStarted");
 
+  if (d->governor->storagePath().isEmpty()) {
+    d->governor->setStoragePath(QFileInfo(file).absolutePath());
+  }
+
+  d->governor->update();
+  d->applyBitrate();
+
+  d->attachFileOutput();
+
   g_object_set(d_ptr->dev->cameraBin, "location", file.toUtf8().data(), NULL);
   g_signal_emit_by_name(d_ptr->dev->cameraBin, "start-capture", NULL);
 
   VideoDoneHandler *handler = dynamic_cast<VideoDoneHandler *>(d_ptr->doneHandler);
   handler->reset();
 
+  d->attachAudioLevel();
+  d->startMonitor();
+
   emit recordingStateChanged();
 
   emit canCaptureChanged();
@@ -393,24 +823,7 @@ void QtCamVideoMode::stopRecording(bool sync) {
   pauseRecording(false);
 
   if (isRecording()) {
-    VideoDoneHandler *handler = dynamic_cast<VideoDoneHandler *>(d_ptr->doneHandler);
-    if (sync) {
-      handler->lock();
-
-      if (handler->isDone()) {
-	handler->unlock();
-	d->clearRewriters();
-	return;
-      }
-    }
-
-    g_signal_emit_by_name(d_ptr->dev->cameraBin, "stop-capture", NULL);
-
-    if (sync) {
-      // TODO: this can block forever
-      handler->wait();
-      handler->unlock();
-    }
+    d->stopCapture(sync);
   }
 
   d->clearRewriters();
@@ -432,6 +845,7 @@ void QtCamVideoMode::pauseRecording(bool pause) {
   } else {
     d->audio->unblock();
     d->video->unblock();
+    d->monitor->resync();
   }
 
   emit pauseStateChanged();
@@ -452,8 +866,16 @@ bool QtCamVideoMode::setResolution(const QtCamResolution& resolution) {
     return false;
   }
 
+  // Do not renegotiate under a capturing pre-roll.
+  d->disarmPreRoll(true);
+
   applySettings();
 
+  // The encoder might have been configured again from properties.ini.
+  d->applyBitrate();
+
+  d->armPreRoll();
+
   return true;
 }
 
@@ -468,3 +890,109 @@ QtCamResolution QtCamVideoMode::currentResolution() {
 void QtCamVideoMode::enablePreview() {
   d_ptr->setPreviewSize(d->resolution.previewResolution());
 }
+
+bool QtCamVideoMode::enablePreRoll(int seconds, const QString& tmpFileName) {
+  if (seconds <= 0 || tmpFileName.isEmpty()) {
+    return false;
+  }
+
+  if (isRecording()) {
+    return false;
+  }
+
+  d->disarmPreRoll(true);
+
+  delete d->preRoll;
+  d->preRoll = 0;
+
+  d->preRollDuration = seconds;
+  d->preRollFileName = tmpFileName;
+
+  d->armPreRoll();
+
+  return true;
+}
+
+void QtCamVideoMode::disablePreRoll() {
+  d->disarmPreRoll(true);
+
+  delete d->preRoll;
+  d->preRoll = 0;
+
+  d->preRollDuration = 0;
+  d->preRollFileName.clear();
+}
+
+bool QtCamVideoMode::snapshot(const QString& fileName) {
+  if (fileName.isEmpty() || !isRecording() || isPaused()) {
+    return false;
+  }
+
+  if (!d->snapshot) {
+    d->snapshot = new QtCamVideoSnapshot;
+    QObject::connect(d->snapshot, SIGNAL(saved(const QString&)),
+		     this, SIGNAL(saved(const QString&)), Qt::QueuedConnection);
+    QObject::connect(d->snapshot, SIGNAL(failed(const QString&)),
+		     this, SIGNAL(snapshotFailed(const QString&)), Qt::QueuedConnection);
+  }
+
+  if (!d->snapshot->isAttached() && !d->attachSnapshot()) {
+    return false;
+  }
+
+  // The same EXIF the captured images get from the muxer.
+  QList<QByteArray> metadata;
+  if (GST_IS_TAG_SETTER(d->dev->cameraBin)) {
+    QByteArray exif =
+      QtCamVideoSnapshot::exifSegment(gst_tag_setter_get_tag_list(GST_TAG_SETTER(d->dev->cameraBin)));
+    if (!exif.isEmpty()) {
+      metadata << exif;
+    }
+  }
+
+  d->snapshot->capture(fileName, metadata);
+
+  return true;
+}
+
+bool QtCamVideoMode::isPreRollEnabled() {
+  return d->preRollDuration > 0;
+}
+
+QList<qreal> QtCamVideoMode::audioPeakLevels() {
+  return d->audioLevel->peak();
+}
+
+QList<qreal> QtCamVideoMode::audioRmsLevels() {
+  return d->audioLevel->rms();
+}
+
+void QtCamVideoMode::setAudioLevelInterval(int msecs) {
+  d->audioLevel->setInterval(msecs);
+}
+
+QtCamRecordingStats QtCamVideoMode::recordingStats() {
+  return d->monitor->stats();
+}
+
+void QtCamVideoMode::setStoragePath(const QString& path) {
+  d->governor->setStoragePath(path);
+  d->governor->update();
+}
+
+void QtCamVideoMode::setBatteryState(int percentage, bool charging) {
+  d->governor->setBatteryState(percentage, charging);
+  d->governor->update();
+}
+
+int QtCamVideoMode::videoBitrate() {
+  return d->governor->bitrate();
+}
+
+qint64 QtCamVideoMode::remainingRecordingTime() {
+  return d->governor->remainingTime();
+}
+
+bool QtCamVideoMode::isLowerResolutionSuggested() {
+  return d->governor->isLowerResolutionSuggested();
+}
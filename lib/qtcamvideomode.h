@@ -29,9 +29,11 @@ class QtCamDevicePrivate;
 class QtCamVideoModePrivate;
 class QtCamResolution;
 class QtCamVideoSettings;
+class QtCamRecordingStats;
 
 class QtCamVideoMode : public QtCamMode {
   Q_OBJECT
+  friend class QtCamDevice;
 
 public:
   QtCamVideoMode(QtCamDevicePrivate *dev, QObject *parent = 0);
@@ -53,6 +55,31 @@ public:
 
   void enablePreview();
 
+  bool enablePreRoll(int seconds, const QString& tmpFileName);
+  void disablePreRoll();
+  bool isPreRollEnabled();
+
+  bool snapshot(const QString& fileName);
+
+  // Levels of the recorded audio per channel in the 0 to 1 range.
+  QList<qreal> audioPeakLevels();
+  QList<qreal> audioRmsLevels();
+  void setAudioLevelInterval(int msecs);
+
+  // Frame drops, A/V drift and queue fill of the current or last recording.
+  QtCamRecordingStats recordingStats();
+
+  // Inputs of the bitrate governor. The storage path defaults to the
+  // directory of the first recording.
+  void setStoragePath(const QString& path);
+  void setBatteryState(int percentage, bool charging);
+
+  // Encoder bitrate picked by the governor in bits per second.
+  int videoBitrate();
+  // Seconds left at that bitrate or -1 if not known.
+  qint64 remainingRecordingTime();
+  bool isLowerResolutionSuggested();
+
 public slots:
   void stopRecording(bool sync);
   void pauseRecording(bool pause);
@@ -60,6 +87,10 @@ public slots:
 signals:
   void recordingStateChanged();
   void pauseStateChanged();
+  void snapshotFailed(const QString& fileName);
+  void audioLevelsChanged();
+  void recordingStatsChanged();
+  void bitrateGovernorChanged();
 
 protected:
   virtual void start();
@@ -27,6 +27,12 @@
 #include "qtcammode_p.h"
 
 class StreamRewriter;
+class QtCamVideoPreRoll;
+class QtCamVideoSnapshot;
+class QtCamAudioLevel;
+class QtCamRecordingMonitor;
+class QtCamVideoFileOutput;
+class QtCamBitrateGovernor;
 
 class QtCamVideoModePrivate : public QObject, public QtCamModePrivate {
   Q_OBJECT
@@ -35,16 +41,48 @@ public:
   QtCamVideoModePrivate(QtCamDevicePrivate *dev);
   ~QtCamVideoModePrivate();
 
+  GstPad *sourcePad(const char *prop, const char *name);
+  GstPad *sourcePeer(const char *prop, const char *name);
   StreamRewriter *createRewriter(const char *prop, const char *name, bool copy);
   void createRewriters();
   void clearRewriters();
 
+  void stopCapture(bool sync);
+
+  void armPreRoll();
+  void disarmPreRoll(bool sync);
+
+  bool attachSnapshot();
+  void attachAudioLevel();
+
+  void startMonitor();
+  void stopMonitor();
+
+  qint64 videoByteRate();
+  void attachFileOutput();
+
+  void applyBitrate();
+
   QtCamResolution resolution;
   StreamRewriter *audio;
   StreamRewriter *video;
 
+  QtCamVideoPreRoll *preRoll;
+  QString preRollFileName;
+  int preRollDuration;
+  bool preRollArmed;
+  bool discardRecording;
+
+  QtCamVideoSnapshot *snapshot;
+  QtCamAudioLevel *audioLevel;
+  QtCamRecordingMonitor *monitor;
+  QtCamVideoFileOutput *fileOutput;
+  QtCamBitrateGovernor *governor;
+
 public slots:
   void _d_idleStateChanged(bool isIdle);
+  void _d_started();
+  void _d_bitrateChanged();
 };
 
 #endif /* QT_CAM_VIDEO_MODE_P_H */
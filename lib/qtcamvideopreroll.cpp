@@ -0,0 +1,358 @@
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "qtcamvideopreroll.h"
+#include <QDebug>
+
+static GstClockTime bufferTimestamp(GstBuffer *buffer) {
+#if GST_CHECK_VERSION(1,0,0)
+  if (GST_CLOCK_TIME_IS_VALID(GST_BUFFER_DTS(buffer))) {
+    return GST_BUFFER_DTS(buffer);
+  }
+
+  return GST_BUFFER_PTS(buffer);
+#else
+  return GST_BUFFER_TIMESTAMP(buffer);
+#endif
+}
+
+static qint64 bufferSize(GstBuffer *buffer) {
+#if GST_CHECK_VERSION(1,0,0)
+  return gst_buffer_get_size(buffer);
+#else
+  return GST_BUFFER_SIZE(buffer);
+#endif
+}
+
+static bool isKeyFrame(GstBuffer *buffer) {
+  return !GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+}
+
+class QtCamVideoPreRollStream {
+public:
+  QtCamVideoPreRollStream(QtCamVideoPreRoll *preRoll, GstPad *sinkPad) :
+    d(preRoll),
+    pad(sinkPad),
+    flushed(false) {
+
+    video = g_str_has_prefix(GST_PAD_NAME(pad), "video") == TRUE;
+
+#if GST_CHECK_VERSION(1,0,0)
+    probe = gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, gst1_buffer_probe, this, NULL);
+#else
+    probe = gst_pad_add_buffer_probe(pad, G_CALLBACK(buffer_probe), this);
+#endif
+  }
+
+  ~QtCamVideoPreRollStream() {
+#if GST_CHECK_VERSION(1,0,0)
+    gst_pad_remove_probe(pad, probe);
+#else
+    gst_pad_remove_buffer_probe(pad, probe);
+#endif
+    gst_object_unref(pad);
+
+    clear();
+  }
+
+  void clear() {
+    while (!buffers.isEmpty()) {
+      gst_buffer_unref(buffers.takeFirst());
+    }
+  }
+
+  QtCamVideoPreRoll *d;
+  GstPad *pad;
+  gulong probe;
+  bool video;
+  bool flushed;
+  QList<GstBuffer *> buffers;
+
+private:
+#if GST_CHECK_VERSION(1,0,0)
+  static GstPadProbeReturn gst1_buffer_probe(GstPad *pad, GstPadProbeInfo *info,
+					     gpointer user_data) {
+    Q_UNUSED(pad);
+
+    if (_buffer_probe((GstBuffer *)info->data, user_data)) {
+      return GST_PAD_PROBE_PASS;
+    }
+
+    return GST_PAD_PROBE_DROP;
+  }
+#else
+  static gboolean buffer_probe(GstPad *pad, GstMiniObject *mini_obj, gpointer user_data) {
+    Q_UNUSED(pad);
+
+    return _buffer_probe(GST_BUFFER(mini_obj), user_data) ? TRUE : FALSE;
+  }
+#endif
+
+  static bool _buffer_probe(GstBuffer *buffer, gpointer user_data) {
+    QtCamVideoPreRollStream *stream = (QtCamVideoPreRollStream *) user_data;
+    QtCamVideoPreRoll *d = stream->d;
+
+    d->m_mutex.lock();
+
+    if (!d->m_flushed) {
+      // Either kept in the ring or discarded. It never reaches the muxer.
+      d->queue(stream, buffer);
+      d->m_mutex.unlock();
+      return false;
+    }
+
+    if (stream->flushed) {
+      d->m_mutex.unlock();
+      return true;
+    }
+
+    // First buffer after flush(): push what we have before the live buffer.
+    QList<GstBuffer *> pending(stream->buffers);
+    stream->buffers.clear();
+    stream->flushed = true;
+
+    foreach (GstBuffer *b, pending) {
+      d->m_size -= bufferSize(b);
+    }
+
+    // We cannot hold the mutex while chaining. The muxer might block this thread
+    // waiting for data on the other pad which in turn needs the mutex.
+    d->m_mutex.unlock();
+
+    while (!pending.isEmpty()) {
+      // The probe will be called again for each buffer but will pass it this time.
+      // gst_pad_chain() takes ownership of the buffer.
+      if (gst_pad_chain(stream->pad, pending.takeFirst()) != GST_FLOW_OK) {
+	qWarning() << "Failed to push pre-roll buffers to the muxer";
+
+	while (!pending.isEmpty()) {
+	  gst_buffer_unref(pending.takeFirst());
+	}
+      }
+    }
+
+    return true;
+  }
+};
+
+QtCamVideoPreRoll::QtCamVideoPreRoll(GstClockTime duration, qint64 maxBytes) :
+  m_duration(duration),
+  m_maxBytes(maxBytes),
+  m_size(0),
+  m_flushed(false) {
+
+}
+
+QtCamVideoPreRoll::~QtCamVideoPreRoll() {
+  detach();
+}
+
+bool QtCamVideoPreRoll::attach(GstElement *muxer) {
+  detach();
+
+  GstIterator *iter = gst_element_iterate_sink_pads(muxer);
+  if (!iter) {
+    return false;
+  }
+
+  bool done = false;
+
+  GstPad *pad = 0;
+
+#if GST_CHECK_VERSION(1,0,0)
+  GValue val = G_VALUE_INIT;
+#endif
+
+  while (!done) {
+#if GST_CHECK_VERSION(1,0,0)
+    switch (gst_iterator_next(iter, &val)) {
+#else
+    switch (gst_iterator_next(iter, (gpointer *)&pad)) {
+#endif
+    case GST_ITERATOR_OK:
+#if GST_CHECK_VERSION(1,0,0)
+      pad = (GstPad *)g_value_dup_object(&val);
+      g_value_reset(&val);
+#endif
+      // The stream takes over the pad reference.
+      m_streams << new QtCamVideoPreRollStream(this, pad);
+      break;
+
+    case GST_ITERATOR_RESYNC:
+      gst_iterator_resync(iter);
+      break;
+
+    case GST_ITERATOR_ERROR:
+    case GST_ITERATOR_DONE:
+      done = true;
+      break;
+    }
+  }
+
+#if GST_CHECK_VERSION(1,0,0)
+  g_value_unset(&val);
+#endif
+
+  gst_iterator_free(iter);
+
+  return !m_streams.isEmpty();
+}
+
+void QtCamVideoPreRoll::detach() {
+  QMutexLocker locker(&m_mutex);
+
+  qDeleteAll(m_streams);
+  m_streams.clear();
+
+  m_size = 0;
+  m_flushed = false;
+}
+
+void QtCamVideoPreRoll::flush() {
+  QMutexLocker locker(&m_mutex);
+
+  m_flushed = true;
+
+  // Audio that predates the first video frame would make the muxer start with a gap.
+  foreach (QtCamVideoPreRollStream *stream, m_streams) {
+    if (stream->video) {
+      dropAudioBefore(stream->buffers.isEmpty() ?
+		      GST_CLOCK_TIME_NONE : bufferTimestamp(stream->buffers.first()));
+      break;
+    }
+  }
+}
+
+bool QtCamVideoPreRoll::isFlushed() {
+  QMutexLocker locker(&m_mutex);
+
+  return m_flushed;
+}
+
+qint64 QtCamVideoPreRoll::size() {
+  QMutexLocker locker(&m_mutex);
+
+  return m_size;
+}
+
+bool QtCamVideoPreRoll::queue(QtCamVideoPreRollStream *stream, GstBuffer *buffer) {
+  // We must be able to start decoding from the first buffer we keep
+  if (stream->video && stream->buffers.isEmpty() && !isKeyFrame(buffer)) {
+    return false;
+  }
+
+  // TODO: encoders which allocate from a small pool will stall if we keep too many
+  // references. None of the encoders we use do that.
+  stream->buffers << gst_buffer_ref(buffer);
+  m_size += bufferSize(buffer);
+
+  trim();
+
+  return true;
+}
+
+void QtCamVideoPreRoll::trim() {
+  QtCamVideoPreRollStream *video = 0;
+
+  foreach (QtCamVideoPreRollStream *stream, m_streams) {
+    if (stream->video) {
+      video = stream;
+      break;
+    }
+  }
+
+  if (!video) {
+    return;
+  }
+
+  while (!video->buffers.isEmpty()) {
+    if (m_size > m_maxBytes) {
+      // Hard limit.
+      dropFirstGop();
+      continue;
+    }
+
+    GstClockTime first = bufferTimestamp(video->buffers.first());
+    GstClockTime last = bufferTimestamp(video->buffers.last());
+
+    if (!GST_CLOCK_TIME_IS_VALID(first) || !GST_CLOCK_TIME_IS_VALID(last) ||
+	last - first <= m_duration) {
+      break;
+    }
+
+    // Only drop if we still have a keyframe to start from afterwards.
+    bool hasNextKeyFrame = false;
+    for (int x = 1; x < video->buffers.size(); x++) {
+      if (isKeyFrame(video->buffers.at(x))) {
+	hasNextKeyFrame = true;
+	break;
+      }
+    }
+
+    if (!hasNextKeyFrame) {
+      break;
+    }
+
+    dropFirstGop();
+  }
+
+  dropAudioBefore(video->buffers.isEmpty() ?
+		  GST_CLOCK_TIME_NONE : bufferTimestamp(video->buffers.first()));
+}
+
+void QtCamVideoPreRoll::dropFirstGop() {
+  foreach (QtCamVideoPreRollStream *stream, m_streams) {
+    if (!stream->video) {
+      continue;
+    }
+
+    if (stream->buffers.isEmpty()) {
+      return;
+    }
+
+    // The keyframe and all the delta units depending on it.
+    do {
+      GstBuffer *buffer = stream->buffers.takeFirst();
+      m_size -= bufferSize(buffer);
+      gst_buffer_unref(buffer);
+    } while (!stream->buffers.isEmpty() && !isKeyFrame(stream->buffers.first()));
+
+    return;
+  }
+}
+
+void QtCamVideoPreRoll::dropAudioBefore(GstClockTime ts) {
+  foreach (QtCamVideoPreRollStream *stream, m_streams) {
+    if (stream->video) {
+      continue;
+    }
+
+    while (!stream->buffers.isEmpty()) {
+      GstBuffer *buffer = stream->buffers.first();
+      if (GST_CLOCK_TIME_IS_VALID(ts) && bufferTimestamp(buffer) >= ts) {
+	break;
+      }
+
+      stream->buffers.takeFirst();
+      m_size -= bufferSize(buffer);
+      gst_buffer_unref(buffer);
+    }
+  }
+}
@@ -0,0 +1,67 @@
+// -*- c++ -*-
+
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef QT_CAM_VIDEO_PRE_ROLL_H
+#define QT_CAM_VIDEO_PRE_ROLL_H
+
+#include <QList>
+#include <QMutex>
+#include <gst/gst.h>
+
+class QtCamVideoPreRollStream;
+
+// Sits between the encoders and the muxer of the video branch and keeps the
+// last few seconds of encoded audio and video in memory instead of letting
+// them reach the muxer. flush() releases the kept buffers into the muxer,
+// starting at a video keyframe, followed by the live stream.
+class QtCamVideoPreRoll {
+public:
+  QtCamVideoPreRoll(GstClockTime duration, qint64 maxBytes);
+  ~QtCamVideoPreRoll();
+
+  bool attach(GstElement *muxer);
+  void detach();
+
+  void flush();
+
+  bool isFlushed();
+
+  qint64 size();
+
+private:
+  friend class QtCamVideoPreRollStream;
+
+  bool queue(QtCamVideoPreRollStream *stream, GstBuffer *buffer);
+  void trim();
+  void dropFirstGop();
+  void dropAudioBefore(GstClockTime ts);
+
+  GstClockTime m_duration;
+  qint64 m_maxBytes;
+  qint64 m_size;
+  bool m_flushed;
+
+  QMutex m_mutex;
+  QList<QtCamVideoPreRollStream *> m_streams;
+};
+
+#endif /* QT_CAM_VIDEO_PRE_ROLL_H */
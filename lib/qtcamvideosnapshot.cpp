@@ -0,0 +1,427 @@
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "qtcamvideosnapshot.h"
+#include "qtcamgstsample.h"
+#include "qtcamjpegencoder.h"
+#include <QRunnable>
+#include <gst/video/video.h>
+#include <gst/tag/tag.h>
+#include <QDebug>
+
+#define JPEG_QUALITY             90
+
+class QtCamVideoSnapshotPlane {
+public:
+  const uchar *data;
+  int stride;
+  int pixelStride;
+  int xShift;
+  int yShift;
+};
+
+class QtCamVideoSnapshotJob : public QRunnable {
+public:
+  QtCamVideoSnapshotJob(QtCamVideoSnapshot *snapshot, QtCamGstSample *sample,
+			const QString& fileName, const QList<QByteArray>& metadata) :
+    m_snapshot(snapshot),
+    m_sample(sample),
+    m_fileName(fileName),
+    m_metadata(metadata) {
+
+  }
+
+  ~QtCamVideoSnapshotJob() {
+    delete m_sample;
+  }
+
+  void run() {
+    QImage image = QtCamVideoSnapshot::toImage(m_sample);
+
+    delete m_sample;
+    m_sample = 0;
+
+    if (image.isNull()) {
+      qWarning() << "Cannot convert video frame for snapshot" << m_fileName;
+      m_snapshot->finish(m_fileName, false);
+      return;
+    }
+
+    if (!QtCamJpegEncoder::save(image, m_fileName, JPEG_QUALITY, m_metadata,
+				&m_snapshot->m_encoderPool)) {
+      qWarning() << "Failed to save snapshot" << m_fileName;
+      m_snapshot->finish(m_fileName, false);
+      return;
+    }
+
+    m_snapshot->finish(m_fileName, true);
+  }
+
+private:
+  QtCamVideoSnapshot *m_snapshot;
+  QtCamGstSample *m_sample;
+  QString m_fileName;
+  QList<QByteArray> m_metadata;
+};
+
+static inline int clamp(int val) {
+  return val < 0 ? 0 : val > 255 ? 255 : val;
+}
+
+static GstBuffer *copyBuffer(GstBuffer *buffer) {
+#if GST_CHECK_VERSION(1,0,0)
+  // gst_buffer_copy() only references the memory which might belong to a small pool.
+  gsize size = gst_buffer_get_size(buffer);
+  GstBuffer *copy = gst_buffer_new_allocate(NULL, size, NULL);
+  if (!copy) {
+    return NULL;
+  }
+
+  GstMapInfo map;
+  if (!gst_buffer_map(copy, &map, GST_MAP_WRITE)) {
+    gst_buffer_unref(copy);
+    return NULL;
+  }
+
+  gsize copied = gst_buffer_extract(buffer, 0, map.data, size);
+  gst_buffer_unmap(copy, &map);
+
+  if (copied != size) {
+    gst_buffer_unref(copy);
+    return NULL;
+  }
+
+  return copy;
+#else
+  return gst_buffer_copy(buffer);
+#endif
+}
+
+QtCamVideoSnapshot::QtCamVideoSnapshot(QObject *parent) :
+  QObject(parent),
+  m_pad(0),
+  m_probe(0) {
+
+  // One frame at a time. The encoders of the recording need the CPU more than we do.
+  m_pool.setMaxThreadCount(1);
+
+  // Helps the job thread with the JPEG bands. It cannot use m_pool which it occupies.
+  m_encoderPool.setMaxThreadCount(1);
+}
+
+QtCamVideoSnapshot::~QtCamVideoSnapshot() {
+  detach();
+
+  m_pool.waitForDone();
+  m_encoderPool.waitForDone();
+}
+
+bool QtCamVideoSnapshot::attach(GstPad *pad) {
+  detach();
+
+  if (!pad) {
+    return false;
+  }
+
+  QMutexLocker locker(&m_mutex);
+
+  m_pad = pad;
+#if GST_CHECK_VERSION(1,0,0)
+  m_probe = gst_pad_add_probe(m_pad, GST_PAD_PROBE_TYPE_BUFFER, gst1_buffer_probe, this, NULL);
+#else
+  m_probe = gst_pad_add_buffer_probe(m_pad, G_CALLBACK(buffer_probe), this);
+#endif
+
+  return true;
+}
+
+void QtCamVideoSnapshot::detach() {
+  QList<QPair<QString, QList<QByteArray> > > pending;
+
+  m_mutex.lock();
+
+  if (m_pad) {
+#if GST_CHECK_VERSION(1,0,0)
+    gst_pad_remove_probe(m_pad, m_probe);
+#else
+    gst_pad_remove_buffer_probe(m_pad, m_probe);
+#endif
+    gst_object_unref(m_pad);
+    m_pad = 0;
+    m_probe = 0;
+  }
+
+  pending = m_pending;
+  m_pending.clear();
+
+  m_mutex.unlock();
+
+  // Recording stopped before another frame arrived.
+  for (int x = 0; x < pending.size(); x++) {
+    emit failed(pending[x].first);
+  }
+}
+
+bool QtCamVideoSnapshot::isAttached() {
+  QMutexLocker locker(&m_mutex);
+
+  return m_pad != 0;
+}
+
+void QtCamVideoSnapshot::capture(const QString& fileName, const QList<QByteArray>& metadata) {
+  QMutexLocker locker(&m_mutex);
+
+  m_pending << qMakePair(fileName, metadata);
+}
+
+QByteArray QtCamVideoSnapshot::exifSegment(const GstTagList *tags) {
+  if (!tags) {
+    return QByteArray();
+  }
+
+  GstBuffer *buffer = gst_tag_list_to_exif_buffer_with_tiff_header(tags);
+  if (!buffer) {
+    return QByteArray();
+  }
+
+#if GST_CHECK_VERSION(1,0,0)
+  GstMapInfo info;
+  if (!gst_buffer_map(buffer, &info, GST_MAP_READ)) {
+    gst_buffer_unref(buffer);
+    return QByteArray();
+  }
+
+  QByteArray tiff((const char *)info.data, info.size);
+  gst_buffer_unmap(buffer, &info);
+#else
+  QByteArray tiff((const char *)GST_BUFFER_DATA(buffer), GST_BUFFER_SIZE(buffer));
+#endif
+
+  gst_buffer_unref(buffer);
+
+  QByteArray payload = QByteArray("Exif\0\0", 6) + tiff;
+  if (payload.size() + 2 > 0xffff) {
+    qWarning() << "EXIF too large for a snapshot";
+    return QByteArray();
+  }
+
+  QByteArray segment;
+  segment.append((char)0xff);
+  segment.append((char)0xe1);
+  segment.append((char)((payload.size() + 2) >> 8));
+  segment.append((char)((payload.size() + 2) & 0xff));
+  segment.append(payload);
+
+  return segment;
+}
+
+#if GST_CHECK_VERSION(1,0,0)
+GstPadProbeReturn QtCamVideoSnapshot::gst1_buffer_probe(GstPad *pad, GstPadProbeInfo *info,
+							gpointer user_data) {
+  if (info->type & GST_PAD_PROBE_TYPE_BUFFER && info->data) {
+    ((QtCamVideoSnapshot *) user_data)->grab(pad, (GstBuffer *)info->data);
+  }
+
+  return GST_PAD_PROBE_PASS;
+}
+#else
+gboolean QtCamVideoSnapshot::buffer_probe(GstPad *pad, GstMiniObject *mini_obj,
+					  gpointer user_data) {
+  ((QtCamVideoSnapshot *) user_data)->grab(pad, GST_BUFFER(mini_obj));
+
+  return TRUE;
+}
+#endif
+
+void QtCamVideoSnapshot::grab(GstPad *pad, GstBuffer *buffer) {
+  QMutexLocker locker(&m_mutex);
+
+  if (m_pending.isEmpty()) {
+    return;
+  }
+
+  QPair<QString, QList<QByteArray> > request = m_pending.takeFirst();
+  QString fileName = request.first;
+
+#if GST_CHECK_VERSION(1,0,0)
+  GstCaps *caps = gst_pad_get_current_caps(pad);
+#else
+  // The pause rewriter pushes buffers without caps.
+  GstCaps *caps = gst_pad_get_negotiated_caps(pad);
+  if (!caps) {
+    caps = gst_buffer_get_caps(buffer);
+  }
+#endif
+
+  if (!caps) {
+    qWarning() << "No caps for video snapshot";
+    locker.unlock();
+    emit failed(fileName);
+    return;
+  }
+
+  // Only a copy of the frame leaves the streaming thread so the recording
+  // never waits for us.
+  GstBuffer *copy = copyBuffer(buffer);
+  if (!copy) {
+    gst_caps_unref(caps);
+    qWarning() << "Failed to copy video frame for snapshot";
+    locker.unlock();
+    emit failed(fileName);
+    return;
+  }
+
+  QtCamGstSample *sample = new QtCamGstSample(copy, caps);
+  gst_buffer_unref(copy);
+  gst_caps_unref(caps);
+
+  m_pool.start(new QtCamVideoSnapshotJob(this, sample, fileName, request.second));
+}
+
+void QtCamVideoSnapshot::finish(const QString& fileName, bool ok) {
+  if (ok) {
+    emit saved(fileName);
+  } else {
+    emit failed(fileName);
+  }
+}
+
+QImage QtCamVideoSnapshot::toImage(QtCamGstSample *sample) {
+  int width = sample->width();
+  int height = sample->height();
+
+  if (width <= 0 || height <= 0) {
+    return QImage();
+  }
+
+  QtCamVideoSnapshotPlane planes[3];
+  bool rgb;
+
+#if GST_CHECK_VERSION(1,0,0)
+  GstVideoInfo info;
+  if (!gst_video_info_from_caps(&info, sample->caps())) {
+    return QImage();
+  }
+
+  if (GST_VIDEO_INFO_N_COMPONENTS(&info) < 3) {
+    return QImage();
+  }
+
+  rgb = GST_VIDEO_INFO_IS_RGB(&info);
+
+  for (int x = 0; x < 3; x++) {
+    if (GST_VIDEO_INFO_COMP_DEPTH(&info, x) != 8) {
+      return QImage();
+    }
+
+    planes[x].data = (const uchar *)GST_VIDEO_INFO_COMP_OFFSET(&info, x);
+    planes[x].stride = GST_VIDEO_INFO_COMP_STRIDE(&info, x);
+    planes[x].pixelStride = GST_VIDEO_INFO_COMP_PSTRIDE(&info, x);
+    planes[x].xShift = info.finfo->w_sub[x];
+    planes[x].yShift = info.finfo->h_sub[x];
+  }
+#else
+  GstVideoFormat format = sample->format();
+  if (format == GST_VIDEO_FORMAT_UNKNOWN || gst_video_format_is_gray(format)) {
+    return QImage();
+  }
+
+  rgb = gst_video_format_is_rgb(format);
+
+  for (int x = 0; x < 3; x++) {
+    if (gst_video_format_get_component_depth(format, x) != 8) {
+      return QImage();
+    }
+
+    planes[x].data =
+      (const uchar *)gst_video_format_get_component_offset(format, x, width, height);
+    planes[x].stride = gst_video_format_get_row_stride(format, x, width);
+    planes[x].pixelStride = gst_video_format_get_pixel_stride(format, x);
+    planes[x].xShift =
+      gst_video_format_get_component_width(format, x, width) < width ? 1 : 0;
+    planes[x].yShift =
+      gst_video_format_get_component_height(format, x, height) < height ? 1 : 0;
+  }
+#endif
+
+  const uchar *src = sample->data();
+  qint64 size = sample->size();
+
+  if (!src) {
+    return QImage();
+  }
+
+  for (int x = 0; x < 3; x++) {
+    QtCamVideoSnapshotPlane& p = planes[x];
+    qint64 offset = (qint64)p.data;
+    qint64 last = offset + (qint64)((height - 1) >> p.yShift) * p.stride +
+      (qint64)((width - 1) >> p.xShift) * p.pixelStride;
+
+    if (last >= size) {
+      return QImage();
+    }
+
+    p.data = src + offset;
+  }
+
+  QImage image(width, height, QImage::Format_RGB32);
+  if (image.isNull()) {
+    return QImage();
+  }
+
+  const QtCamVideoSnapshotPlane& p0 = planes[0];
+  const QtCamVideoSnapshotPlane& p1 = planes[1];
+  const QtCamVideoSnapshotPlane& p2 = planes[2];
+
+  uchar *bits = image.bits();
+  int bytesPerLine = image.bytesPerLine();
+
+  for (int y = 0; y < height; y++) {
+    const uchar *l0 = p0.data + (y >> p0.yShift) * p0.stride;
+    const uchar *l1 = p1.data + (y >> p1.yShift) * p1.stride;
+    const uchar *l2 = p2.data + (y >> p2.yShift) * p2.stride;
+
+    QRgb *line = (QRgb *)(bits + y * bytesPerLine);
+
+    if (rgb) {
+      for (int x = 0; x < width; x++) {
+	line[x] = qRgb(l0[(x >> p0.xShift) * p0.pixelStride],
+		       l1[(x >> p1.xShift) * p1.pixelStride],
+		       l2[(x >> p2.xShift) * p2.pixelStride]);
+      }
+
+      continue;
+    }
+
+    for (int x = 0; x < width; x++) {
+      // BT.601, video range.
+      int c = 298 * (l0[(x >> p0.xShift) * p0.pixelStride] - 16);
+      int d = l1[(x >> p1.xShift) * p1.pixelStride] - 128;
+      int e = l2[(x >> p2.xShift) * p2.pixelStride] - 128;
+
+      line[x] = qRgb(clamp((c + 409 * e + 128) >> 8),
+		     clamp((c - 100 * d - 208 * e + 128) >> 8),
+		     clamp((c + 516 * d + 128) >> 8));
+    }
+  }
+
+  return image;
+}
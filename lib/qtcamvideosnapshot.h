@@ -0,0 +1,88 @@
+// -*- c++ -*-
+
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2015 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#ifndef QT_CAM_VIDEO_SNAPSHOT_H
+#define QT_CAM_VIDEO_SNAPSHOT_H
+
+#include <QObject>
+#include <QMutex>
+#include <QList>
+#include <QPair>
+#include <QThreadPool>
+#include <QImage>
+#include <gst/gst.h>
+
+class QtCamGstSample;
+class QtCamVideoSnapshotJob;
+
+// Takes still images from the video branch while recording. The probe never
+// drops or holds on to a buffer: the next frame after capture() is copied and
+// the conversion and JPEG encoding happen on a worker thread. The snapshots
+// carry the same EXIF as the captured images.
+class QtCamVideoSnapshot : public QObject {
+  Q_OBJECT
+
+public:
+  QtCamVideoSnapshot(QObject *parent = 0);
+  ~QtCamVideoSnapshot();
+
+  // Takes over the pad reference.
+  bool attach(GstPad *pad);
+  void detach();
+  bool isAttached();
+
+  // metadata holds complete APPn segments to be written to the JPEG.
+  void capture(const QString& fileName,
+	       const QList<QByteArray>& metadata = QList<QByteArray>());
+
+  static QImage toImage(QtCamGstSample *sample);
+
+  // An APP1 segment with the EXIF for tags or an empty array.
+  static QByteArray exifSegment(const GstTagList *tags);
+
+signals:
+  void saved(const QString& fileName);
+  void failed(const QString& fileName);
+
+private:
+  friend class QtCamVideoSnapshotJob;
+
+#if GST_CHECK_VERSION(1,0,0)
+  static GstPadProbeReturn gst1_buffer_probe(GstPad *pad, GstPadProbeInfo *info,
+					     gpointer user_data);
+#else
+  static gboolean buffer_probe(GstPad *pad, GstMiniObject *mini_obj, gpointer user_data);
+#endif
+
+  void grab(GstPad *pad, GstBuffer *buffer);
+  void finish(const QString& fileName, bool ok);
+
+  QMutex m_mutex;
+  GstPad *m_pad;
+  gulong m_probe;
+  QList<QPair<QString, QList<QByteArray> > > m_pending;
+  QThreadPool m_pool;
+  QThreadPool m_encoderPool;
+};
+
+#endif /* QT_CAM_VIDEO_SNAPSHOT_H */
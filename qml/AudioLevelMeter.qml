@@ -0,0 +1,75 @@
+// -*- qml -*-
+
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2014 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+import QtQuick 2.0
+
+Column {
+    id: meter
+    property variant peak: []
+    property variant rms: []
+    property real barWidth: 120
+    property real barHeight: 6
+    // Levels below this are shown as silence.
+    property real floor: -60
+
+    spacing: 2
+
+    function position(level) {
+        if (level <= 0) {
+            return 0
+        }
+
+        var db = 20 * Math.log(level) / Math.LN10
+        return Math.max(0, Math.min(1, 1 - db / meter.floor))
+    }
+
+    Repeater {
+        model: meter.rms.length
+
+        Rectangle {
+            width: meter.barWidth
+            height: meter.barHeight
+            color: cameraStyle.backgroundColor
+            border.color: cameraStyle.borderColor
+            border.width: 1
+
+            Rectangle {
+                anchors {
+                    left: parent.left
+                    top: parent.top
+                    bottom: parent.bottom
+                }
+
+                width: parent.width * meter.position(meter.rms[index])
+                color: meter.peak[index] >= 0.99 ? "red" : "green"
+            }
+
+            Rectangle {
+                x: Math.min(parent.width - width, parent.width * meter.position(meter.peak[index]))
+                width: 2
+                height: parent.height
+                color: "white"
+                visible: meter.peak[index] > 0
+            }
+        }
+    }
+}
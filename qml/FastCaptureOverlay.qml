@@ -46,7 +46,10 @@ Item {
         id: imageMode
         camera: cam
         enablePreview: false
-        onSaved: mountProtector.unlock(platformSettings.imagePath)
+        onSaved: {
+            imageRotator.rotateImage(fileName)
+            mountProtector.unlock(platformSettings.imagePath)
+        }
     }
 
     ZoomSlider {
@@ -0,0 +1,306 @@
+// -*- qml -*-
+
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2014 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+import QtQuick 2.0
+import QtCamera 1.0
+import CameraPlus 1.0
+
+// TODO: disable proximity capture
+// TODO: disable zoom capture
+
+BaseOverlay {
+    id: overlay
+
+    policyMode: CameraResources.Image
+    pressed: processing || pageBeingManipulated
+    inhibitDim: processing
+    captureButtonIconSource: cameraTheme.captureButtonImageIconId
+    canCapture: imageMode.canCapture && !processing
+
+    property bool processing: bracketing || fusion.busy
+    property bool bracketing: false
+    property int shot: 0
+    property int pendingSaves: 0
+    property variant exposures: []
+    property variant frames: []
+    property variant mergedFrames: []
+
+    ImageMode {
+        id: imageMode
+        camera: cam
+
+        // The bracketed frames are not interesting on their own.
+        enablePreview: false
+
+        onCanCaptureChanged: {
+            if (canCapture && bracketing && !settleTimer.running) {
+                overlay.nextExposure()
+            }
+        }
+
+        onSaved: {
+            --pendingSaves
+            overlay.mergeWhenSaved()
+        }
+    }
+
+    ExposureFusion {
+        id: fusion
+        discard: !settings.hdrKeepBrackets
+
+        onMerged: {
+            trackerStore.storeImage(fileName)
+            imageRotator.rotateImage(fileName)
+            if (settings.hdrKeepBrackets) {
+                overlay.rotateFrames(overlay.mergedFrames)
+            }
+            mountProtector.unlock(platformSettings.imagePath)
+        }
+
+        onFailed: {
+            showError(qsTr("Failed to create HDR image."))
+            if (!settings.hdrKeepBrackets) {
+                overlay.storeFrames(overlay.mergedFrames)
+            }
+            overlay.rotateFrames(overlay.mergedFrames)
+            mountProtector.unlock(platformSettings.imagePath)
+        }
+    }
+
+    Timer {
+        // Give the sensor a few frames to apply the new exposure.
+        id: settleTimer
+        interval: 300
+        onTriggered: overlay.captureFrame()
+    }
+
+    CameraLabel {
+        anchors.centerIn: parent
+        visible: processing
+        color: "white"
+        styleColor: "black"
+        style: Text.Outline
+        font.pixelSize: cameraStyle.fontSizeLarge
+        text: fusion.busy ? qsTr("Creating HDR image %1%").arg(Math.round(fusion.progress * 100))
+            : qsTr("Hold still (%1/%2)").arg(shot + 1).arg(exposures.length)
+    }
+
+    CameraToolBarLabel {
+        id: selectedLabel
+        anchors {
+            bottom: toolBar.top
+            bottomMargin: cameraStyle.padding
+        }
+        visible: controlsVisible && !overlayCapturing && text != ""
+    }
+
+    ImageModeToolBar {
+        id: toolBar
+        selectedLabel: selectedLabel
+        visible: controlsVisible && !overlayCapturing
+    }
+
+    ImageModeIndicators {
+        id: indicators
+        visible: controlsVisible && !overlayCapturing
+    }
+
+    Connections {
+        target: rootWindow
+        onActiveChanged: {
+            if (!rootWindow.active && overlay.processing) {
+                overlay.policyLost()
+            }
+        }
+    }
+
+    function bracket() {
+        var base = deviceSettings().imageEvComp
+        var stops = settings.hdrStops
+        var list = []
+
+        // Darkest first. The middle one is the reference for the merge.
+        for (var x = -1; x <= 1; x++) {
+            var ev = Math.max(cam.evComp.minimum, Math.min(cam.evComp.maximum, base + x * stops))
+            if (list.length == 0 || list[list.length - 1] != ev) {
+                list.push(ev)
+            }
+        }
+
+        return list
+    }
+
+    function captureFrame() {
+        if (!bracketing) {
+            return
+        }
+
+        metaData.setMetaData()
+
+        var fileName = fileNaming.imageFileName()
+        if (!imageMode.capture(fileName)) {
+            showError(qsTr("Failed to capture image. Please restart the camera."))
+            policyLost()
+        } else {
+            ++pendingSaves
+            var list = frames
+            list.push(fileName)
+            frames = list
+        }
+    }
+
+    function nextExposure() {
+        ++shot
+        if (shot < exposures.length) {
+            cam.evComp.value = exposures[shot]
+            settleTimer.start()
+            return
+        }
+
+        bracketing = false
+        cam.evComp.value = deviceSettings().imageEvComp
+        mergeWhenSaved()
+    }
+
+    function mergeWhenSaved() {
+        if (bracketing || pendingSaves > 0 || frames.length == 0) {
+            return
+        }
+
+        var list = frames
+        frames = []
+
+        if (list.length < 2) {
+            // The device cannot vary the exposure. Keep what we have.
+            storeFrames(list)
+            rotateFrames(list)
+            mountProtector.unlock(platformSettings.imagePath)
+            return
+        }
+
+        if (settings.hdrKeepBrackets) {
+            storeFrames(list)
+        }
+
+        if (!fusion.merge(list, fileNaming.imageFileName())) {
+            showError(qsTr("Failed to create HDR image."))
+            if (!settings.hdrKeepBrackets) {
+                storeFrames(list)
+            }
+            rotateFrames(list)
+            mountProtector.unlock(platformSettings.imagePath)
+        } else {
+            mergedFrames = list
+        }
+    }
+
+    function storeFrames(list) {
+        for (var x = 0; x < list.length; x++) {
+            trackerStore.storeImage(list[x])
+        }
+    }
+
+    function rotateFrames(list) {
+        // Only once the fusion is done reading them.
+        for (var x = 0; x < list.length; x++) {
+            imageRotator.rotateImage(list[x])
+        }
+    }
+
+    function cameraError() {
+        policyLost()
+    }
+
+    function policyLost() {
+        settleTimer.stop()
+
+        if (bracketing) {
+            bracketing = false
+            cam.evComp.value = deviceSettings().imageEvComp
+            if (frames.length == 0) {
+                mountProtector.unlock(platformSettings.imagePath)
+            } else {
+                // Whatever got captured will be saved and merged.
+                mergeWhenSaved()
+            }
+        } else if (fusion.busy) {
+            // onFailed unlocks
+            fusion.cancel()
+        }
+    }
+
+    function startCapture() {
+        if (!imageMode.canCapture) {
+            showError(qsTr("Camera is already capturing an image."))
+            stopCapture()
+        } else if (!batteryMonitor.good) {
+            showError(qsTr("Not enough battery to capture images."))
+            stopCapture()
+        } else if (!fileSystem.available) {
+            showError(qsTr("Camera cannot capture images in mass storage mode."))
+            stopCapture()
+        } else if (!fileSystem.hasFreeSpace(platformSettings.imagePath)) {
+            showError(qsTr("Not enough space to capture images."))
+            stopCapture()
+        } else if (!mountProtector.lock(platformSettings.imagePath)) {
+            showError(qsTr("Failed to lock images directory."))
+            stopCapture()
+        } else {
+            exposures = bracket()
+            frames = []
+            shot = 0
+            pendingSaves = 0
+            bracketing = true
+            cam.evComp.value = exposures[0]
+            settleTimer.start()
+        }
+    }
+
+    function stopCapture() {
+        // Nothing. Focus stays continuous so all frames share it.
+    }
+
+    function resetToolBar() {
+        if (toolBar.depth() > 1) {
+            toolBar.pop()
+        }
+    }
+
+    function cameraDeviceChanged() {
+        resetToolBar()
+    }
+
+    function applySettings() {
+        var s = deviceSettings()
+
+        camera.scene.value = s.imageSceneMode
+        // The flash would not fire at the same strength for all the frames.
+        camera.flash.value = Flash.Off
+        camera.evComp.value = s.imageEvComp
+        camera.whiteBalance.value = s.imageWhiteBalance
+        camera.colorTone.value = s.imageColorFilter
+        camera.iso.value = s.imageIso
+        camera.focus.value = Focus.ContinuousNormal
+
+        imageSettings.setImageResolution()
+    }
+}
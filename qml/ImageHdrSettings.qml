@@ -0,0 +1,71 @@
+// -*- qml -*-
+
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2014 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+import QtQuick 2.0
+import QtCamera 1.0
+
+Column {
+    width: parent.width
+    spacing: cameraStyle.spacingMedium
+
+    CameraLabel {
+        font.pixelSize: cameraStyle.fontSizeLarge
+        text: qsTr("HDR settings")
+    }
+
+    ImageResolutionSettings {
+        width: parent.width
+    }
+
+    Column {
+        width: parent.width
+
+        CameraLabel {
+            text: qsTr("Exposure bracket: %1 EV").arg(settings.hdrStops.toFixed(1))
+        }
+
+        CameraSlider {
+            anchors.horizontalCenter: parent.horizontalCenter
+            width: (parent.width * 3) / 4
+            minimumValue: 0.5
+            maximumValue: 3
+            stepSize: 0.5
+            value: settings.hdrStops
+            onValueChanged: {
+                if (pressed) {
+                    settings.hdrStops = value
+                }
+            }
+
+            valueIndicatorText: formatValue(value)
+            function formatValue(value) {
+                return qsTr("±%1 EV").arg(value.toFixed(1))
+            }
+        }
+    }
+
+    CameraTextSwitch {
+        text: qsTr("Keep the bracketed images")
+        checked: settings.hdrKeepBrackets
+        onCheckedChanged: settings.hdrKeepBrackets = checked
+    }
+}
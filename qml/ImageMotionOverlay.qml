@@ -0,0 +1,206 @@
+// -*- qml -*-
+
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2014 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+import QtQuick 2.0
+import QtCamera 1.0
+import CameraPlus 1.0
+
+BaseOverlay {
+    id: overlay
+
+    property bool armed: false
+
+    policyMode: CameraResources.Image
+    pressed: armed || pageBeingManipulated
+    inhibitDim: armed
+    captureButtonIconSource: cameraTheme.selfTimerIconId
+    canCapture: imageMode.canCapture && !armed
+
+    ImageMode {
+        id: imageMode
+        camera: cam
+
+        enablePreview: settings.enablePreview
+
+        onPreviewAvailable: overlay.previewAvailable(preview)
+
+        onSaved: imageRotator.rotateImage(fileName)
+    }
+
+    MotionDetector {
+        id: motionDetector
+        camera: cam
+        enabled: overlay.armed
+        sensitivity: settings.motionSensitivity
+        coolDown: settings.motionCoolDown * 1000
+
+        onMotionStarted: overlay.captureImage()
+    }
+
+    Timer {
+        // Keep capturing as long as the scene keeps moving.
+        interval: settings.motionCoolDown * 1000
+        running: overlay.armed && motionDetector.motion
+        repeat: true
+        onTriggered: overlay.captureImage()
+    }
+
+    CameraLabel {
+        anchors.centerIn: parent
+        visible: armed
+        text: motionDetector.motion ? qsTr("Motion detected") : qsTr("Waiting for motion")
+        color: "white"
+        styleColor: "black"
+        style: Text.Outline
+        font.pixelSize: cameraStyle.fontSizeLarge
+    }
+
+    CameraToolBarLabel {
+        id: selectedLabel
+        anchors {
+            bottom: toolBar.top
+            bottomMargin: cameraStyle.padding
+        }
+        visible: controlsVisible && !overlayCapturing && text != ""
+    }
+
+    ImageModeToolBar {
+        id: toolBar
+        selectedLabel: selectedLabel
+        visible: controlsVisible && !overlayCapturing
+    }
+
+    ImageModeIndicators {
+        id: indicators
+        visible: controlsVisible && !overlayCapturing
+    }
+
+    Connections {
+        target: rootWindow
+        onActiveChanged: {
+            if (!rootWindow.active && armed) {
+                overlay.policyLost()
+            }
+        }
+    }
+
+    Connections {
+        target: batteryMonitor
+        onGoodChanged: {
+            if (!batteryMonitor.good && armed) {
+                showError(qsTr("Not enough battery to capture images."))
+                overlay.policyLost()
+            }
+        }
+    }
+
+    CaptureCancel {
+        anchors.fill: parent
+        enabled: armed
+        onClicked: policyLost()
+    }
+
+    function captureImage() {
+        if (!armed || !imageMode.canCapture) {
+            // Busy with the previous image. The next motion will be caught.
+            return
+        }
+
+        if (!fileSystem.hasFreeSpace(platformSettings.imagePath)) {
+            showError(qsTr("Not enough space to capture images."))
+            policyLost()
+            return
+        }
+
+        metaData.setMetaData()
+
+        var fileName = fileNaming.imageFileName()
+        if (!imageMode.capture(fileName)) {
+            showError(qsTr("Failed to capture image. Please restart the camera."))
+            policyLost()
+        } else {
+            trackerStore.storeImage(fileName)
+        }
+    }
+
+    function cameraError() {
+        policyLost()
+    }
+
+    function policyLost() {
+        if (armed) {
+            armed = false
+            mountProtector.unlock(platformSettings.imagePath)
+        }
+
+        stopCapture()
+    }
+
+    function startCapture() {
+        if (!imageMode.canCapture) {
+            showError(qsTr("Camera is already capturing an image."))
+            stopCapture()
+        } else if (!batteryMonitor.good) {
+            showError(qsTr("Not enough battery to capture images."))
+            stopCapture()
+        } else if (!fileSystem.available) {
+            showError(qsTr("Camera cannot capture images in mass storage mode."))
+            stopCapture()
+        } else if (!fileSystem.hasFreeSpace(platformSettings.imagePath)) {
+            showError(qsTr("Not enough space to capture images."))
+            stopCapture()
+        } else if (!mountProtector.lock(platformSettings.imagePath)) {
+            showError(qsTr("Failed to lock images directory."))
+            stopCapture()
+        } else {
+            armed = true
+        }
+    }
+
+    function stopCapture() {
+        // Nothing. We do not focus before motion triggered captures.
+    }
+
+    function resetToolBar() {
+        if (toolBar.depth() > 1) {
+            toolBar.pop()
+        }
+    }
+
+    function cameraDeviceChanged() {
+        resetToolBar()
+    }
+
+    function applySettings() {
+        var s = deviceSettings()
+
+        camera.scene.value = s.imageSceneMode
+        camera.flash.value = s.imageFlashMode
+        camera.evComp.value = s.imageEvComp
+        camera.whiteBalance.value = s.imageWhiteBalance
+        camera.colorTone.value = s.imageColorFilter
+        camera.iso.value = s.imageIso
+        camera.focus.value = Focus.ContinuousNormal
+
+        imageSettings.setImageResolution()
+    }
+}
@@ -0,0 +1,252 @@
+// -*- qml -*-
+
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2014 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+import QtQuick 2.0
+import QtCamera 1.0
+import CameraPlus 1.0
+
+// TODO: disable proximity capture
+// TODO: disable zoom capture
+
+BaseOverlay {
+    id: overlay
+
+    policyMode: CameraResources.Image
+    pressed: processing || pageBeingManipulated
+    inhibitDim: processing
+    captureButtonIconSource: cameraTheme.captureButtonImageIconId
+    canCapture: imageMode.canCapture && !processing
+
+    property bool processing: capturing || stacker.busy
+    property bool capturing: false
+    property int shot: 0
+    property int pendingSaves: 0
+    property variant frames: []
+    property variant stackedFrames: []
+
+    ImageMode {
+        id: imageMode
+        camera: cam
+
+        // The individual frames are not interesting on their own.
+        enablePreview: false
+
+        onCanCaptureChanged: {
+            if (canCapture && capturing) {
+                overlay.nextFrame()
+            }
+        }
+
+        onSaved: {
+            --pendingSaves
+            overlay.stackWhenSaved()
+        }
+    }
+
+    NightStacker {
+        id: stacker
+        discard: true
+
+        onStacked: {
+            trackerStore.storeImage(fileName)
+            imageRotator.rotateImage(fileName)
+            mountProtector.unlock(platformSettings.imagePath)
+        }
+
+        onFailed: {
+            showError(qsTr("Failed to create night image."))
+            overlay.storeFrames(overlay.stackedFrames)
+            mountProtector.unlock(platformSettings.imagePath)
+        }
+    }
+
+    CameraLabel {
+        anchors.centerIn: parent
+        visible: processing
+        color: "white"
+        styleColor: "black"
+        style: Text.Outline
+        font.pixelSize: cameraStyle.fontSizeLarge
+        text: stacker.busy ? qsTr("Creating night image %1%").arg(Math.round(stacker.progress * 100))
+            : qsTr("Hold still (%1/%2)").arg(shot + 1).arg(settings.nightStackFrames)
+    }
+
+    CameraToolBarLabel {
+        id: selectedLabel
+        anchors {
+            bottom: toolBar.top
+            bottomMargin: cameraStyle.padding
+        }
+        visible: controlsVisible && !overlayCapturing && text != ""
+    }
+
+    ImageModeToolBar {
+        id: toolBar
+        selectedLabel: selectedLabel
+        visible: controlsVisible && !overlayCapturing
+    }
+
+    ImageModeIndicators {
+        id: indicators
+        visible: controlsVisible && !overlayCapturing
+    }
+
+    Connections {
+        target: rootWindow
+        onActiveChanged: {
+            if (!rootWindow.active && overlay.processing) {
+                overlay.policyLost()
+            }
+        }
+    }
+
+    function captureFrame() {
+        if (!capturing) {
+            return
+        }
+
+        metaData.setMetaData()
+
+        var fileName = fileNaming.imageFileName()
+        if (!imageMode.capture(fileName)) {
+            showError(qsTr("Failed to capture image. Please restart the camera."))
+            policyLost()
+        } else {
+            ++pendingSaves
+            var list = frames
+            list.push(fileName)
+            frames = list
+        }
+    }
+
+    function nextFrame() {
+        ++shot
+        if (shot < settings.nightStackFrames) {
+            captureFrame()
+            return
+        }
+
+        capturing = false
+        stackWhenSaved()
+    }
+
+    function stackWhenSaved() {
+        if (capturing || pendingSaves > 0 || frames.length == 0) {
+            return
+        }
+
+        var list = frames
+        frames = []
+
+        if (list.length < 2) {
+            storeFrames(list)
+            mountProtector.unlock(platformSettings.imagePath)
+        } else if (!stacker.stack(list, fileNaming.imageFileName())) {
+            showError(qsTr("Failed to create night image."))
+            storeFrames(list)
+            mountProtector.unlock(platformSettings.imagePath)
+        } else {
+            stackedFrames = list
+        }
+    }
+
+    function storeFrames(list) {
+        // Only called once the stacker is done with the frames.
+        for (var x = 0; x < list.length; x++) {
+            trackerStore.storeImage(list[x])
+            imageRotator.rotateImage(list[x])
+        }
+    }
+
+    function cameraError() {
+        policyLost()
+    }
+
+    function policyLost() {
+        if (capturing) {
+            capturing = false
+            if (frames.length == 0) {
+                mountProtector.unlock(platformSettings.imagePath)
+            } else {
+                // Whatever got captured will be saved and stacked.
+                stackWhenSaved()
+            }
+        } else if (stacker.busy) {
+            // onFailed unlocks
+            stacker.cancel()
+        }
+    }
+
+    function startCapture() {
+        if (!imageMode.canCapture) {
+            showError(qsTr("Camera is already capturing an image."))
+            stopCapture()
+        } else if (!batteryMonitor.good) {
+            showError(qsTr("Not enough battery to capture images."))
+            stopCapture()
+        } else if (!fileSystem.available) {
+            showError(qsTr("Camera cannot capture images in mass storage mode."))
+            stopCapture()
+        } else if (!fileSystem.hasFreeSpace(platformSettings.imagePath)) {
+            showError(qsTr("Not enough space to capture images."))
+            stopCapture()
+        } else if (!mountProtector.lock(platformSettings.imagePath)) {
+            showError(qsTr("Failed to lock images directory."))
+            stopCapture()
+        } else {
+            frames = []
+            shot = 0
+            pendingSaves = 0
+            capturing = true
+            captureFrame()
+        }
+    }
+
+    function stopCapture() {
+        // Nothing. Focus stays continuous so all frames share it.
+    }
+
+    function resetToolBar() {
+        if (toolBar.depth() > 1) {
+            toolBar.pop()
+        }
+    }
+
+    function cameraDeviceChanged() {
+        resetToolBar()
+    }
+
+    function applySettings() {
+        var s = deviceSettings()
+
+        // Short exposures keep each frame sharp. Stacking takes care of the noise.
+        camera.scene.value = Scene.Auto
+        camera.flash.value = Flash.Off
+        camera.evComp.value = s.imageEvComp
+        camera.whiteBalance.value = s.imageWhiteBalance
+        camera.colorTone.value = s.imageColorFilter
+        camera.iso.value = s.imageIso
+        camera.focus.value = Focus.ContinuousNormal
+
+        imageSettings.setImageResolution()
+    }
+}
@@ -41,7 +41,10 @@ BaseOverlay {
 
         onPreviewAvailable: overlay.previewAvailable(preview)
 
-        onSaved: mountProtector.unlock(platformSettings.imagePath)
+        onSaved: {
+            imageRotator.rotateImage(fileName)
+            mountProtector.unlock(platformSettings.imagePath)
+        }
     }
 
     Timer {
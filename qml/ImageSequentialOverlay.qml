@@ -34,6 +34,8 @@ BaseOverlay {
     canCapture: imageMode.canCapture && remainingShots == 0
 
     property int remainingShots: 0
+    property bool selecting: false
+    property int pendingSaves: 0
 
     ImageMode {
         id: imageMode
@@ -51,13 +53,39 @@ BaseOverlay {
                 if (remainingShots > 0) {
                     countDown.value = settings.sequentialShotsInterval
                     captureTimer.start()
+                } else {
+                    endSelection()
                 }
             }
 
             stopCapture()
         }
 
-        onSaved: mountProtector.unlock(platformSettings.imagePath)
+        onSaved: {
+            if (selecting) {
+                // Rotated once the selector is done reading it.
+                burstSelector.add(fileName)
+                --pendingSaves
+                endSelection()
+            } else {
+                imageRotator.rotateImage(fileName)
+            }
+
+            mountProtector.unlock(platformSettings.imagePath)
+        }
+    }
+
+    BurstSelector {
+        id: burstSelector
+        keep: settings.sequentialShotsKeep
+        discard: true
+        onScored: trackerStore.storeScore(fileName, score)
+        onRemoved: trackerStore.removeImage(fileName)
+        onFinished: {
+            for (var x = 0; x < kept.length; x++) {
+                imageRotator.rotateImage(kept[x])
+            }
+        }
     }
 
     Column {
@@ -239,6 +267,16 @@ BaseOverlay {
             policyLost()
         } else {
             trackerStore.storeImage(fileName)
+            if (selecting) {
+                ++pendingSaves
+            }
+        }
+    }
+
+    function endSelection() {
+        if (selecting && remainingShots == 0 && pendingSaves == 0) {
+            selecting = false
+            burstSelector.end()
         }
     }
 
@@ -253,6 +291,7 @@ BaseOverlay {
         captureTimer.stop()
         stopCapture()
         mountProtector.unlock(platformSettings.imagePath)
+        endSelection()
     }
 
     function startCapture() {
@@ -275,6 +314,11 @@ BaseOverlay {
             count.close()
             interval.close()
             remainingShots = settings.sequentialShotsCount
+            selecting = settings.sequentialShotsKeep > 0 && !burstSelector.busy
+            pendingSaves = 0
+            if (selecting) {
+                burstSelector.begin()
+            }
             delayTimer.start()
             countDown.value = settings.sequentialShotsDelay
         }
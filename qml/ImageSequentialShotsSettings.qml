@@ -63,6 +63,35 @@ Column {
         }
     }
 
+    Column {
+        width: parent.width
+
+        CameraLabel {
+            text: settings.sequentialShotsKeep > 0 ?
+                qsTr("Keep only the %1 sharpest images").arg(settings.sequentialShotsKeep) :
+                qsTr("Keep all images")
+        }
+
+        CameraSlider {
+            anchors.horizontalCenter: parent.horizontalCenter
+            width: (parent.width * 3) / 4
+            minimumValue: 0
+            maximumValue: 20
+            stepSize: 1
+            value: settings.sequentialShotsKeep
+            onValueChanged: {
+                if (pressed) {
+                    settings.sequentialShotsKeep = value
+                }
+            }
+
+            valueIndicatorText: formatValue(value)
+            function formatValue(value) {
+                return value > 0 ? qsTr("%1 images").arg(value) : qsTr("All")
+            }
+        }
+    }
+
     CameraTextSwitch {
         text: qsTr("Try to focus before capturing images")
         checked: settings.focusBeforeSequentialShots
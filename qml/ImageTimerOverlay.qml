@@ -43,7 +43,10 @@ BaseOverlay {
 
         onPreviewAvailable: overlay.previewAvailable(preview)
 
-        onSaved: mountProtector.unlock(platformSettings.imagePath)
+        onSaved: {
+            imageRotator.rotateImage(fileName)
+            mountProtector.unlock(platformSettings.imagePath)
+        }
     }
 
     CameraLabel {
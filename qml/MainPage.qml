@@ -323,6 +323,25 @@ CameraPage {
         id: mountProtector
     }
 
+    ImageRotator {
+        id: imageRotator
+        enabled: settings.losslessRotation
+
+        onRotated: mountProtector.unlock(platformSettings.imagePath)
+        onFailed: mountProtector.unlock(platformSettings.imagePath)
+
+        function rotateImage(fileName) {
+            // The file is rewritten in the background. Keep the storage mounted until then.
+            if (!enabled || !mountProtector.lock(platformSettings.imagePath)) {
+                return
+            }
+
+            if (!rotate(fileName)) {
+                mountProtector.unlock(platformSettings.imagePath)
+            }
+        }
+    }
+
     TrackerStore {
         id: trackerStore
         active: viewfinder.camera.running
@@ -40,19 +40,87 @@ BaseOverlay {
     enableFocus: false
     enableRoi: false
 
-    property bool processing
+    // Keyframes still being saved keep us busy so that they are not left behind.
+    property bool processing: panorama.active || panorama.stitching || pendingSaves > 0
+    property int pendingSaves: 0
+    property bool stitchRequested: false
+    property bool cancelRequested: false
 
     ImageMode {
         id: imageMode
         camera: cam
 
-        onCaptureEnded: stopCapture()
+        // Keyframes are not interesting on their own.
+        enablePreview: false
 
-        enablePreview: settings.enablePreview
+        onSaved: {
+            --pendingSaves
+            overlay.cancelWhenSaved()
+            overlay.stitchWhenSaved()
+        }
+    }
+
+    Panorama {
+        id: panorama
+        camera: cam
+
+        onKeyframeNeeded: overlay.captureKeyframe()
+        onTooFast: tooFastLabel.show()
+
+        onStitched: {
+            trackerStore.storeImage(fileName)
+            mountProtector.unlock(platformSettings.imagePath)
+        }
+
+        onStitchingFailed: {
+            showError(qsTr("Failed to create panorama."))
+            mountProtector.unlock(platformSettings.imagePath)
+        }
+    }
 
-        onPreviewAvailable: overlay.previewAvailable(preview)
+    Column {
+        anchors.centerIn: parent
+        visible: processing
+        spacing: cameraStyle.spacingMedium
+
+        CameraLabel {
+            id: guide
+            anchors.horizontalCenter: parent.horizontalCenter
+            color: "white"
+            styleColor: "black"
+            style: Text.Outline
+            font.pixelSize: cameraStyle.fontSizeLarge
+            text: panorama.stitching ? qsTr("Creating panorama %1%").arg(Math.round(panorama.progress * 100))
+                : !panorama.active ? qsTr("Saving images")
+                : Math.abs(panorama.position.y) > 0.1 ? (panorama.position.y > 0 ? qsTr("Tilt up") : qsTr("Tilt down"))
+                : qsTr("Pan slowly (%1 images)").arg(panorama.keyframes)
+        }
+
+        CameraLabel {
+            id: tooFastLabel
+            anchors.horizontalCenter: parent.horizontalCenter
+            color: "red"
+            styleColor: "black"
+            style: Text.Outline
+            font.pixelSize: cameraStyle.fontSizeLarge
+            text: qsTr("Too fast!")
+            visible: tooFastTimer.running && panorama.active
+
+            function show() {
+                tooFastTimer.restart()
+            }
+
+            Timer {
+                id: tooFastTimer
+                interval: 1000
+            }
+        }
+    }
 
-        onSaved: mountProtector.unlock(platformSettings.imagePath)
+    CaptureCancel {
+        anchors.fill: parent
+        enabled: panorama.active
+        onClicked: overlay.finishPanorama()
     }
 
     Connections {
@@ -69,11 +137,74 @@ BaseOverlay {
     }
 
     function policyLost() {
-        // TODO: stop panorama mode
-        stopCapture()
+        if (panorama.stitching) {
+            // onStitchingFailed unlocks
+            panorama.cancel()
+        } else if (panorama.active || stitchRequested) {
+            // Keyframes saved after the cancellation would stay around.
+            panorama.stop()
+            cancelRequested = true
+            cancelWhenSaved()
+        }
+
+        stitchRequested = false
+    }
+
+    function cancelWhenSaved() {
+        if (!cancelRequested || pendingSaves > 0) {
+            return
+        }
+
+        cancelRequested = false
+        panorama.cancel()
         mountProtector.unlock(platformSettings.imagePath)
     }
 
+    function captureKeyframe() {
+        if (!panorama.active) {
+            return
+        }
+
+        if (!imageMode.canCapture) {
+            // Still busy with the previous keyframe. We will be asked again
+            // on the next frame which is far enough.
+            panorama.keyframeSkipped()
+            return
+        }
+
+        var fileName = fileNaming.imageFileName()
+        if (!imageMode.capture(fileName)) {
+            showError(qsTr("Failed to capture image. Please restart the camera."))
+            policyLost()
+        } else {
+            ++pendingSaves
+            panorama.addKeyframe(fileName)
+        }
+    }
+
+    function finishPanorama() {
+        panorama.stop()
+        stitchRequested = true
+        stitchWhenSaved()
+    }
+
+    function stitchWhenSaved() {
+        if (!stitchRequested || pendingSaves > 0) {
+            return
+        }
+
+        stitchRequested = false
+
+        if (panorama.keyframes < 2) {
+            showError(qsTr("Pan further to create a panorama."))
+            panorama.cancel()
+            mountProtector.unlock(platformSettings.imagePath)
+        } else if (!panorama.stitch(fileNaming.imageFileName())) {
+            showError(qsTr("Failed to create panorama."))
+            mountProtector.unlock(platformSettings.imagePath)
+        }
+    }
+
     function startCapture() {
         if (!batteryMonitor.good) {
             showError(qsTr("Not enough battery to capture images."))
@@ -87,13 +218,16 @@ BaseOverlay {
         } else if (!mountProtector.lock(platformSettings.imagePath)) {
             showError(qsTr("Failed to lock images directory."))
             stopCapture()
+        } else if (!panorama.start()) {
+            showError(qsTr("Failed to start panorama."))
+            mountProtector.unlock(platformSettings.imagePath)
         } else {
-            // TODO: start panorama
+            pendingSaves = 0
         }
     }
 
     function stopCapture() {
-        // TODO:
+        // Nothing. The panorama goes on until it is canceled.
     }
 
     function cameraDeviceChanged() {
@@ -101,7 +235,6 @@ BaseOverlay {
     }
 
     function applySettings() {
-            // TODO:
         var s = deviceSettings()
 
         camera.scene.value = Scene.Manual
@@ -24,6 +24,7 @@ import QtQuick 2.0
 
 Rectangle {
     property int duration
+    property int remaining: -1
 
     anchors {
         verticalCenter: parent.verticalCenter
@@ -65,5 +66,17 @@ Rectangle {
             text: formatDuration(parent.duration)
             anchors.verticalCenter: parent.verticalCenter
         }
+
+        CameraLabel {
+            function formatRemaining(secs) {
+                var hours = Math.floor(secs / 3600)
+                var minutes = Math.floor((secs - (hours * 3600)) / 60)
+                return qsTr("(%1h %2m left)").arg(hours).arg(minutes)
+            }
+
+            visible: remaining >= 0
+            text: formatRemaining(remaining)
+            anchors.verticalCenter: parent.verticalCenter
+        }
     }
 }
@@ -97,6 +97,12 @@ Flickable {
             onCheckedChanged: settings.enablePreview = checked
         }
 
+        CameraTextSwitch {
+            text: qsTr("Rotate images instead of tagging their orientation")
+            checked: settings.losslessRotation
+            onCheckedChanged: settings.losslessRotation = checked
+        }
+
         CameraTextSwitch {
             text: qsTr("Enable night mode (Viewfinder dimming)")
             checked: settings.nightMode
@@ -0,0 +1,229 @@
+// -*- qml -*-
+
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2014 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+import QtQuick 2.0
+import QtCamera 1.0
+import CameraPlus 1.0
+
+BaseOverlay {
+    id: overlay
+
+    property bool armed: false
+    property bool recording: false
+    property bool startPending: false
+
+    policyMode: recording ? CameraResources.Recording : CameraResources.Video
+    pressed: armed || pageBeingManipulated
+    inhibitDim: armed
+    captureButtonIconSource: cameraTheme.captureButtonVideoIconId
+    canCapture: !armed
+    enableRoi: false
+
+    VideoMode {
+        id: videoMode
+        camera: cam
+        enablePreview: false
+    }
+
+    MotionDetector {
+        id: motionDetector
+        camera: cam
+        enabled: overlay.armed
+        sensitivity: settings.motionSensitivity
+        coolDown: settings.motionCoolDown * 1000
+
+        onMotionStarted: overlay.startRecording()
+        onMotionStopped: {
+            overlay.startPending = false
+            overlay.stopRecording()
+        }
+    }
+
+    Connections {
+        target: videoMode
+        onCanCaptureChanged: {
+            // The previous clip is finalized.
+            if (overlay.startPending && videoMode.canCapture) {
+                overlay.startPending = false
+                overlay.startRecording()
+            }
+        }
+    }
+
+    CameraLabel {
+        anchors.centerIn: parent
+        visible: armed
+        text: recording ? qsTr("Recording") : qsTr("Waiting for motion")
+        color: "white"
+        styleColor: "black"
+        style: Text.Outline
+        font.pixelSize: cameraStyle.fontSizeLarge
+    }
+
+    Connections {
+        target: rootWindow
+        onActiveChanged: {
+            if (!rootWindow.active && armed) {
+                overlay.policyLost()
+            }
+        }
+    }
+
+    Connections {
+        target: batteryMonitor
+        onGoodChanged: {
+            if (!batteryMonitor.good && armed) {
+                showError(qsTr("Not enough battery to record video."))
+                overlay.policyLost()
+            }
+        }
+    }
+
+    Timer {
+        id: recordingDuration
+        property int duration: 0
+        running: overlay.recording
+        interval: 1000
+        repeat: true
+
+        onTriggered: {
+            duration = duration + 1
+
+            if (platformSettings.maximumVideoDuration != -1 &&
+                duration >= platformSettings.maximumVideoDuration) {
+                // Start a new clip if the motion goes on.
+                overlay.stopRecording()
+                overlay.startPending = motionDetector.motion
+            } else if (!fileSystem.hasFreeSpace(platformSettings.temporaryVideoPath)) {
+                showError(qsTr("Not enough space to continue recording."))
+                overlay.policyLost()
+            }
+        }
+    }
+
+    CaptureCancel {
+        anchors.fill: parent
+        enabled: armed
+        onClicked: policyLost()
+    }
+
+    function startRecording() {
+        if (!armed || recording) {
+            return
+        }
+
+        if (!pipelineManager.acquired || pipelineManager.hijacked) {
+            return
+        }
+
+        if (!videoMode.canCapture) {
+            // Still writing out the previous clip.
+            startPending = true
+            return
+        }
+
+        if (!fileSystem.hasFreeSpace(platformSettings.videoPath) ||
+            !fileSystem.hasFreeSpace(platformSettings.temporaryVideoPath)) {
+            showError(qsTr("Not enough space to record video."))
+            policyLost()
+            return
+        }
+
+        metaData.setMetaData()
+
+        var file = fileNaming.videoFileName()
+        var tmpFile = fileNaming.temporaryVideoFileName()
+
+        recordingDuration.duration = 0
+        recording = true
+
+        if (!videoMode.startRecording(file, tmpFile)) {
+            showError(qsTr("Failed to record video. Please restart the camera."))
+            recording = false
+            policyLost()
+            return
+        }
+
+        trackerStore.storeVideo(file)
+    }
+
+    function stopRecording() {
+        if (recording) {
+            videoMode.stopRecording(true)
+            recording = false
+        }
+    }
+
+    function startCapture() {
+        if (!fileSystem.available) {
+            showError(qsTr("Camera cannot record videos in mass storage mode."))
+        } else if (!batteryMonitor.good) {
+            showError(qsTr("Not enough battery to record video."))
+        } else if (!fileSystem.hasFreeSpace(platformSettings.videoPath) || !fileSystem.hasFreeSpace(platformSettings.temporaryVideoPath)) {
+            showError(qsTr("Not enough space to record video."))
+        } else if (!mountProtector.lock(platformSettings.temporaryVideoPath)) {
+            showError(qsTr("Failed to lock temporary videos directory."))
+        } else if (!mountProtector.lock(platformSettings.videoPath)) {
+            showError(qsTr("Failed to lock videos directory."))
+            mountProtector.unlock(platformSettings.temporaryVideoPath)
+        } else {
+            armed = true
+        }
+    }
+
+    function stopCapture() {
+        // This is a callback needed by CaptureControl when user cancels
+        // an attempt to capture. It's relevant only for images
+    }
+
+    function cameraError() {
+        policyLost()
+    }
+
+    function policyLost() {
+        startPending = false
+        stopRecording()
+
+        if (armed) {
+            armed = false
+            mountProtector.unlock(platformSettings.temporaryVideoPath)
+            mountProtector.unlock(platformSettings.videoPath)
+        }
+    }
+
+    function cameraDeviceChanged() {
+    }
+
+    function applySettings() {
+        var s = deviceSettings()
+
+        camera.scene.value = s.videoSceneMode
+        camera.evComp.value = s.videoEvComp
+        camera.whiteBalance.value = s.videoWhiteBalance
+        camera.colorTone.value = s.videoColorFilter
+        camera.videoMute.enabled = s.videoMuted
+        camera.videoTorch.on = s.videoTorchOn
+        camera.focus.value = Focus.ContinuousNormal
+
+        videoSettings.setVideoResolution()
+    }
+}
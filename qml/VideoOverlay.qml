@@ -27,6 +27,15 @@ import CameraPlus 1.0
 BaseOverlay {
     id: overlay
     property bool recording: false
+    // Snapshots being encoded. Each holds a lock on the images directory.
+    property variant pendingSnapshots: []
+
+    Component.onDestruction: {
+        // Whatever becomes of the pending snapshots will not reach us anymore.
+        for (var x = 0; x < pendingSnapshots.length; x++) {
+            mountProtector.unlock(platformSettings.imagePath)
+        }
+    }
 
     policyMode: recording == true ? CameraResources.Recording : CameraResources.Video
     pressed: overlay.recording || pageBeingManipulated
@@ -42,6 +51,19 @@ BaseOverlay {
         camera: cam
         enablePreview: settings.enablePreview
         onPreviewAvailable: overlay.previewAvailable(preview)
+        onSnapshotFailed: {
+            overlay.snapshotDone(fileName)
+            showError(qsTr("Failed to capture image."))
+        }
+        onSaved: {
+            // Also emitted for the video itself.
+            if (overlay.snapshotDone(fileName)) {
+                trackerStore.storeImage(fileName)
+            }
+        }
+        storagePath: platformSettings.videoPath
+        batteryPercentage: batteryMonitor.percentage
+        batteryCharging: batteryMonitor.charging
     }
 
     CaptureButton {
@@ -121,6 +143,12 @@ BaseOverlay {
                 visible: deviceFeatures().numberOfVideoColorTones > 1
             }
 
+            CameraToolIcon {
+                visible: overlay.recording
+                iconSource: cameraTheme.captureButtonImageIconId
+                onClicked: overlay.snapshot()
+            }
+
             CameraToolIcon {
                 iconSource: deviceSettings().videoMuted ? cameraTheme.soundMuteOnIconId : cameraTheme.soundMuteOffIconId
                 onClicked: deviceSettings().videoMuted = !deviceSettings().videoMuted
@@ -129,6 +157,7 @@ BaseOverlay {
             RecordingDurationLabel {
                 visible: overlay.recording
                 duration: recordingDuration.duration
+                remaining: videoMode.remainingRecordingTime
             }
 
             DeviceSelector {
@@ -179,6 +208,13 @@ BaseOverlay {
                 alwaysRunToEnd: true
             }
         }
+
+        AudioLevelMeter {
+            anchors.verticalCenter: parent.verticalCenter
+            visible: overlay.recording && !deviceSettings().videoMuted
+            peak: videoMode.audioPeak
+            rms: videoMode.audioRms
+        }
     }
 
     Connections {
@@ -248,7 +284,7 @@ BaseOverlay {
         if (!mountProtector.lock(platformSettings.videoPath)) {
             showError(qsTr("Failed to lock videos directory."))
             overlay.recording = false
-            mountProtector.unlockAll()
+            mountProtector.unlock(platformSettings.temporaryVideoPath)
             return
         }
 
@@ -257,7 +293,8 @@ BaseOverlay {
 
         if (!videoMode.startRecording(file, tmpFile)) {
             showError(qsTr("Failed to record video. Please restart the camera."))
-            mountProtector.unlockAll()
+            mountProtector.unlock(platformSettings.temporaryVideoPath)
+            mountProtector.unlock(platformSettings.videoPath)
             overlay.recording = false
             return
         }
@@ -283,10 +320,56 @@ BaseOverlay {
 
     function stopRecording() {
         videoMode.stopRecording(true)
-        mountProtector.unlockAll()
+
+        // Snapshots still being encoded keep their own locks.
+        if (overlay.recording) {
+            mountProtector.unlock(platformSettings.temporaryVideoPath)
+            mountProtector.unlock(platformSettings.videoPath)
+        }
+
         overlay.recording = false
     }
 
+    function snapshot() {
+        if (!overlay.recording || videoMode.paused) {
+            return
+        }
+
+        if (!fileSystem.hasFreeSpace(platformSettings.imagePath)) {
+            showError(qsTr("Not enough space to capture images."))
+            return
+        }
+
+        if (!mountProtector.lock(platformSettings.imagePath)) {
+            showError(qsTr("Failed to lock images directory."))
+            return
+        }
+
+        var fileName = fileNaming.imageFileName()
+        if (!videoMode.snapshot(fileName)) {
+            showError(qsTr("Failed to capture image."))
+            mountProtector.unlock(platformSettings.imagePath)
+            return
+        }
+
+        var list = pendingSnapshots
+        list.push(fileName)
+        pendingSnapshots = list
+    }
+
+    function snapshotDone(fileName) {
+        var list = pendingSnapshots
+        var index = list.indexOf(fileName)
+        if (index == -1) {
+            return false
+        }
+
+        list.splice(index, 1)
+        pendingSnapshots = list
+        mountProtector.unlock(platformSettings.imagePath)
+        return true
+    }
+
     function startCapture() {
         if (overlay.recording) {
             overlay.stopRecording()
@@ -0,0 +1,162 @@
+// -*- qml -*-
+
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2014 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+import QtQuick 2.0
+import QtCamera 1.0
+import CameraPlus 1.0
+
+BaseOverlay {
+    id: overlay
+
+    // The camera bin stays in viewfinder mode. Frames are encoded on the side.
+    policyMode: CameraResources.Video
+    pressed: timeLapse.recording || pageBeingManipulated
+    inhibitDim: false
+    captureButtonIconSource: cameraTheme.captureButtonVideoIconId
+    canCapture: !timeLapse.recording
+    enableRoi: false
+
+    property string fileName
+
+    VideoMode {
+        id: videoMode
+        camera: cam
+        enablePreview: false
+    }
+
+    TimeLapse {
+        id: timeLapse
+        camera: cam
+        interval: settings.timeLapseInterval * 1000
+        frameRate: settings.timeLapseFrameRate
+
+        onFinished: {
+            trackerStore.storeVideo(fileName)
+            mountProtector.unlock(platformSettings.videoPath)
+        }
+
+        onFailed: {
+            showError(qsTr("Failed to record time-lapse."))
+            mountProtector.unlock(platformSettings.videoPath)
+        }
+    }
+
+    Column {
+        anchors.centerIn: parent
+        visible: timeLapse.recording
+        spacing: cameraStyle.spacingMedium
+
+        CameraLabel {
+            anchors.horizontalCenter: parent.horizontalCenter
+            color: "white"
+            styleColor: "black"
+            style: Text.Outline
+            font.pixelSize: cameraStyle.fontSizeLarge
+            text: qsTr("%1 frames").arg(timeLapse.frames)
+        }
+
+        CameraLabel {
+            anchors.horizontalCenter: parent.horizontalCenter
+            color: "white"
+            styleColor: "black"
+            style: Text.Outline
+            text: qsTr("%1 seconds of video").arg((timeLapse.frames / timeLapse.frameRate).toFixed(1))
+        }
+    }
+
+    Connections {
+        target: batteryMonitor
+        onGoodChanged: {
+            if (!batteryMonitor.good && timeLapse.recording) {
+                showError(qsTr("Not enough battery to record video."))
+                overlay.policyLost()
+            }
+        }
+    }
+
+    Timer {
+        // Frames are far apart. Checking the space now and then is enough.
+        interval: 10000
+        running: timeLapse.recording
+        repeat: true
+        onTriggered: {
+            if (!fileSystem.hasFreeSpace(platformSettings.videoPath)) {
+                showError(qsTr("Not enough space to continue recording."))
+                overlay.policyLost()
+            }
+        }
+    }
+
+    CaptureCancel {
+        anchors.fill: parent
+        enabled: timeLapse.recording
+        onClicked: policyLost()
+    }
+
+    function startCapture() {
+        if (!fileSystem.available) {
+            showError(qsTr("Camera cannot record videos in mass storage mode."))
+        } else if (!batteryMonitor.good) {
+            showError(qsTr("Not enough battery to record video."))
+        } else if (!fileSystem.hasFreeSpace(platformSettings.videoPath)) {
+            showError(qsTr("Not enough space to record video."))
+        } else if (!mountProtector.lock(platformSettings.videoPath)) {
+            showError(qsTr("Failed to lock videos directory."))
+        } else {
+            fileName = fileNaming.videoFileName()
+            if (!timeLapse.start(fileName)) {
+                showError(qsTr("Failed to record time-lapse."))
+                mountProtector.unlock(platformSettings.videoPath)
+            }
+        }
+    }
+
+    function stopCapture() {
+        // This is a callback needed by CaptureControl when user cancels
+        // an attempt to capture. It's relevant only for images
+    }
+
+    function cameraError() {
+        policyLost()
+    }
+
+    function policyLost() {
+        // onFinished or onFailed unlocks
+        timeLapse.stop()
+    }
+
+    function cameraDeviceChanged() {
+    }
+
+    function applySettings() {
+        var s = deviceSettings()
+
+        camera.scene.value = s.videoSceneMode
+        camera.evComp.value = s.videoEvComp
+        camera.whiteBalance.value = s.videoWhiteBalance
+        camera.colorTone.value = s.videoColorFilter
+        camera.videoTorch.on = false
+        camera.focus.value = Focus.ContinuousNormal
+
+        videoSettings.setVideoResolution()
+    }
+}
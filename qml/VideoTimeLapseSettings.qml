@@ -0,0 +1,92 @@
+// -*- qml -*-
+
+/*!
+ * This file is part of CameraPlus.
+ *
+ * Copyright (C) 2012-2014 Mohammed Sameer <msameer@foolab.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+import QtQuick 2.0
+import QtCamera 1.0
+
+Column {
+    width: parent.width
+    spacing: cameraStyle.spacingMedium
+
+    CameraLabel {
+        font.pixelSize: cameraStyle.fontSizeLarge
+        text: qsTr("Time-lapse settings")
+    }
+
+    VideoResolutionSettings {
+        width: parent.width
+    }
+
+    Column {
+        width: parent.width
+
+        CameraLabel {
+            text: qsTr("Time between frames: %1").arg(settings.timeLapseInterval)
+        }
+
+        CameraSlider {
+            anchors.horizontalCenter: parent.horizontalCenter
+            width: (parent.width * 3) / 4
+            minimumValue: 1
+            maximumValue: 120
+            stepSize: 1
+            value: settings.timeLapseInterval
+            onValueChanged: {
+                if (pressed) {
+                    settings.timeLapseInterval = value
+                }
+            }
+
+            valueIndicatorText: formatValue(value)
+            function formatValue(value) {
+                return qsTr("%1 seconds").arg(value)
+            }
+        }
+    }
+
+    Column {
+        width: parent.width
+
+        CameraLabel {
+            text: qsTr("Playback frame rate: %1").arg(settings.timeLapseFrameRate)
+        }
+
+        CameraSlider {
+            anchors.horizontalCenter: parent.horizontalCenter
+            width: (parent.width * 3) / 4
+            minimumValue: 5
+            maximumValue: 30
+            stepSize: 1
+            value: settings.timeLapseFrameRate
+            onValueChanged: {
+                if (pressed) {
+                    settings.timeLapseFrameRate = value
+                }
+            }
+
+            valueIndicatorText: formatValue(value)
+            function formatValue(value) {
+                return qsTr("%1 fps").arg(value)
+            }
+        }
+    }
+}
@@ -34,6 +34,7 @@ BuildRequires:  pkgconfig(quill-qt5)
 BuildRequires:  pkgconfig(contextkit-statefs)
 BuildRequires:  pkgconfig(sndfile)
 BuildRequires:  pkgconfig(libpulse)
+BuildRequires:  libjpeg-turbo-devel
 BuildRequires:  desktop-file-utils
 Requires:       qt5-qtdeclarative-import-positioning
 Requires:       qt5-qtdeclarative-import-sensors
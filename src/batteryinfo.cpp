@@ -40,6 +40,8 @@ BatteryInfo::BatteryInfo(QObject *parent) :
 
   QObject::connect(m_percentage, SIGNAL(valueChanged()), this, SLOT(check()));
   QObject::connect(m_charging, SIGNAL(valueChanged()), this, SLOT(check()));
+  QObject::connect(m_percentage, SIGNAL(valueChanged()), this, SIGNAL(percentageChanged()));
+  QObject::connect(m_charging, SIGNAL(valueChanged()), this, SIGNAL(chargingChanged()));
 
   check();
 }
@@ -52,6 +54,14 @@ bool BatteryInfo::isGood() const {
   return m_isGood;
 }
 
+int BatteryInfo::percentage() const {
+  return m_percentage->value().toInt();
+}
+
+bool BatteryInfo::isCharging() const {
+  return m_charging->value().toBool();
+}
+
 void BatteryInfo::check() {
   bool isGood = false;
 
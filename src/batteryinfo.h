@@ -31,15 +31,21 @@ class BatteryInfo : public QObject {
   Q_OBJECT
 
   Q_PROPERTY(bool good READ isGood NOTIFY isGoodChanged);
+  Q_PROPERTY(int percentage READ percentage NOTIFY percentageChanged);
+  Q_PROPERTY(bool charging READ isCharging NOTIFY chargingChanged);
 
 public:
   BatteryInfo(QObject *parent = 0);
   ~BatteryInfo();
 
   bool isGood() const;
+  int percentage() const;
+  bool isCharging() const;
 
 signals:
   void isGoodChanged();
+  void percentageChanged();
+  void chargingChanged();
 
 private slots:
   void check();
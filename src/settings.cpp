@@ -42,6 +42,7 @@
 #define DEFAULT_DEVICE                    0
 #define DEFAULT_ENABLE_PREVIEW            true
 #define DEFAULT_NIGHT_MODE                false
+#define DEFAULT_LOSSLESS_ROTATION         false
 #define DEFAULT_PLUGIN                    "org.foolab.cameraplus.image"
 #define DEFAULT_CAPTURE_TIMER_DELAY       5
 #define DEFAULT_LEFT_HANDED_MODE          false
@@ -49,6 +50,14 @@
 #define DEFAULT_SEQUENTIAL_SHOTS_INTERVAL 5
 #define DEFAULT_SEQUENTIAL_SHOTS_DELAY    0
 #define DEFAULT_SEQUENTIAL_SHOTS_FOCUS    true
+#define DEFAULT_SEQUENTIAL_SHOTS_KEEP     0
+#define DEFAULT_MOTION_SENSITIVITY        50
+#define DEFAULT_MOTION_COOL_DOWN          3
+#define DEFAULT_HDR_STOPS                 2.0
+#define DEFAULT_HDR_KEEP_BRACKETS         false
+#define DEFAULT_NIGHT_STACK_FRAMES        6
+#define DEFAULT_TIME_LAPSE_INTERVAL       5
+#define DEFAULT_TIME_LAPSE_FRAME_RATE     25
 
 Settings::Settings(QObject *parent) :
   QObject(parent),
@@ -239,6 +248,17 @@ void Settings::setNightModeEnabled(bool enabled) {
   }
 }
 
+bool Settings::isLosslessRotationEnabled() const {
+  return m_settings->value("camera/losslessRotation", DEFAULT_LOSSLESS_ROTATION).toBool();
+}
+
+void Settings::setLosslessRotationEnabled(bool enabled) {
+  if (isLosslessRotationEnabled() != enabled) {
+    m_settings->setValue("camera/losslessRotation", enabled);
+    emit losslessRotationChanged();
+  }
+}
+
 QString Settings::plugin() const {
   return m_settings->value("camera/plugin", DEFAULT_PLUGIN).toString();
 }
@@ -316,3 +336,91 @@ void Settings::setFocusBeforeSequentialShotsEnabled(bool enabled) {
     emit focusBeforeSequentialShotsChanged();
   }
 }
+
+int Settings::sequentialShotsKeep() const {
+  return m_settings->value("sequentialShots/keep", DEFAULT_SEQUENTIAL_SHOTS_KEEP).toInt();
+}
+
+void Settings::setSequentialShotsKeep(int keep) {
+  if (sequentialShotsKeep() != keep) {
+    m_settings->setValue("sequentialShots/keep", keep);
+    emit sequentialShotsKeepChanged();
+  }
+}
+
+int Settings::motionSensitivity() const {
+  return m_settings->value("motion/sensitivity", DEFAULT_MOTION_SENSITIVITY).toInt();
+}
+
+void Settings::setMotionSensitivity(int sensitivity) {
+  if (motionSensitivity() != sensitivity) {
+    m_settings->setValue("motion/sensitivity", sensitivity);
+    emit motionSensitivityChanged();
+  }
+}
+
+int Settings::motionCoolDown() const {
+  return m_settings->value("motion/coolDown", DEFAULT_MOTION_COOL_DOWN).toInt();
+}
+
+void Settings::setMotionCoolDown(int coolDown) {
+  if (motionCoolDown() != coolDown) {
+    m_settings->setValue("motion/coolDown", coolDown);
+    emit motionCoolDownChanged();
+  }
+}
+
+qreal Settings::hdrStops() const {
+  return m_settings->value("hdr/stops", DEFAULT_HDR_STOPS).toReal();
+}
+
+void Settings::setHdrStops(qreal stops) {
+  if (!qFuzzyCompare(hdrStops(), stops)) {
+    m_settings->setValue("hdr/stops", stops);
+    emit hdrStopsChanged();
+  }
+}
+
+bool Settings::isHdrKeepBracketsEnabled() const {
+  return m_settings->value("hdr/keepBrackets", DEFAULT_HDR_KEEP_BRACKETS).toBool();
+}
+
+void Settings::setHdrKeepBracketsEnabled(bool enabled) {
+  if (isHdrKeepBracketsEnabled() != enabled) {
+    m_settings->setValue("hdr/keepBrackets", enabled);
+    emit hdrKeepBracketsChanged();
+  }
+}
+
+int Settings::nightStackFrames() const {
+  return m_settings->value("nightStack/frames", DEFAULT_NIGHT_STACK_FRAMES).toInt();
+}
+
+void Settings::setNightStackFrames(int frames) {
+  if (nightStackFrames() != frames) {
+    m_settings->setValue("nightStack/frames", frames);
+    emit nightStackFramesChanged();
+  }
+}
+
+int Settings::timeLapseInterval() const {
+  return m_settings->value("timeLapse/interval", DEFAULT_TIME_LAPSE_INTERVAL).toInt();
+}
+
+void Settings::setTimeLapseInterval(int interval) {
+  if (timeLapseInterval() != interval) {
+    m_settings->setValue("timeLapse/interval", interval);
+    emit timeLapseIntervalChanged();
+  }
+}
+
+int Settings::timeLapseFrameRate() const {
+  return m_settings->value("timeLapse/frameRate", DEFAULT_TIME_LAPSE_FRAME_RATE).toInt();
+}
+
+void Settings::setTimeLapseFrameRate(int frameRate) {
+  if (timeLapseFrameRate() != frameRate) {
+    m_settings->setValue("timeLapse/frameRate", frameRate);
+    emit timeLapseFrameRateChanged();
+  }
+}
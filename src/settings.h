@@ -45,6 +45,7 @@ class Settings : public QObject {
   Q_PROPERTY(int device READ device WRITE setDevice NOTIFY deviceChanged);
   Q_PROPERTY(bool enablePreview READ isPreviewEnabled WRITE setPreviewEnabled NOTIFY previewEnabledChanged);
   Q_PROPERTY(bool nightMode READ isNightModeEnabled WRITE setNightModeEnabled NOTIFY nightModeChanged);
+  Q_PROPERTY(bool losslessRotation READ isLosslessRotationEnabled WRITE setLosslessRotationEnabled NOTIFY losslessRotationChanged);
   Q_PROPERTY(QString plugin READ plugin WRITE setPlugin NOTIFY pluginChanged);
   Q_PROPERTY(int captureTimerDelay READ captureTimerDelay WRITE setCaptureTimerDelay NOTIFY captureTimerDelayChanged);
   Q_PROPERTY(bool leftHandedMode READ isLeftHandedModeEnabled WRITE setLeftHandedModeEnabled NOTIFY leftHandedModeChanged);
@@ -52,6 +53,14 @@ class Settings : public QObject {
   Q_PROPERTY(int sequentialShotsInterval READ sequentialShotsInterval WRITE setSequentialShotsInterval NOTIFY sequentialShotsIntervalChanged);
   Q_PROPERTY(int sequentialShotsDelay READ sequentialShotsDelay WRITE setSequentialShotsDelay NOTIFY sequentialShotsDelayChanged);
   Q_PROPERTY(bool focusBeforeSequentialShots READ isFocusBeforeSequentialShotsEnabled WRITE setFocusBeforeSequentialShotsEnabled NOTIFY focusBeforeSequentialShotsChanged);
+  Q_PROPERTY(int sequentialShotsKeep READ sequentialShotsKeep WRITE setSequentialShotsKeep NOTIFY sequentialShotsKeepChanged);
+  Q_PROPERTY(int motionSensitivity READ motionSensitivity WRITE setMotionSensitivity NOTIFY motionSensitivityChanged);
+  Q_PROPERTY(int motionCoolDown READ motionCoolDown WRITE setMotionCoolDown NOTIFY motionCoolDownChanged);
+  Q_PROPERTY(qreal hdrStops READ hdrStops WRITE setHdrStops NOTIFY hdrStopsChanged);
+  Q_PROPERTY(bool hdrKeepBrackets READ isHdrKeepBracketsEnabled WRITE setHdrKeepBracketsEnabled NOTIFY hdrKeepBracketsChanged);
+  Q_PROPERTY(int nightStackFrames READ nightStackFrames WRITE setNightStackFrames NOTIFY nightStackFramesChanged);
+  Q_PROPERTY(int timeLapseInterval READ timeLapseInterval WRITE setTimeLapseInterval NOTIFY timeLapseIntervalChanged);
+  Q_PROPERTY(int timeLapseFrameRate READ timeLapseFrameRate WRITE setTimeLapseFrameRate NOTIFY timeLapseFrameRateChanged);
 
 public:
   Settings(QObject *parent = 0);
@@ -102,6 +111,9 @@ public:
   bool isNightModeEnabled() const;
   void setNightModeEnabled(bool enabled);
 
+  bool isLosslessRotationEnabled() const;
+  void setLosslessRotationEnabled(bool enabled);
+
   QString plugin() const;
   void setPlugin(const QString& plugin);
 
@@ -126,6 +138,30 @@ public:
   bool isFocusBeforeSequentialShotsEnabled() const;
   void setFocusBeforeSequentialShotsEnabled(bool enabled);
 
+  int sequentialShotsKeep() const;
+  void setSequentialShotsKeep(int keep);
+
+  int motionSensitivity() const;
+  void setMotionSensitivity(int sensitivity);
+
+  int motionCoolDown() const;
+  void setMotionCoolDown(int coolDown);
+
+  qreal hdrStops() const;
+  void setHdrStops(qreal stops);
+
+  bool isHdrKeepBracketsEnabled() const;
+  void setHdrKeepBracketsEnabled(bool enabled);
+
+  int nightStackFrames() const;
+  void setNightStackFrames(int frames);
+
+  int timeLapseInterval() const;
+  void setTimeLapseInterval(int interval);
+
+  int timeLapseFrameRate() const;
+  void setTimeLapseFrameRate(int frameRate);
+
 signals:
   void modeChanged();
   void creatorNameChanged();
@@ -140,6 +176,7 @@ signals:
   void deviceChanged();
   void previewEnabledChanged();
   void nightModeChanged();
+  void losslessRotationChanged();
   void pluginChanged();
   void captureTimerDelayChanged();
   void leftHandedModeChanged();
@@ -147,6 +184,14 @@ signals:
   void sequentialShotsIntervalChanged();
   void sequentialShotsDelayChanged();
   void focusBeforeSequentialShotsChanged();
+  void sequentialShotsKeepChanged();
+  void motionSensitivityChanged();
+  void motionCoolDownChanged();
+  void hdrStopsChanged();
+  void hdrKeepBracketsChanged();
+  void nightStackFramesChanged();
+  void timeLapseIntervalChanged();
+  void timeLapseFrameRateChanged();
 
 private:
   QSettings *m_settings;
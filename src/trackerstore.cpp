@@ -40,6 +40,12 @@
 #define IMAGE_QUERY BEGIN_IMAGE QUERY_END
 #define VIDEO_QUERY BEGIN_VIDEO QUERY_END
 
+// nao:numericRating is the user's star rating so the score is kept as a property of our own.
+#define SCORE_PROPERTY "\"cameraplus-burst-score\""
+#define SCORE_QUERY "DELETE { ?p a rdfs:Resource } WHERE { ?f nie:url ?:file_url ; nao:hasProperty ?p . ?p nao:propertyName " SCORE_PROPERTY " } " \
+  "INSERT { _:p a nao:Property ; nao:propertyName " SCORE_PROPERTY " ; nao:propertyValue ?:score . ?f nao:hasProperty _:p } WHERE { ?f nie:url ?:file_url }"
+#define REMOVE_QUERY "DELETE { ?f a rdfs:Resource } WHERE { ?f nie:url ?:file_url }"
+
 TrackerStore::TrackerStore(QObject *parent) :
   QObject(parent),
   m_connection(0) {
@@ -100,6 +106,31 @@ void TrackerStore::storeVideo(const QString& path) {
   execQuery(VIDEO_QUERY, path);
 }
 
+void TrackerStore::storeScore(const QString& path, qreal score) {
+  if (!isActive()) {
+    qmlInfo(this) << "TrackerStore is not active";
+    return;
+  }
+
+  QSparqlQuery q(SCORE_QUERY, QSparqlQuery::InsertStatement);
+  q.bindValue("file_url", QUrl::fromLocalFile(path));
+  q.bindValue("score", QString::number(score));
+
+  exec(q);
+}
+
+void TrackerStore::removeImage(const QString& path) {
+  if (!isActive()) {
+    qmlInfo(this) << "TrackerStore is not active";
+    return;
+  }
+
+  QSparqlQuery q(REMOVE_QUERY, QSparqlQuery::DeleteStatement);
+  q.bindValue("file_url", QUrl::fromLocalFile(path));
+
+  exec(q);
+}
+
 bool TrackerStore::execQuery(const QString& query, const QString& path) {
   QDateTime dateTime = QDateTime::currentDateTime();
 
@@ -52,6 +52,8 @@ public:
 public slots:
   void storeImage(const QString& path);
   void storeVideo(const QString& path);
+  void storeScore(const QString& path, qreal score);
+  void removeImage(const QString& path);
 
 signals:
   void activeChanged();
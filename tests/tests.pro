@@ -1,4 +1,22 @@
 TEMPLATE = subdirs
 SUBDIRS = \
           tst_position.pro \
-          tst_camera.pro
+          tst_camera.pro \
+          tst_config.pro \
+          tst_messagereplay.pro \
+          tst_regiondetector.pro \
+          tst_histogram.pro \
+          tst_motiondetector.pro \
+          tst_phasecorrelation.pro \
+          tst_jpegmetadata.pro \
+          tst_exposurefusion.pro \
+          tst_nightstacker.pro \
+          tst_videosnapshot.pro \
+          tst_audiolevel.pro \
+          tst_recordingmonitor.pro \
+          tst_filewriter.pro \
+          tst_bitrategovernor.pro \
+          tst_jpegencoder.pro \
+          tst_jpegrotator.pro \
+          tst_sharpness.pro \
+          tst_burstselector.pro
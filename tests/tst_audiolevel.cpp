@@ -0,0 +1,113 @@
+#include <QTest>
+#include <QVector>
+#include <cmath>
+#include "qtcamaudiolevel.h"
+
+class tst_audiolevel : public QObject {
+  Q_OBJECT
+
+private slots:
+  void measure_data();
+  void measure();
+  void sine();
+  void throughput();
+};
+
+void tst_audiolevel::measure_data() {
+  QTest::addColumn<int>("channels");
+  QTest::addColumn<int>("frames");
+
+  QTest::newRow("mono") << 1 << 1031;
+  QTest::newRow("stereo") << 2 << 1031;
+  QTest::newRow("3 channels") << 3 << 517;
+  QTest::newRow("short") << 2 << 3;
+  QTest::newRow("empty") << 1 << 0;
+}
+
+void tst_audiolevel::measure() {
+  QFETCH(int, channels);
+  QFETCH(int, frames);
+
+  qsrand(7);
+
+  QVector<qint16> samples(frames * channels);
+  for (int x = 0; x < samples.size(); x++) {
+    switch (qrand() % 16) {
+    case 0:
+      samples[x] = -32768;
+      break;
+    case 1:
+      samples[x] = 32767;
+      break;
+    default:
+      samples[x] = qrand() % 65536 - 32768;
+    }
+  }
+
+  quint64 squares[QT_CAM_AUDIO_LEVEL_MAX_CHANNELS];
+  quint64 expectedSquares[QT_CAM_AUDIO_LEVEL_MAX_CHANNELS];
+  int peak[QT_CAM_AUDIO_LEVEL_MAX_CHANNELS];
+  int expectedPeak[QT_CAM_AUDIO_LEVEL_MAX_CHANNELS];
+
+  // Results are accumulated on top of what is there.
+  for (int x = 0; x < QT_CAM_AUDIO_LEVEL_MAX_CHANNELS; x++) {
+    squares[x] = expectedSquares[x] = x * 1000;
+    peak[x] = expectedPeak[x] = x;
+  }
+
+  for (int x = 0; x < frames; x++) {
+    for (int c = 0; c < channels; c++) {
+      int sample = samples[x * channels + c];
+      expectedSquares[c] += sample * sample;
+      expectedPeak[c] = qMax(expectedPeak[c], qMin(qAbs(sample), 32767));
+    }
+  }
+
+  QtCamAudioLevel::measure(samples.constData(), frames, channels, squares, peak);
+
+  for (int c = 0; c < QT_CAM_AUDIO_LEVEL_MAX_CHANNELS; c++) {
+    QCOMPARE(squares[c], expectedSquares[c]);
+    QCOMPARE(peak[c], expectedPeak[c]);
+  }
+}
+
+void tst_audiolevel::sine() {
+  // Full scale on the left, silence on the right.
+  const int frames = 4800;
+  QVector<qint16> samples(frames * 2);
+
+  for (int x = 0; x < frames; x++) {
+    samples[x * 2] = qRound(32767 * sin(2 * M_PI * x / 48.0));
+    samples[x * 2 + 1] = 0;
+  }
+
+  quint64 squares[2] = {0, 0};
+  int peak[2] = {0, 0};
+
+  QtCamAudioLevel::measure(samples.constData(), frames, 2, squares, peak);
+
+  QCOMPARE(peak[0], 32767);
+  QCOMPARE(peak[1], 0);
+  QCOMPARE(squares[1], (quint64)0);
+
+  qreal rms = sqrt((double)squares[0] / frames) / 32767.0;
+  QVERIFY(qAbs(rms - M_SQRT1_2) < 0.001);
+}
+
+void tst_audiolevel::throughput() {
+  // One second of 48kHz stereo.
+  QVector<qint16> samples(48000 * 2);
+  for (int x = 0; x < samples.size(); x++) {
+    samples[x] = qrand() % 65536 - 32768;
+  }
+
+  QBENCHMARK {
+    quint64 squares[2] = {0, 0};
+    int peak[2] = {0, 0};
+    QtCamAudioLevel::measure(samples.constData(), 48000, 2, squares, peak);
+  }
+}
+
+QTEST_APPLESS_MAIN(tst_audiolevel);
+
+#include "tst_audiolevel.moc"
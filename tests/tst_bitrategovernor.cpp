@@ -0,0 +1,216 @@
+#include <QTest>
+#include <QDir>
+#include <QFile>
+#include <QSignalSpy>
+#include <climits>
+#include "qtcambitrategovernor.h"
+
+#define MB                     (1024 * 1024LL)
+
+class FakeGovernor : public QtCamBitrateGovernor {
+public:
+  FakeGovernor() : space(0) {}
+
+  qint64 space;
+
+protected:
+  qint64 freeSpace(const QString& path) {
+    Q_UNUSED(path);
+    return space;
+  }
+};
+
+class tst_bitrategovernor : public QObject {
+  Q_OBJECT
+
+private slots:
+  void initTestCase();
+  void cleanupTestCase();
+
+  void nominal();
+  void thermal();
+  void hysteresis();
+  void battery();
+  void storage();
+  void remainingTime();
+  void noThermalZone();
+
+private:
+  void setTemperature(int degrees);
+  void setup(FakeGovernor& governor);
+
+  QString m_zone;
+};
+
+void tst_bitrategovernor::initTestCase() {
+  // A fake sysfs thermal zone.
+  m_zone = QDir::temp().absoluteFilePath(QString("tst_bitrategovernor-%1")
+					 .arg(QCoreApplication::applicationPid()));
+  QVERIFY(QDir().mkpath(m_zone));
+}
+
+void tst_bitrategovernor::cleanupTestCase() {
+  QFile::remove(m_zone + "/temp");
+  QDir().rmdir(m_zone);
+}
+
+void tst_bitrategovernor::setTemperature(int degrees) {
+  QFile file(m_zone + "/temp");
+  QVERIFY(file.open(QFile::WriteOnly | QFile::Truncate));
+  file.write(QByteArray::number(degrees * 1000) + "\n");
+}
+
+void tst_bitrategovernor::setup(FakeGovernor& governor) {
+  governor.setThermalZone(m_zone);
+  governor.setThermalLimits(45, 55);
+  governor.setStoragePath("/fake");
+  governor.setNominalBitrate(12000000);
+  governor.setMinimumBitrate(2000000);
+  governor.space = 64000 * MB;
+}
+
+void tst_bitrategovernor::nominal() {
+  setTemperature(30);
+
+  FakeGovernor governor;
+  setup(governor);
+
+  QSignalSpy spy(&governor, SIGNAL(bitrateChanged()));
+  governor.update();
+
+  QCOMPARE(spy.count(), 1);
+  QCOMPARE(governor.bitrate(), 12000000);
+  QCOMPARE(governor.temperature(), 30);
+  QCOMPARE(governor.thermalState(), QtCamBitrateGovernor::Normal);
+  QVERIFY(!governor.isLowerResolutionSuggested());
+
+  // Nothing changed.
+  governor.update();
+  QCOMPARE(spy.count(), 1);
+}
+
+void tst_bitrategovernor::thermal() {
+  FakeGovernor governor;
+  setup(governor);
+
+  setTemperature(47);
+  governor.update();
+  QCOMPARE(governor.thermalState(), QtCamBitrateGovernor::Warm);
+  QCOMPARE(governor.bitrate(), 9000000);
+  QVERIFY(!governor.isLowerResolutionSuggested());
+
+  setTemperature(60);
+  governor.update();
+  QCOMPARE(governor.thermalState(), QtCamBitrateGovernor::Hot);
+  QCOMPARE(governor.bitrate(), 6000000);
+  QVERIFY(governor.isLowerResolutionSuggested());
+}
+
+void tst_bitrategovernor::hysteresis() {
+  FakeGovernor governor;
+  setup(governor);
+
+  setTemperature(56);
+  governor.update();
+  QCOMPARE(governor.thermalState(), QtCamBitrateGovernor::Hot);
+
+  // Just below the limit is not enough to cool down.
+  setTemperature(54);
+  governor.update();
+  QCOMPARE(governor.thermalState(), QtCamBitrateGovernor::Hot);
+
+  setTemperature(52);
+  governor.update();
+  QCOMPARE(governor.thermalState(), QtCamBitrateGovernor::Warm);
+
+  setTemperature(44);
+  governor.update();
+  QCOMPARE(governor.thermalState(), QtCamBitrateGovernor::Warm);
+
+  setTemperature(40);
+  governor.update();
+  QCOMPARE(governor.thermalState(), QtCamBitrateGovernor::Normal);
+  QCOMPARE(governor.bitrate(), 12000000);
+}
+
+void tst_bitrategovernor::battery() {
+  setTemperature(30);
+
+  FakeGovernor governor;
+  setup(governor);
+
+  governor.setBatteryState(10, false);
+  governor.update();
+  QCOMPARE(governor.bitrate(), 9000000);
+
+  // Charging does not count as low.
+  governor.setBatteryState(10, true);
+  governor.update();
+  QCOMPARE(governor.bitrate(), 12000000);
+
+  // Both at the same time.
+  setTemperature(50);
+  governor.setBatteryState(5, false);
+  governor.update();
+  QCOMPARE(governor.bitrate(), 6500000);
+}
+
+void tst_bitrategovernor::storage() {
+  setTemperature(30);
+
+  FakeGovernor governor;
+  setup(governor);
+
+  // The 500 MB left after the reserve last 10 minutes at about 6.7 Mbit/s.
+  governor.space = 600 * MB;
+  governor.update();
+  QCOMPARE(governor.bitrate(), 6500000);
+  QVERIFY(!governor.isLowerResolutionSuggested());
+
+  // Not even the minimum fits.
+  governor.space = 150 * MB;
+  governor.update();
+  QCOMPARE(governor.bitrate(), 2000000);
+  QVERIFY(governor.isLowerResolutionSuggested());
+
+  governor.space = 64000 * MB;
+  governor.update();
+  QCOMPARE(governor.bitrate(), 12000000);
+  QVERIFY(!governor.isLowerResolutionSuggested());
+}
+
+void tst_bitrategovernor::remainingTime() {
+  setTemperature(30);
+
+  FakeGovernor governor;
+  setup(governor);
+
+  governor.space = 100 * MB + 12000000LL + 256 * 1024;
+  governor.update();
+  QCOMPARE(governor.remainingTime(), Q_INT64_C(8));
+
+  governor.space = 50 * MB;
+  governor.update();
+  QCOMPARE(governor.remainingTime(), Q_INT64_C(0));
+
+  // Unknown.
+  governor.space = -1;
+  governor.update();
+  QCOMPARE(governor.remainingTime(), Q_INT64_C(-1));
+  QCOMPARE(governor.bitrate(), 12000000);
+}
+
+void tst_bitrategovernor::noThermalZone() {
+  FakeGovernor governor;
+  setup(governor);
+  governor.setThermalZone(m_zone + "/nonexistent");
+
+  governor.update();
+  QCOMPARE(governor.temperature(), INT_MIN);
+  QCOMPARE(governor.thermalState(), QtCamBitrateGovernor::Normal);
+  QCOMPARE(governor.bitrate(), 12000000);
+}
+
+QTEST_APPLESS_MAIN(tst_bitrategovernor);
+
+#include "tst_bitrategovernor.moc"
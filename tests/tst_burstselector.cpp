@@ -0,0 +1,235 @@
+#include <QTest>
+#include <QSignalSpy>
+#include <QTemporaryFile>
+#include <QImage>
+#include <QFile>
+#include <QDir>
+#include "burstselector.h"
+
+#define WIDTH  320
+#define HEIGHT 240
+
+class tst_burstselector : public QObject {
+  Q_OBJECT
+
+private slots:
+  void initTestCase();
+  void cleanupTestCase();
+
+  void measure();
+  void ranking_data();
+  void ranking();
+  void keepAll();
+  void discard();
+
+private:
+  QImage noise(int low, int high, int seed);
+  QImage blurred(const QImage& image);
+  QString save(const QImage& image, const QString& name);
+  bool run(BurstSelector& selector, const QStringList& files);
+
+  QString m_sharp;
+  QString m_blurred;
+  QString m_dark;
+};
+
+QImage tst_burstselector::noise(int low, int high, int seed) {
+  QImage image(WIDTH, HEIGHT, QImage::Format_RGB32);
+
+  qsrand(seed);
+
+  for (int y = 0; y < HEIGHT; y++) {
+    QRgb *line = (QRgb *)image.scanLine(y);
+    for (int x = 0; x < WIDTH; x++) {
+      int v = low + qrand() % (high - low + 1);
+      line[x] = qRgb(v, v, v);
+    }
+  }
+
+  return image;
+}
+
+QImage tst_burstselector::blurred(const QImage& image) {
+  QImage out(image.size(), QImage::Format_RGB32);
+
+  // 5x5 box blur. Same brightness, a lot less detail.
+  for (int y = 0; y < image.height(); y++) {
+    for (int x = 0; x < image.width(); x++) {
+      int sum = 0;
+      int n = 0;
+
+      for (int dy = -2; dy <= 2; dy++) {
+	for (int dx = -2; dx <= 2; dx++) {
+	  int xx = qBound(0, x + dx, image.width() - 1);
+	  int yy = qBound(0, y + dy, image.height() - 1);
+	  sum += qGray(image.pixel(xx, yy));
+	  ++n;
+	}
+      }
+
+      out.setPixel(x, y, qRgb(sum / n, sum / n, sum / n));
+    }
+  }
+
+  return out;
+}
+
+QString tst_burstselector::save(const QImage& image, const QString& name) {
+  QString fileName = QDir::temp().filePath(QString("tst_burstselector_%1.png").arg(name));
+  image.save(fileName, "PNG");
+  return fileName;
+}
+
+bool tst_burstselector::run(BurstSelector& selector, const QStringList& files) {
+  QSignalSpy finished(&selector, SIGNAL(finished(const QStringList&, const QStringList&)));
+
+  selector.begin();
+
+  foreach (const QString& file, files) {
+    selector.add(file);
+  }
+
+  selector.end();
+
+  for (int x = 0; x < 500 && finished.isEmpty(); x++) {
+    QTest::qWait(10);
+  }
+
+  return !selector.isBusy() && finished.count() == 1;
+}
+
+void tst_burstselector::initTestCase() {
+  QImage sharp = noise(60, 180, 1);
+
+  m_sharp = save(sharp, "sharp");
+  m_blurred = save(blurred(sharp), "blurred");
+  // Mostly clipped and barely any detail left.
+  m_dark = save(noise(0, 4, 2), "dark");
+}
+
+void tst_burstselector::cleanupTestCase() {
+  QFile::remove(m_sharp);
+  QFile::remove(m_blurred);
+  QFile::remove(m_dark);
+}
+
+void tst_burstselector::measure() {
+  double sharpSharpness, sharpExposure;
+  double blurredSharpness, blurredExposure;
+  double darkSharpness, darkExposure;
+
+  QVERIFY(BurstSelector::measure(QImage(m_sharp), &sharpSharpness, &sharpExposure));
+  QVERIFY(BurstSelector::measure(QImage(m_blurred), &blurredSharpness, &blurredExposure));
+  QVERIFY(BurstSelector::measure(QImage(m_dark), &darkSharpness, &darkExposure));
+
+  QVERIFY(sharpSharpness > blurredSharpness * 4);
+  QVERIFY(qAbs(sharpExposure - blurredExposure) < 0.05);
+  QVERIFY(darkExposure < 0.1);
+  QVERIFY(sharpExposure > 0.8);
+
+  double sharpness, exposure;
+  QVERIFY(!BurstSelector::measure(QImage(1, 1, QImage::Format_RGB32), &sharpness, &exposure));
+}
+
+void tst_burstselector::ranking_data() {
+  QTest::addColumn<int>("keep");
+  QTest::addColumn<QStringList>("kept");
+  QTest::addColumn<QStringList>("rejected");
+
+  QTest::newRow("1") << 1 << (QStringList() << "sharp") << (QStringList() << "blurred" << "dark");
+  QTest::newRow("2") << 2 << (QStringList() << "sharp" << "blurred") << (QStringList() << "dark");
+  QTest::newRow("more than the burst") << 5
+				       << (QStringList() << "sharp" << "blurred" << "dark")
+				       << QStringList();
+}
+
+void tst_burstselector::ranking() {
+  QFETCH(int, keep);
+  QFETCH(QStringList, kept);
+  QFETCH(QStringList, rejected);
+
+  QHash<QString, QString> names;
+  names[m_sharp] = "sharp";
+  names[m_blurred] = "blurred";
+  names[m_dark] = "dark";
+
+  BurstSelector selector;
+  selector.setKeep(keep);
+
+  QSignalSpy scored(&selector, SIGNAL(scored(const QString&, qreal)));
+  QSignalSpy finished(&selector, SIGNAL(finished(const QStringList&, const QStringList&)));
+
+  // Added out of order on purpose.
+  QVERIFY(run(selector, QStringList() << m_dark << m_sharp << m_blurred));
+
+  QCOMPARE(scored.count(), 3);
+  for (int x = 0; x < scored.count(); x++) {
+    qreal score = scored.at(x).at(1).toReal();
+    QVERIFY(score >= 0.0 && score <= 1.0);
+  }
+
+  QStringList gotKept, gotRejected;
+  foreach (const QString& file, finished.at(0).at(0).toStringList()) {
+    gotKept << names[file];
+  }
+
+  foreach (const QString& file, finished.at(0).at(1).toStringList()) {
+    gotRejected << names[file];
+  }
+
+  QCOMPARE(gotKept, kept);
+  QCOMPARE(gotRejected, rejected);
+
+  // Nothing is removed unless asked to.
+  QVERIFY(QFile::exists(m_sharp));
+  QVERIFY(QFile::exists(m_blurred));
+  QVERIFY(QFile::exists(m_dark));
+}
+
+void tst_burstselector::keepAll() {
+  BurstSelector selector;
+  selector.setKeep(0);
+  selector.setDiscard(true);
+
+  QSignalSpy finished(&selector, SIGNAL(finished(const QStringList&, const QStringList&)));
+  QSignalSpy removed(&selector, SIGNAL(removed(const QString&)));
+
+  QVERIFY(run(selector, QStringList() << m_dark << m_sharp << m_blurred));
+
+  QCOMPARE(finished.at(0).at(0).toStringList(),
+	   QStringList() << m_sharp << m_blurred << m_dark);
+  QVERIFY(finished.at(0).at(1).toStringList().isEmpty());
+  QCOMPARE(removed.count(), 0);
+
+  QVERIFY(QFile::exists(m_dark));
+}
+
+void tst_burstselector::discard() {
+  // Copies because they get removed.
+  QStringList files;
+  foreach (const QString& file, QStringList() << m_sharp << m_blurred << m_dark) {
+    QString copy = file + ".copy.png";
+    QFile::remove(copy);
+    QVERIFY(QFile::copy(file, copy));
+    files << copy;
+  }
+
+  BurstSelector selector;
+  selector.setKeep(1);
+  selector.setDiscard(true);
+
+  QSignalSpy removed(&selector, SIGNAL(removed(const QString&)));
+
+  QVERIFY(run(selector, files));
+
+  QCOMPARE(removed.count(), 2);
+  QVERIFY(QFile::exists(files[0]));
+  QVERIFY(!QFile::exists(files[1]));
+  QVERIFY(!QFile::exists(files[2]));
+
+  QFile::remove(files[0]);
+}
+
+QTEST_MAIN(tst_burstselector);
+
+#include "tst_burstselector.moc"
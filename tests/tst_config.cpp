@@ -0,0 +1,50 @@
+#include <QTest>
+#include "qtcamconfig.h"
+
+class tst_config : public QObject {
+  Q_OBJECT
+
+private slots:
+  void init();
+  void cleanup();
+
+  void modeSwitch();
+
+private:
+  QtCamConfig *m_conf;
+};
+
+void tst_config::init() {
+  m_conf = new QtCamConfig;
+}
+
+void tst_config::cleanup() {
+  delete m_conf; m_conf = 0;
+}
+
+void tst_config::modeSwitch() {
+  // What an image -> video -> image round trip asks the configuration for
+  QBENCHMARK {
+    m_conf->mediaType("viewfinder-caps");
+    m_conf->mediaFourcc("viewfinder-caps");
+    m_conf->mediaType("video-capture-caps");
+    m_conf->mediaFourcc("video-capture-caps");
+    m_conf->isPreviewSupported();
+    m_conf->viewfinderFiltersUseAnalysisBin();
+
+    m_conf->mediaType("viewfinder-caps");
+    m_conf->mediaFourcc("viewfinder-caps");
+    m_conf->mediaType("image-capture-caps");
+    m_conf->mediaFourcc("image-capture-caps");
+    m_conf->isPreviewSupported();
+    m_conf->viewfinderFiltersUseAnalysisBin();
+    m_conf->fastCaptureProperty();
+
+    m_conf->viewfinderSink();
+    m_conf->viewfinderRenderer();
+  }
+}
+
+QTEST_APPLESS_MAIN(tst_config);
+
+#include "tst_config.moc"
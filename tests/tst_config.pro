@@ -0,0 +1,11 @@
+include(../cameraplus.pri)
+
+TEMPLATE = app
+QT += testlib
+
+DEPENDPATH += ../lib
+INCLUDEPATH += ../lib
+
+LIBS += -L../lib/ -lqtcamera
+
+SOURCES += tst_config.cpp
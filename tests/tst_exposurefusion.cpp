@@ -0,0 +1,165 @@
+#include <QTest>
+#include <QThreadPool>
+#include <QElapsedTimer>
+#include <QDebug>
+#include "qtcamexposurefusion.h"
+
+class tst_exposurefusion : public QObject {
+  Q_OBJECT
+
+private slots:
+  void align_data();
+  void align();
+  void fuseIdentical();
+  void fuseBracket();
+  void benchmark();
+
+private:
+  QImage scene(int width, int height);
+  QImage luma(const QImage& image, const QRect& rect, qreal gain);
+  QImage exposed(const QImage& image, qreal gain);
+};
+
+QImage tst_exposurefusion::scene(int width, int height) {
+  // Random blocks, smoothed. Enough structure for the bitmaps and the weights.
+  qsrand(7);
+
+  QImage blocks(width / 8 + 1, height / 8 + 1, QImage::Format_RGB32);
+  for (int y = 0; y < blocks.height(); y++) {
+    for (int x = 0; x < blocks.width(); x++) {
+      int v = qrand() % 200 + 28;
+      blocks.setPixel(x, y, qRgb(v, qBound(0, v + qrand() % 40 - 20, 255), v / 2));
+    }
+  }
+
+  return blocks.scaled(width, height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+}
+
+QImage tst_exposurefusion::luma(const QImage& image, const QRect& rect, qreal gain) {
+  QImage out(rect.size(), QImage::Format_Indexed8);
+  for (int y = 0; y < rect.height(); y++) {
+    const QRgb *in = (const QRgb *)image.constScanLine(rect.y() + y) + rect.x();
+    uchar *line = out.scanLine(y);
+    for (int x = 0; x < rect.width(); x++) {
+      line[x] = qMin(255, (int)(qGray(in[x]) * gain));
+    }
+  }
+
+  return out;
+}
+
+QImage tst_exposurefusion::exposed(const QImage& image, qreal gain) {
+  QImage out(image.size(), QImage::Format_RGB32);
+  for (int y = 0; y < image.height(); y++) {
+    const QRgb *in = (const QRgb *)image.constScanLine(y);
+    QRgb *line = (QRgb *)out.scanLine(y);
+    for (int x = 0; x < image.width(); x++) {
+      line[x] = qRgb(qMin(255, (int)(qRed(in[x]) * gain)),
+		     qMin(255, (int)(qGreen(in[x]) * gain)),
+		     qMin(255, (int)(qBlue(in[x]) * gain)));
+    }
+  }
+
+  return out;
+}
+
+void tst_exposurefusion::align_data() {
+  QTest::addColumn<QPoint>("offset");
+  QTest::addColumn<qreal>("gain");
+
+  QTest::newRow("none") << QPoint(0, 0) << 1.0;
+  QTest::newRow("shifted") << QPoint(5, -3) << 1.0;
+  QTest::newRow("darker") << QPoint(-7, 2) << 0.4;
+  QTest::newRow("brighter") << QPoint(11, 9) << 1.8;
+}
+
+void tst_exposurefusion::align() {
+  QFETCH(QPoint, offset);
+  QFETCH(qreal, gain);
+
+  QImage base = scene(320, 240);
+  QRect rect(32, 32, 256, 176);
+
+  QImage reference = luma(base, rect, 1.0);
+  QImage image = luma(base, rect.translated(offset), gain);
+
+  // image(x - offset) == reference(x)
+  QCOMPARE(QtCamExposureFusion::align(reference, image, 4), -offset);
+}
+
+void tst_exposurefusion::fuseIdentical() {
+  QImage image = scene(200, 120);
+
+  QList<QImage> images;
+  images << image << image << image;
+
+  QThreadPool pool;
+  QImage out = QtCamExposureFusion::fuse(images, QList<QPoint>() << QPoint() << QPoint()
+					 << QPoint(), &pool);
+
+  QCOMPARE(out.size(), image.size());
+
+  for (int y = 0; y < image.height(); y++) {
+    for (int x = 0; x < image.width(); x++) {
+      QRgb a = image.pixel(x, y);
+      QRgb b = out.pixel(x, y);
+      QVERIFY(qAbs(qRed(a) - qRed(b)) <= 1);
+      QVERIFY(qAbs(qGreen(a) - qGreen(b)) <= 1);
+      QVERIFY(qAbs(qBlue(a) - qBlue(b)) <= 1);
+    }
+  }
+}
+
+void tst_exposurefusion::fuseBracket() {
+  QImage image = scene(200, 120);
+
+  QList<QImage> images;
+  images << exposed(image, 0.3) << image << exposed(image, 3.0);
+
+  QThreadPool pool;
+  QImage out = QtCamExposureFusion::fuse(images, QList<QPoint>() << QPoint() << QPoint()
+					 << QPoint(), &pool);
+
+  int clipped = 0, crushed = 0, brightClipped = 0, darkCrushed = 0;
+
+  for (int y = 0; y < image.height(); y++) {
+    for (int x = 0; x < image.width(); x++) {
+      clipped += qGray(out.pixel(x, y)) >= 250;
+      crushed += qGray(out.pixel(x, y)) <= 10;
+      brightClipped += qGray(images[2].pixel(x, y)) >= 250;
+      darkCrushed += qGray(images[0].pixel(x, y)) <= 10;
+    }
+  }
+
+  QVERIFY(brightClipped > 0);
+  QVERIFY(clipped < brightClipped / 4);
+  QVERIFY(crushed <= darkCrushed);
+}
+
+void tst_exposurefusion::benchmark() {
+  QImage image = scene(1600, 1200);
+
+  QList<QImage> images;
+  images << exposed(image, 0.5) << image << exposed(image, 2.0);
+
+  QList<QPoint> offsets;
+  offsets << QPoint(3, -2) << QPoint() << QPoint(-4, 1);
+
+  QThreadPool pool;
+
+  QElapsedTimer timer;
+  int runs = 0;
+  timer.start();
+
+  QBENCHMARK {
+    QtCamExposureFusion::fuse(images, offsets, &pool);
+    ++runs;
+  }
+
+  qDebug() << "Exposure fusion:" << timer.elapsed() / (runs * 1.92) << "ms/MP with"
+	   << pool.maxThreadCount() << "threads";
+}
+
+QTEST_APPLESS_MAIN(tst_exposurefusion);
+
+#include "tst_exposurefusion.moc"
@@ -0,0 +1,175 @@
+#include <QTest>
+#include <QTemporaryFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QDebug>
+#include "qtcamfilewriter.h"
+
+// The benchmark writes to QTCAM_BENCH_DIR or the temporary directory. To
+// measure on the kind of media we record to:
+//   tmpfs: mount -t tmpfs -o size=256m tmpfs /mnt/bench
+//   vfat:  dd if=/dev/zero of=vfat.img bs=1M count=256 && mkfs.vfat vfat.img &&
+//          mount -o loop vfat.img /mnt/bench
+// then run with QTCAM_BENCH_DIR=/mnt/bench
+
+#define BUFFER_SIZE            (4 * 1024 * 1024)
+#define BENCH_SIZE             (64 * 1024 * 1024)
+#define BENCH_CHUNK            (32 * 1024)
+
+class tst_filewriter : public QObject {
+  Q_OBJECT
+
+private slots:
+  void sequential();
+  void rewrite();
+  void trim();
+  void badPath();
+  void throughput_data();
+  void throughput();
+
+private:
+  QString benchDir();
+  QByteArray pattern(int size, int seed);
+};
+
+QByteArray tst_filewriter::pattern(int size, int seed) {
+  QByteArray data(size, 0);
+
+  for (int x = 0; x < size; x++) {
+    data[x] = (char)((x * 31 + seed) & 0xff);
+  }
+
+  return data;
+}
+
+QString tst_filewriter::benchDir() {
+  QByteArray dir = qgetenv("QTCAM_BENCH_DIR");
+  return dir.isEmpty() ? QDir::tempPath() : QString::fromLocal8Bit(dir);
+}
+
+void tst_filewriter::sequential() {
+  QTemporaryFile file;
+  QVERIFY(file.open());
+
+  QByteArray data = pattern(3 * 1024 * 1024 + 123, 7);
+
+  // Small ring so it wraps around a few times.
+  QtCamFileWriter writer(256 * 1024);
+  QVERIFY(writer.open(file.fileName(), 1024 * 1024));
+
+  int offset = 0;
+  int size = 1;
+  while (offset < data.size()) {
+    int len = qMin(size, data.size() - offset);
+    QVERIFY(writer.write(offset, data.constData() + offset, len));
+    offset += len;
+    size = (size * 7 + 13) % 70000 + 1;
+  }
+
+  QVERIFY(writer.close());
+  QVERIFY(!writer.isOpen());
+
+  QCOMPARE(file.readAll(), data);
+}
+
+void tst_filewriter::rewrite() {
+  QTemporaryFile file;
+  QVERIFY(file.open());
+
+  QByteArray data = pattern(1024 * 1024, 3);
+  QByteArray header = pattern(64, 100);
+
+  QtCamFileWriter writer(BUFFER_SIZE);
+  QVERIFY(writer.open(file.fileName(), 0));
+
+  QVERIFY(writer.write(0, data.constData(), data.size()));
+  // Muxers go back to fix up the headers once they know the sizes.
+  QVERIFY(writer.write(16, header.constData(), header.size()));
+  QVERIFY(writer.write(data.size(), header.constData(), header.size()));
+  QVERIFY(writer.close());
+
+  data.replace(16, header.size(), header);
+  data.append(header);
+
+  QCOMPARE(file.readAll(), data);
+}
+
+void tst_filewriter::trim() {
+  QTemporaryFile file;
+  QVERIFY(file.open());
+
+  // Left over from an earlier recording. We do not truncate on open.
+  QCOMPARE(file.write(pattern(8192, 1)), qint64(8192));
+  QVERIFY(file.flush());
+
+  QByteArray data = pattern(1000, 2);
+
+  QtCamFileWriter writer(BUFFER_SIZE);
+  QVERIFY(writer.open(file.fileName(), 10 * 1024 * 1024));
+  QVERIFY(writer.write(0, data.constData(), data.size()));
+  QVERIFY(writer.close());
+
+  // Neither the old data nor the preallocation survive.
+  QCOMPARE(QFileInfo(file.fileName()).size(), qint64(data.size()));
+
+  QVERIFY(file.seek(0));
+  QCOMPARE(file.readAll(), data);
+}
+
+void tst_filewriter::badPath() {
+  QtCamFileWriter writer(BUFFER_SIZE);
+  QVERIFY(!writer.open("/nonexistent/directory/file.mp4", 0));
+  QVERIFY(!writer.isOpen());
+  QVERIFY(!writer.write(0, "x", 1));
+}
+
+void tst_filewriter::throughput_data() {
+  QTest::addColumn<bool>("buffered");
+
+  QTest::newRow("direct") << false;
+  QTest::newRow("write-behind") << true;
+}
+
+void tst_filewriter::throughput() {
+  QFETCH(bool, buffered);
+
+  QByteArray data = pattern(BENCH_CHUNK, 5);
+
+  qint64 maxStall = 0;
+
+  QBENCHMARK {
+    QTemporaryFile file(benchDir() + "/tst_filewriter-XXXXXX");
+    QVERIFY(file.open());
+
+    if (buffered) {
+      QtCamFileWriter writer(BUFFER_SIZE);
+      QVERIFY(writer.open(file.fileName(), 2 * 1024 * 1024));
+
+      for (qint64 offset = 0; offset < BENCH_SIZE; offset += data.size()) {
+	QVERIFY(writer.write(offset, data.constData(), data.size()));
+      }
+
+      QVERIFY(writer.close());
+
+      maxStall = qMax(maxStall, writer.maxStall());
+    } else {
+      QElapsedTimer timer;
+
+      for (qint64 offset = 0; offset < BENCH_SIZE; offset += data.size()) {
+	timer.start();
+	QCOMPARE(file.write(data), qint64(data.size()));
+	QVERIFY(file.flush());
+	maxStall = qMax(maxStall, timer.nsecsElapsed() / 1000);
+      }
+    }
+
+    QCOMPARE(QFileInfo(file.fileName()).size(), qint64(BENCH_SIZE));
+  }
+
+  qDebug() << "Longest stall in us:" << maxStall << "directory:" << benchDir();
+}
+
+QTEST_APPLESS_MAIN(tst_filewriter);
+
+#include "tst_filewriter.moc"
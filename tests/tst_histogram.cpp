@@ -0,0 +1,100 @@
+#include <QTest>
+#include <gst/gst.h>
+#include "qtcamgstsample.h"
+#include "qtcamhistogram.h"
+
+#define WIDTH  1920
+#define HEIGHT 1080
+
+class tst_histogram : public QObject {
+  Q_OBJECT
+
+private slots:
+  void initTestCase();
+  void cleanupTestCase();
+
+  void statistics();
+  void throughput();
+
+private:
+  QtCamGstSample *createFrame();
+
+  QtCamGstSample *m_frame;
+};
+
+void tst_histogram::initTestCase() {
+  gst_init(0, 0);
+
+  m_frame = createFrame();
+}
+
+void tst_histogram::cleanupTestCase() {
+  delete m_frame;
+  m_frame = 0;
+}
+
+QtCamGstSample *tst_histogram::createFrame() {
+  int size = WIDTH * HEIGHT * 3 / 2;
+  QByteArray data(size, (char)128);
+
+  // Left half black, right half white, neutral chroma.
+  for (int y = 0; y < HEIGHT; y++) {
+    memset(data.data() + y * WIDTH, 16, WIDTH / 2);
+    memset(data.data() + y * WIDTH + WIDTH / 2, 235, WIDTH / 2);
+  }
+
+#if GST_CHECK_VERSION(1,0,0)
+  GstCaps *caps = gst_caps_new_simple("video/x-raw",
+				      "format", G_TYPE_STRING, "I420",
+				      "width", G_TYPE_INT, WIDTH,
+				      "height", G_TYPE_INT, HEIGHT,
+				      "framerate", GST_TYPE_FRACTION, 30, 1,
+				      NULL);
+  GstBuffer *buffer = gst_buffer_new_allocate(NULL, size, NULL);
+  gst_buffer_fill(buffer, 0, data.constData(), size);
+#else
+  GstCaps *caps = gst_caps_new_simple("video/x-raw-yuv",
+				      "format", GST_TYPE_FOURCC, GST_MAKE_FOURCC('I', '4', '2', '0'),
+				      "width", G_TYPE_INT, WIDTH,
+				      "height", G_TYPE_INT, HEIGHT,
+				      "framerate", GST_TYPE_FRACTION, 30, 1,
+				      NULL);
+  GstBuffer *buffer = gst_buffer_new_and_alloc(size);
+  memcpy(GST_BUFFER_DATA(buffer), data.constData(), size);
+#endif
+
+  QtCamGstSample *sample = new QtCamGstSample(buffer, caps);
+
+  gst_buffer_unref(buffer);
+  gst_caps_unref(caps);
+
+  return sample;
+}
+
+void tst_histogram::statistics() {
+  QtCamHistogramData data;
+  QVERIFY(QtCamHistogram::compute(m_frame, data));
+
+  QVERIFY(data.samples > 0);
+  QCOMPARE(data.luma[0] + data.luma[255], data.samples);
+  QCOMPARE(data.luma[0], data.luma[255]);
+  QCOMPARE(data.red[0], data.luma[0]);
+  QCOMPARE(data.blue[255], data.luma[255]);
+
+  QCOMPARE(data.shadowsClipped, 50.0);
+  QCOMPARE(data.highlightsClipped, 50.0);
+  QCOMPARE(data.mean, 127);
+  QCOMPARE(data.median, 0);
+}
+
+void tst_histogram::throughput() {
+  QtCamHistogramData data;
+
+  QBENCHMARK {
+    QtCamHistogram::compute(m_frame, data);
+  }
+}
+
+QTEST_APPLESS_MAIN(tst_histogram);
+
+#include "tst_histogram.moc"
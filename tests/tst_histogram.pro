@@ -0,0 +1,15 @@
+include(../cameraplus.pri)
+
+TEMPLATE = app
+QT += testlib
+
+CONFIG += link_pkgconfig
+harmattan:PKGCONFIG += gstreamer-0.10 gstreamer-video-0.10
+sailfish:PKGCONFIG += gstreamer-1.0 gstreamer-video-1.0
+
+DEPENDPATH += ../lib
+INCLUDEPATH += ../lib
+
+LIBS += -L../lib/ -lqtcamera
+
+SOURCES += tst_histogram.cpp
@@ -0,0 +1,213 @@
+#include <QTest>
+#include <QImage>
+#include <QThread>
+#include <QThreadPool>
+#include <QElapsedTimer>
+#include <QTemporaryFile>
+#include <QDebug>
+#include <cstring>
+#include "qtcamjpegencoder.h"
+
+class ImageSource : public QtCamJpegSource {
+public:
+  ImageSource(const QImage& image) : image(image), reads(0), next(0) {}
+
+  bool read(int top, QImage& lines) {
+    if (top != next || lines.width() != image.width()) {
+      return false;
+    }
+
+    for (int y = 0; y < lines.height(); y++) {
+      memcpy(lines.scanLine(y), image.constScanLine(top + y), image.width() * 4);
+    }
+
+    next = top + lines.height();
+    ++reads;
+
+    return true;
+  }
+
+  QImage image;
+  int reads;
+  int next;
+};
+
+class tst_jpegencoder : public QObject {
+  Q_OBJECT
+
+private slots:
+  void bands_data();
+  void bands();
+  void metadata();
+  void quality();
+  void bandHeight();
+  void stream();
+  void benchmark_data();
+  void benchmark();
+
+private:
+  QImage scene(int width, int height);
+  QByteArray segment(uchar marker, const QByteArray& payload);
+};
+
+QImage tst_jpegencoder::scene(int width, int height) {
+  QImage image(width, height, QImage::Format_RGB32);
+
+  for (int y = 0; y < height; y++) {
+    QRgb *line = (QRgb *)image.scanLine(y);
+    for (int x = 0; x < width; x++) {
+      line[x] = qRgb((x * 7 + y * 3) & 0xff, (x * y) & 0xff, (x ^ y) & 0xff);
+    }
+  }
+
+  return image;
+}
+
+QByteArray tst_jpegencoder::segment(uchar marker, const QByteArray& payload) {
+  QByteArray data;
+  data.append((char)0xff);
+  data.append((char)marker);
+  data.append((char)((payload.size() + 2) >> 8));
+  data.append((char)((payload.size() + 2) & 0xff));
+  data.append(payload);
+  return data;
+}
+
+void tst_jpegencoder::bands_data() {
+  QTest::addColumn<QSize>("size");
+
+  QTest::newRow("tiny") << QSize(17, 9);
+  QTest::newRow("vga") << QSize(640, 480);
+  QTest::newRow("odd") << QSize(1001, 777);
+  QTest::newRow("wide") << QSize(8000, 300);
+}
+
+void tst_jpegencoder::bands() {
+  QFETCH(QSize, size);
+
+  QImage image = scene(size.width(), size.height());
+  QThreadPool pool;
+
+  QByteArray few = QtCamJpegEncoder::encode(image, 90, QList<QByteArray>(), &pool, 1);
+  QByteArray many = QtCamJpegEncoder::encode(image, 90, QList<QByteArray>(), &pool, 32);
+  QVERIFY(!few.isEmpty());
+  QVERIFY(!many.isEmpty());
+
+  QImage a = QImage::fromData(few, "jpeg").convertToFormat(QImage::Format_RGB32);
+  QImage b = QImage::fromData(many, "jpeg").convertToFormat(QImage::Format_RGB32);
+
+  QCOMPARE(a.size(), size);
+  QCOMPARE(b.size(), size);
+
+  // Restart markers do not change what the decoder produces.
+  QVERIFY(a == b);
+}
+
+void tst_jpegencoder::metadata() {
+  QByteArray exif = segment(0xe1, QByteArray("Exif\0\0", 6) + QByteArray(100, 'e'));
+
+  QByteArray data = QtCamJpegEncoder::encode(scene(320, 240), 85,
+					     QList<QByteArray>() << exif);
+  QVERIFY(!data.isEmpty());
+
+  // EXIF right after SOI and no JFIF.
+  QCOMPARE(data.left(2), QByteArray("\xff\xd8", 2));
+  QCOMPARE(data.mid(2, exif.size()), exif);
+
+  QCOMPARE(QImage::fromData(data, "jpeg").size(), QSize(320, 240));
+
+  // JFIF without metadata.
+  data = QtCamJpegEncoder::encode(scene(320, 240), 85);
+  QCOMPARE(data.mid(2, 2), QByteArray("\xff\xe0", 2));
+  QCOMPARE(data.mid(6, 5), QByteArray("JFIF\0", 5));
+}
+
+void tst_jpegencoder::quality() {
+  QImage image = scene(64, 64);
+
+  for (int q = 10; q <= 100; q += 5) {
+    QCOMPARE(QtCamJpegEncoder::quality(QtCamJpegEncoder::encode(image, q)), q);
+  }
+
+  QCOMPARE(QtCamJpegEncoder::quality(QByteArray()), -1);
+  QCOMPARE(QtCamJpegEncoder::quality(QByteArray("\xff\xd8\xff\xd9", 4)), -1);
+}
+
+void tst_jpegencoder::bandHeight() {
+  // Whole MCU rows, two bands per thread.
+  QCOMPARE(QtCamJpegEncoder::bandHeight(4000, 3000, 4), 384);
+  QCOMPARE(QtCamJpegEncoder::bandHeight(4000, 3000, 1), 1504);
+
+  // Never less than one MCU row.
+  QCOMPARE(QtCamJpegEncoder::bandHeight(640, 8, 16), 16);
+
+  // The restart interval must fit in 16 bits.
+  int height = QtCamJpegEncoder::bandHeight(100000, 100000, 1);
+  QVERIFY(height % 16 == 0);
+  QVERIFY((100000 + 15) / 16 * (height / 16) <= 65535);
+}
+
+void tst_jpegencoder::stream() {
+  QImage image = scene(3000, 1000);
+  ImageSource source(image);
+
+  QTemporaryFile file;
+  QVERIFY(file.open());
+
+  QThreadPool pool;
+  QVERIFY(QtCamJpegEncoder::save(&source, image.size(), file.fileName(), 90,
+				 QList<QByteArray>(), &pool));
+
+  // Asked for in bands, top to bottom.
+  int height = QtCamJpegEncoder::streamBandHeight(image.width());
+  QCOMPARE(source.reads, (image.height() + height - 1) / height);
+  QVERIFY(source.reads > 1);
+  QCOMPARE(source.next, image.height());
+
+  QImage streamed = QImage(file.fileName(), "jpeg").convertToFormat(QImage::Format_RGB32);
+  QImage whole = QImage::fromData(QtCamJpegEncoder::encode(image, 90), "jpeg")
+    .convertToFormat(QImage::Format_RGB32);
+
+  QCOMPARE(streamed.size(), image.size());
+  QVERIFY(streamed == whole);
+
+  // Nothing is left behind if the source fails.
+  ImageSource broken(scene(100, 100));
+  QVERIFY(!QtCamJpegEncoder::save(&broken, QSize(200, 100), file.fileName(), 90));
+  QVERIFY(!QFile::exists(file.fileName()));
+}
+
+void tst_jpegencoder::benchmark_data() {
+  QTest::addColumn<int>("threads");
+
+  QTest::newRow("1 thread") << 1;
+  QTest::newRow("2 threads") << 2;
+  QTest::newRow("4 threads") << 4;
+  QTest::newRow("ideal") << QThread::idealThreadCount();
+}
+
+void tst_jpegencoder::benchmark() {
+  QFETCH(int, threads);
+
+  // 12 megapixels, what the sensor gives us.
+  QImage image = scene(4000, 3000);
+
+  QThreadPool pool;
+  pool.setMaxThreadCount(threads);
+
+  QElapsedTimer timer;
+  int runs = 0;
+  timer.start();
+
+  QBENCHMARK {
+    QtCamJpegEncoder::encode(image, 90, QList<QByteArray>(), &pool);
+    ++runs;
+  }
+
+  qDebug() << "JPEG encoding:" << runs * 1000.0 / qMax<qint64>(1, timer.elapsed())
+	   << "images/s with" << threads << "threads";
+}
+
+QTEST_APPLESS_MAIN(tst_jpegencoder);
+
+#include "tst_jpegencoder.moc"
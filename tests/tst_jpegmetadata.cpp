@@ -0,0 +1,118 @@
+#include <QTest>
+#include <QBuffer>
+#include <QImage>
+#include <QImageWriter>
+#include <QFile>
+#include <QDir>
+#include "qtcamjpegmetadata.h"
+
+class tst_jpegmetadata : public QObject {
+  Q_OBJECT
+
+private slots:
+  void segments();
+  void replace();
+  void copy();
+  void malformed();
+
+private:
+  QByteArray jpeg(const QSize& size);
+  QByteArray segment(uchar marker, const QByteArray& payload);
+};
+
+QByteArray tst_jpegmetadata::jpeg(const QSize& size) {
+  QImage image(size, QImage::Format_RGB32);
+  image.fill(qRgb(40, 80, 120));
+
+  QByteArray data;
+  QBuffer buffer(&data);
+  buffer.open(QBuffer::WriteOnly);
+
+  QImageWriter writer(&buffer, "jpeg");
+  writer.write(image);
+
+  return data;
+}
+
+QByteArray tst_jpegmetadata::segment(uchar marker, const QByteArray& payload) {
+  QByteArray data;
+  data.append((char)0xff);
+  data.append((char)marker);
+  data.append((char)((payload.size() + 2) >> 8));
+  data.append((char)((payload.size() + 2) & 0xff));
+  data.append(payload);
+  return data;
+}
+
+void tst_jpegmetadata::segments() {
+  QByteArray data = jpeg(QSize(16, 16));
+  QVERIFY(!data.isEmpty());
+
+  // Only JFIF which is not metadata we care about.
+  QVERIFY(QtCamJpegMetadata::segments(data).isEmpty());
+}
+
+void tst_jpegmetadata::replace() {
+  QByteArray exif = segment(0xe1, QByteArray("Exif\0\0", 6) + QByteArray(100, 'e'));
+  QByteArray xmp = segment(0xe1, QByteArray("http://ns.adobe.com/xap/1.0/\0", 29) +
+			   QByteArray(40, 'x'));
+
+  QByteArray data = QtCamJpegMetadata::replace(jpeg(QSize(32, 24)),
+					       QList<QByteArray>() << exif << xmp);
+
+  QVERIFY(!data.isEmpty());
+
+  // EXIF right after SOI.
+  QCOMPARE(data.mid(2, exif.size()), exif);
+  QCOMPARE(QtCamJpegMetadata::segments(data), QList<QByteArray>() << exif << xmp);
+
+  QImage image = QImage::fromData(data, "jpeg");
+  QCOMPARE(image.size(), QSize(32, 24));
+
+  // Replacing again does not accumulate.
+  data = QtCamJpegMetadata::replace(data, QList<QByteArray>() << xmp);
+  QCOMPARE(QtCamJpegMetadata::segments(data), QList<QByteArray>() << xmp);
+  QVERIFY(!QImage::fromData(data, "jpeg").isNull());
+}
+
+void tst_jpegmetadata::copy() {
+  QByteArray exif = segment(0xe1, QByteArray("Exif\0\0", 6) + QByteArray(64, 'e'));
+
+  QString from = QDir::temp().filePath("tst_jpegmetadata_from.jpg");
+  QString to = QDir::temp().filePath("tst_jpegmetadata_to.jpg");
+
+  QFile source(from);
+  QVERIFY(source.open(QFile::WriteOnly));
+  source.write(QtCamJpegMetadata::replace(jpeg(QSize(16, 16)), QList<QByteArray>() << exif));
+  source.close();
+
+  QFile target(to);
+  QVERIFY(target.open(QFile::WriteOnly));
+  target.write(jpeg(QSize(48, 32)));
+  target.close();
+
+  QVERIFY(QtCamJpegMetadata::copy(from, to));
+
+  QVERIFY(target.open(QFile::ReadOnly));
+  QByteArray data = target.readAll();
+  target.close();
+
+  QCOMPARE(QtCamJpegMetadata::segments(data), QList<QByteArray>() << exif);
+  QCOMPARE(QImage::fromData(data, "jpeg").size(), QSize(48, 32));
+
+  QFile::remove(from);
+  QFile::remove(to);
+}
+
+void tst_jpegmetadata::malformed() {
+  QVERIFY(QtCamJpegMetadata::segments(QByteArray("not a jpeg")).isEmpty());
+  QVERIFY(QtCamJpegMetadata::replace(QByteArray("not a jpeg"), QList<QByteArray>()).isEmpty());
+
+  // Truncated inside a segment.
+  QByteArray data = jpeg(QSize(16, 16));
+  QVERIFY(QtCamJpegMetadata::replace(data.left(10), QList<QByteArray>()).isEmpty());
+}
+
+QTEST_APPLESS_MAIN(tst_jpegmetadata);
+
+#include "tst_jpegmetadata.moc"
@@ -0,0 +1,255 @@
+#include <QTest>
+#include <QSignalSpy>
+#include <QImage>
+#include <QTransform>
+#include <QFile>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QDebug>
+#include "qtcamjpegrotator.h"
+#include "qtcamjpegmetadata.h"
+#include "qtcamjpegencoder.h"
+
+class tst_jpegrotator : public QObject {
+  Q_OBJECT
+
+private slots:
+  void orientation();
+  void transform_data();
+  void transform();
+  void exif();
+  void worker();
+  void benchmark();
+
+private:
+  QImage scene(int width, int height);
+  QByteArray exifSegment(int orientation, int width, int height);
+  QByteArray read(const QString& fileName);
+  void write(const QString& fileName, const QByteArray& data);
+  int difference(const QImage& a, const QImage& b);
+};
+
+QImage tst_jpegrotator::scene(int width, int height) {
+  QImage image(width, height, QImage::Format_RGB32);
+
+  // Smooth and asymmetric so a wrong rotation or misplaced block shows.
+  for (int y = 0; y < height; y++) {
+    QRgb *line = (QRgb *)image.scanLine(y);
+    for (int x = 0; x < width; x++) {
+      line[x] = qRgb(x * 255 / width, y * 255 / height, x < width / 3 && y < height / 4 ? 220 : 40);
+    }
+  }
+
+  return image;
+}
+
+static QByteArray be16(int val) {
+  QByteArray data;
+  data.append((char)(val >> 8));
+  data.append((char)val);
+  return data;
+}
+
+static QByteArray be32(int val) {
+  return be16(val >> 16) + be16(val & 0xffff);
+}
+
+// IFD0 (orientation, EXIF IFD) at 8, EXIF IFD (pixel dimensions) at 38 and IFD1 at 68.
+QByteArray tst_jpegrotator::exifSegment(int orientation, int width, int height) {
+  QByteArray tiff("MM\0\x2a", 4);
+  tiff += be32(8);
+
+  tiff += be16(2);
+  tiff += be16(0x0112) + be16(3) + be32(1) + be16(orientation) + be16(0);
+  tiff += be16(0x8769) + be16(4) + be32(1) + be32(38);
+  tiff += be32(68);
+
+  tiff += be16(2);
+  tiff += be16(0xa002) + be16(4) + be32(1) + be32(width);
+  tiff += be16(0xa003) + be16(3) + be32(1) + be16(height) + be16(0);
+  tiff += be32(0);
+
+  tiff += be16(1);
+  tiff += be16(0x0103) + be16(3) + be32(1) + be16(6) + be16(0);
+  tiff += be32(0);
+
+  QByteArray payload = QByteArray("Exif\0\0", 6) + tiff;
+
+  QByteArray segment;
+  segment.append((char)0xff);
+  segment.append((char)0xe1);
+  segment += be16(payload.size() + 2);
+  segment += payload;
+  return segment;
+}
+
+QByteArray tst_jpegrotator::read(const QString& fileName) {
+  QFile file(fileName);
+  if (!file.open(QFile::ReadOnly)) {
+    return QByteArray();
+  }
+
+  return file.readAll();
+}
+
+void tst_jpegrotator::write(const QString& fileName, const QByteArray& data) {
+  QFile file(fileName);
+  QVERIFY(file.open(QFile::WriteOnly | QFile::Truncate));
+  QCOMPARE(file.write(data), (qint64)data.size());
+}
+
+int tst_jpegrotator::difference(const QImage& a, const QImage& b) {
+  int diff = 0;
+
+  for (int y = 0; y < a.height(); y++) {
+    for (int x = 0; x < a.width(); x++) {
+      QRgb p = a.pixel(x, y);
+      QRgb q = b.pixel(x, y);
+      diff = qMax(diff, qAbs(qRed(p) - qRed(q)));
+      diff = qMax(diff, qAbs(qGreen(p) - qGreen(q)));
+      diff = qMax(diff, qAbs(qBlue(p) - qBlue(q)));
+    }
+  }
+
+  return diff;
+}
+
+void tst_jpegrotator::orientation() {
+  QCOMPARE(QtCamJpegRotator::orientationAngle(QList<QByteArray>()), 0);
+  QCOMPARE(QtCamJpegRotator::orientationAngle(QList<QByteArray>() << exifSegment(1, 16, 16)), 0);
+  QCOMPARE(QtCamJpegRotator::orientationAngle(QList<QByteArray>() << exifSegment(3, 16, 16)), 180);
+  QCOMPARE(QtCamJpegRotator::orientationAngle(QList<QByteArray>() << exifSegment(6, 16, 16)), 90);
+  QCOMPARE(QtCamJpegRotator::orientationAngle(QList<QByteArray>() << exifSegment(8, 16, 16)), 270);
+
+  // Mirrored.
+  QCOMPARE(QtCamJpegRotator::orientationAngle(QList<QByteArray>() << exifSegment(2, 16, 16)), -1);
+  QCOMPARE(QtCamJpegRotator::orientationAngle(QList<QByteArray>() << exifSegment(7, 16, 16)), -1);
+}
+
+void tst_jpegrotator::transform_data() {
+  QTest::addColumn<QSize>("size");
+  QTest::addColumn<int>("angle");
+  QTest::addColumn<QRect>("kept");
+
+  // Whole 16x16 MCUs.
+  QTest::newRow("90") << QSize(64, 48) << 90 << QRect(0, 0, 64, 48);
+  QTest::newRow("180") << QSize(64, 48) << 180 << QRect(0, 0, 64, 48);
+  QTest::newRow("270") << QSize(64, 48) << 270 << QRect(0, 0, 64, 48);
+
+  // Partial MCUs are dropped when they would end up at the top or left.
+  QTest::newRow("90 partial") << QSize(70, 50) << 90 << QRect(0, 0, 70, 48);
+  QTest::newRow("180 partial") << QSize(70, 50) << 180 << QRect(0, 0, 64, 48);
+  QTest::newRow("270 partial") << QSize(70, 50) << 270 << QRect(0, 0, 64, 50);
+}
+
+void tst_jpegrotator::transform() {
+  QFETCH(QSize, size);
+  QFETCH(int, angle);
+  QFETCH(QRect, kept);
+
+  QString from = QDir::temp().filePath("tst_jpegrotator_from.jpg");
+  QString to = QDir::temp().filePath("tst_jpegrotator_to.jpg");
+
+  write(from, QtCamJpegEncoder::encode(scene(size.width(), size.height()), 95));
+
+  QVERIFY(QtCamJpegRotator::transform(from, to, angle));
+
+  QImage expected = QImage(from).copy(kept).transformed(QTransform().rotate(angle));
+  QImage rotated(to);
+
+  QCOMPARE(rotated.size(), expected.size());
+
+  // Only the rounding of the inverse DCT differs.
+  QVERIFY(difference(rotated, expected) <= 8);
+
+  QFile::remove(from);
+  QFile::remove(to);
+}
+
+void tst_jpegrotator::exif() {
+  QString from = QDir::temp().filePath("tst_jpegrotator_from.jpg");
+  QString to = QDir::temp().filePath("tst_jpegrotator_to.jpg");
+
+  write(from, QtCamJpegEncoder::encode(scene(64, 48), 90,
+				       QList<QByteArray>() << exifSegment(6, 64, 48)));
+
+  QVERIFY(QtCamJpegRotator::transform(from, to, 90));
+
+  QByteArray data = read(to);
+  QList<QByteArray> segments = QtCamJpegMetadata::segments(data);
+  QCOMPARE(segments.size(), 1);
+
+  // EXIF right after SOI.
+  QCOMPARE(data.mid(2, segments[0].size()), segments[0]);
+
+  QCOMPARE(QtCamJpegRotator::orientationAngle(segments), 0);
+
+  // Same layout with the values patched: the dimensions are swapped and IFD1 is gone.
+  QByteArray expected = exifSegment(1, 48, 64);
+  QCOMPARE(segments[0], expected.left(44) + be32(0) + expected.mid(48));
+
+  QFile::remove(from);
+  QFile::remove(to);
+}
+
+void tst_jpegrotator::worker() {
+  QString fileName = QDir::temp().filePath("tst_jpegrotator_worker.jpg");
+  QString upright = QDir::temp().filePath("tst_jpegrotator_upright.jpg");
+
+  write(fileName, QtCamJpegEncoder::encode(scene(320, 240), 90,
+					   QList<QByteArray>() << exifSegment(8, 320, 240)));
+  write(upright, QtCamJpegEncoder::encode(scene(320, 240), 90,
+					  QList<QByteArray>() << exifSegment(1, 320, 240)));
+  QByteArray original = read(upright);
+
+  QtCamJpegRotator rotator;
+  QSignalSpy finished(&rotator, SIGNAL(finished(const QString&)));
+  QSignalSpy failed(&rotator, SIGNAL(failed(const QString&)));
+
+  rotator.rotate(fileName);
+  rotator.rotate(upright);
+  rotator.rotate(QDir::temp().filePath("tst_jpegrotator_missing.jpg"));
+
+  for (int x = 0; x < 500 && finished.count() + failed.count() < 3; x++) {
+    QTest::qWait(10);
+  }
+
+  QCOMPARE(finished.count(), 2);
+  QCOMPARE(failed.count(), 1);
+
+  QCOMPARE(QImage(fileName).size(), QSize(240, 320));
+  QCOMPARE(QtCamJpegRotator::orientationAngle(QtCamJpegMetadata::segments(read(fileName))), 0);
+
+  // Nothing to do.
+  QCOMPARE(read(upright), original);
+
+  QFile::remove(fileName);
+  QFile::remove(upright);
+}
+
+void tst_jpegrotator::benchmark() {
+  QString from = QDir::temp().filePath("tst_jpegrotator_from.jpg");
+  QString to = QDir::temp().filePath("tst_jpegrotator_to.jpg");
+
+  // 8 megapixels, what the sensor gives us.
+  write(from, QtCamJpegEncoder::encode(scene(3264, 2448), 90,
+				       QList<QByteArray>() << exifSegment(6, 3264, 2448)));
+
+  QElapsedTimer timer;
+  int runs = 0;
+  timer.start();
+
+  QBENCHMARK {
+    QVERIFY(QtCamJpegRotator::transform(from, to, 90));
+    ++runs;
+  }
+
+  qDebug() << "Lossless rotation:" << timer.elapsed() / (runs * 7.99) << "ms/MP";
+
+  QFile::remove(from);
+  QFile::remove(to);
+}
+
+QTEST_MAIN(tst_jpegrotator);
+
+#include "tst_jpegrotator.moc"
@@ -0,0 +1,244 @@
+#include <QTest>
+#include <QSignalSpy>
+#include <QTemporaryFile>
+#include <gst/gst.h>
+#include "qtcamgstmessagelistener.h"
+#include "qtcamgstmessagehandler.h"
+#include "qtcamgstmessagerecorder.h"
+
+#define ROI_MESSAGES 1000
+
+class CountingHandler : public QtCamGstMessageHandler {
+public:
+  CountingHandler(const QString& name) : QtCamGstMessageHandler(name), count(0) {}
+
+  void handleMessage(GstMessage *message) {
+    Q_UNUSED(message);
+    ++count;
+  }
+
+  int count;
+};
+
+class CopyingHandler : public QtCamGstMessageHandler {
+public:
+  CopyingHandler(const QString& name) : QtCamGstMessageHandler(name), structure(0) {}
+
+  ~CopyingHandler() {
+    if (structure) {
+      gst_structure_free(structure);
+    }
+  }
+
+  void handleMessage(GstMessage *message) {
+    if (structure) {
+      gst_structure_free(structure);
+    }
+
+    structure = gst_structure_copy(gst_message_get_structure(message));
+  }
+
+  GstStructure *structure;
+};
+
+class tst_messagereplay : public QObject {
+  Q_OBJECT
+
+private slots:
+  void initTestCase();
+  void init();
+  void cleanup();
+
+  void replay();
+  void fields();
+  void notLog();
+  void reopen();
+  void roiSession();
+  void recordSession();
+
+private:
+  void record(const QString& fileName, int roiMessages);
+
+  QtCamGstMessageListener *m_listener;
+};
+
+void tst_messagereplay::initTestCase() {
+  gst_init(0, 0);
+}
+
+void tst_messagereplay::init() {
+  m_listener = new QtCamGstMessageListener(gst_bus_new(), 0);
+}
+
+void tst_messagereplay::cleanup() {
+  delete m_listener; m_listener = 0;
+}
+
+void tst_messagereplay::record(const QString& fileName, int roiMessages) {
+  QtCamGstMessageRecorder recorder(fileName);
+  QVERIFY(recorder.open());
+
+  GstMessage *message =
+    gst_message_new_state_changed(NULL, GST_STATE_PAUSED, GST_STATE_PLAYING, GST_STATE_VOID_PENDING);
+  recorder.record(message);
+  gst_message_unref(message);
+
+  for (int x = 0; x < roiMessages; x++) {
+    GstStructure *s = gst_structure_new("regions-of-interest",
+					"frame-width", G_TYPE_UINT, 640,
+					"frame-height", G_TYPE_UINT, 480,
+					"type", G_TYPE_INT, x % 2,
+					NULL);
+    message = gst_message_new_element(NULL, s);
+    recorder.record(message);
+    gst_message_unref(message);
+  }
+
+  GError *err = g_error_new_literal(GST_CORE_ERROR, GST_CORE_ERROR_FAILED, "failed");
+  message = gst_message_new_error(NULL, err, "debug\ninformation");
+  recorder.record(message);
+  gst_message_unref(message);
+  g_error_free(err);
+}
+
+void tst_messagereplay::replay() {
+  QTemporaryFile file;
+  QVERIFY(file.open());
+  record(file.fileName(), 10);
+
+  CountingHandler *handler = new CountingHandler("regions-of-interest");
+  CountingHandler *syncHandler = new CountingHandler("regions-of-interest");
+  m_listener->addHandler(handler);
+  m_listener->addSyncHandler(syncHandler);
+
+  QSignalSpy started(m_listener, SIGNAL(started()));
+  QSignalSpy error(m_listener, SIGNAL(error(const QString&, int, const QString&)));
+
+  QtCamGstMessageReplay replay(m_listener);
+  QVERIFY(replay.load(file.fileName()));
+  QCOMPARE(replay.size(), 12);
+
+  replay.replay();
+
+  QCOMPARE(handler->count, 10);
+  QCOMPARE(syncHandler->count, 10);
+  QCOMPARE(started.count(), 1);
+  QCOMPARE(error.count(), 1);
+  QCOMPARE(error.at(0).at(0).toString(), QString("failed"));
+  QCOMPARE(error.at(0).at(2).toString(), QString("debug\ninformation"));
+}
+
+void tst_messagereplay::fields() {
+  QTemporaryFile file;
+  QVERIFY(file.open());
+
+  GstStructure *s = gst_structure_new("fields",
+				      "int", G_TYPE_INT, -5,
+				      "uint", G_TYPE_UINT, 300,
+				      "int64", G_TYPE_INT64, G_GINT64_CONSTANT(-1) << 40,
+				      "uint64", G_TYPE_UINT64, G_GUINT64_CONSTANT(1) << 63,
+				      "boolean", G_TYPE_BOOLEAN, TRUE,
+				      "double", G_TYPE_DOUBLE, 0.25,
+				      "string", G_TYPE_STRING, "tab\there",
+				      "null", G_TYPE_STRING, NULL,
+				      "fraction", GST_TYPE_FRACTION, 30, 1,
+				      NULL);
+
+  {
+    QtCamGstMessageRecorder recorder(file.fileName());
+    QVERIFY(recorder.open());
+
+    GstMessage *message = gst_message_new_element(NULL, gst_structure_copy(s));
+    recorder.record(message);
+    gst_message_unref(message);
+  }
+
+  CopyingHandler *handler = new CopyingHandler("fields");
+  m_listener->addHandler(handler);
+
+  QtCamGstMessageReplay replay(m_listener);
+  QVERIFY(replay.load(file.fileName()));
+  QCOMPARE(replay.size(), 1);
+
+  replay.replay();
+
+  QVERIFY(handler->structure);
+  QVERIFY(gst_structure_is_equal(handler->structure, s));
+
+  gst_structure_free(s);
+}
+
+void tst_messagereplay::notLog() {
+  QTemporaryFile file;
+  QVERIFY(file.open());
+  file.write("0\tstate-changed\t\tqtcam-state-changed, old=(int)3, new=(int)4, pending=(int)0\n");
+  file.flush();
+
+  QtCamGstMessageReplay replay(m_listener);
+  QVERIFY(!replay.load(file.fileName()));
+  QCOMPARE(replay.size(), 0);
+}
+
+void tst_messagereplay::reopen() {
+  QTemporaryFile file;
+  QVERIFY(file.open());
+
+  // Two devices, one after the other.
+  record(file.fileName(), 10);
+  record(file.fileName(), 5);
+
+  CountingHandler *handler = new CountingHandler("regions-of-interest");
+  m_listener->addHandler(handler);
+
+  QtCamGstMessageReplay replay(m_listener);
+  QVERIFY(replay.load(file.fileName()));
+  QCOMPARE(replay.size(), 19);
+
+  replay.replay();
+
+  QCOMPARE(handler->count, 15);
+}
+
+void tst_messagereplay::roiSession() {
+  QTemporaryFile file;
+  QVERIFY(file.open());
+  record(file.fileName(), ROI_MESSAGES);
+
+  CountingHandler *handler = new CountingHandler("regions-of-interest");
+  m_listener->addHandler(handler);
+
+  QtCamGstMessageReplay replay(m_listener);
+  QVERIFY(replay.load(file.fileName()));
+
+  QBENCHMARK {
+    replay.replay();
+  }
+}
+
+void tst_messagereplay::recordSession() {
+  QTemporaryFile file;
+  QVERIFY(file.open());
+
+  QtCamGstMessageRecorder recorder(file.fileName());
+  QVERIFY(recorder.open());
+
+  GstStructure *s = gst_structure_new("regions-of-interest",
+				      "frame-width", G_TYPE_UINT, 640,
+				      "frame-height", G_TYPE_UINT, 480,
+				      "type", G_TYPE_INT, 0,
+				      NULL);
+  GstMessage *message = gst_message_new_element(NULL, s);
+
+  // What a streaming thread pays for each message.
+  QBENCHMARK {
+    recorder.record(message);
+  }
+
+  recorder.close();
+
+  gst_message_unref(message);
+}
+
+QTEST_APPLESS_MAIN(tst_messagereplay);
+
+#include "tst_messagereplay.moc"
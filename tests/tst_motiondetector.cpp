@@ -0,0 +1,88 @@
+#include <QTest>
+#include "qtcamlumaplane.h"
+#include "qtcammotiondetector.h"
+
+#define WIDTH  32
+#define HEIGHT 18
+
+class tst_motiondetector : public QObject {
+  Q_OBJECT
+
+private slots:
+  void still();
+  void motion();
+  void masked();
+  void lighting();
+
+private:
+  void fill(QtCamLumaPlane& plane, int value, const QRect& area = QRect(), int areaValue = 0);
+};
+
+void tst_motiondetector::fill(QtCamLumaPlane& plane, int value,
+			      const QRect& area, int areaValue) {
+  plane.resize(WIDTH, HEIGHT, QSize(WIDTH, HEIGHT), 1);
+
+  for (int y = 0; y < HEIGHT; y++) {
+    for (int x = 0; x < WIDTH; x++) {
+      plane.bits()[y * WIDTH + x] = area.contains(x, y) ? areaValue : value;
+    }
+  }
+}
+
+void tst_motiondetector::still() {
+  QtCamMotionDetector detector;
+  QtCamLumaPlane plane;
+
+  fill(plane, 100);
+
+  // The first frame becomes the background.
+  QCOMPARE(detector.compare(plane), qreal(-1));
+  QCOMPARE(detector.compare(plane), qreal(0));
+
+  // Sensor noise
+  fill(plane, 102);
+  QCOMPARE(detector.compare(plane), qreal(0));
+}
+
+void tst_motiondetector::motion() {
+  QtCamMotionDetector detector;
+  QtCamLumaPlane plane;
+
+  fill(plane, 100);
+  detector.compare(plane);
+
+  fill(plane, 100, QRect(4, 4, 4, 4), 200);
+  QCOMPARE(detector.compare(plane), qreal(16) / (WIDTH * HEIGHT));
+}
+
+void tst_motiondetector::masked() {
+  QtCamMotionDetector detector;
+  detector.setMasks(QList<QRectF>() << QRectF(0, 0, 0.5, 1));
+
+  QtCamLumaPlane plane;
+
+  fill(plane, 100);
+  detector.compare(plane);
+
+  fill(plane, 100, QRect(4, 4, 4, 4), 200);
+  QCOMPARE(detector.compare(plane), qreal(0));
+
+  fill(plane, 100, QRect(20, 4, 4, 4), 200);
+  QCOMPARE(detector.compare(plane), qreal(16) / (WIDTH * HEIGHT / 2));
+}
+
+void tst_motiondetector::lighting() {
+  QtCamMotionDetector detector;
+  QtCamLumaPlane plane;
+
+  fill(plane, 100);
+  detector.compare(plane);
+
+  fill(plane, 180);
+  QCOMPARE(detector.compare(plane), qreal(-1));
+  QCOMPARE(detector.compare(plane), qreal(0));
+}
+
+QTEST_APPLESS_MAIN(tst_motiondetector);
+
+#include "tst_motiondetector.moc"
@@ -0,0 +1,164 @@
+#include <QTest>
+#include <QSignalSpy>
+#include <QImage>
+#include <QDir>
+#include <QFile>
+#include "qtcamnightstacker.h"
+
+class tst_nightstacker : public QObject {
+  Q_OBJECT
+
+private slots:
+  void accumulate();
+  void threshold();
+  void stack();
+
+private:
+  int noise();
+};
+
+int tst_nightstacker::noise() {
+  // Roughly gaussian with a sigma of 6
+  int sum = 0;
+  for (int x = 0; x < 12; x++) {
+    sum += qrand() % 1001;
+  }
+
+  return (sum - 6000) * 6 / 289;
+}
+
+void tst_nightstacker::accumulate() {
+  qsrand(5);
+
+  // Odd size to cover the tail after the vector loop.
+  const int size = 1027;
+
+  QVector<uchar> frame(size), reference(size);
+  QVector<quint16> sum(size), count(size);
+
+  for (int x = 0; x < size; x++) {
+    frame[x] = qrand() % 256;
+    reference[x] = qrand() % 256;
+    sum[x] = qrand() % 1000;
+    count[x] = qrand() % 4 + 1;
+  }
+
+  QVector<quint16> expectedSum(sum), expectedCount(count);
+  for (int x = 0; x < size; x++) {
+    if (qAbs(frame[x] - reference[x]) <= 20) {
+      expectedSum[x] += frame[x];
+      ++expectedCount[x];
+    }
+  }
+
+  QtCamNightStacker::accumulate(frame.constData(), reference.constData(),
+				sum.data(), count.data(), size, 20);
+
+  QCOMPARE(sum, expectedSum);
+  QCOMPARE(count, expectedCount);
+
+  QVector<quint16> s, c;
+  s << 765 << 1275 << 3 << 16320;
+  c << 3 << 5 << 2 << 64;
+
+  QVector<uchar> out(4);
+  QtCamNightStacker::resolve(s.constData(), c.constData(), out.data(), 4);
+  QCOMPARE(out, QVector<uchar>() << 255 << 255 << 2 << 255);
+}
+
+void tst_nightstacker::threshold() {
+  qsrand(9);
+
+  const int size = 40000;
+  QVector<uchar> reference(size, 128), frame(size, 128);
+
+  QCOMPARE(QtCamNightStacker::threshold(frame.constData(), reference.constData(), size), 6);
+
+  // Difference of two frames with a sigma of 6 has a sigma of 8.5
+  for (int x = 0; x < size; x++) {
+    if ((x & 3) != 3) {
+      frame[x] = 128 + noise() + noise();
+    }
+  }
+
+  int t = QtCamNightStacker::threshold(frame.constData(), reference.constData(), size);
+  QVERIFY(t >= 20 && t <= 30);
+}
+
+void tst_nightstacker::stack() {
+  qsrand(11);
+
+  // Tall enough for a few bands
+  QSize size(160, 600);
+  QImage clean(size, QImage::Format_RGB32);
+  for (int y = 0; y < size.height(); y++) {
+    for (int x = 0; x < size.width(); x++) {
+      int v = 60 + ((x / 16 + y / 16) % 2) * 100;
+      clean.setPixel(x, y, qRgb(v, v, v));
+    }
+  }
+
+  QStringList files;
+  for (int n = 0; n < 5; n++) {
+    QImage frame(size, QImage::Format_RGB32);
+    for (int y = 0; y < size.height(); y++) {
+      for (int x = 0; x < size.width(); x++) {
+	int v = qGray(clean.pixel(x, y));
+	frame.setPixel(x, y, qRgb(qBound(0, v + noise(), 255), qBound(0, v + noise(), 255),
+				  qBound(0, v + noise(), 255)));
+      }
+    }
+
+    if (n == 0) {
+      // Something passing by in one frame only
+      for (int y = 300; y < 340; y++) {
+	for (int x = 40; x < 80; x++) {
+	  frame.setPixel(x, y, qRgb(255, 255, 255));
+	}
+      }
+    }
+
+    // Decoded with libjpeg like the captured frames.
+    QString file = QDir::temp().filePath(QString("tst_nightstacker_%1.jpg").arg(n));
+    QVERIFY(frame.save(file, "JPEG", 100));
+    files << file;
+  }
+
+  QString out = QDir::temp().filePath("tst_nightstacker_out.jpg");
+
+  QtCamNightStacker stacker;
+  QSignalSpy finished(&stacker, SIGNAL(finished(const QString&)));
+
+  QVERIFY(stacker.stack(files, out));
+  QVERIFY(stacker.wait(30000));
+  QCOMPARE(finished.count(), 1);
+
+  QImage result(out);
+  QImage reference(files[2]);
+  QCOMPARE(result.size(), size);
+
+  qint64 resultError = 0, referenceError = 0;
+  for (int y = 0; y < size.height(); y++) {
+    for (int x = 0; x < size.width(); x++) {
+      int v = qRed(clean.pixel(x, y));
+      resultError += qAbs(qRed(result.pixel(x, y)) - v);
+      referenceError += qAbs(qRed(reference.pixel(x, y)) - v);
+    }
+  }
+
+  // Averaging 5 frames should at least halve the noise.
+  QVERIFY(resultError * 2 < referenceError);
+
+  // The white square is rejected.
+  QVERIFY(qAbs(qRed(result.pixel(60, 320)) - qRed(clean.pixel(60, 320))) < 20);
+
+  foreach (const QString& file, files) {
+    QFile::remove(file);
+  }
+
+  QFile::remove(out);
+}
+
+QTEST_APPLESS_MAIN(tst_nightstacker);
+
+#include "tst_nightstacker.moc"
@@ -0,0 +1,73 @@
+#include <QTest>
+#include "qtcamphasecorrelation.h"
+
+#define SIZE 160
+
+class tst_phasecorrelation : public QObject {
+  Q_OBJECT
+
+private slots:
+  void shift_data();
+  void shift();
+  void profiles();
+
+private:
+  QVector<float> scene(int offset);
+};
+
+QVector<float> tst_phasecorrelation::scene(int offset) {
+  // A random walk looks enough like the profile of a real scene.
+  static QVector<float> base;
+  if (base.isEmpty()) {
+    qsrand(3);
+
+    float value = 128;
+    for (int x = 0; x < SIZE * 3; x++) {
+      value = qBound(0.0f, value + qrand() % 41 - 20, 255.0f);
+      base << value;
+    }
+  }
+
+  return base.mid(SIZE - offset, SIZE);
+}
+
+void tst_phasecorrelation::shift_data() {
+  QTest::addColumn<int>("offset");
+
+  QTest::newRow("none") << 0;
+  QTest::newRow("right") << 13;
+  QTest::newRow("left") << -21;
+  QTest::newRow("far") << 55;
+}
+
+void tst_phasecorrelation::shift() {
+  QFETCH(int, offset);
+
+  double confidence;
+  double d = QtCamPhaseCorrelation::shift(scene(0), scene(offset), &confidence);
+
+  QVERIFY(qAbs(d - offset) < 1.0);
+  QVERIFY(confidence > 0.1);
+}
+
+void tst_phasecorrelation::profiles() {
+  uchar data[3 * 4] = {
+    0, 10, 20, 30,
+    0, 10, 20, 30,
+    3, 13, 23, 33
+  };
+
+  QVector<float> columns = QtCamPhaseCorrelation::columnProfile(data, 4, 3, 4);
+  QCOMPARE(columns.size(), 4);
+  QCOMPARE(columns[0], 1.0f);
+  QCOMPARE(columns[3], 31.0f);
+
+  QVector<float> rows = QtCamPhaseCorrelation::rowProfile(data, 4, 3, 4);
+  QCOMPARE(rows.size(), 3);
+  QCOMPARE(rows[0], 15.0f);
+  QCOMPARE(rows[2], 18.0f);
+}
+
+QTEST_APPLESS_MAIN(tst_phasecorrelation);
+
+#include "tst_phasecorrelation.moc"
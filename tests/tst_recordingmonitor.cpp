@@ -0,0 +1,236 @@
+#include <QTest>
+#include <QTemporaryFile>
+#include <gst/gst.h>
+#include "qtcamrecordingmonitor.h"
+
+class tst_recordingmonitor : public QObject {
+  Q_OBJECT
+
+private slots:
+  void initTestCase();
+
+  void videoGaps();
+  void audioGaps();
+  void drift();
+  void summary();
+  void writeStall();
+
+private:
+  GstPad *createPad(const char *name);
+  GstPad *createSource(GstPad *sink);
+  void push(GstPad *pad, GstClockTime ts, GstClockTime duration = GST_CLOCK_TIME_NONE,
+	    int size = 16);
+};
+
+#if GST_CHECK_VERSION(1,0,0)
+static GstFlowReturn chain(GstPad *pad, GstObject *parent, GstBuffer *buffer) {
+  Q_UNUSED(pad);
+  Q_UNUSED(parent);
+#else
+static GstFlowReturn chain(GstPad *pad, GstBuffer *buffer) {
+  Q_UNUSED(pad);
+#endif
+
+  gst_buffer_unref(buffer);
+  return GST_FLOW_OK;
+}
+
+#if GST_CHECK_VERSION(1,0,0)
+static GstFlowReturn slowChain(GstPad *pad, GstObject *parent, GstBuffer *buffer) {
+  Q_UNUSED(pad);
+  Q_UNUSED(parent);
+#else
+static GstFlowReturn slowChain(GstPad *pad, GstBuffer *buffer) {
+  Q_UNUSED(pad);
+#endif
+
+  // A slow disk.
+  g_usleep(50000);
+
+  gst_buffer_unref(buffer);
+  return GST_FLOW_OK;
+}
+
+void tst_recordingmonitor::initTestCase() {
+  gst_init(0, 0);
+}
+
+GstPad *tst_recordingmonitor::createPad(const char *name) {
+  GstPad *pad = gst_pad_new(name, GST_PAD_SINK);
+  gst_pad_set_chain_function(pad, chain);
+  gst_pad_set_active(pad, TRUE);
+  return pad;
+}
+
+GstPad *tst_recordingmonitor::createSource(GstPad *sink) {
+  GstPad *pad = gst_pad_new("src", GST_PAD_SRC);
+  gst_pad_set_active(pad, TRUE);
+  gst_pad_link(pad, sink);
+  return pad;
+}
+
+void tst_recordingmonitor::push(GstPad *pad, GstClockTime ts, GstClockTime duration, int size) {
+#if GST_CHECK_VERSION(1,0,0)
+  GstBuffer *buffer = gst_buffer_new_allocate(NULL, size, NULL);
+  GST_BUFFER_PTS(buffer) = ts;
+#else
+  GstBuffer *buffer = gst_buffer_new_and_alloc(size);
+  GST_BUFFER_TIMESTAMP(buffer) = ts;
+#endif
+  GST_BUFFER_DURATION(buffer) = duration;
+
+  if (GST_PAD_IS_SRC(pad)) {
+    QCOMPARE(gst_pad_push(pad, buffer), GST_FLOW_OK);
+  } else {
+    QCOMPARE(gst_pad_chain(pad, buffer), GST_FLOW_OK);
+  }
+}
+
+void tst_recordingmonitor::videoGaps() {
+  QtCamRecordingMonitor monitor;
+  monitor.start(GST_SECOND / 30);
+
+  GstPad *pad = createPad("video");
+  monitor.addPad(QtCamRecordingMonitor::VideoSource, (GstPad *)gst_object_ref(pad));
+
+  GstClockTime interval = GST_SECOND / 30;
+  for (int x = 0; x < 10; x++) {
+    push(pad, x * interval);
+  }
+
+  // Frames 10 to 12 never arrive.
+  for (int x = 13; x < 20; x++) {
+    push(pad, x * interval);
+  }
+
+  QtCamRecordingStats stats = monitor.stats();
+  QCOMPARE(stats.frames[QtCamRecordingStats::Source], (qint64)17);
+  QCOMPARE(stats.missingFrames[QtCamRecordingStats::Source], (qint64)3);
+  QCOMPARE(stats.frames[QtCamRecordingStats::Muxer], (qint64)0);
+  QCOMPARE(stats.longestFrameGap, 4 * interval);
+
+  monitor.stop();
+
+  // Nothing is counted once stopped.
+  push(pad, 20 * interval);
+  QCOMPARE(monitor.stats().frames[QtCamRecordingStats::Source], (qint64)17);
+
+  gst_object_unref(pad);
+}
+
+void tst_recordingmonitor::audioGaps() {
+  QtCamRecordingMonitor monitor;
+  monitor.start(GST_CLOCK_TIME_NONE);
+
+  GstPad *pad = createPad("audio");
+  monitor.addPad(QtCamRecordingMonitor::AudioSource, (GstPad *)gst_object_ref(pad));
+
+  GstClockTime duration = 20 * GST_MSECOND;
+  push(pad, 0, duration);
+  push(pad, duration, duration);
+  // A little jitter is fine.
+  push(pad, 2 * duration + GST_MSECOND, duration);
+  push(pad, 5 * duration, duration);
+
+  QtCamRecordingStats stats = monitor.stats();
+  QCOMPARE(stats.audioBuffers, (qint64)4);
+  QCOMPARE(stats.audioGaps, (qint64)1);
+  QCOMPARE(stats.audioMissing, 2 * duration - GST_MSECOND);
+
+  monitor.stop();
+
+  gst_object_unref(pad);
+}
+
+void tst_recordingmonitor::drift() {
+  QtCamRecordingMonitor monitor;
+  monitor.start(GST_SECOND / 30);
+
+  GstPad *video = createPad("video_0");
+  GstPad *audio = createPad("audio_0");
+  monitor.addPad(QtCamRecordingMonitor::VideoMuxer, (GstPad *)gst_object_ref(video));
+  monitor.addPad(QtCamRecordingMonitor::AudioMuxer, (GstPad *)gst_object_ref(audio));
+
+  // No audio yet.
+  push(video, 0);
+  QtCamRecordingStats stats = monitor.stats();
+  QVERIFY(stats.minAvDrift > stats.maxAvDrift);
+
+  push(audio, 100 * GST_MSECOND);
+  push(video, 40 * GST_MSECOND);
+  push(audio, 200 * GST_MSECOND);
+  push(video, 250 * GST_MSECOND);
+
+  stats = monitor.stats();
+  QCOMPARE(stats.frames[QtCamRecordingStats::Muxer], (qint64)3);
+  QCOMPARE(stats.avDrift, (GstClockTimeDiff)(50 * GST_MSECOND));
+  QCOMPARE(stats.minAvDrift, -(GstClockTimeDiff)(60 * GST_MSECOND));
+  QCOMPARE(stats.maxAvDrift, (GstClockTimeDiff)(50 * GST_MSECOND));
+
+  monitor.stop();
+
+  gst_object_unref(video);
+  gst_object_unref(audio);
+}
+
+void tst_recordingmonitor::summary() {
+  QtCamRecordingMonitor monitor;
+  monitor.start(GST_SECOND / 30);
+
+  GstPad *sink = createPad("sink");
+  GstPad *src = createSource(sink);
+  monitor.addPad(QtCamRecordingMonitor::Sink, (GstPad *)gst_object_ref(src));
+
+  push(src, GST_CLOCK_TIME_NONE, GST_CLOCK_TIME_NONE, 1000);
+  push(src, GST_CLOCK_TIME_NONE, GST_CLOCK_TIME_NONE, 24);
+
+  monitor.stop();
+
+  QTemporaryFile file;
+  QVERIFY(file.open());
+  QVERIFY(monitor.writeSummary(file.fileName()));
+
+  QStringList lines = QString::fromUtf8(file.readAll()).split('\n');
+  QVERIFY(lines.contains("bytes-written: 1024"));
+  QVERIFY(lines.contains("source-frames: 0"));
+  // No audio so no drift.
+  QVERIFY(!lines.contains("av-drift: 0"));
+
+  gst_object_unref(src);
+  gst_object_unref(sink);
+}
+
+void tst_recordingmonitor::writeStall() {
+  QtCamRecordingMonitor monitor;
+  monitor.start(GST_SECOND / 30);
+
+  GstPad *sink = createPad("sink");
+  gst_pad_set_chain_function(sink, slowChain);
+  GstPad *src = createSource(sink);
+  monitor.addPad(QtCamRecordingMonitor::Sink, (GstPad *)gst_object_ref(src));
+
+  push(src, GST_CLOCK_TIME_NONE);
+
+  // Idle between buffers is not a stall.
+  QTest::qWait(200);
+
+  push(src, GST_CLOCK_TIME_NONE);
+
+  monitor.stop();
+
+  qint64 stall = monitor.stats().longestWriteStall;
+#if GST_CHECK_VERSION(1,0,0)
+  QVERIFY(stall >= 50000);
+  QVERIFY(stall < 200000);
+#else
+  // Only the time between buffers.
+  QVERIFY(stall >= 200000);
+#endif
+
+  gst_object_unref(src);
+  gst_object_unref(sink);
+}
+
+QTEST_MAIN(tst_recordingmonitor);
+
+#include "tst_recordingmonitor.moc"
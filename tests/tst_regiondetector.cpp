@@ -0,0 +1,219 @@
+#include <QTest>
+#include <QDir>
+#include <QImage>
+#include <QDebug>
+#include <gst/gst.h>
+#include "qtcamgstsample.h"
+#include "qtcamlumaplane.h"
+#include "qtcamregiondetector.h"
+
+#define WIDTH  1280
+#define HEIGHT 720
+#define FRAMES 8
+
+class tst_regiondetector : public QObject {
+  Q_OBJECT
+
+private slots:
+  void initTestCase();
+  void cleanupTestCase();
+
+  void detect();
+  void throughput_data();
+  void throughput();
+  void recorded_data();
+  void recorded();
+
+private:
+  QtCamGstSample *createFrame(int seed, const QRect& detail);
+  QtCamGstSample *createSample(const QByteArray& data, int width, int height);
+  QtCamGstSample *loadFrame(const QString& fileName);
+
+  QList<QtCamGstSample *> m_frames;
+  QList<QtCamGstSample *> m_recorded;
+};
+
+void tst_regiondetector::initTestCase() {
+  gst_init(0, 0);
+
+  // A flat frame with a moving area of detail.
+  for (int x = 0; x < FRAMES; x++) {
+    m_frames << createFrame(x, QRect(200 + x * 20, 150, 240, 240));
+  }
+
+  // Viewfinder frames saved as images, e.g. video snapshots.
+  QByteArray dir = qgetenv("QTCAM_RECORDED_FRAMES");
+  if (!dir.isEmpty()) {
+    QDir frames(QString::fromLocal8Bit(dir));
+    QStringList filters = QStringList() << "*.jpg" << "*.jpeg" << "*.png";
+
+    foreach (const QString& file, frames.entryList(filters, QDir::Files, QDir::Name)) {
+      QtCamGstSample *sample = loadFrame(frames.filePath(file));
+      if (sample) {
+	m_recorded << sample;
+      }
+    }
+  }
+}
+
+void tst_regiondetector::cleanupTestCase() {
+  qDeleteAll(m_frames);
+  m_frames.clear();
+
+  qDeleteAll(m_recorded);
+  m_recorded.clear();
+}
+
+QtCamGstSample *tst_regiondetector::createFrame(int seed, const QRect& detail) {
+  int size = WIDTH * HEIGHT * 3 / 2;
+  QByteArray data(size, (char)128);
+
+  qsrand(seed);
+
+  for (int y = detail.top(); y <= detail.bottom(); y++) {
+    for (int x = detail.left(); x <= detail.right(); x++) {
+      data[y * WIDTH + x] = (char)((((x / 4) + (y / 4)) % 2) ? 230 : 20 + qrand() % 20);
+    }
+  }
+
+  return createSample(data, WIDTH, HEIGHT);
+}
+
+QtCamGstSample *tst_regiondetector::loadFrame(const QString& fileName) {
+  QImage image(fileName);
+  if (image.isNull()) {
+    qWarning() << "Cannot load" << fileName;
+    return 0;
+  }
+
+  // I420 wants even dimensions.
+  int width = image.width() & ~1;
+  int height = image.height() & ~1;
+  image = image.convertToFormat(QImage::Format_RGB32);
+
+  QByteArray data(width * height * 3 / 2, (char)128);
+
+  for (int y = 0; y < height; y++) {
+    const QRgb *line = (const QRgb *)image.constScanLine(y);
+    uchar *luma = (uchar *)data.data() + y * width;
+
+    for (int x = 0; x < width; x++) {
+      luma[x] = (qRed(line[x]) * 77 + qGreen(line[x]) * 150 + qBlue(line[x]) * 29) >> 8;
+    }
+  }
+
+  return createSample(data, width, height);
+}
+
+QtCamGstSample *tst_regiondetector::createSample(const QByteArray& data, int width, int height) {
+  int size = data.size();
+
+#if GST_CHECK_VERSION(1,0,0)
+  GstCaps *caps = gst_caps_new_simple("video/x-raw",
+				      "format", G_TYPE_STRING, "I420",
+				      "width", G_TYPE_INT, width,
+				      "height", G_TYPE_INT, height,
+				      "framerate", GST_TYPE_FRACTION, 30, 1,
+				      NULL);
+  GstBuffer *buffer = gst_buffer_new_allocate(NULL, size, NULL);
+  gst_buffer_fill(buffer, 0, data.constData(), size);
+#else
+  GstCaps *caps = gst_caps_new_simple("video/x-raw-yuv",
+				      "format", GST_TYPE_FOURCC, GST_MAKE_FOURCC('I', '4', '2', '0'),
+				      "width", G_TYPE_INT, width,
+				      "height", G_TYPE_INT, height,
+				      "framerate", GST_TYPE_FRACTION, 30, 1,
+				      NULL);
+  GstBuffer *buffer = gst_buffer_new_and_alloc(size);
+  memcpy(GST_BUFFER_DATA(buffer), data.constData(), size);
+#endif
+
+  QtCamGstSample *sample = new QtCamGstSample(buffer, caps);
+
+  gst_buffer_unref(buffer);
+  gst_caps_unref(caps);
+
+  return sample;
+}
+
+void tst_regiondetector::detect() {
+  QtCamLumaPlane plane;
+  QVERIFY(plane.scale(m_frames[0], 4));
+  QCOMPARE(plane.width(), WIDTH / 4);
+  QCOMPARE(plane.height(), HEIGHT / 4);
+
+  QList<QRect> regions = QtCamRegionDetector::findRegions(plane, 5);
+  QVERIFY(!regions.isEmpty());
+
+  // The best region must be inside the area of detail.
+  QRect detail(200 / 4, 150 / 4, 240 / 4, 240 / 4);
+  QVERIFY(detail.adjusted(-4, -4, 4, 4).contains(regions.first()));
+}
+
+void tst_regiondetector::throughput_data() {
+  QTest::addColumn<int>("factor");
+
+  QTest::newRow("1/4") << 4;
+  QTest::newRow("1/8") << 8;
+}
+
+void tst_regiondetector::throughput() {
+  QFETCH(int, factor);
+
+  QtCamLumaPlane plane;
+
+  QBENCHMARK {
+    foreach (QtCamGstSample *sample, m_frames) {
+      plane.scale(sample, factor);
+      QtCamRegionDetector::findRegions(plane, 5);
+    }
+  }
+}
+
+void tst_regiondetector::recorded_data() {
+  QTest::addColumn<int>("factor");
+
+  QTest::newRow("1/4") << 4;
+  QTest::newRow("1/8") << 8;
+}
+
+void tst_regiondetector::recorded() {
+  QFETCH(int, factor);
+
+  if (m_recorded.isEmpty()) {
+#if defined(QT4)
+    QSKIP("Set QTCAM_RECORDED_FRAMES to a directory of viewfinder frames", SkipAll);
+#else
+    QSKIP("Set QTCAM_RECORDED_FRAMES to a directory of viewfinder frames");
+#endif
+  }
+
+  QtCamLumaPlane plane;
+  int found = 0;
+
+  foreach (QtCamGstSample *sample, m_recorded) {
+    QVERIFY(plane.scale(sample, factor));
+
+    QList<QRect> regions = QtCamRegionDetector::findRegions(plane, 5);
+    QVERIFY(regions.size() <= 5);
+
+    foreach (const QRect& rect, regions) {
+      QVERIFY(QRect(0, 0, plane.width(), plane.height()).contains(rect));
+    }
+
+    found += regions.size();
+  }
+
+  qDebug() << found << "regions in" << m_recorded.size() << "recorded frames";
+
+  QBENCHMARK {
+    foreach (QtCamGstSample *sample, m_recorded) {
+      plane.scale(sample, factor);
+      QtCamRegionDetector::findRegions(plane, 5);
+    }
+  }
+}
+
+QTEST_APPLESS_MAIN(tst_regiondetector);
+
+#include "tst_regiondetector.moc"
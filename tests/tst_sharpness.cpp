@@ -0,0 +1,195 @@
+#include <QTest>
+#include <QVector>
+#include <cstring>
+#include "qtcamsharpness.h"
+#include "qtcamlumaplane.h"
+
+// Viewfinder size.
+#define WIDTH  1280
+#define HEIGHT 720
+
+class tst_sharpness : public QObject {
+  Q_OBJECT
+
+private slots:
+  void energy_data();
+  void energy();
+  void magnitude_data();
+  void magnitude();
+  void measure();
+  void saturation();
+  void benchmark_data();
+  void benchmark();
+
+private:
+  QVector<uchar> noise(int stride, int height, int seed);
+  quint64 scalarEnergy(const uchar *data, int width, int height, int stride);
+  void scalarMagnitude(const uchar *line, const uchar *below, uchar *out, int width);
+};
+
+QVector<uchar> tst_sharpness::noise(int stride, int height, int seed) {
+  QVector<uchar> data(stride * height);
+
+  qsrand(seed);
+
+  for (int x = 0; x < data.size(); x++) {
+    data[x] = qrand() & 0xff;
+  }
+
+  return data;
+}
+
+// Reference implementations. What the vectorized code must match.
+quint64 tst_sharpness::scalarEnergy(const uchar *data, int width, int height, int stride) {
+  quint64 sum = 0;
+
+  for (int y = 0; y + 1 < height; y++) {
+    const uchar *line = data + y * stride;
+    const uchar *below = line + stride;
+
+    for (int x = 0; x + 1 < width; x++) {
+      int dx = line[x + 1] - line[x];
+      int dy = below[x] - line[x];
+      sum += dx * dx + dy * dy;
+    }
+  }
+
+  return sum;
+}
+
+void tst_sharpness::scalarMagnitude(const uchar *line, const uchar *below, uchar *out, int width) {
+  for (int x = 0; x + 1 < width; x++) {
+    int m = qAbs(line[x + 1] - line[x]) + qAbs(below[x] - line[x]);
+    out[x] = m > 255 ? 255 : m;
+  }
+
+  if (width > 0) {
+    out[width - 1] = 0;
+  }
+}
+
+void tst_sharpness::energy_data() {
+  QTest::addColumn<int>("width");
+  QTest::addColumn<int>("height");
+  QTest::addColumn<int>("stride");
+
+  // Around the 8 and 16 pixel vector widths and their tails.
+  QTest::newRow("1x1") << 1 << 1 << 1;
+  QTest::newRow("2x2") << 2 << 2 << 2;
+  QTest::newRow("8x3") << 8 << 3 << 8;
+  QTest::newRow("9x3") << 9 << 3 << 9;
+  QTest::newRow("16x3") << 16 << 3 << 16;
+  QTest::newRow("17x3") << 17 << 3 << 17;
+  QTest::newRow("18x3") << 18 << 3 << 18;
+  QTest::newRow("33x5") << 33 << 5 << 33;
+  QTest::newRow("padded") << 100 << 40 << 128;
+  QTest::newRow("viewfinder") << WIDTH << HEIGHT << WIDTH;
+}
+
+void tst_sharpness::energy() {
+  QFETCH(int, width);
+  QFETCH(int, height);
+  QFETCH(int, stride);
+
+  QVector<uchar> data = noise(stride, height, width * height);
+
+  QCOMPARE(QtCamSharpness::gradientEnergy(data.constData(), width, height, stride),
+	   scalarEnergy(data.constData(), width, height, stride));
+}
+
+void tst_sharpness::magnitude_data() {
+  QTest::addColumn<int>("width");
+
+  QTest::newRow("1") << 1;
+  QTest::newRow("2") << 2;
+  QTest::newRow("16") << 16;
+  QTest::newRow("17") << 17;
+  QTest::newRow("18") << 18;
+  QTest::newRow("35") << 35;
+  QTest::newRow("viewfinder") << WIDTH;
+}
+
+void tst_sharpness::magnitude() {
+  QFETCH(int, width);
+
+  QVector<uchar> data = noise(width, 2, width);
+  QVector<uchar> out(width, 0xaa);
+  QVector<uchar> expected(width, 0xaa);
+
+  QtCamSharpness::gradientMagnitude(data.constData(), data.constData() + width,
+				    out.data(), width);
+  scalarMagnitude(data.constData(), data.constData() + width, expected.data(), width);
+
+  QVERIFY(out == expected);
+}
+
+void tst_sharpness::measure() {
+  QtCamLumaPlane plane;
+  plane.resize(WIDTH / 4, HEIGHT / 4, QSize(WIDTH, HEIGHT), 4);
+
+  QVector<uchar> data = noise(plane.width(), plane.height(), 1);
+  memcpy(plane.bits(), data.constData(), data.size());
+
+  double expected = (double)scalarEnergy(data.constData(), plane.width(), plane.height(),
+					 plane.width()) /
+    ((plane.width() - 1) * (plane.height() - 1));
+
+  QCOMPARE(QtCamSharpness::measure(plane), expected);
+
+  // A flat plane has no detail at all.
+  memset(plane.bits(), 100, plane.width() * plane.height());
+  QCOMPARE(QtCamSharpness::measure(plane), 0.0);
+}
+
+void tst_sharpness::saturation() {
+  // Worst case for the 16 bit differences and the 32 bit lanes.
+  int width = 4001;
+  int height = 3;
+  QVector<uchar> data(width * height);
+
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      data[y * width + x] = (x + y) % 2 ? 255 : 0;
+    }
+  }
+
+  QCOMPARE(QtCamSharpness::gradientEnergy(data.constData(), width, height, width),
+	   scalarEnergy(data.constData(), width, height, width));
+
+  QVector<uchar> out(width);
+  QVector<uchar> expected(width);
+  QtCamSharpness::gradientMagnitude(data.constData(), data.constData() + width,
+				    out.data(), width);
+  scalarMagnitude(data.constData(), data.constData() + width, expected.data(), width);
+
+  QVERIFY(out == expected);
+  QCOMPARE((int)out[0], 255);
+}
+
+void tst_sharpness::benchmark_data() {
+  QTest::addColumn<bool>("reference");
+
+  QTest::newRow("vectorized") << false;
+  QTest::newRow("scalar") << true;
+}
+
+void tst_sharpness::benchmark() {
+  QFETCH(bool, reference);
+
+  QVector<uchar> data = noise(WIDTH, HEIGHT, 2);
+
+  if (reference) {
+    QBENCHMARK {
+      scalarEnergy(data.constData(), WIDTH, HEIGHT, WIDTH);
+    }
+  }
+  else {
+    QBENCHMARK {
+      QtCamSharpness::gradientEnergy(data.constData(), WIDTH, HEIGHT, WIDTH);
+    }
+  }
+}
+
+QTEST_APPLESS_MAIN(tst_sharpness);
+
+#include "tst_sharpness.moc"
@@ -0,0 +1,168 @@
+#include <QTest>
+#include <gst/gst.h>
+#include "qtcamgstsample.h"
+#include "qtcamvideosnapshot.h"
+#include "qtcamjpegrotator.h"
+
+#define WIDTH  1920
+#define HEIGHT 1080
+
+class tst_videosnapshot : public QObject {
+  Q_OBJECT
+
+private slots:
+  void initTestCase();
+
+  void i420();
+  void nv12();
+  void truncated();
+  void exif();
+  void throughput();
+
+private:
+  QtCamGstSample *createFrame(const char *format, const QByteArray& data);
+  QByteArray i420Frame();
+  QByteArray nv12Frame();
+};
+
+void tst_videosnapshot::initTestCase() {
+  gst_init(0, 0);
+}
+
+QtCamGstSample *tst_videosnapshot::createFrame(const char *format, const QByteArray& data) {
+#if GST_CHECK_VERSION(1,0,0)
+  GstCaps *caps = gst_caps_new_simple("video/x-raw",
+				      "format", G_TYPE_STRING, format,
+				      "width", G_TYPE_INT, WIDTH,
+				      "height", G_TYPE_INT, HEIGHT,
+				      "framerate", GST_TYPE_FRACTION, 30, 1,
+				      NULL);
+  GstBuffer *buffer = gst_buffer_new_allocate(NULL, data.size(), NULL);
+  gst_buffer_fill(buffer, 0, data.constData(), data.size());
+#else
+  GstCaps *caps = gst_caps_new_simple("video/x-raw-yuv",
+				      "format", GST_TYPE_FOURCC,
+				      GST_MAKE_FOURCC(format[0], format[1], format[2], format[3]),
+				      "width", G_TYPE_INT, WIDTH,
+				      "height", G_TYPE_INT, HEIGHT,
+				      "framerate", GST_TYPE_FRACTION, 30, 1,
+				      NULL);
+  GstBuffer *buffer = gst_buffer_new_and_alloc(data.size());
+  memcpy(GST_BUFFER_DATA(buffer), data.constData(), data.size());
+#endif
+
+  QtCamGstSample *sample = new QtCamGstSample(buffer, caps);
+
+  gst_buffer_unref(buffer);
+  gst_caps_unref(caps);
+
+  return sample;
+}
+
+QByteArray tst_videosnapshot::i420Frame() {
+  // Top half black, bottom half white. Left half of the chroma is pushed to red.
+  QByteArray data(WIDTH * HEIGHT * 3 / 2, (char)128);
+
+  memset(data.data(), 16, WIDTH * HEIGHT / 2);
+  memset(data.data() + WIDTH * HEIGHT / 2, 235, WIDTH * HEIGHT / 2);
+
+  char *v = data.data() + WIDTH * HEIGHT * 5 / 4;
+  for (int y = 0; y < HEIGHT / 2; y++) {
+    memset(v + y * WIDTH / 2, 240, WIDTH / 4);
+  }
+
+  return data;
+}
+
+QByteArray tst_videosnapshot::nv12Frame() {
+  QByteArray data(WIDTH * HEIGHT * 3 / 2, (char)128);
+
+  memset(data.data(), 16, WIDTH * HEIGHT / 2);
+  memset(data.data() + WIDTH * HEIGHT / 2, 235, WIDTH * HEIGHT / 2);
+
+  char *uv = data.data() + WIDTH * HEIGHT;
+  for (int y = 0; y < HEIGHT / 2; y++) {
+    for (int x = 0; x < WIDTH / 4; x++) {
+      uv[y * WIDTH + x * 2 + 1] = (char)240;
+    }
+  }
+
+  return data;
+}
+
+void tst_videosnapshot::i420() {
+  QtCamGstSample *sample = createFrame("I420", i420Frame());
+  QImage image = QtCamVideoSnapshot::toImage(sample);
+  delete sample;
+
+  QCOMPARE(image.size(), QSize(WIDTH, HEIGHT));
+
+  QCOMPARE(image.pixel(WIDTH - 1, 0), qRgb(0, 0, 0));
+  QCOMPARE(image.pixel(WIDTH - 1, HEIGHT - 1), qRgb(255, 255, 255));
+
+  // BT.601: Y = 16, Cb = 128, Cr = 240
+  QCOMPARE(image.pixel(0, 0), qRgb(179, 0, 0));
+}
+
+void tst_videosnapshot::nv12() {
+  QtCamGstSample *s1 = createFrame("I420", i420Frame());
+  QtCamGstSample *s2 = createFrame("NV12", nv12Frame());
+
+  QImage i420 = QtCamVideoSnapshot::toImage(s1);
+  QImage nv12 = QtCamVideoSnapshot::toImage(s2);
+
+  delete s1;
+  delete s2;
+
+  QVERIFY(!nv12.isNull());
+  QVERIFY(nv12 == i420);
+}
+
+void tst_videosnapshot::truncated() {
+  QByteArray data = i420Frame();
+  data.truncate(WIDTH * HEIGHT);
+
+  QtCamGstSample *sample = createFrame("I420", data);
+  QVERIFY(QtCamVideoSnapshot::toImage(sample).isNull());
+  delete sample;
+}
+
+void tst_videosnapshot::exif() {
+  QVERIFY(QtCamVideoSnapshot::exifSegment(NULL).isEmpty());
+
+#if GST_CHECK_VERSION(1,0,0)
+  GstTagList *tags = gst_tag_list_new_empty();
+#else
+  GstTagList *tags = gst_tag_list_new();
+#endif
+  gst_tag_list_add(tags, GST_TAG_MERGE_REPLACE,
+		   GST_TAG_IMAGE_ORIENTATION, "rotate-90",
+		   GST_TAG_DEVICE_MODEL, "model",
+		   NULL);
+
+  QByteArray segment = QtCamVideoSnapshot::exifSegment(tags);
+#if GST_CHECK_VERSION(1,0,0)
+  gst_tag_list_unref(tags);
+#else
+  gst_tag_list_free(tags);
+#endif
+
+  QCOMPARE(segment.left(2), QByteArray("\xff\xe1", 2));
+  QCOMPARE(((uchar)segment[2] << 8) | (uchar)segment[3], segment.size() - 2);
+  QCOMPARE(segment.mid(4, 6), QByteArray("Exif\0\0", 6));
+  QCOMPARE(QtCamJpegRotator::orientationAngle(QList<QByteArray>() << segment), 90);
+}
+
+void tst_videosnapshot::throughput() {
+  QtCamGstSample *sample = createFrame("NV12", nv12Frame());
+
+  QBENCHMARK {
+    QtCamVideoSnapshot::toImage(sample);
+  }
+
+  delete sample;
+}
+
+QTEST_APPLESS_MAIN(tst_videosnapshot);
+
+#include "tst_videosnapshot.moc"